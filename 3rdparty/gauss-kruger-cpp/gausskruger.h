@@ -8,6 +8,8 @@
 #ifndef GAUSSKRUGER_H
 #define GAUSSKRUGER_H
 
+#include <cstddef>
+
 namespace gausskruger {
 
 class Projection
@@ -23,6 +25,13 @@ public:
     virtual double falseEasting() = 0;
     void geodeticToGrid(double latitude, double longitude, double& northing, double& easting);
     void gridToGeodetic(double northing, double easting, double& latitude, double& longitude);
+
+    // Convert count points at once. The projection parameters are read and
+    // the series coefficients computed only once per call.
+    void geodeticToGrid(const double* latitude, const double* longitude,
+                        double* northing, double* easting, std::size_t count);
+    void gridToGeodetic(const double* northing, const double* easting,
+                        double* latitude, double* longitude, std::size_t count);
 };
 
 } // namespace gausskruger
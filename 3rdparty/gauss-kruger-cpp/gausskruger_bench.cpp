@@ -0,0 +1,167 @@
+//          Copyright Erik Lundin 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Throughput and agreement of the projection implementations: the virtual
+// Projection one point per call and per batch, and StaticProjection one
+// point per call and per batch, in both directions. The batched results
+// are checked against Projection converting one point per call, the exit
+// status is 1 if any of them is off by more than the tolerance.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "gausskruger.h"
+#include "gausskruger_static.h"
+
+namespace {
+
+struct SWEREF99TM : gausskruger::GRS80
+{
+    static constexpr double centralMeridian() { return 15.0; }
+    static constexpr double scale() { return 0.9996; }
+    static constexpr double falseNorthing() { return 0.0; }
+    static constexpr double falseEasting() { return 500000.0; }
+};
+
+class DynamicSWEREF99TM : public gausskruger::Projection
+{
+public:
+    double flattening() { return SWEREF99TM::flattening(); }
+    double equatorialRadius() { return SWEREF99TM::equatorialRadius(); }
+    double centralMeridian() { return SWEREF99TM::centralMeridian(); }
+    double scale() { return SWEREF99TM::scale(); }
+    double falseNorthing() { return SWEREF99TM::falseNorthing(); }
+    double falseEasting() { return SWEREF99TM::falseEasting(); }
+};
+
+typedef gausskruger::StaticProjection<SWEREF99TM> StaticSWEREF99TM;
+
+const double gridTolerance = 0.0001;      // metres
+const double degreeTolerance = 0.000000001; // about 0.1 mm
+
+typedef std::chrono::steady_clock Clock;
+
+// Keeps the one point per call loops from being vectorized, so they
+// measure what a caller converting single points gets.
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline))
+#endif
+void staticToGrid(double latitude, double longitude, double& northing, double& easting)
+{
+    StaticSWEREF99TM::geodeticToGrid(latitude, longitude, northing, easting);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline))
+#endif
+void staticToGeodetic(double northing, double easting, double& latitude, double& longitude)
+{
+    StaticSWEREF99TM::gridToGeodetic(northing, easting, latitude, longitude);
+}
+
+template <class Function>
+void measure(const char* name, std::size_t points, Function function)
+{
+    const Clock::time_point start = Clock::now();
+    function();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%-34s %8.3f s %10.2f Mpoints/s\n", name, seconds, points / seconds / 1e6);
+}
+
+double maxDifference(const std::vector<double>& a, const std::vector<double>& b)
+{
+    double result = 0;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        result = std::max(result, std::fabs(a[i] - b[i]));
+    return result;
+}
+
+bool check(const char* name, double difference, double tolerance)
+{
+    const bool ok = difference <= tolerance;
+    std::printf("%-34s max difference %.3g (tolerance %.3g) %s\n", name, difference, tolerance, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const std::size_t points = argc > 1 ? std::strtoul(argv[1], 0, 10) : 4000000;
+    if (points == 0) {
+        std::fprintf(stderr, "Usage: gausskruger_bench [points]\n");
+        return 2;
+    }
+
+    // Synthetic points covering Sweden, from a fixed seed so runs compare
+    std::vector<double> latitude(points);
+    std::vector<double> longitude(points);
+    unsigned long long state = 88172645463325252ULL;
+    for (std::size_t i = 0; i < points; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        latitude[i] = 55.0 + 14.0 * (state % 1000000) / 1000000.0;
+        longitude[i] = 10.5 + 13.5 * ((state / 1000000) % 1000000) / 1000000.0;
+    }
+
+    DynamicSWEREF99TM dynamic;
+    std::vector<double> northing(points), easting(points);
+    std::vector<double> batchNorthing(points), batchEasting(points);
+    std::vector<double> staticNorthing(points), staticEasting(points);
+    std::vector<double> staticBatchNorthing(points), staticBatchEasting(points);
+
+    std::printf("%lu points\n\nGeodetic to grid\n", static_cast<unsigned long>(points));
+    measure("Projection, per point", points, [&]() {
+        for (std::size_t i = 0; i < points; ++i)
+            dynamic.geodeticToGrid(latitude[i], longitude[i], northing[i], easting[i]);
+    });
+    measure("Projection, batch", points, [&]() {
+        dynamic.geodeticToGrid(&latitude[0], &longitude[0], &batchNorthing[0], &batchEasting[0], points);
+    });
+    measure("StaticProjection, per point", points, [&]() {
+        for (std::size_t i = 0; i < points; ++i)
+            staticToGrid(latitude[i], longitude[i], staticNorthing[i], staticEasting[i]);
+    });
+    measure("StaticProjection, batch", points, [&]() {
+        StaticSWEREF99TM::geodeticToGrid(&latitude[0], &longitude[0], &staticBatchNorthing[0], &staticBatchEasting[0], points);
+    });
+
+    std::vector<double> backLatitude(points), backLongitude(points);
+    std::vector<double> batchLatitude(points), batchLongitude(points);
+    std::vector<double> staticLatitude(points), staticLongitude(points);
+    std::vector<double> staticBatchLatitude(points), staticBatchLongitude(points);
+
+    std::printf("\nGrid to geodetic\n");
+    measure("Projection, per point", points, [&]() {
+        for (std::size_t i = 0; i < points; ++i)
+            dynamic.gridToGeodetic(northing[i], easting[i], backLatitude[i], backLongitude[i]);
+    });
+    measure("Projection, batch", points, [&]() {
+        dynamic.gridToGeodetic(&northing[0], &easting[0], &batchLatitude[0], &batchLongitude[0], points);
+    });
+    measure("StaticProjection, per point", points, [&]() {
+        for (std::size_t i = 0; i < points; ++i)
+            staticToGeodetic(northing[i], easting[i], staticLatitude[i], staticLongitude[i]);
+    });
+    measure("StaticProjection, batch", points, [&]() {
+        StaticSWEREF99TM::gridToGeodetic(&northing[0], &easting[0], &staticBatchLatitude[0], &staticBatchLongitude[0], points);
+    });
+
+    std::printf("\nAgreement with Projection, per point\n");
+    bool ok = true;
+    ok &= check("Projection, batch: grid", std::max(maxDifference(northing, batchNorthing), maxDifference(easting, batchEasting)), gridTolerance);
+    ok &= check("StaticProjection: grid", std::max(maxDifference(northing, staticNorthing), maxDifference(easting, staticEasting)), gridTolerance);
+    ok &= check("StaticProjection, batch: grid", std::max(maxDifference(northing, staticBatchNorthing), maxDifference(easting, staticBatchEasting)), gridTolerance);
+    ok &= check("Projection, batch: geodetic", std::max(maxDifference(backLatitude, batchLatitude), maxDifference(backLongitude, batchLongitude)), degreeTolerance);
+    ok &= check("StaticProjection: geodetic", std::max(maxDifference(backLatitude, staticLatitude), maxDifference(backLongitude, staticLongitude)), degreeTolerance);
+    ok &= check("StaticProjection, batch: geodetic", std::max(maxDifference(backLatitude, staticBatchLatitude), maxDifference(backLongitude, staticBatchLongitude)), degreeTolerance);
+    ok &= check("Round trip", std::max(maxDifference(latitude, staticBatchLatitude), maxDifference(longitude, staticBatchLongitude)), degreeTolerance);
+
+    return ok ? 0 : 1;
+}
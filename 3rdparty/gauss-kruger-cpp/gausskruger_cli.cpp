@@ -7,6 +7,7 @@
 #include <iomanip>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 #include <vector>
 #include <boost/program_options.hpp>
 
@@ -43,6 +44,94 @@ private:
     double mFalseEasting;
 };
 
+// Lines are converted in blocks of this many, which keeps the projection
+// parameters and coefficients out of the per point work.
+static const std::size_t csvBlockSize = 4096;
+
+struct CsvLine
+{
+    std::string line;
+    bool converted;
+    std::string::size_type rest; // start of the columns after the coordinates
+};
+
+// Parses "a,b[,...]". Returns false for lines not starting with two
+// numbers, like headers, which are copied to the output as they are.
+static bool parseCsvLine(CsvLine& csvLine, double& a, double& b)
+{
+    const char* begin = csvLine.line.c_str();
+    char* end;
+    a = strtod(begin, &end);
+    if (end == begin || *end != ',')
+        return false;
+    const char* second = end + 1;
+    b = strtod(second, &end);
+    if (end == second || (*end != ',' && *end != '\0' && *end != '\r'))
+        return false;
+    csvLine.rest = end - begin;
+    return true;
+}
+
+static void writeCsvBlock(std::vector<CsvLine>& lines, std::vector<double>& a, std::vector<double>& b,
+                          std::size_t points, Projection& projection, bool reverse)
+{
+    std::vector<double> outA(points);
+    std::vector<double> outB(points);
+    if (points > 0) {
+        if (reverse)
+            projection.gridToGeodetic(&a[0], &b[0], &outA[0], &outB[0], points);
+        else
+            projection.geodeticToGrid(&a[0], &b[0], &outA[0], &outB[0], points);
+    }
+
+    std::size_t point = 0;
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        const CsvLine& csvLine = lines[i];
+        if (csvLine.converted) {
+            std::cout << outA[point] << ',' << outB[point];
+            std::cout.write(csvLine.line.data() + csvLine.rest, csvLine.line.size() - csvLine.rest);
+            ++point;
+        } else {
+            std::cout << csvLine.line;
+        }
+        std::cout << '\n';
+    }
+}
+
+// Converts CSV from stdin to stdout. The first two columns are the
+// coordinates, any further columns are passed through.
+static void convertCsv(Projection& projection, bool reverse)
+{
+    std::ios::sync_with_stdio(false);
+
+    std::vector<CsvLine> lines;
+    std::vector<double> a;
+    std::vector<double> b;
+    lines.reserve(csvBlockSize);
+    a.reserve(csvBlockSize);
+    b.reserve(csvBlockSize);
+
+    CsvLine csvLine;
+    while (std::getline(std::cin, csvLine.line)) {
+        double first, second;
+        csvLine.converted = parseCsvLine(csvLine, first, second);
+        if (csvLine.converted) {
+            a.push_back(first);
+            b.push_back(second);
+        }
+        lines.push_back(csvLine);
+
+        if (lines.size() == csvBlockSize) {
+            writeCsvBlock(lines, a, b, a.size(), projection, reverse);
+            lines.clear();
+            a.clear();
+            b.clear();
+        }
+    }
+    writeCsvBlock(lines, a, b, a.size(), projection, reverse);
+    std::cout.flush();
+}
+
 int main(int argc, char *argv[])
 {
     double inverseFlattening;
@@ -79,6 +168,9 @@ int main(int argc, char *argv[])
                 ("decimals,d", po::value<int>(&nDecimals)->default_value(3), "number of decimals")
                 ("reverse,r",
                         "reverse transformation (grid to geodetic), default is geodetic to grid")
+                ("csv,c",
+                        "convert CSV lines \"latitude,longitude[,...]\" (or \"northing,easting[,...]\" with -r) "
+                        "from stdin to stdout, further columns are passed through")
                 ;
 
         // Positional parameters (input coordinates)
@@ -102,6 +194,7 @@ int main(int argc, char *argv[])
         if (argc == 1 || vm.count("help")) {
             std::cout << "Usage: " << EXE_NAME << " <projection> [options] latitude longitude\n"
                       << "       " << EXE_NAME << " <projection> [options] -r northing easting\n"
+                      << "       " << EXE_NAME << " <projection> [options] [-r] -c < input.csv\n"
                       << visible_parameters << std::endl;
             return 1;
         }
@@ -112,7 +205,7 @@ int main(int argc, char *argv[])
             std::cout << "Missing mandatory projection parameter(s)" << std::endl;
             return 2;
         }
-        if (coords.size() != 2) {
+        if (!vm.count("csv") && coords.size() != 2) {
             std::cerr << "Exactly two coordinate values have to be entered" << std::endl;
             return 3;
         }
@@ -124,7 +217,9 @@ int main(int argc, char *argv[])
         // Do the actual transformation
         ParameterProjection projection(1 / inverseFlattening, equatorialRadius,
                 centralMeridian, scale, falseNorthing, falseEasting);
-        if (vm.count("reverse")) {
+        if (vm.count("csv")) {
+            convertCsv(projection, vm.count("reverse"));
+        } else if (vm.count("reverse")) {
             double lat, lon;
             projection.gridToGeodetic(coords.at(0), coords.at(1), lat, lon);
             std::cout << std::fixed << "Latitude: " << lat << "\nLongitude: " << lon << std::endl;
@@ -0,0 +1,320 @@
+//          Copyright Erik Lundin 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+// Version: 1.0.0
+
+#ifndef GAUSSKRUGER_STATIC_H
+#define GAUSSKRUGER_STATIC_H
+
+// Compile time specialized counterpart of gausskruger::Projection, for
+// callers that know their projection when compiling and convert many
+// points at once. Requires C++11.
+//
+// A projection is described by a struct with the same members as the
+// virtual getters of Projection, only static and constexpr:
+//
+//     struct SWEREF99TM : gausskruger::GRS80
+//     {
+//         static constexpr double centralMeridian() { return 15.0; }
+//         static constexpr double scale() { return 0.9996; }
+//         static constexpr double falseNorthing() { return 0.0; }
+//         static constexpr double falseEasting() { return 500000.0; }
+//     };
+//
+//     gausskruger::StaticProjection<SWEREF99TM>::geodeticToGrid(lat, lon, n, e);
+//
+// All series coefficients are folded into constants by the compiler. The
+// multiple angle terms of the Krüger series are built by angle addition,
+// so a point takes six calls to the transcendental functions instead of
+// the twenty odd of Projection. The batch overloads
+// take plain arrays and run a branch free loop over them which compilers
+// can vectorize (GCC does with -O3 -ffast-math, or -fopenmp-simd and
+// GAUSSKRUGER_SIMD defined).
+
+#include <cmath>
+#include <cstddef>
+
+#ifdef __QNX__
+// This line is needed to avoid compilation errors on BlackBerry 10
+using namespace std;
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GAUSSKRUGER_RESTRICT __restrict__
+#else
+#define GAUSSKRUGER_RESTRICT
+#endif
+
+#if defined(GAUSSKRUGER_SIMD) || defined(_OPENMP)
+#define GAUSSKRUGER_SIMD_LOOP _Pragma("omp simd")
+#else
+#define GAUSSKRUGER_SIMD_LOOP
+#endif
+
+namespace gausskruger {
+
+struct GRS80
+{
+    static constexpr double flattening() { return 1 / 298.257222101; }
+    static constexpr double equatorialRadius() { return 6378137.0; }
+};
+
+struct WGS84
+{
+    static constexpr double flattening() { return 1 / 298.257223563; }
+    static constexpr double equatorialRadius() { return 6378137.0; }
+};
+
+struct Bessel1841
+{
+    static constexpr double flattening() { return 1 / 299.1528128; }
+    static constexpr double equatorialRadius() { return 6377397.155; }
+};
+
+// German Gauss-Krüger zones on the Bessel ellipsoid (DHDN), three degrees
+// wide, the zone number prefixes the easting.
+template <int Zone>
+struct GaussKrugerZone : Bessel1841
+{
+    static constexpr double centralMeridian() { return 3.0 * Zone; }
+    static constexpr double scale() { return 1.0; }
+    static constexpr double falseNorthing() { return 0.0; }
+    static constexpr double falseEasting() { return Zone * 1000000.0 + 500000.0; }
+};
+
+// UTM zones of the northern hemisphere.
+template <int Zone, class Ellipsoid = WGS84>
+struct UTMZone : Ellipsoid
+{
+    static constexpr double centralMeridian() { return 6.0 * Zone - 183.0; }
+    static constexpr double scale() { return 0.9996; }
+    static constexpr double falseNorthing() { return 0.0; }
+    static constexpr double falseEasting() { return 500000.0; }
+};
+
+namespace detail {
+
+// The constants Projection::geodeticToGrid() and gridToGeodetic() derive
+// from the ellipsoid on every call.
+template <class Grid>
+struct Coefficients
+{
+    static constexpr double pi = 3.14159265358979323846;
+    static constexpr double degree = pi / 180;
+
+    static constexpr double f = Grid::flattening();
+    static constexpr double e2 = f * (2 - f); // e2: first eccentricity squared
+    static constexpr double n = f / (2 - f); // n: 3rd flattening
+    static constexpr double n2 = n * n;
+    static constexpr double n3 = n2 * n;
+    static constexpr double n4 = n3 * n;
+    static constexpr double rectifyingRadius = Grid::equatorialRadius() / (1 + n) * (1 + 0.25 * n2 + 0.015625 * n4);
+    static constexpr double radius = Grid::scale() * rectifyingRadius;
+
+    static constexpr double lambda0 = Grid::centralMeridian() * degree;
+
+    static constexpr double A = e2;
+    static constexpr double B = (5 * e2 * e2 - e2 * e2 * e2) / 6.0;
+    static constexpr double C = (104 * e2 * e2 * e2 - 45 * e2 * e2 * e2 * e2) / 120.0;
+    static constexpr double D = (1237 * e2 * e2 * e2 * e2) / 1260.0;
+
+    static constexpr double beta1 = 1/2.0 * n - 2/3.0 * n2 + 5/16.0 * n3     + 41/180.0 * n4;
+    static constexpr double beta2 =           13/48.0 * n2  - 3/5.0 * n3   + 557/1440.0 * n4;
+    static constexpr double beta3 =                         61/240.0 * n3    - 103/140.0 * n4;
+    static constexpr double beta4 =                                      49561/161280.0 * n4;
+
+    static constexpr double delta1 = 1/2.0 * n - 2/3.0 * n2 + 37/96.0 * n3     - 1/360.0 * n4;
+    static constexpr double delta2 =            1/48.0 * n2  + 1/15.0 * n3  - 437/1440.0 * n4;
+    static constexpr double delta3 =                         17/480.0 * n3    - 37/840.0 * n4;
+    static constexpr double delta4 =                                      4397/161280.0 * n4;
+
+    static constexpr double AStar =  e2     + e2 * e2        + e2 * e2 * e2        + e2 * e2 * e2 * e2;
+    static constexpr double BStar =      (7 * e2 * e2   + 17 * e2 * e2 * e2   + 30 * e2 * e2 * e2 * e2) / -6;
+    static constexpr double CStar =                       (224 * e2 * e2 * e2  + 889 * e2 * e2 * e2 * e2) / 120;
+    static constexpr double DStar =                                          (4279 * e2 * e2 * e2 * e2) / -1260;
+};
+
+template <class Grid> constexpr double Coefficients<Grid>::pi;
+template <class Grid> constexpr double Coefficients<Grid>::degree;
+template <class Grid> constexpr double Coefficients<Grid>::f;
+template <class Grid> constexpr double Coefficients<Grid>::e2;
+template <class Grid> constexpr double Coefficients<Grid>::n;
+template <class Grid> constexpr double Coefficients<Grid>::n2;
+template <class Grid> constexpr double Coefficients<Grid>::n3;
+template <class Grid> constexpr double Coefficients<Grid>::n4;
+template <class Grid> constexpr double Coefficients<Grid>::rectifyingRadius;
+template <class Grid> constexpr double Coefficients<Grid>::radius;
+template <class Grid> constexpr double Coefficients<Grid>::lambda0;
+template <class Grid> constexpr double Coefficients<Grid>::A;
+template <class Grid> constexpr double Coefficients<Grid>::B;
+template <class Grid> constexpr double Coefficients<Grid>::C;
+template <class Grid> constexpr double Coefficients<Grid>::D;
+template <class Grid> constexpr double Coefficients<Grid>::beta1;
+template <class Grid> constexpr double Coefficients<Grid>::beta2;
+template <class Grid> constexpr double Coefficients<Grid>::beta3;
+template <class Grid> constexpr double Coefficients<Grid>::beta4;
+template <class Grid> constexpr double Coefficients<Grid>::delta1;
+template <class Grid> constexpr double Coefficients<Grid>::delta2;
+template <class Grid> constexpr double Coefficients<Grid>::delta3;
+template <class Grid> constexpr double Coefficients<Grid>::delta4;
+template <class Grid> constexpr double Coefficients<Grid>::AStar;
+template <class Grid> constexpr double Coefficients<Grid>::BStar;
+template <class Grid> constexpr double Coefficients<Grid>::CStar;
+template <class Grid> constexpr double Coefficients<Grid>::DStar;
+
+// Evaluates sum(c_k * sin(2k*xi) * cosh(2k*eta)) and
+// sum(c_k * cos(2k*xi) * sinh(2k*eta)) for k = 1..4, given tan(xi) with
+// |xi| < pi/2. The multiples are built by angle addition from the double
+// angle of tan(xi) and exp(2*eta), so this takes a single call to a
+// transcendental function.
+inline void kruegerSeries(double tanXi, double eta, double c1, double c2, double c3, double c4,
+                          double& sumSinCosh, double& sumCosSinh)
+{
+    const double t2 = tanXi * tanXi;
+    const double s1 = 2 * tanXi / (1 + t2);
+    const double k1 = (1 - t2) / (1 + t2);
+    const double e = exp(2 * eta);
+    const double sh1 = 0.5 * (e - 1 / e);
+    const double ch1 = 0.5 * (e + 1 / e);
+
+    const double s2 = 2 * s1 * k1;
+    const double k2 = k1 * k1 - s1 * s1;
+    const double sh2 = 2 * sh1 * ch1;
+    const double ch2 = ch1 * ch1 + sh1 * sh1;
+
+    const double s3 = s2 * k1 + k2 * s1;
+    const double k3 = k2 * k1 - s2 * s1;
+    const double sh3 = sh2 * ch1 + ch2 * sh1;
+    const double ch3 = ch2 * ch1 + sh2 * sh1;
+
+    const double s4 = 2 * s2 * k2;
+    const double k4 = k2 * k2 - s2 * s2;
+    const double sh4 = 2 * sh2 * ch2;
+    const double ch4 = ch2 * ch2 + sh2 * sh2;
+
+    sumSinCosh = c1 * s1 * ch1 + c2 * s2 * ch2 + c3 * s3 * ch3 + c4 * s4 * ch4;
+    sumCosSinh = c1 * k1 * sh1 + c2 * k2 * sh2 + c3 * k3 * sh3 + c4 * k4 * sh4;
+}
+
+} // namespace detail
+
+// The kernels never take sine and cosine of the same angle: the cosine
+// of an angle within +-90 degrees follows from its sine, and GCC would
+// otherwise fuse the pair into sincos(), which it cannot vectorize.
+// Points are expected within 90 degrees of the central meridian.
+template <class Grid>
+class StaticProjection
+{
+    typedef detail::Coefficients<Grid> K;
+
+public:
+    static void geodeticToGrid(double latitude, double longitude, double& northing, double& easting)
+    {
+        // Latitude and longitude are expected to be given in degrees
+        const double phi = latitude * K::degree;
+        const double deltaLambda = longitude * K::degree - K::lambda0;
+
+        // phiStar: conformal latitude
+        const double sinPhi = sin(phi);
+        const double sinPhi2 = sinPhi * sinPhi;
+        const double cosPhi = sqrt(1 - sinPhi2);
+        const double phiStar = phi - sinPhi * cosPhi * (K::A + sinPhi2 * (K::B + sinPhi2 * (K::C + sinPhi2 * K::D)));
+
+        const double sinPhiStar = sin(phiStar);
+        const double cosPhiStar = sqrt(1 - sinPhiStar * sinPhiStar);
+        const double sinDeltaLambda = sin(deltaLambda);
+        const double cosDeltaLambda = sqrt(1 - sinDeltaLambda * sinDeltaLambda);
+
+        const double tanXiPrim = sinPhiStar / (cosPhiStar * cosDeltaLambda);
+        const double xiPrim = atan(tanXiPrim);
+        const double etaPrim = atanh(cosPhiStar * sinDeltaLambda);
+
+        double sumSinCosh, sumCosSinh;
+        detail::kruegerSeries(tanXiPrim, etaPrim, K::beta1, K::beta2, K::beta3, K::beta4, sumSinCosh, sumCosSinh);
+
+        northing = Grid::falseNorthing() + K::radius * (xiPrim + sumSinCosh);
+        easting = Grid::falseEasting() + K::radius * (etaPrim + sumCosSinh);
+    }
+
+    static void gridToGeodetic(double northing, double easting, double& latitude, double& longitude)
+    {
+        const double xi = (northing - Grid::falseNorthing()) / K::radius;
+        const double eta = (easting - Grid::falseEasting()) / K::radius;
+
+        double sumSinCosh, sumCosSinh;
+        detail::kruegerSeries(tan(xi), eta, K::delta1, K::delta2, K::delta3, K::delta4, sumSinCosh, sumCosSinh);
+        const double xiPrim = xi - sumSinCosh;
+        const double etaPrim = eta - sumCosSinh;
+
+        const double e = exp(etaPrim);
+        const double sinhEtaPrim = 0.5 * (e - 1 / e);
+        const double coshEtaPrim = 0.5 * (e + 1 / e);
+
+        const double sinXiPrim = sin(xiPrim);
+        const double cosXiPrim = sqrt(1 - sinXiPrim * sinXiPrim);
+
+        const double sinPhiStar = sinXiPrim / coshEtaPrim;
+        const double sinPhiStar2 = sinPhiStar * sinPhiStar;
+        const double phiStar = asin(sinPhiStar); // Conformal latitude
+        const double deltaLambda = atan(sinhEtaPrim / cosXiPrim);
+
+        const double phi = phiStar + sinPhiStar * sqrt(1 - sinPhiStar2)
+                * (K::AStar + sinPhiStar2 * (K::BStar + sinPhiStar2 * (K::CStar + sinPhiStar2 * K::DStar)));
+
+        // Return latitude and longitude as degrees
+        latitude = phi / K::degree;
+        longitude = Grid::centralMeridian() + deltaLambda / K::degree;
+    }
+
+    // Projects count points. Output arrays may be the input arrays for an
+    // in place conversion, other than that they must not overlap.
+    static void geodeticToGrid(const double* latitude, const double* longitude,
+                               double* northing, double* easting, std::size_t count)
+    {
+        if (aliased(latitude, longitude, northing, easting)) {
+            for (std::size_t i = 0; i < count; ++i)
+                geodeticToGrid(latitude[i], longitude[i], northing[i], easting[i]);
+            return;
+        }
+        batchGeodeticToGrid(latitude, longitude, northing, easting, count);
+    }
+
+    static void gridToGeodetic(const double* northing, const double* easting,
+                               double* latitude, double* longitude, std::size_t count)
+    {
+        if (aliased(northing, easting, latitude, longitude)) {
+            for (std::size_t i = 0; i < count; ++i)
+                gridToGeodetic(northing[i], easting[i], latitude[i], longitude[i]);
+            return;
+        }
+        batchGridToGeodetic(northing, easting, latitude, longitude, count);
+    }
+
+private:
+    static bool aliased(const double* in1, const double* in2, const double* out1, const double* out2)
+    {
+        return in1 == out1 || in1 == out2 || in2 == out1 || in2 == out2;
+    }
+
+    static void batchGeodeticToGrid(const double* GAUSSKRUGER_RESTRICT latitude, const double* GAUSSKRUGER_RESTRICT longitude,
+                                    double* GAUSSKRUGER_RESTRICT northing, double* GAUSSKRUGER_RESTRICT easting, std::size_t count)
+    {
+        GAUSSKRUGER_SIMD_LOOP
+        for (std::size_t i = 0; i < count; ++i)
+            geodeticToGrid(latitude[i], longitude[i], northing[i], easting[i]);
+    }
+
+    static void batchGridToGeodetic(const double* GAUSSKRUGER_RESTRICT northing, const double* GAUSSKRUGER_RESTRICT easting,
+                                    double* GAUSSKRUGER_RESTRICT latitude, double* GAUSSKRUGER_RESTRICT longitude, std::size_t count)
+    {
+        GAUSSKRUGER_SIMD_LOOP
+        for (std::size_t i = 0; i < count; ++i)
+            gridToGeodetic(northing[i], easting[i], latitude[i], longitude[i]);
+    }
+};
+
+} // namespace gausskruger
+
+#endif // GAUSSKRUGER_STATIC_H
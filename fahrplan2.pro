@@ -52,7 +52,7 @@ QML_IMPORT_PATH =
 
 QT += network xml
 lessThan(QT_MAJOR_VERSION, 5) {
-    QT += declarative script
+    QT += declarative
 } else {
     QT += quick qml concurrent
     DEFINES += BUILD_FOR_QT5
@@ -107,6 +107,12 @@ HEADERS += \
     src/calendarthreadwrapper.h \
     src/calendar_sfos_wrapper.h \
     src/fahrplan_parser_thread.h \
+    src/fahrplan_network_thread.h \
+    src/fahrplan_request_timings.h \
+    src/fahrplan_trace.h \
+    src/fahrplan_station_index.h \
+    src/fahrplan_merged_board.h \
+    src/fahrplan_log.h \
     src/fahrplan_calendar_manager.h \
     src/models/backends.h \
     src/models/stationslistmodel.h \
@@ -115,6 +121,8 @@ HEADERS += \
     src/models/recentstations.h \
     src/models/timetable.h \
     src/models/trainrestrictions.h \
+    src/models/requeststatistics.h \
+    src/models/bandwidthstatistics.h \
     src/parser/parser_xmlnri.h \
     src/parser/parser_hafasbinary.h \
     src/parser/parser_movas_bahnde.h \
@@ -130,12 +138,23 @@ HEADERS += \
     src/parser/parser_vrr_efa.h \
     src/parser/parser_hafasxml.h \
     src/parser/parser_abstract.h \
+    src/parser/parser_json.h \
+    src/parser/parser_stringpool.h \
+    src/parser/parser_coordinates.h \
+    src/parser/parser_datetime.h \
+    src/parser/parser_hafaslocationid.h \
+    src/parser/parser_regexps.h \
     src/parser/parser_definitions.h \
     src/parser/parser_xmlrejseplanendk.h \
     src/parser/parser_xmloebbat.h \
     src/parser/parser_xmlvasttrafikse.h \
     src/parser/parser_search_ch.h \
-    src/parser/parser_trentino.h
+    src/parser/parser_trentino.h \
+    src/parser/parser_gtfs.h \
+    src/parser/parser_gtfs_importer.h \
+    src/parser/parser_gtfs_realtime.h \
+    src/parser/parser_gtfs_router.h \
+    src/parser/parser_gtfs_timetable.h
 
 SOURCES += src/main.cpp \
     src/fahrplan.cpp \
@@ -143,6 +162,12 @@ SOURCES += src/main.cpp \
     src/calendarthreadwrapper.cpp \
     src/calendar_sfos_wrapper.cpp \
     src/fahrplan_parser_thread.cpp \
+    src/fahrplan_network_thread.cpp \
+    src/fahrplan_request_timings.cpp \
+    src/fahrplan_trace.cpp \
+    src/fahrplan_station_index.cpp \
+    src/fahrplan_merged_board.cpp \
+    src/fahrplan_log.cpp \
     src/fahrplan_calendar_manager.cpp \
     src/models/backends.cpp \
     src/models/stationslistmodel.cpp \
@@ -151,6 +176,8 @@ SOURCES += src/main.cpp \
     src/models/recentstations.cpp \
     src/models/timetable.cpp \
     src/models/trainrestrictions.cpp \
+    src/models/requeststatistics.cpp \
+    src/models/bandwidthstatistics.cpp \
     src/parser/parser_movas_bahnde.cpp \
     src/parser/parser_xmlnri.cpp \
     src/parser/parser_hafasbinary.cpp \
@@ -166,12 +193,23 @@ SOURCES += src/main.cpp \
     src/parser/parser_vrr_efa.cpp \
     src/parser/parser_hafasxml.cpp \
     src/parser/parser_abstract.cpp \
+    src/parser/parser_json.cpp \
+    src/parser/parser_stringpool.cpp \
+    src/parser/parser_coordinates.cpp \
+    src/parser/parser_datetime.cpp \
+    src/parser/parser_hafaslocationid.cpp \
+    src/parser/parser_regexps.cpp \
     src/parser/parser_definitions.cpp \
     src/parser/parser_xmlrejseplanendk.cpp \
     src/parser/parser_xmloebbat.cpp \
     src/parser/parser_xmlvasttrafikse.cpp \
     src/parser/parser_search_ch.cpp \
-    src/parser/parser_trentino.cpp
+    src/parser/parser_trentino.cpp \
+    src/parser/parser_gtfs.cpp \
+    src/parser/parser_gtfs_importer.cpp \
+    src/parser/parser_gtfs_realtime.cpp \
+    src/parser/parser_gtfs_router.cpp \
+    src/parser/parser_gtfs_timetable.cpp
 
 
 LIBS += $$PWD/3rdparty/gauss-kruger-cpp/gausskruger.cpp
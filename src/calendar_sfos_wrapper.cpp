@@ -18,6 +18,8 @@
 ****************************************************************************/
 
 #include "calendar_sfos_wrapper.h"
+#include "fahrplan_trace.h"
+#include "fahrplan_log.h"
 
 #include <QCoreApplication>
 #include <QThread>
@@ -77,6 +79,7 @@ formatStations(item->arrivalDateTime(), item->arrivalStation(), item->arrivalInf
 
 void CalendarSfosWrapper::addToCalendar()
 {
+    FAHRPLAN_TRACE_SCOPE("calendar", "CalendarSfosWrapper::addToCalendar");
 
     const QString viaStation = m_result->viaStation();
     QSettings settings(FAHRPLAN_SETTINGS_NAMESPACE, "fahrplan2");
@@ -166,7 +169,7 @@ void CalendarSfosWrapper::addToCalendar()
     aDesc.append("END:VEVENT\n");
     aDesc.append("END:VCALENDAR");
 
-    qDebug() << "icalfile: " << aDesc;
+    fahrplanDebug(logCalendar) << "icalfile: " << aDesc;
     */
 
     // It's annoying but they took some shortcuts in the parserser
@@ -191,10 +194,10 @@ void CalendarSfosWrapper::addToCalendar()
             << "END:VCALENDAR";
 
         tmpFile->close();
-        qDebug() << "Opening" << tmpFile->fileName();
+        fahrplanDebug(logCalendar) << "Opening" << tmpFile->fileName();
         if ( !QDesktopServices::openUrl(QUrl::fromLocalFile(tmpFile->fileName())) ) 
 	{
-            qWarning() << "QDesktopServices::openUrl fails!";
+            fahrplanWarning(logCalendar) << "QDesktopServices::openUrl fails!";
             emit addCalendarEntryComplete(false);
         } else {
             emit addCalendarEntryComplete(true);
@@ -18,6 +18,7 @@
 ****************************************************************************/
 
 #include "calendarthreadwrapper.h"
+#include "fahrplan_trace.h"
 
 #include <QCoreApplication>
 #include <QThread>
@@ -70,6 +71,7 @@ CalendarThreadWrapper::~CalendarThreadWrapper()
 
 void CalendarThreadWrapper::addToCalendar()
 {
+    FAHRPLAN_TRACE_SCOPE("calendar", "CalendarThreadWrapper::addToCalendar");
 
     const QString viaStation = m_result->viaStation();
     QSettings settings(FAHRPLAN_SETTINGS_NAMESPACE, "fahrplan2");
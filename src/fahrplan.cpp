@@ -20,6 +20,11 @@
 #include "fahrplan.h"
 #include "fahrplan_parser_thread.h"
 #include "fahrplan_backend_manager.h"
+#include "fahrplan_network_thread.h"
+#include "fahrplan_station_index.h"
+#include "fahrplan_merged_board.h"
+#include "fahrplan_trace.h"
+#include "fahrplan_log.h"
 #include "calendarthreadwrapper.h"
 #include "calendar_sfos_wrapper.h"
 #include "models/favorites.h"
@@ -28,9 +33,18 @@
 #include "models/timetable.h"
 #include "models/trainrestrictions.h"
 #include "models/backends.h"
+#include "models/requeststatistics.h"
+#include "models/bandwidthstatistics.h"
 
+#include <QDir>
 #include <QThread>
 
+#if defined(BUILD_FOR_QT5)
+    #include <QStandardPaths>
+#else
+    #include <QDesktopServices>
+#endif
+
 FahrplanBackendManager *Fahrplan::m_parser_manager = NULL;
 StationSearchResults *Fahrplan::m_stationSearchResults = NULL;
 MostRecentStations *Fahrplan::m_mostRecentStations = NULL;
@@ -38,6 +52,16 @@ Favorites *Fahrplan::m_favorites = NULL;
 Timetable *Fahrplan::m_timetable = NULL;
 Trainrestrictions *Fahrplan::m_trainrestrictions = NULL;
 Backends *Fahrplan::m_backends = NULL;
+RequestStatistics *Fahrplan::m_requestStatistics = NULL;
+BandwidthStatistics *Fahrplan::m_bandwidthStatistics = NULL;
+StationIndex *Fahrplan::m_stationIndex = NULL;
+MergedBoard *Fahrplan::m_mergedBoard = NULL;
+JourneyResultList *Fahrplan::m_partialJourneyResult = NULL;
+
+// Nearby stations shown from the station index while the backend is asked
+static const int maxIndexedNearbyStations = 20;
+// Station searches are ranked by distance from fixes up to this old, in ms
+static const qint64 maxPositionAge = 10 * 60 * 1000;
 
 Fahrplan::Fahrplan(QObject *parent)
     : QObject(parent)
@@ -47,11 +71,24 @@ Fahrplan::Fahrplan(QObject *parent)
     , m_trainrestriction(0)
     , m_mode(DepartureMode)
     , m_dateTime(QDateTime::currentDateTime())
+    , m_positionLatitude(0)
+    , m_positionLongitude(0)
+    , m_positionTime(-1)
+    , m_nearbyBoardStations(0)
+    , m_nearbyBoardMode(ParserAbstract::Departure)
+    , m_resultDeliveredAt(-1)
+    , m_modelUpdateTime(-1)
 {
 
     settings = new QSettings(FAHRPLAN_SETTINGS_NAMESPACE, "fahrplan2");
     setMode(static_cast<Mode>(settings->value("mode", DepartureMode).toInt()));
 
+    FahrplanTrace::setEnabled(settings->value("traceEnabled", false).toBool() || !qgetenv("FAHRPLAN_TRACE").isEmpty());
+    ParserAbstract::setDataSaverEnabled(settings->value("dataSaver", false).toBool());
+
+    // Start network I/O from the GUI thread before any parser needs it.
+    FahrplanNetworkThread::instance();
+
     if (!m_parser_manager) {
         int currentBackend = settings->value("currentBackend", 0).toInt();
         m_parser_manager = new FahrplanBackendManager(currentBackend);
@@ -87,16 +124,51 @@ Fahrplan::Fahrplan(QObject *parent)
         m_backends = new Backends(this);
         m_backends->setBackendParserList(m_parser_manager->getParserList());
     }
+
+    if (!m_requestStatistics) {
+        m_requestStatistics = new RequestStatistics(this);
+#if defined(BUILD_FOR_QT5)
+        QString logDir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+        QString logDir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+        QDir().mkpath(logDir);
+        m_requestStatistics->setLogFile(logDir + QLatin1String("/requests.log"));
+        m_requestStatistics->setLogEnabled(settings->value("requestStatisticsLog", false).toBool());
+    }
+
+    if (!m_bandwidthStatistics) {
+        m_bandwidthStatistics = new BandwidthStatistics(this);
+    }
+
+    if (!m_stationIndex) {
+        m_stationIndex = new StationIndex(this);
+        // Once for all instances, the models are shared
+        connect(m_favorites, &StationsListModel::stationSelected, this, &Fahrplan::recordStationUse);
+        connect(m_stationSearchResults, &StationsListModel::stationSelected, this, &Fahrplan::recordStationUse);
+        connect(m_mostRecentStations, &StationsListModel::stationSelected, this, &Fahrplan::recordStationUse);
+    }
+
+    if (!m_mergedBoard) {
+        m_mergedBoard = new MergedBoard(this);
+    }
+    connect(m_mergedBoard, &MergedBoard::result, this, &Fahrplan::onMergedTimetableResult);
+    connect(m_mergedBoard, &MergedBoard::errorOccured, this, &Fahrplan::parserErrorOccured);
+    connect(m_mergedBoard, &MergedBoard::requestTimingsRecorded, this, &Fahrplan::onRequestTimings);
 }
 
 void Fahrplan::bindParserSignals()
 {
     if (m_parser_manager->getParser()) {
         connect(m_parser_manager->getParser(), SIGNAL(stationsResult(StationsList)), this, SLOT(onStationSearchResults(StationsList)));
-        connect(m_parser_manager->getParser(), SIGNAL(journeyResult(JourneyResultList*)), this, SIGNAL(parserJourneyResult(JourneyResultList*)));
+        connect(m_parser_manager->getParser(), SIGNAL(journeyResult(JourneyResultList*)), this, SLOT(onJourneyResult(JourneyResultList*)));
         connect(m_parser_manager->getParser(), SIGNAL(errorOccured(QString)), this, SIGNAL(parserErrorOccured(QString)));
-        connect(m_parser_manager->getParser(), SIGNAL(journeyDetailsResult(JourneyDetailResultList*)), this, SIGNAL(parserJourneyDetailsResult(JourneyDetailResultList*)));
+        connect(m_parser_manager->getParser(), SIGNAL(errorOccured(QString)), m_timetable, SLOT(resetPartialEntries()));
+        connect(m_parser_manager->getParser(), SIGNAL(journeyDetailsResult(JourneyDetailResultList*)), this, SLOT(onJourneyDetailsResult(JourneyDetailResultList*)));
         connect(m_parser_manager->getParser(), SIGNAL(timeTableResult(TimetableEntriesList)), this, SLOT(onTimetableResult(TimetableEntriesList)));
+        connect(m_parser_manager->getParser(), SIGNAL(journeyPartialResult(JourneyResultList*)), this, SLOT(onJourneyPartialResult(JourneyResultList*)));
+        connect(m_parser_manager->getParser(), SIGNAL(timeTablePartialResult(TimetableEntriesList)), this, SLOT(onTimetablePartialResult(TimetableEntriesList)));
+        connect(m_parser_manager->getParser(), SIGNAL(requestTimingsRecorded(RequestTimings)), this, SLOT(onRequestTimings(RequestTimings)));
     }
 }
 
@@ -160,6 +232,16 @@ Trainrestrictions *Fahrplan::trainrestrictions() const
     return m_trainrestrictions;
 }
 
+RequestStatistics *Fahrplan::requestStatistics() const
+{
+    return m_requestStatistics;
+}
+
+BandwidthStatistics *Fahrplan::bandwidthStatistics() const
+{
+    return m_bandwidthStatistics;
+}
+
 
 QString Fahrplan::departureStationName() const
 {
@@ -231,14 +313,55 @@ void Fahrplan::setDateTime(const QDateTime &dateTime)
     emit dateTimeChanged();
 }
 
+bool Fahrplan::dataSaver() const
+{
+    return ParserAbstract::dataSaverEnabled();
+}
+
+void Fahrplan::setDataSaver(bool enabled)
+{
+    if (enabled == ParserAbstract::dataSaverEnabled())
+        return;
+
+    ParserAbstract::setDataSaverEnabled(enabled);
+    settings->setValue("dataSaver", enabled);
+    emit dataSaverChanged();
+}
+
 bool Fahrplan::timeFormat24h() const
 {
     // A hacky way to detect whether locale uses 24 or 12 hour time format.
     return !QLocale().timeFormat().contains("ap", Qt::CaseInsensitive);
 }
 
+void Fahrplan::setTraceEnabled(bool enabled)
+{
+    settings->setValue("traceEnabled", enabled);
+    FahrplanTrace::setEnabled(enabled);
+}
+
+QString Fahrplan::dumpTrace()
+{
+#if defined(BUILD_FOR_QT5)
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+    QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+    QDir().mkpath(dir);
+    QString fileName = dir + QString("/trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+
+    if (!FahrplanTrace::dump(fileName))
+        return QString();
+
+    fahrplanInfo(logGui) << "Trace written to" << fileName;
+    return fileName;
+}
+
 void Fahrplan::setStation(Fahrplan::StationType type, const Station &station)
 {
+    if (station.valid)
+        m_stationIndex->insert(station);
+
     switch (type) {
     case DepartureStation:
         m_departureStation = station;
@@ -284,18 +407,52 @@ void Fahrplan::resetStation(StationType type)
 
 void Fahrplan::findStationsByName(const QString &stationName)
 {
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::findStationsByName");
     m_stationSearchResults->setStationsList(StationsList());
+    m_stationQuery = stationName;
+    m_nearbyBoardStations = 0;
     m_parser_manager->getParser()->findStationsByName(stationName);
 }
 
 void Fahrplan::findStationsByCoordinates(qreal longitude, qreal latitude)
 {
-    m_stationSearchResults->setStationsList(StationsList());
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::findStationsByCoordinates");
+    setPosition(longitude, latitude);
+    m_stationQuery.clear();
+    m_nearbyBoardStations = 0;
+
+    // Stations seen before right away, the backend's answer replaces them
+    StationsList nearby = m_stationIndex->nearest(latitude, longitude, maxIndexedNearbyStations);
+    for (int i = 0; i < nearby.count(); ++i) {
+        const qreal distance = StationIndex::distance(latitude, longitude, nearby.at(i).latitude, nearby.at(i).longitude);
+        nearby[i].miscInfo = QString("%1m").arg(qRound(distance));
+    }
+    m_stationSearchResults->setStationsList(m_stationIndex->rank(nearby, m_stationQuery, latitude, longitude));
+
     m_parser_manager->getParser()->findStationsByCoordinates(longitude, latitude);
 }
 
+void Fahrplan::setPosition(qreal longitude, qreal latitude)
+{
+    m_positionLatitude = latitude;
+    m_positionLongitude = longitude;
+    m_positionTime = QDateTime::currentMSecsSinceEpoch();
+}
+
+bool Fahrplan::hasRecentPosition() const
+{
+    return m_positionTime >= 0 && QDateTime::currentMSecsSinceEpoch() - m_positionTime <= maxPositionAge;
+}
+
+// Late single stop boards must not replace it
+bool Fahrplan::showsMergedBoard() const
+{
+    return m_mergedBoard->isActive() || m_nearbyBoardStations > 0;
+}
+
 void Fahrplan::searchJourney()
 {
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::searchJourney");
     ParserAbstract::Mode mode;
 
     if (m_mode == NowMode) {
@@ -310,6 +467,7 @@ void Fahrplan::searchJourney()
 
 void Fahrplan::getTimeTable()
 {
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::getTimeTable");
     ParserAbstract::Mode mode;
 
     if (m_mode == NowMode) {
@@ -319,9 +477,72 @@ void Fahrplan::getTimeTable()
         mode = ParserAbstract::Mode(m_mode);
     }
 
+    m_mergedBoard->cancel();
+    m_nearbyBoardStations = 0;
+    m_timetable->resetPartialEntries();
     m_parser_manager->getParser()->getTimeTableForStation(m_currentStation, m_directionStation, m_dateTime, mode, m_trainrestriction);
 }
 
+void Fahrplan::getMergedTimeTable(const StationsList &stations)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::getMergedTimeTable");
+    ParserAbstract::Mode mode;
+
+    if (m_mode == NowMode) {
+        setDateTime(QDateTime::currentDateTime());
+        mode = ParserAbstract::Departure;
+    } else {
+        mode = ParserAbstract::Mode(m_mode);
+    }
+
+    m_timetable->clear();
+    m_nearbyBoardStations = 0;
+    m_mergedBoard->setParserIndex(m_parser_manager->getParser()->getParserIndex());
+    m_mergedBoard->request(stations, m_directionStation, m_dateTime, mode, m_trainrestriction);
+}
+
+void Fahrplan::getMergedTimeTableForSearchResults(const QVariantList &rows)
+{
+    StationsList stations;
+    foreach (const QVariant &row, rows) {
+        const Station station = m_stationSearchResults->getStation(row.toInt());
+        if (station.valid)
+            stations.append(station);
+    }
+    getMergedTimeTable(stations);
+}
+
+void Fahrplan::getNearbyTimeTable(qreal longitude, qreal latitude, int stations)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::getNearbyTimeTable");
+    ParserAbstract::Mode mode;
+
+    if (m_mode == NowMode) {
+        setDateTime(QDateTime::currentDateTime());
+        mode = ParserAbstract::Departure;
+    } else {
+        mode = ParserAbstract::Mode(m_mode);
+    }
+
+    m_timetable->clear();
+    m_mergedBoard->cancel();
+    m_mergedBoard->setParserIndex(m_parser_manager->getParser()->getParserIndex());
+
+    // Boards for stations seen before are on their way while the backend
+    // is still looking for the nearby ones
+    const bool supportsGps = m_parser_manager->getParser()->supportsGps();
+    const StationsList indexed = m_stationIndex->nearest(latitude, longitude, stations);
+    if (!indexed.isEmpty() || !supportsGps)
+        m_mergedBoard->request(indexed, Station(false), m_dateTime, mode, m_trainrestriction);
+
+    if (!supportsGps)
+        return;
+
+    findStationsByCoordinates(longitude, latitude);
+    m_nearbyBoardStations = stations;
+    m_nearbyBoardMode = mode;
+}
+
 void Fahrplan::setTrainrestriction(int index)
 {
     if (index < m_trainrestrictions->count()) {
@@ -343,15 +564,22 @@ QString Fahrplan::trainrestrictionName() const
 
 void Fahrplan::onParserChanged(const QString &name, int index)
 {
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onParserChanged");
     //We need to reconnect all Signals to the new Parser
     bindParserSignals();
+    m_nearbyBoardStations = 0;
+    m_mergedBoard->setParserIndex(index);
     m_stationSearchResults->setStationsList(StationsList());
+    m_stationIndex->setBackend(m_parser_manager->getParser()->uid());
     loadStations();
-    if (m_favorites)
+    if (m_favorites) {
         m_favorites->reload();
+        m_stationIndex->insert(m_favorites->stationsList());
+    }
 
     if (m_mostRecentStations) {
         m_mostRecentStations->reload();
+        m_stationIndex->insert(m_mostRecentStations->stationsList());
     }
 
     if (m_trainrestrictions) {
@@ -374,18 +602,123 @@ void Fahrplan::onParserChanged(const QString &name, int index)
 
 void Fahrplan::onStationSearchResults(const StationsList &result)
 {
-    m_stationSearchResults->setStationsList(result);
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onStationSearchResults");
+    m_resultDeliveredAt = RequestTimings::now();
+    if (hasRecentPosition())
+        m_stationSearchResults->setStationsList(m_stationIndex->rank(result, m_stationQuery, m_positionLatitude, m_positionLongitude));
+    else
+        m_stationSearchResults->setStationsList(result);
+    m_modelUpdateTime = RequestTimings::now() - m_resultDeliveredAt;
+    m_stationIndex->insert(result);
+
+    // The nearest of the stations from the index and the backend's ones,
+    // boards of index stations that are not among them are dropped
+    if (m_nearbyBoardStations > 0) {
+        const StationsList nearby = StationIndex::nearest(m_mergedBoard->stations() + result, m_positionLatitude,
+                                                          m_positionLongitude, m_nearbyBoardStations);
+        m_nearbyBoardStations = 0;
+        if (m_mergedBoard->isActive())
+            m_mergedBoard->setStations(nearby);
+        else
+            m_mergedBoard->request(nearby, Station(false), m_dateTime, m_nearbyBoardMode, m_trainrestriction);
+    }
 
     emit parserStationsResult();
 }
 
+void Fahrplan::recordStationUse(Fahrplan::StationType, const Station &station)
+{
+    m_stationIndex->recordUse(station);
+}
+
 void Fahrplan::onTimetableResult(const TimetableEntriesList &timetableEntries)
 {
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onTimetableResult");
+    if (showsMergedBoard())
+        return;
+
+    m_resultDeliveredAt = RequestTimings::now();
+    m_timetable->setTimetableEntries(timetableEntries);
+    m_modelUpdateTime = RequestTimings::now() - m_resultDeliveredAt;
+
+    emit parserTimeTableResult();
+}
+
+// Partial results only update the models, the timings are recorded for
+// the complete result.
+void Fahrplan::onTimetablePartialResult(const TimetableEntriesList &timetableEntries)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onTimetablePartialResult");
+    if (showsMergedBoard())
+        return;
+
+    m_timetable->appendTimetableEntries(timetableEntries);
+
+    emit parserTimeTableResult();
+}
+
+// Every stop that answers updates the whole board
+void Fahrplan::onMergedTimetableResult(const TimetableEntriesList &timetableEntries)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onMergedTimetableResult");
+    m_resultDeliveredAt = RequestTimings::now();
     m_timetable->setTimetableEntries(timetableEntries);
+    m_modelUpdateTime = RequestTimings::now() - m_resultDeliveredAt;
 
     emit parserTimeTableResult();
 }
 
+void Fahrplan::onJourneyPartialResult(JourneyResultList *result)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onJourneyPartialResult");
+
+    emit parserJourneyResult(result);
+
+    // The GUIs copy the journeys out while handling the signal
+    if (m_partialJourneyResult != result) {
+        delete m_partialJourneyResult;
+        m_partialJourneyResult = result;
+    }
+}
+
+void Fahrplan::onJourneyResult(JourneyResultList *result)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onJourneyResult");
+    m_resultDeliveredAt = RequestTimings::now();
+    m_modelUpdateTime = 0;
+
+    emit parserJourneyResult(result);
+
+    delete m_partialJourneyResult;
+    m_partialJourneyResult = NULL;
+}
+
+void Fahrplan::onJourneyDetailsResult(JourneyDetailResultList *result)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::onJourneyDetailsResult");
+    m_resultDeliveredAt = RequestTimings::now();
+    m_modelUpdateTime = 0;
+
+    emit parserJourneyDetailsResult(result);
+}
+
+void Fahrplan::onRequestTimings(const RequestTimings &timings)
+{
+    RequestTimings completed = timings;
+
+    // Results and timings are queued from the same parser thread, so a
+    // result belonging to this request has always arrived already.
+    if (m_resultDeliveredAt >= timings.queuedAt) {
+        completed.deliveredAt = m_resultDeliveredAt;
+        completed.modelUpdateTime = m_modelUpdateTime;
+    }
+    m_resultDeliveredAt = -1;
+    m_modelUpdateTime = -1;
+
+    m_requestStatistics->addTimings(completed);
+    m_bandwidthStatistics->addTimings(completed);
+}
+
 QString Fahrplan::parserName() const
 {
     return m_parser_manager->getParser()->name();
@@ -398,13 +731,15 @@ QString Fahrplan::parserShortName() const
 
 void Fahrplan::setParser(int index)
 {
-    qDebug()<<"Set parser:"<<index;
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::setParser");
+    fahrplanDebug(logGui) << "Set parser:" << index;
     settings->setValue("currentBackend", index);
     m_parser_manager->setParser(index);
 }
 
 void Fahrplan::addJourneyDetailResultToCalendar(JourneyDetailResultList *result)
 {
+    FAHRPLAN_TRACE_SCOPE("gui", "Fahrplan::addJourneyDetailResultToCalendar");
 
 #if defined(BUILD_FOR_SAILFISHOS)
     CalendarSfosWrapper *wrapper = new CalendarSfosWrapper(result,this);
@@ -414,6 +749,7 @@ void Fahrplan::addJourneyDetailResultToCalendar(JourneyDetailResultList *result)
 
 #else
     QThread *workerThread = new QThread(this);
+    workerThread->setObjectName("Calendar");
     CalendarThreadWrapper *wrapper = new CalendarThreadWrapper(result);
 
     connect(workerThread, SIGNAL(started()), wrapper, SLOT(addToCalendar()));
@@ -36,6 +36,10 @@ class Timetable;
 class Favorites;
 class Backends;
 class Trainrestrictions;
+class RequestStatistics;
+class BandwidthStatistics;
+class StationIndex;
+class MergedBoard;
 class Fahrplan : public QObject
 {
     Q_OBJECT
@@ -52,6 +56,9 @@ class Fahrplan : public QObject
     Q_PROPERTY(Timetable *timetable READ timetable CONSTANT)
     Q_PROPERTY(Backends *backends READ backends CONSTANT)
     Q_PROPERTY(Trainrestrictions *trainrestrictions READ trainrestrictions CONSTANT)
+    Q_PROPERTY(RequestStatistics *requestStatistics READ requestStatistics CONSTANT)
+    Q_PROPERTY(BandwidthStatistics *bandwidthStatistics READ bandwidthStatistics CONSTANT)
+    Q_PROPERTY(bool dataSaver READ dataSaver WRITE setDataSaver NOTIFY dataSaverChanged)
     Q_PROPERTY(QString departureStationName READ departureStationName NOTIFY departureStationChanged)
     Q_PROPERTY(QString viaStationName READ viaStationName NOTIFY viaStationChanged)
     Q_PROPERTY(QString arrivalStationName READ arrivalStationName NOTIFY arrivalStationChanged)
@@ -93,6 +100,8 @@ class Fahrplan : public QObject
         Timetable *timetable() const;
         Backends *backends() const;
         Trainrestrictions *trainrestrictions() const;
+        RequestStatistics *requestStatistics() const;
+        BandwidthStatistics *bandwidthStatistics() const;
         QString departureStationName() const;
         QString viaStationName() const;
         QString arrivalStationName() const;
@@ -106,7 +115,12 @@ class Fahrplan : public QObject
         QDateTime dateTime() const;
         void setDateTime(const QDateTime &dateTime);
 
+        bool dataSaver() const;
+        void setDataSaver(bool enabled);
+
         Q_INVOKABLE bool timeFormat24h() const;
+        Q_INVOKABLE void setTraceEnabled(bool enabled);
+        Q_INVOKABLE QString dumpTrace();
 
     public slots:
         void setParser(int index);
@@ -116,7 +130,18 @@ class Fahrplan : public QObject
         void resetStation(StationType type);
         void findStationsByName(const QString &stationName);
         void findStationsByCoordinates(qreal longitude, qreal latitude);
+        // A position fix, station search results are ranked by the
+        // distance from it for a few minutes
+        void setPosition(qreal longitude, qreal latitude);
         void getTimeTable();
+        // One board for several stops, e.g. all bays of an interchange
+        void getMergedTimeTable(const StationsList &stations);
+        // The same for the given rows of the station search results
+        void getMergedTimeTableForSearchResults(const QVariantList &rows);
+        // One board for the stations nearest to a position fix. Stations
+        // seen before are asked right away, the backend's nearby stations
+        // replace the farther ones as soon as they arrive.
+        void getNearbyTimeTable(qreal longitude, qreal latitude, int stations = 3);
         void searchJourney();
         void addJourneyDetailResultToCalendar(JourneyDetailResultList *result);
         void setTrainrestriction(int index);
@@ -131,6 +156,7 @@ class Fahrplan : public QObject
 
         void modeChanged();
         void dateTimeChanged();
+        void dataSaverChanged();
 
         void parserStationsResult();
         void parserJourneyResult(JourneyResultList *result);
@@ -144,7 +170,14 @@ class Fahrplan : public QObject
         void setStation(Fahrplan::StationType type, const Station &station);
         void onParserChanged(const QString &name, int index);
         void onStationSearchResults(const StationsList &result);
+        void recordStationUse(Fahrplan::StationType, const Station &station);
         void onTimetableResult(const TimetableEntriesList &timetableEntries);
+        void onTimetablePartialResult(const TimetableEntriesList &timetableEntries);
+        void onMergedTimetableResult(const TimetableEntriesList &timetableEntries);
+        void onJourneyResult(JourneyResultList *result);
+        void onJourneyPartialResult(JourneyResultList *result);
+        void onJourneyDetailsResult(JourneyDetailResultList *result);
+        void onRequestTimings(const RequestTimings &timings);
         void bindParserSignals();
 
     private:
@@ -155,6 +188,13 @@ class Fahrplan : public QObject
         static Timetable *m_timetable;
         static Trainrestrictions *m_trainrestrictions;
         static Backends *m_backends;
+        static RequestStatistics *m_requestStatistics;
+        static BandwidthStatistics *m_bandwidthStatistics;
+        static StationIndex *m_stationIndex;
+        static MergedBoard *m_mergedBoard;
+        // The partial journey list shown last, deleted once a newer list
+        // replaced it
+        static JourneyResultList *m_partialJourneyResult;
         QSettings *settings;
 
         Station m_departureStation;
@@ -167,7 +207,26 @@ class Fahrplan : public QObject
         Mode m_mode;
         QDateTime m_dateTime;
 
+        // The last position fix and station search
+        qreal m_positionLatitude;
+        qreal m_positionLongitude;
+        qint64 m_positionTime;
+        QString m_stationQuery;
+
+        // Stations the next station search result adds to the nearby
+        // board, 0 while none waits for it
+        int m_nearbyBoardStations;
+        ParserAbstract::Mode m_nearbyBoardMode;
+
+        // When the last parser result reached the GUI thread and how long
+        // the model took to take it, matched up with the timings that
+        // follow the result.
+        qint64 m_resultDeliveredAt;
+        qint64 m_modelUpdateTime;
+
         Station getStation(StationType type) const;
+        bool hasRecentPosition() const;
+        bool showsMergedBoard() const;
         void loadStations();
         void saveStationToSettings(const QString &key, const Station &station);
         Station loadStationFromSettings(const QString &key);
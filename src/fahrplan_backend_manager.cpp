@@ -45,6 +45,7 @@ QStringList FahrplanBackendManager::getParserList()
     result.append(ParserVRREFA::getName());
     result.append(ParserSearchCH::getName());
     result.append(ParserTrentinoTrasporti::getName());
+    result.append(ParserGtfs::getName());
 
     // Make sure the index is in bounds
     if (currentParserIndex > (result.count() - 1) || currentParserIndex < 0) {
@@ -0,0 +1,150 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "fahrplan_log.h"
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+FAHRPLAN_LOG_CATEGORY(logGui, "gui")
+FAHRPLAN_LOG_CATEGORY(logNetwork, "network")
+FAHRPLAN_LOG_CATEGORY(logCalendar, "calendar")
+FAHRPLAN_LOG_CATEGORY(logParser, "parser")
+
+namespace
+{
+    struct Rule
+    {
+        QString pattern;
+        FahrplanLog::Level level;
+        int sampleRate;
+
+        bool matches(const QString &name) const
+        {
+            if (pattern.endsWith(QLatin1Char('*')))
+                return name.startsWith(pattern.left(pattern.length() - 1));
+            return name == pattern;
+        }
+    };
+
+    // Categories are created lazily on first use, possibly in parser
+    // threads, so both lists are shared under one mutex.
+    QMutex *registryMutex()
+    {
+        static QMutex mutex;
+        return &mutex;
+    }
+
+    QList<FahrplanLog::Category *> &categories()
+    {
+        static QList<FahrplanLog::Category *> list;
+        return list;
+    }
+
+    QList<Rule> &rules()
+    {
+        static QList<Rule> list;
+        return list;
+    }
+
+    // Later rules win, so "parser.*=warning;parser.efa=debug" works.
+    void applyRules(FahrplanLog::Category *category)
+    {
+        const QString name = QString::fromLatin1(category->name());
+        foreach (const Rule &rule, rules()) {
+            if (rule.matches(name)) {
+                category->setLevel(rule.level);
+                category->setSampleRate(rule.sampleRate);
+            }
+        }
+    }
+
+    bool parseLevel(const QString &text, FahrplanLog::Level *level)
+    {
+        if (text == QLatin1String("debug"))
+            *level = FahrplanLog::Debug;
+        else if (text == QLatin1String("info"))
+            *level = FahrplanLog::Info;
+        else if (text == QLatin1String("warning"))
+            *level = FahrplanLog::Warning;
+        else if (text == QLatin1String("off"))
+            *level = FahrplanLog::Off;
+        else
+            return false;
+        return true;
+    }
+}
+
+FahrplanLog::Category::Category(const char *name)
+    : m_name(name), m_level(Debug), m_sampleRate(1), m_counter(0)
+{
+    QMutexLocker locker(registryMutex());
+    categories().append(this);
+    applyRules(this);
+}
+
+void FahrplanLog::Category::setLevel(Level level)
+{
+    m_level.store(level, std::memory_order_relaxed);
+}
+
+void FahrplanLog::Category::setSampleRate(int rate)
+{
+    m_sampleRate.store(qMax(1, rate), std::memory_order_relaxed);
+}
+
+void FahrplanLog::setRules(const QString &text)
+{
+    QList<Rule> parsed;
+    foreach (const QString &entry, text.split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+        const int equals = entry.indexOf(QLatin1Char('='));
+        if (equals <= 0) {
+            qWarning() << "Ignoring log rule" << entry;
+            continue;
+        }
+
+        Rule rule;
+        rule.pattern = entry.left(equals).trimmed();
+        rule.sampleRate = 1;
+
+        QString value = entry.mid(equals + 1).trimmed().toLower();
+        const int slash = value.indexOf(QLatin1Char('/'));
+        if (slash >= 0) {
+            rule.sampleRate = qMax(1, value.mid(slash + 1).toInt());
+            value.truncate(slash);
+        }
+
+        if (!parseLevel(value, &rule.level)) {
+            qWarning() << "Ignoring log rule" << entry;
+            continue;
+        }
+        parsed.append(rule);
+    }
+
+    QMutexLocker locker(registryMutex());
+    rules() = parsed;
+    foreach (Category *category, categories()) {
+        category->setLevel(Debug);
+        category->setSampleRate(1);
+        applyRules(category);
+    }
+}
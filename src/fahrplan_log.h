@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef FAHRPLAN_LOG_H
+#define FAHRPLAN_LOG_H
+
+#include <QDebug>
+#include <QString>
+
+#include <atomic>
+
+// Categorized logging for the parsers and the subsystems around them.
+//
+// Messages below FAHRPLAN_LOG_LEVEL are removed by the compiler, including
+// the formatting of their arguments. Release builds keep Info and above,
+// debug builds keep everything; override with e.g.
+// DEFINES += FAHRPLAN_LOG_LEVEL=2 in the .pro file.
+//
+// What remains can be filtered at runtime with rules in the environment
+// variable FAHRPLAN_LOG_RULES, separated by ';':
+//
+//     parser.*=warning;parser.efa=debug/20
+//
+// sets all parsers to warnings only and logs one of every 20 debug
+// messages of the EFA parser. Warnings are never sampled.
+namespace FahrplanLog
+{
+    enum Level {
+        Debug = 0,
+        Info = 1,
+        Warning = 2,
+        Off = 3
+    };
+
+    class Category
+    {
+    public:
+        explicit Category(const char *name);
+
+        const char *name() const { return m_name; }
+
+        bool isEnabled(Level level) const
+        {
+            if (level < m_level.load(std::memory_order_relaxed))
+                return false;
+            if (level >= Warning)
+                return true;
+            int rate = m_sampleRate.load(std::memory_order_relaxed);
+            return rate <= 1 || m_counter.fetch_add(1, std::memory_order_relaxed) % rate == 0;
+        }
+
+        void setLevel(Level level);
+        void setSampleRate(int rate);
+
+    private:
+        const char *m_name;
+        std::atomic<int> m_level;
+        std::atomic<int> m_sampleRate;
+        mutable std::atomic<unsigned int> m_counter;
+    };
+
+    void setRules(const QString &rules);
+}
+
+#ifndef FAHRPLAN_LOG_LEVEL
+    #ifdef QT_NO_DEBUG
+        #define FAHRPLAN_LOG_LEVEL 1
+    #else
+        #define FAHRPLAN_LOG_LEVEL 0
+    #endif
+#endif
+
+#define FAHRPLAN_DECLARE_LOG_CATEGORY(function) \
+    FahrplanLog::Category &function();
+
+#define FAHRPLAN_LOG_CATEGORY(function, name) \
+    FahrplanLog::Category &function() \
+    { \
+        static FahrplanLog::Category category(name); \
+        return category; \
+    }
+
+// The constant comparison lets the compiler drop the whole statement,
+// the for() keeps the macro safe inside unbraced if/else.
+#define FAHRPLAN_LOG_STREAM(category, level, stream) \
+    for (bool fahrplanLogEnabled = (FahrplanLog::level >= FAHRPLAN_LOG_LEVEL) && category().isEnabled(FahrplanLog::level); \
+         fahrplanLogEnabled; fahrplanLogEnabled = false) \
+        stream() << category().name() << ':'
+
+#define fahrplanDebug(category) FAHRPLAN_LOG_STREAM(category, Debug, qDebug)
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    #define fahrplanInfo(category) FAHRPLAN_LOG_STREAM(category, Info, qInfo)
+#else
+    #define fahrplanInfo(category) FAHRPLAN_LOG_STREAM(category, Info, qDebug)
+#endif
+#define fahrplanWarning(category) FAHRPLAN_LOG_STREAM(category, Warning, qWarning)
+
+// Subsystem categories, parsers define their own "parser.<name>" ones.
+FAHRPLAN_DECLARE_LOG_CATEGORY(logGui)
+FAHRPLAN_DECLARE_LOG_CATEGORY(logNetwork)
+FAHRPLAN_DECLARE_LOG_CATEGORY(logCalendar)
+FAHRPLAN_DECLARE_LOG_CATEGORY(logParser)
+
+#endif // FAHRPLAN_LOG_H
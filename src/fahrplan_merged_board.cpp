@@ -0,0 +1,392 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "fahrplan_merged_board.h"
+#include "fahrplan_parser_thread.h"
+#include "fahrplan_log.h"
+#include "fahrplan_trace.h"
+
+#include <QSet>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace
+{
+    const int msecsPerDay = 24 * 60 * 60 * 1000;
+    // Delayed trains are still listed a while after their scheduled time
+    const int earlierSlack = 60 * 60 * 1000;
+
+    // Position of time on a board starting at startMsecs, in ms
+    int boardKey(const QTime &time, int startMsecs)
+    {
+        if (!time.isValid())
+            return msecsPerDay;
+        return (QTime(0, 0).msecsTo(time) - startMsecs + msecsPerDay) % msecsPerDay;
+    }
+
+    struct Cursor
+    {
+        int key;
+        int board;
+        int next;
+
+        bool operator>(const Cursor &other) const
+        {
+            return key != other.key ? key > other.key : board > other.board;
+        }
+    };
+
+    typedef std::pair<int, int> KeyedPosition;
+
+    bool keyLess(const KeyedPosition &a, const KeyedPosition &b)
+    {
+        return a.first < b.first;
+    }
+}
+
+MergedBoard::MergedBoard(QObject *parent)
+    : QObject(parent)
+    , m_parserIndex(-1)
+    , m_mode(ParserAbstract::Departure)
+    , m_trainrestrictions(0)
+    , m_active(false)
+{
+}
+
+MergedBoard::~MergedBoard()
+{
+    while (!m_workers.isEmpty())
+        retireWorker(0);
+}
+
+void MergedBoard::setParserIndex(int index)
+{
+    if (index == m_parserIndex)
+        return;
+
+    cancel();
+    while (!m_workers.isEmpty())
+        retireWorker(0);
+    m_parserIndex = index;
+}
+
+void MergedBoard::request(const StationsList &stations, const Station &directionStation, const QDateTime &dateTime,
+                          ParserAbstract::Mode mode, int trainrestrictions)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "MergedBoard::request");
+    cancel();
+
+    m_directionStation = directionStation;
+    m_dateTime = dateTime;
+    m_mode = mode;
+    m_trainrestrictions = trainrestrictions;
+    m_active = true;
+
+    setStations(stations);
+    if (m_stops.isEmpty())
+        publish();
+}
+
+void MergedBoard::setStations(const StationsList &stations)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "MergedBoard::setStations");
+    const int pendingBefore = pendingStops();
+
+    QList<Stop> stops;
+    QVector<int> moved(m_stops.count(), -1);
+    foreach (const Station &station, stations) {
+        if (stopIndex(stops, station) >= 0)
+            continue;
+
+        const int old = stopIndex(m_stops, station);
+        if (old >= 0) {
+            moved[old] = stops.count();
+            stops.append(m_stops.at(old));
+        } else {
+            Stop stop;
+            stop.station = station;
+            stop.state = Queued;
+            stops.append(stop);
+        }
+    }
+
+    bool changed = false;
+    for (int i = 0; i < m_stops.count(); ++i) {
+        if (moved.at(i) < 0 && !m_stops.at(i).board.isEmpty())
+            changed = true;
+    }
+
+    // Threads still asking for stops that left are let go
+    for (int i = m_workers.count() - 1; i >= 0; --i) {
+        const int stop = m_workers.at(i).stop;
+        if (stop < 0)
+            continue;
+        if (moved.at(stop) < 0)
+            retireWorker(i);
+        else
+            m_workers[i].stop = moved.at(stop);
+    }
+
+    m_stops = stops;
+    dispatch();
+
+    if (changed || (pendingBefore > 0 && pendingStops() == 0))
+        publish();
+}
+
+void MergedBoard::cancel()
+{
+    // Busy threads are not asked to abort, not every parser reports
+    // back after that. They are let go and answer into the void.
+    for (int i = m_workers.count() - 1; i >= 0; --i) {
+        if (m_workers.at(i).stop >= 0)
+            retireWorker(i);
+    }
+
+    m_stops.clear();
+    m_error.clear();
+    m_active = false;
+}
+
+bool MergedBoard::isActive() const
+{
+    return m_active;
+}
+
+bool MergedBoard::isRunning() const
+{
+    return pendingStops() > 0;
+}
+
+StationsList MergedBoard::stations() const
+{
+    StationsList result;
+    foreach (const Stop &stop, m_stops)
+        result.append(stop.station);
+    return result;
+}
+
+TimetableEntriesList MergedBoard::merge(const QList<TimetableEntriesList> &boards, const QTime &from)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "MergedBoard::merge");
+    const int start = from.isValid() ? (QTime(0, 0).msecsTo(from) - earlierSlack + msecsPerDay) % msecsPerDay : 0;
+
+    // Backends return their boards sorted, only an odd one is sorted here
+    QVector<QVector<KeyedPosition> > keyed(boards.count());
+    int total = 0;
+    for (int i = 0; i < boards.count(); ++i) {
+        const TimetableEntriesList &board = boards.at(i);
+        QVector<KeyedPosition> &keys = keyed[i];
+        keys.reserve(board.count());
+        for (int j = 0; j < board.count(); ++j)
+            keys.append(KeyedPosition(boardKey(board.at(j).time, start), j));
+        if (!std::is_sorted(keys.begin(), keys.end(), keyLess))
+            std::stable_sort(keys.begin(), keys.end(), keyLess);
+        total += board.count();
+    }
+
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor> > heads;
+    for (int i = 0; i < keyed.count(); ++i) {
+        if (!keyed.at(i).isEmpty()) {
+            Cursor cursor = { keyed.at(i).first().first, i, 0 };
+            heads.push(cursor);
+        }
+    }
+
+    TimetableEntriesList result;
+    result.reserve(total);
+
+    // Trips already taken at the current time
+    int runKey = -1;
+    QSet<QString> runTrips;
+
+    while (!heads.empty()) {
+        Cursor cursor = heads.top();
+        heads.pop();
+
+        const QVector<KeyedPosition> &keys = keyed.at(cursor.board);
+        const TimetableEntry &entry = boards.at(cursor.board).at(keys.at(cursor.next).second);
+
+        if (cursor.key != runKey) {
+            runKey = cursor.key;
+            runTrips.clear();
+        }
+        const QString trip = entry.trainType + QLatin1Char('\n') + entry.destinationStation;
+        if (!runTrips.contains(trip)) {
+            runTrips.insert(trip);
+            result.append(entry);
+        }
+
+        if (++cursor.next < keys.count()) {
+            cursor.key = keys.at(cursor.next).first;
+            heads.push(cursor);
+        }
+    }
+
+    return result;
+}
+
+void MergedBoard::onTimetableResult(const TimetableEntriesList &entries)
+{
+    stopFinished(sender(), entries);
+}
+
+void MergedBoard::onErrorOccured(const QString &msg)
+{
+    const int index = workerIndex(sender());
+    if (index < 0 || m_workers.at(index).stop < 0)
+        return;
+
+    fahrplanWarning(logGui) << "Board for" << m_stops.at(m_workers.at(index).stop).station.name << "failed:" << msg;
+    if (m_error.isEmpty())
+        m_error = msg;
+    stopFinished(sender(), TimetableEntriesList());
+}
+
+int MergedBoard::stopIndex(const QList<Stop> &stops, const Station &station)
+{
+    for (int i = 0; i < stops.count(); ++i) {
+        if (stops.at(i).station == station)
+            return i;
+    }
+    return -1;
+}
+
+int MergedBoard::pendingStops() const
+{
+    int pending = 0;
+    foreach (const Stop &stop, m_stops) {
+        if (stop.state != Answered)
+            ++pending;
+    }
+    return pending;
+}
+
+int MergedBoard::maxWorkers() const
+{
+    // Offline lookups do not wait for the network, another instance would
+    // only open (or import) the feed once more.
+    if (!m_workers.isEmpty() && m_workers.first().thread->uid() == QLatin1String(ParserGtfs::staticMetaObject.className()))
+        return 1;
+    return MaxParallelRequests;
+}
+
+int MergedBoard::workerIndex(QObject *thread) const
+{
+    for (int i = 0; i < m_workers.count(); ++i) {
+        if (m_workers.at(i).thread == thread)
+            return i;
+    }
+    return -1;
+}
+
+void MergedBoard::retireWorker(int index)
+{
+    FahrplanParserThread *thread = m_workers.at(index).thread;
+    disconnect(thread, 0, this, 0);
+    // Parser object will be autodeleted after the thread quits.
+    thread->quit();
+    m_workers.removeAt(index);
+}
+
+void MergedBoard::dispatch()
+{
+    for (int stop = 0; stop < m_stops.count(); ++stop) {
+        if (m_stops.at(stop).state != Queued)
+            continue;
+
+        int index = -1;
+        for (int i = 0; i < m_workers.count(); ++i) {
+            if (m_workers.at(i).stop < 0) {
+                index = i;
+                break;
+            }
+        }
+
+        if (index < 0) {
+            if (m_workers.count() >= maxWorkers())
+                return;
+
+            Worker worker;
+            worker.thread = new FahrplanParserThread();
+            worker.thread->init(m_parserIndex);
+            worker.stop = -1;
+            connect(worker.thread, SIGNAL(timeTableResult(TimetableEntriesList)), this, SLOT(onTimetableResult(TimetableEntriesList)));
+            connect(worker.thread, SIGNAL(errorOccured(QString)), this, SLOT(onErrorOccured(QString)));
+            connect(worker.thread, SIGNAL(requestTimingsRecorded(RequestTimings)), this, SIGNAL(requestTimingsRecorded(RequestTimings)));
+            m_workers.append(worker);
+            index = m_workers.count() - 1;
+        }
+
+        m_workers[index].stop = stop;
+        m_stops[stop].state = Asked;
+        m_workers.at(index).thread->getTimeTableForStation(m_stops.at(stop).station, m_directionStation, m_dateTime,
+                                                           m_mode, m_trainrestrictions);
+    }
+}
+
+void MergedBoard::stopFinished(QObject *thread, const TimetableEntriesList &entries)
+{
+    FAHRPLAN_TRACE_SCOPE("gui", "MergedBoard::stopFinished");
+    const int index = workerIndex(thread);
+    if (index < 0)
+        return;
+
+    // A parser may report an error after it already delivered the board
+    const int stop = m_workers.at(index).stop;
+    if (stop < 0)
+        return;
+    m_workers[index].stop = -1;
+
+    // Tell the stops apart where the backend leaves it out
+    TimetableEntriesList board = entries;
+    for (int i = 0; i < board.count(); ++i) {
+        if (board.at(i).currentStation.isEmpty())
+            board[i].currentStation = m_stops.at(stop).station.name;
+    }
+    m_stops[stop].board = board;
+    m_stops[stop].state = Answered;
+
+    dispatch();
+
+    if (board.isEmpty() && pendingStops() > 0)
+        return;
+    publish();
+}
+
+void MergedBoard::publish()
+{
+    QList<TimetableEntriesList> boards;
+    foreach (const Stop &stop, m_stops)
+        boards.append(stop.board);
+
+    const bool last = pendingStops() == 0;
+    const TimetableEntriesList merged = merge(boards, m_dateTime.time());
+    if (last && merged.isEmpty() && !m_error.isEmpty())
+        emit errorOccured(m_error);
+    else
+        emit result(merged);
+
+    if (last)
+        emit finished();
+}
@@ -0,0 +1,119 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef FAHRPLAN_MERGED_BOARD_H
+#define FAHRPLAN_MERGED_BOARD_H
+
+#include "parser/parser_abstract.h"
+
+#include <QList>
+#include <QObject>
+
+class FahrplanParserThread;
+
+// One departure or arrival board for several stops, e.g. the bays of a
+// bus station or the stop points of an EFA stop area. A parser handles a
+// single request at a time, so the stops are asked on a few parser
+// threads of their own next to the one of the backend manager, and the
+// boards are k-way merged into one list as they arrive.
+//
+// result() is emitted after every stop with the merge of all boards so
+// far, finished() once all stops answered or failed.
+class MergedBoard : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MaxParallelRequests = 4;
+
+    explicit MergedBoard(QObject *parent = 0);
+    ~MergedBoard();
+
+    // Drops the parser threads of the previous backend
+    void setParserIndex(int index);
+
+    void request(const StationsList &stations, const Station &directionStation, const QDateTime &dateTime,
+                 ParserAbstract::Mode mode, int trainrestrictions);
+    // Replaces the stops of the last request, even when that one finished
+    // already. Boards of stops that stay are kept, stops no longer in
+    // stations are not asked any more and leave the board.
+    void setStations(const StationsList &stations);
+    void cancel();
+    // A board was requested and not cancelled since
+    bool isActive() const;
+    bool isRunning() const;
+    StationsList stations() const;
+
+    // Merges boards sorted by time into one, starting at from and wrapping
+    // at midnight. Entries for the same trip (time, train and destination)
+    // are only kept once.
+    static TimetableEntriesList merge(const QList<TimetableEntriesList> &boards, const QTime &from);
+
+signals:
+    void result(const TimetableEntriesList &entries);
+    void finished();
+    void errorOccured(const QString &msg);
+    void requestTimingsRecorded(const RequestTimings &timings);
+
+private slots:
+    void onTimetableResult(const TimetableEntriesList &entries);
+    void onErrorOccured(const QString &msg);
+
+private:
+    struct Worker
+    {
+        FahrplanParserThread *thread;
+        int stop;       // -1 while idle
+    };
+
+    enum StopState {
+        Queued,
+        Asked,
+        Answered
+    };
+
+    struct Stop
+    {
+        Station station;
+        TimetableEntriesList board;
+        StopState state;
+    };
+
+    int m_parserIndex;
+    QList<Worker> m_workers;
+
+    QList<Stop> m_stops;
+    Station m_directionStation;
+    QDateTime m_dateTime;
+    ParserAbstract::Mode m_mode;
+    int m_trainrestrictions;
+    bool m_active;
+    QString m_error;
+
+    static int stopIndex(const QList<Stop> &stops, const Station &station);
+    int pendingStops() const;
+    int maxWorkers() const;
+    int workerIndex(QObject *thread) const;
+    void retireWorker(int index);
+    void dispatch();
+    void stopFinished(QObject *thread, const TimetableEntriesList &entries);
+    void publish();
+};
+
+#endif // FAHRPLAN_MERGED_BOARD_H
@@ -0,0 +1,464 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "fahrplan_network_thread.h"
+#include "fahrplan_log.h"
+
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QNetworkCookieJar>
+#include <QNetworkDiskCache>
+
+#if defined(BUILD_FOR_QT5)
+    #include <QStandardPaths>
+#else
+    #include <QDesktopServices>
+#endif
+
+//-------------- FahrplanNetworkResponse
+
+FahrplanNetworkResponse::FahrplanNetworkResponse()
+    : error(QNetworkReply::NoError)
+{}
+
+
+//-------------- FahrplanNetworkReply
+
+FahrplanNetworkReply::FahrplanNetworkReply(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, QObject *parent)
+    : QNetworkReply(parent)
+    , m_offset(0)
+    , m_done(false)
+{
+    m_timings.queuedAt = RequestTimings::now();
+    setOperation(operation);
+    setRequest(request);
+    setUrl(request.url());
+}
+
+void FahrplanNetworkReply::abort()
+{
+    if (m_done)
+        return;
+
+    // Same contract as QNetworkAccessManager: an aborted reply finishes
+    // right away with OperationCanceledError.
+    emit abortRequested();
+    setError(OperationCanceledError, tr("Operation canceled"));
+    m_content.clear();
+    m_offset = 0;
+    complete();
+}
+
+qint64 FahrplanNetworkReply::bytesAvailable() const
+{
+    return m_content.size() - m_offset + QIODevice::bytesAvailable();
+}
+
+bool FahrplanNetworkReply::isSequential() const
+{
+    return true;
+}
+
+RequestTimings FahrplanNetworkReply::timings() const
+{
+    return m_timings;
+}
+
+QByteArray FahrplanNetworkReply::receivedData() const
+{
+    return m_content;
+}
+
+bool FahrplanNetworkReply::isComplete() const
+{
+    return m_done;
+}
+
+void FahrplanNetworkReply::transferProgress(qint64 bytesReceived, qint64 bytesTotal)
+{
+    if (m_done)
+        return;
+
+    emit downloadProgress(bytesReceived, bytesTotal);
+}
+
+void FahrplanNetworkReply::transferMetaData(const FahrplanNetworkResponse &response)
+{
+    if (m_done)
+        return;
+
+    applyMetaData(response);
+    emit metaDataChanged();
+}
+
+void FahrplanNetworkReply::transferData(const QByteArray &data)
+{
+    if (m_done || data.isEmpty())
+        return;
+
+    m_content.append(data);
+    emit readyRead();
+}
+
+void FahrplanNetworkReply::transferCompleted(const FahrplanNetworkResponse &response)
+{
+    if (m_done)
+        return;
+
+    applyMetaData(response);
+    if (response.error != NoError)
+        setError(response.error, response.errorString);
+
+    m_content.append(response.content);
+    const qint64 queuedAt = m_timings.queuedAt;
+    m_timings = response.timings;
+    m_timings.queuedAt = queuedAt;
+    complete();
+}
+
+qint64 FahrplanNetworkReply::readData(char *data, qint64 maxSize)
+{
+    if (m_offset >= m_content.size())
+        return -1;
+
+    qint64 number = qMin(maxSize, m_content.size() - m_offset);
+    memcpy(data, m_content.constData() + m_offset, number);
+    m_offset += number;
+
+    return number;
+}
+
+void FahrplanNetworkReply::applyMetaData(const FahrplanNetworkResponse &response)
+{
+    setUrl(response.url);
+    for (QList<QPair<QByteArray, QByteArray> >::ConstIterator it = response.rawHeaders.constBegin(); it != response.rawHeaders.constEnd(); ++it)
+        setRawHeader(it->first, it->second);
+    if (response.httpStatusCode.isValid())
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, response.httpStatusCode);
+    if (response.httpReasonPhrase.isValid())
+        setAttribute(QNetworkRequest::HttpReasonPhraseAttribute, response.httpReasonPhrase);
+}
+
+void FahrplanNetworkReply::complete()
+{
+    m_done = true;
+    open(ReadOnly | Unbuffered);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    setFinished(true);
+#endif
+    if (!m_content.isEmpty())
+        emit readyRead();
+    emit finished();
+}
+
+
+//-------------- FahrplanNetworkTransfer
+
+// Header sizes are estimated from what Qt exposes, which leaves out a few
+// headers it adds on its own. Close enough for data usage accounting.
+static qint64 headerBytes(const QList<QPair<QByteArray, QByteArray> > &headers)
+{
+    qint64 bytes = 0;
+    for (QList<QPair<QByteArray, QByteArray> >::ConstIterator it = headers.constBegin(); it != headers.constEnd(); ++it)
+        bytes += it->first.size() + it->second.size() + 4;
+    return bytes;
+}
+
+static qint64 requestBytes(const QNetworkRequest &request, const QByteArray &data)
+{
+    QList<QPair<QByteArray, QByteArray> > headers;
+    foreach (const QByteArray &name, request.rawHeaderList())
+        headers.append(qMakePair(name, request.rawHeader(name)));
+
+    // Request line: method, path and protocol
+    return request.url().toEncoded().size() + 16 + headerBytes(headers) + data.size();
+}
+
+static qint64 responseBytes(QNetworkReply *reply, qint64 contentSize)
+{
+    if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool())
+        return 0;
+
+    // Qt inflates gzip transparently when it negotiated the encoding
+    // itself, Content-Length still tells what was actually transferred.
+    bool ok = false;
+    qint64 body = reply->rawHeader("Content-Length").toLongLong(&ok);
+    if (!ok)
+        body = contentSize;
+
+    return 16 + headerBytes(reply->rawHeaderPairs()) + body;
+}
+
+FahrplanNetworkTransfer::FahrplanNetworkTransfer(QNetworkAccessManager *manager, QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data, const QSet<QSslError::SslError> &ignoredSslErrors)
+    : QObject(0)
+    , m_manager(manager)
+    , m_operation(operation)
+    , m_request(request)
+    , m_data(data)
+    , m_ignoredSslErrors(ignoredSslErrors)
+    , m_reply(NULL)
+    , m_aborted(false)
+    , m_bytesForwarded(0)
+{
+}
+
+void FahrplanNetworkTransfer::start()
+{
+    if (m_aborted) {
+        deleteLater();
+        return;
+    }
+
+    m_timings.startedAt = RequestTimings::now();
+
+    if (m_operation == QNetworkAccessManager::PostOperation) {
+        m_reply = m_manager->post(m_request, m_data);
+    } else {
+        m_reply = m_manager->get(m_request);
+    }
+
+    connect(m_reply, SIGNAL(downloadProgress(qint64,qint64)), this, SIGNAL(downloadProgress(qint64,qint64)));
+    connect(m_reply, SIGNAL(sslErrors(QList<QSslError>)), this, SLOT(replySslErrors(QList<QSslError>)));
+    connect(m_reply, SIGNAL(metaDataChanged()), this, SLOT(replyMetaDataChanged()));
+    connect(m_reply, SIGNAL(readyRead()), this, SLOT(replyReadyRead()));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 1, 0)
+    connect(m_reply, SIGNAL(encrypted()), this, SLOT(replyEncrypted()));
+#endif
+    connect(m_reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+}
+
+void FahrplanNetworkTransfer::abort()
+{
+    m_aborted = true;
+    if (m_reply)
+        m_reply->abort();
+}
+
+void FahrplanNetworkTransfer::replyEncrypted()
+{
+    m_timings.encryptedAt = RequestTimings::now();
+}
+
+void FahrplanNetworkTransfer::replyMetaDataChanged()
+{
+    if (m_timings.firstByteAt < 0)
+        m_timings.firstByteAt = RequestTimings::now();
+
+    FahrplanNetworkResponse response;
+    response.url = m_reply->url();
+    response.rawHeaders = m_reply->rawHeaderPairs();
+    response.httpStatusCode = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    response.httpReasonPhrase = m_reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute);
+    emit metaDataReceived(response);
+}
+
+void FahrplanNetworkTransfer::replyReadyRead()
+{
+    // Forward the body as it comes in, so parsers can start on the first
+    // results while the rest is still on its way.
+    const QByteArray data = m_reply->readAll();
+    m_bytesForwarded += data.size();
+    emit dataReceived(data);
+}
+
+void FahrplanNetworkTransfer::replyFinished()
+{
+    m_timings.finishedAt = RequestTimings::now();
+    if (m_timings.firstByteAt < 0)
+        m_timings.firstByteAt = m_timings.finishedAt;
+
+    FahrplanNetworkResponse response;
+    response.url = m_reply->url();
+    response.content = m_reply->readAll();
+    response.rawHeaders = m_reply->rawHeaderPairs();
+    response.httpStatusCode = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    response.httpReasonPhrase = m_reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute);
+    response.error = m_reply->error();
+    response.errorString = m_reply->errorString();
+    response.timings = m_timings;
+    response.timings.bytesSent = requestBytes(m_request, m_data);
+    response.timings.bytesReceived = responseBytes(m_reply, m_bytesForwarded + response.content.size());
+    response.timings.bytesDecoded = m_bytesForwarded + response.content.size();
+
+    emit completed(response);
+
+    m_reply->deleteLater();
+    m_reply = NULL;
+    deleteLater();
+}
+
+void FahrplanNetworkTransfer::replySslErrors(const QList<QSslError> &errors)
+{
+    foreach (const QSslError &error, errors) {
+        fahrplanDebug(logNetwork) << Q_FUNC_INFO << error;
+        if (m_ignoredSslErrors.contains(error.error())) {
+            m_reply->ignoreSslErrors();
+            return;
+        }
+    }
+}
+
+
+//-------------- FahrplanNetworkThread
+
+FahrplanNetworkThread *FahrplanNetworkThread::m_instance = NULL;
+bool FahrplanNetworkThread::m_shutDown = false;
+static QMutex instanceMutex;
+
+FahrplanNetworkThread::FahrplanNetworkThread(QObject *parent) :
+    QThread(parent)
+{
+    qRegisterMetaType<FahrplanNetworkResponse>("FahrplanNetworkResponse");
+    setObjectName("Network");
+
+    m_manager = new QNetworkAccessManager();
+    m_manager->setCookieJar(new QNetworkCookieJar());
+
+    QNetworkDiskCache *cache = new QNetworkDiskCache();
+#if defined(BUILD_FOR_QT5)
+    cache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/network"));
+#else
+    cache->setCacheDirectory(QDesktopServices::storageLocation(QDesktopServices::CacheLocation) + QLatin1String("/network"));
+#endif
+    cache->setMaximumCacheSize(2 * 1024 * 1024);
+    m_manager->setCache(cache);
+
+    // Everything owned by the manager moves along with it, so the
+    // connection pool, cookie jar and cache are only ever touched here.
+    m_manager->moveToThread(this);
+    start();
+}
+
+FahrplanNetworkThread *FahrplanNetworkThread::instance()
+{
+    QMutexLocker locker(&instanceMutex);
+
+    if (!m_instance && !m_shutDown) {
+        m_instance = new FahrplanNetworkThread();
+        if (QCoreApplication::instance())
+            connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()), m_instance, SLOT(shutdown()));
+    }
+
+    return m_instance;
+}
+
+void FahrplanNetworkThread::shutdown()
+{
+    {
+        QMutexLocker locker(&instanceMutex);
+        if (m_instance == this) {
+            m_instance = NULL;
+            m_shutDown = true;
+        }
+    }
+
+    quit();
+    wait();
+}
+
+void FahrplanNetworkThread::run()
+{
+    exec();
+
+    // Destroyed in the thread it lives in. Open transfers are dropped with
+    // it, the disk cache writes out what it has.
+    delete m_manager;
+    m_manager = NULL;
+}
+
+FahrplanNetworkReply *FahrplanNetworkThread::get(const QNetworkRequest &request, QObject *parent, const QSet<QSslError::SslError> &ignoredSslErrors)
+{
+    return sendRequest(QNetworkAccessManager::GetOperation, request, QByteArray(), parent, ignoredSslErrors);
+}
+
+FahrplanNetworkReply *FahrplanNetworkThread::post(const QNetworkRequest &request, const QByteArray &data, QObject *parent, const QSet<QSslError::SslError> &ignoredSslErrors)
+{
+    return sendRequest(QNetworkAccessManager::PostOperation, request, data, parent, ignoredSslErrors);
+}
+
+FahrplanNetworkReply *FahrplanNetworkThread::sendRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data,
+                                                         QObject *parent, const QSet<QSslError::SslError> &ignoredSslErrors)
+{
+    FahrplanNetworkReply *reply = new FahrplanNetworkReply(operation, request, parent);
+
+    // Nothing would ever run the request once the application quits. The
+    // reply still finishes from the event loop, like a failed request of
+    // QNetworkAccessManager, so the caller can connect to it first.
+    FahrplanNetworkThread *thread = instance();
+    if (!thread) {
+        FahrplanNetworkResponse response;
+        response.url = request.url();
+        response.error = QNetworkReply::OperationCanceledError;
+        response.errorString = tr("The network thread has stopped");
+        QMetaObject::invokeMethod(reply, "transferCompleted", Qt::QueuedConnection, Q_ARG(FahrplanNetworkResponse, response));
+        return reply;
+    }
+
+    FahrplanNetworkTransfer *transfer = new FahrplanNetworkTransfer(thread->m_manager, operation, request, data, ignoredSslErrors);
+
+    // All connections are made before the transfer leaves this thread. Qt
+    // drops them automatically if either side is destroyed first.
+    connect(transfer, SIGNAL(downloadProgress(qint64,qint64)), reply, SLOT(transferProgress(qint64,qint64)), Qt::QueuedConnection);
+    connect(transfer, SIGNAL(metaDataReceived(FahrplanNetworkResponse)), reply, SLOT(transferMetaData(FahrplanNetworkResponse)), Qt::QueuedConnection);
+    connect(transfer, SIGNAL(dataReceived(QByteArray)), reply, SLOT(transferData(QByteArray)), Qt::QueuedConnection);
+    connect(transfer, SIGNAL(completed(FahrplanNetworkResponse)), reply, SLOT(transferCompleted(FahrplanNetworkResponse)), Qt::QueuedConnection);
+    connect(reply, SIGNAL(abortRequested()), transfer, SLOT(abort()), Qt::QueuedConnection);
+
+    transfer->moveToThread(thread);
+    QMetaObject::invokeMethod(transfer, "start", Qt::QueuedConnection);
+
+    return reply;
+}
+
+
+//-------------- FahrplanNetworkManager
+
+FahrplanNetworkManager::FahrplanNetworkManager(QObject *parent) :
+    QObject(parent)
+{
+}
+
+QNetworkReply *FahrplanNetworkManager::get(const QNetworkRequest &request)
+{
+    return track(FahrplanNetworkThread::get(request, this, m_ignoredSslErrors));
+}
+
+QNetworkReply *FahrplanNetworkManager::post(const QNetworkRequest &request, const QByteArray &data)
+{
+    return track(FahrplanNetworkThread::post(request, data, this, m_ignoredSslErrors));
+}
+
+void FahrplanNetworkManager::setIgnoredSslErrors(const QSet<QSslError::SslError> &errors)
+{
+    m_ignoredSslErrors = errors;
+}
+
+void FahrplanNetworkManager::replyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply)
+        emit finished(reply);
+}
+
+QNetworkReply *FahrplanNetworkManager::track(FahrplanNetworkReply *reply)
+{
+    connect(reply, SIGNAL(finished()), this, SLOT(replyFinished()));
+    return reply;
+}
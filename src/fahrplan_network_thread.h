@@ -0,0 +1,194 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef FAHRPLAN_NETWORK_THREAD_H
+#define FAHRPLAN_NETWORK_THREAD_H
+
+#include <QThread>
+#include <QMetaType>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSet>
+#include <QSslError>
+
+#include "fahrplan_request_timings.h"
+
+// Everything the network thread knows about a finished request. It is
+// handed over to the requesting thread in one piece so that parsers never
+// touch a QNetworkReply which lives in another thread.
+struct FahrplanNetworkResponse
+{
+    QUrl url;
+    QByteArray content; // the part of the body not yet sent as a chunk
+    QList<QPair<QByteArray, QByteArray> > rawHeaders;
+    QVariant httpStatusCode;
+    QVariant httpReasonPhrase;
+    QNetworkReply::NetworkError error;
+    QString errorString;
+    RequestTimings timings;
+
+public:
+    FahrplanNetworkResponse();
+};
+Q_DECLARE_METATYPE(FahrplanNetworkResponse)
+
+// Reply object handed out to the parsers. It lives in the thread that
+// issued the request. Headers and body chunks are forwarded while the
+// download is running, readyRead() is emitted for every chunk and
+// receivedData() gives everything so far without consuming it. The reply
+// is only readable once the network thread delivered the completed body.
+class FahrplanNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    explicit FahrplanNetworkReply(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, QObject *parent = 0);
+
+    void abort();
+    qint64 bytesAvailable() const;
+    bool isSequential() const;
+
+    RequestTimings timings() const;
+    QByteArray receivedData() const;
+    bool isComplete() const;
+
+signals:
+    void abortRequested();
+
+public slots:
+    void transferProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void transferMetaData(const FahrplanNetworkResponse &response);
+    void transferData(const QByteArray &data);
+    void transferCompleted(const FahrplanNetworkResponse &response);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+
+private:
+    QByteArray m_content;
+    qint64 m_offset;
+    bool m_done;
+    RequestTimings m_timings;
+
+    void applyMetaData(const FahrplanNetworkResponse &response);
+    void complete();
+};
+
+// Runs a single request inside the network thread and reports back
+// through queued signals only.
+class FahrplanNetworkTransfer : public QObject
+{
+    Q_OBJECT
+
+public:
+    FahrplanNetworkTransfer(QNetworkAccessManager *manager, QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data, const QSet<QSslError::SslError> &ignoredSslErrors);
+
+public slots:
+    void start();
+    void abort();
+
+signals:
+    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void metaDataReceived(const FahrplanNetworkResponse &response);
+    void dataReceived(const QByteArray &data);
+    void completed(const FahrplanNetworkResponse &response);
+
+private slots:
+    void replyEncrypted();
+    void replyMetaDataChanged();
+    void replyReadyRead();
+    void replyFinished();
+    void replySslErrors(const QList<QSslError> &errors);
+
+private:
+    QNetworkAccessManager *m_manager;
+    QNetworkAccessManager::Operation m_operation;
+    QNetworkRequest m_request;
+    QByteArray m_data;
+    QSet<QSslError::SslError> m_ignoredSslErrors;
+    QNetworkReply *m_reply;
+    bool m_aborted;
+    qint64 m_bytesForwarded;
+    RequestTimings m_timings;
+};
+
+// The one thread doing network I/O for every parser. It owns the only
+// QNetworkAccessManager, so connection pool, cookie jar and cache are
+// shared no matter how many parser threads are alive.
+class FahrplanNetworkThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    // NULL once the thread was shut down
+    static FahrplanNetworkThread *instance();
+
+    // After the shutdown the reply fails with OperationCanceledError
+    static FahrplanNetworkReply *get(const QNetworkRequest &request, QObject *parent = 0,
+                                     const QSet<QSslError::SslError> &ignoredSslErrors = QSet<QSslError::SslError>());
+    static FahrplanNetworkReply *post(const QNetworkRequest &request, const QByteArray &data, QObject *parent = 0,
+                                      const QSet<QSslError::SslError> &ignoredSslErrors = QSet<QSslError::SslError>());
+
+public slots:
+    // Called when the application is about to quit. Returns once the
+    // manager, and with it the cache, is gone and the thread finished.
+    void shutdown();
+
+protected:
+    void run();
+
+private:
+    explicit FahrplanNetworkThread(QObject *parent = 0);
+
+    static FahrplanNetworkReply *sendRequest(QNetworkAccessManager::Operation operation, const QNetworkRequest &request, const QByteArray &data,
+                                             QObject *parent, const QSet<QSslError::SslError> &ignoredSslErrors);
+
+    static FahrplanNetworkThread *m_instance;
+    static bool m_shutDown;
+    QNetworkAccessManager *m_manager;
+};
+
+// Per parser front end with the subset of the QNetworkAccessManager API
+// the parsers use. Requests are forwarded to FahrplanNetworkThread.
+class FahrplanNetworkManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FahrplanNetworkManager(QObject *parent = 0);
+
+    QNetworkReply *get(const QNetworkRequest &request);
+    QNetworkReply *post(const QNetworkRequest &request, const QByteArray &data);
+
+    void setIgnoredSslErrors(const QSet<QSslError::SslError> &errors);
+
+signals:
+    void finished(QNetworkReply *reply);
+
+private slots:
+    void replyFinished();
+
+private:
+    QSet<QSslError::SslError> m_ignoredSslErrors;
+
+    QNetworkReply *track(FahrplanNetworkReply *reply);
+};
+
+#endif // FAHRPLAN_NETWORK_THREAD_H
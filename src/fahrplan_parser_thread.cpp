@@ -18,6 +18,7 @@
 ****************************************************************************/
 
 #include "fahrplan_parser_thread.h"
+#include "fahrplan_trace.h"
 
 FahrplanParserThread::FahrplanParserThread(QObject *parent) :
     QThread(parent), m_ready(false)
@@ -27,10 +28,12 @@ FahrplanParserThread::FahrplanParserThread(QObject *parent) :
 
 void FahrplanParserThread::init(int parserIndex)
 {
+    FAHRPLAN_TRACE_SCOPE("parser", "FahrplanParserThread::init");
     if (this->isRunning()) {
         return;
     }
     i_parser = parserIndex;
+    setObjectName(QString("Parser %1").arg(parserIndex));
     start();
     while(!m_ready) msleep(50);
 }
@@ -43,41 +46,49 @@ int FahrplanParserThread::getParserIndex()
 
 void FahrplanParserThread::getTimeTableForStation(const Station &currentStation, const Station &directionStation, const QDateTime &dateTime, ParserAbstract::Mode mode, int trainrestrictions)
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestGetTimeTableForStation");
     emit requestGetTimeTableForStation(currentStation, directionStation, dateTime, mode, trainrestrictions);
 }
 
 void FahrplanParserThread::findStationsByName(const QString &stationName)
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestFindStationsByName");
     emit requestFindStationsByName(stationName);
 }
 
 void FahrplanParserThread::findStationsByCoordinates(qreal longitude, qreal latitude)
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestFindStationsByCoordinates");
     emit requestFindStationsByCoordinates(longitude, latitude);
 }
 
 void FahrplanParserThread::searchJourney(const Station &departureStation, const Station &viaStation, const Station &arrivalStation, const QDateTime &dateTime, ParserAbstract::Mode mode, int trainrestrictions)
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestSearchJourney");
     emit requestSearchJourney(departureStation, viaStation, arrivalStation, dateTime, mode, trainrestrictions);
 }
 
 void FahrplanParserThread::searchJourneyLater()
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestSearchJourneyLater");
     emit requestSearchJourneyLater();
 }
 
 void FahrplanParserThread::searchJourneyEarlier()
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestSearchJourneyEarlier");
     emit requestSearchJourneyEarlier();
 }
 
 void FahrplanParserThread::getJourneyDetails(const QString &id)
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestGetJourneyDetails");
     emit requestGetJourneyDetails(id);
 }
 
 void FahrplanParserThread::cancelRequest()
 {
+    FAHRPLAN_TRACE_INSTANT("parser", "requestCancelRequest");
     emit requestCancelRequest();
 }
 
@@ -172,6 +183,9 @@ void FahrplanParserThread::run()
         case 15:
             m_parser = new ParserTrentinoTrasporti();
             break;
+        case 16:
+            m_parser = new ParserGtfs();
+            break;
     }
 
     m_name = m_parser->name();
@@ -200,6 +214,9 @@ void FahrplanParserThread::run()
     connect(m_parser, SIGNAL(journeyResult(JourneyResultList*)), this, SIGNAL(journeyResult(JourneyResultList*)), Qt::QueuedConnection);
     connect(m_parser, SIGNAL(stationsResult(StationsList)), this, SIGNAL(stationsResult(StationsList)), Qt::QueuedConnection);
     connect(m_parser, SIGNAL(timetableResult(TimetableEntriesList)), this, SIGNAL(timeTableResult(TimetableEntriesList)), Qt::QueuedConnection);
+    connect(m_parser, SIGNAL(journeyPartialResult(JourneyResultList*)), this, SIGNAL(journeyPartialResult(JourneyResultList*)), Qt::QueuedConnection);
+    connect(m_parser, SIGNAL(timetablePartialResult(TimetableEntriesList)), this, SIGNAL(timeTablePartialResult(TimetableEntriesList)), Qt::QueuedConnection);
+    connect(m_parser, SIGNAL(requestTimingsRecorded(RequestTimings)), this, SIGNAL(requestTimingsRecorded(RequestTimings)), Qt::QueuedConnection);
 
     m_ready = true;
 
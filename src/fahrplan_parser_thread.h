@@ -41,6 +41,7 @@
 #include "parser/parser_vrr_efa.h"
 #include "parser/parser_search_ch.h"
 #include "parser/parser_trentino.h"
+#include "parser/parser_gtfs.h"
 
 class FahrplanParserThread : public QThread
 {
@@ -64,7 +65,10 @@ signals:
     void journeyResult(JourneyResultList *result);
     void journeyDetailsResult(JourneyDetailResultList *result);
     void timeTableResult(const TimetableEntriesList &result);
+    void journeyPartialResult(JourneyResultList *result);
+    void timeTablePartialResult(const TimetableEntriesList &result);
     void errorOccured(QString msg);
+    void requestTimingsRecorded(const RequestTimings &timings);
 
 public slots:
     void init(int parserIndex);
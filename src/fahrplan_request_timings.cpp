@@ -0,0 +1,143 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "fahrplan_request_timings.h"
+#include "parser/parser_definitions.h"
+
+#include <QElapsedTimer>
+
+static QElapsedTimer startedClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+static qint64 span(qint64 from, qint64 to)
+{
+    if (from < 0 || to < 0)
+        return -1;
+    return qMax(Q_INT64_C(0), to - from);
+}
+
+RequestTimings::RequestTimings()
+    : request(FahrplanNS::noneRequest)
+    , queuedAt(-1)
+    , startedAt(-1)
+    , encryptedAt(-1)
+    , firstByteAt(-1)
+    , finishedAt(-1)
+    , parsedAt(-1)
+    , deliveredAt(-1)
+    , decompressTime(0)
+    , parseTime(-1)
+    , modelUpdateTime(-1)
+    , bytesSent(-1)
+    , bytesReceived(-1)
+    , bytesDecoded(-1)
+{}
+
+bool RequestTimings::isValid() const
+{
+    return !backend.isEmpty() && queuedAt >= 0;
+}
+
+qint64 RequestTimings::duration(Phase phase) const
+{
+    switch (phase) {
+    case QueueWait:
+        return span(queuedAt, startedAt);
+    case Connect:
+        return span(startedAt, encryptedAt);
+    case TimeToFirstByte:
+        return span(startedAt, firstByteAt);
+    case Download:
+        return span(firstByteAt, finishedAt);
+    case Decompress:
+        return decompressTime;
+    case Parse:
+        return parseTime;
+    case Delivery:
+        return span(parsedAt, deliveredAt);
+    case ModelUpdate:
+        return modelUpdateTime;
+    case Total:
+        if (deliveredAt < 0)
+            return span(queuedAt, parsedAt);
+        return span(queuedAt, deliveredAt) + qMax(Q_INT64_C(0), modelUpdateTime);
+    default:
+        return -1;
+    }
+}
+
+qint64 RequestTimings::now()
+{
+    // Function local statics are initialized exactly once, even if the
+    // first call happens concurrently in several threads.
+    static const QElapsedTimer clock = startedClock();
+    return clock.elapsed();
+}
+
+QString RequestTimings::phaseName(Phase phase)
+{
+    switch (phase) {
+    case QueueWait:
+        return QLatin1String("queue");
+    case Connect:
+        return QLatin1String("connect");
+    case TimeToFirstByte:
+        return QLatin1String("ttfb");
+    case Download:
+        return QLatin1String("download");
+    case Decompress:
+        return QLatin1String("decompress");
+    case Parse:
+        return QLatin1String("parse");
+    case Delivery:
+        return QLatin1String("delivery");
+    case ModelUpdate:
+        return QLatin1String("model");
+    case Total:
+        return QLatin1String("total");
+    default:
+        return QString();
+    }
+}
+
+QString RequestTimings::requestName(int request)
+{
+    switch (request) {
+    case FahrplanNS::stationsByNameRequest:
+        return QLatin1String("stationsByName");
+    case FahrplanNS::stationsByCoordinatesRequest:
+        return QLatin1String("stationsByCoordinates");
+    case FahrplanNS::searchJourneyRequest:
+        return QLatin1String("searchJourney");
+    case FahrplanNS::searchJourneyLaterRequest:
+        return QLatin1String("searchJourneyLater");
+    case FahrplanNS::searchJourneyEarlierRequest:
+        return QLatin1String("searchJourneyEarlier");
+    case FahrplanNS::journeyDetailsRequest:
+        return QLatin1String("journeyDetails");
+    case FahrplanNS::getTimeTableForStationRequest:
+        return QLatin1String("timetable");
+    default:
+        return QLatin1String("none");
+    }
+}
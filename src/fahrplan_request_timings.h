@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef FAHRPLAN_REQUEST_TIMINGS_H
+#define FAHRPLAN_REQUEST_TIMINGS_H
+
+#include <QMetaType>
+#include <QString>
+
+// Timestamps of a single backend request on its way from the network
+// thread through the parser to the GUI models. All points in time are
+// milliseconds of one process wide monotonic clock (see now()), so they
+// can be compared across threads. Unknown points are -1.
+//
+// The request also carries its traffic: bytesSent and bytesReceived are
+// what went over the wire including headers (0 for cache hits),
+// bytesDecoded is the response body after decompression.
+struct RequestTimings
+{
+    enum Phase {
+        QueueWait = 0,      // request issued -> picked up by network thread
+        Connect,            // DNS, TCP connect and TLS handshake
+        TimeToFirstByte,    // request sent -> response headers received
+        Download,           // response headers -> last byte
+        Decompress,         // time spent in ParserAbstract::gzipDecompress
+        Parse,              // parse*() minus decompression
+        Delivery,           // parse finished -> result arrived in the GUI thread
+        ModelUpdate,        // setStationsList / setTimetableEntries
+        Total,              // request issued -> model updated
+        PhaseCount
+    };
+
+    QString backend;
+    int request;
+
+    qint64 queuedAt;
+    qint64 startedAt;
+    qint64 encryptedAt;
+    qint64 firstByteAt;
+    qint64 finishedAt;
+    qint64 parsedAt;
+    qint64 deliveredAt;
+
+    qint64 decompressTime;
+    qint64 parseTime;
+    qint64 modelUpdateTime;
+
+    qint64 bytesSent;
+    qint64 bytesReceived;
+    qint64 bytesDecoded;
+
+public:
+    RequestTimings();
+
+    bool isValid() const;
+    qint64 duration(Phase phase) const;
+
+    static qint64 now();
+    static QString phaseName(Phase phase);
+    static QString requestName(int request);
+};
+Q_DECLARE_METATYPE(RequestTimings)
+
+#endif // FAHRPLAN_REQUEST_TIMINGS_H
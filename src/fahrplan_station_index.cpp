@@ -0,0 +1,502 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "fahrplan_station_index.h"
+#include "fahrplan_log.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#if defined(BUILD_FOR_QT5)
+    #include <QStandardPaths>
+#else
+    #include <QDesktopServices>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const qreal pi = 3.14159265358979323846;
+    const qreal earthRadius = 6371000;
+    const qreal metersPerDegree = earthRadius * pi / 180;
+    // Degrees, about two kilometers north to south
+    const qreal cellSize = 0.02;
+    // Nearest-N searches look no further than this many cells around
+    const int maxRings = 50;
+    const int saveDelay = 5000;
+    const quint32 fileMagic = 0x46534958;
+    const quint32 fileVersion = 2;
+
+    // Weights of rank(), they add up to one. The text match dominates, of
+    // the stations matching equally well the nearby and familiar ones win.
+    const qreal textWeight = 0.45;
+    const qreal distanceWeight = 0.3;
+    const qreal usageWeight = 0.15;
+    const qreal orderWeight = 0.1;
+    // Distance at which a station gets half the distance score
+    const qreal distanceScale = 1000;
+    // Uses beyond this don't make a station any more familiar
+    const int saturatingUses = 20;
+
+    typedef std::pair<qreal, int> Candidate;
+
+    qreal toRadians(qreal degrees)
+    {
+        return degrees * pi / 180;
+    }
+
+    qreal metersPerLongitudeDegree(qreal latitude)
+    {
+        return metersPerDegree * std::cos(toRadians(qMin(qAbs(latitude), qreal(89))));
+    }
+
+    int cellIndex(qreal degrees)
+    {
+        return int(std::floor(degrees / cellSize));
+    }
+
+    qint64 cellKey(int row, int column)
+    {
+        return (qint64(row) << 32) | quint32(column);
+    }
+
+    qint64 cellKey(const Station &station)
+    {
+        return cellKey(cellIndex(station.latitude), cellIndex(station.longitude));
+    }
+
+    // Many backends leave both at 0 when they don't know
+    bool hasPosition(const Station &station)
+    {
+        return (station.latitude != 0 || station.longitude != 0)
+                && qAbs(station.latitude) <= 90 && qAbs(station.longitude) <= 180;
+    }
+
+    QString stationKey(const Station &station)
+    {
+        const QString id = station.id.toString();
+        return id.isEmpty() ? station.name : id;
+    }
+
+    // needle is simplified and case folded already
+    qreal textMatch(const QString &name, const QString &needle)
+    {
+        const QString haystack = name.simplified().toCaseFolded();
+        if (haystack == needle)
+            return 1;
+        if (haystack.startsWith(needle))
+            return 0.8;
+        const int at = haystack.indexOf(needle);
+        if (at > 0 && !haystack.at(at - 1).isLetterOrNumber())
+            return 0.6;
+        if (at > 0)
+            return 0.4;
+        // Backends also match aliases and misspellings
+        return 0;
+    }
+
+    qreal usageScore(int uses)
+    {
+        return qMin(qreal(1), std::log(qreal(1 + uses)) / std::log(qreal(1 + saturatingUses)));
+    }
+}
+
+StationIndex::StationIndex(QObject *parent)
+    : QObject(parent)
+    , m_saveTimer(new QTimer(this))
+{
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(saveDelay);
+    connect(m_saveTimer, SIGNAL(timeout()), this, SLOT(save()));
+}
+
+StationIndex::~StationIndex()
+{
+    if (m_saveTimer->isActive())
+        save();
+}
+
+void StationIndex::setBackend(const QString &uid)
+{
+    if (uid == m_backend)
+        return;
+
+    if (m_saveTimer->isActive())
+        save();
+
+    m_backend = uid;
+    m_entries.clear();
+    m_byId.clear();
+    m_cells.clear();
+    load();
+}
+
+void StationIndex::insert(const Station &station)
+{
+    if (add(station, QDateTime::currentMSecsSinceEpoch() / 1000)) {
+        evict();
+        m_saveTimer->start();
+    }
+}
+
+void StationIndex::recordUse(const Station &station)
+{
+    if (!add(station, QDateTime::currentMSecsSinceEpoch() / 1000))
+        return;
+
+    ++m_entries[m_byId.value(stationKey(station))].uses;
+    evict();
+    m_saveTimer->start();
+}
+
+int StationIndex::uses(const Station &station) const
+{
+    QHash<QString, int>::const_iterator it = m_byId.constFind(stationKey(station));
+    return it == m_byId.constEnd() ? 0 : m_entries.at(it.value()).uses;
+}
+
+void StationIndex::insert(const StationsList &stations)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    bool changed = false;
+    foreach (const Station &station, stations)
+        changed |= add(station, now);
+
+    if (changed) {
+        evict();
+        m_saveTimer->start();
+    }
+}
+
+bool StationIndex::add(const Station &station, qint64 lastSeen, quint32 uses)
+{
+    if (!hasPosition(station) || station.name.isEmpty())
+        return false;
+
+    Entry entry;
+    entry.station = station;
+    entry.station.valid = true;
+    // Distances and the like only fit the search they came with
+    entry.station.miscInfo.clear();
+    entry.lastSeen = lastSeen;
+    entry.uses = uses;
+
+    const QString key = stationKey(station);
+    QHash<QString, int>::const_iterator it = m_byId.constFind(key);
+    if (it == m_byId.constEnd()) {
+        m_byId.insert(key, m_entries.count());
+        m_cells[cellKey(station)].append(m_entries.count());
+        m_entries.append(entry);
+        return true;
+    }
+
+    const int index = it.value();
+    const qint64 oldCell = cellKey(m_entries.at(index).station);
+    if (oldCell != cellKey(station)) {
+        QVector<int> &cell = m_cells[oldCell];
+        cell.remove(cell.indexOf(index));
+        if (cell.isEmpty())
+            m_cells.remove(oldCell);
+        m_cells[cellKey(station)].append(index);
+    }
+    entry.uses = qMax(entry.uses, m_entries.at(index).uses);
+    m_entries[index] = entry;
+    return true;
+}
+
+void StationIndex::evict()
+{
+    if (m_entries.count() <= MaxStations)
+        return;
+
+    // Make room for a while, not just for the next station
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) {
+        return a.lastSeen > b.lastSeen;
+    });
+    m_entries.resize(MaxStations * 9 / 10);
+    rebuild();
+}
+
+void StationIndex::rebuild()
+{
+    m_byId.clear();
+    m_cells.clear();
+    for (int i = 0; i < m_entries.count(); ++i) {
+        m_byId.insert(stationKey(m_entries.at(i).station), i);
+        m_cells[cellKey(m_entries.at(i).station)].append(i);
+    }
+}
+
+StationsList StationIndex::nearest(qreal latitude, qreal longitude, int count) const
+{
+    if (count <= 0 || m_entries.isEmpty())
+        return StationsList();
+
+    const int row = cellIndex(latitude);
+    const int column = cellIndex(longitude);
+    std::vector<Candidate> found;
+
+    // Rings of cells around the position, until nothing beyond them can
+    // be closer than the count-th station found so far
+    for (int ring = 0; ring <= maxRings; ++ring) {
+        for (int r = row - ring; r <= row + ring; ++r) {
+            // Inner rows only have their first and last cell on the ring
+            const int step = (r == row - ring || r == row + ring) ? 1 : 2 * ring;
+            for (int c = column - ring; c <= column + ring; c += step) {
+                QHash<qint64, QVector<int> >::const_iterator cell = m_cells.constFind(cellKey(r, c));
+                if (cell == m_cells.constEnd())
+                    continue;
+                foreach (int index, cell.value()) {
+                    const Station &station = m_entries.at(index).station;
+                    found.push_back(Candidate(distance(latitude, longitude, station.latitude, station.longitude), index));
+                }
+            }
+        }
+
+        if (int(found.size()) >= count) {
+            std::nth_element(found.begin(), found.begin() + count - 1, found.end());
+            const qreal reach = ring * cellSize * qMin(metersPerDegree,
+                                                       metersPerLongitudeDegree(qAbs(latitude) + (ring + 1) * cellSize));
+            if (found[count - 1].first <= reach)
+                break;
+        }
+    }
+
+    const size_t taken = qMin(found.size(), size_t(count));
+    std::partial_sort(found.begin(), found.begin() + taken, found.end());
+
+    StationsList result;
+    for (size_t i = 0; i < taken; ++i)
+        result.append(m_entries.at(found[i].second).station);
+    return result;
+}
+
+StationsList StationIndex::withinRadius(qreal latitude, qreal longitude, qreal radius) const
+{
+    const qreal latitudeSpan = radius / metersPerDegree;
+    const qreal longitudeSpan = radius / metersPerLongitudeDegree(qAbs(latitude) + latitudeSpan);
+    const int firstRow = cellIndex(latitude - latitudeSpan);
+    const int lastRow = cellIndex(latitude + latitudeSpan);
+    const int firstColumn = cellIndex(longitude - longitudeSpan);
+    const int lastColumn = cellIndex(longitude + longitudeSpan);
+
+    std::vector<Candidate> found;
+    const auto consider = [&](int index) {
+        const Station &station = m_entries.at(index).station;
+        const qreal meters = distance(latitude, longitude, station.latitude, station.longitude);
+        if (meters <= radius)
+            found.push_back(Candidate(meters, index));
+    };
+
+    // A huge radius is cheaper to answer from the stations themselves
+    if (qint64(lastRow - firstRow + 1) * (lastColumn - firstColumn + 1) > m_cells.count()) {
+        for (int i = 0; i < m_entries.count(); ++i)
+            consider(i);
+    } else {
+        for (int r = firstRow; r <= lastRow; ++r) {
+            for (int c = firstColumn; c <= lastColumn; ++c) {
+                QHash<qint64, QVector<int> >::const_iterator cell = m_cells.constFind(cellKey(r, c));
+                if (cell == m_cells.constEnd())
+                    continue;
+                foreach (int index, cell.value())
+                    consider(index);
+            }
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    StationsList result;
+    for (size_t i = 0; i < found.size(); ++i)
+        result.append(m_entries.at(found[i].second).station);
+    return result;
+}
+
+StationsList StationIndex::rank(const StationsList &stations, const QString &query, qreal latitude, qreal longitude) const
+{
+    const int count = stations.count();
+    if (count < 2)
+        return stations;
+
+    QVector<qreal> latitudes(count);
+    QVector<qreal> longitudes(count);
+    QVector<qreal> meters(count);
+    for (int i = 0; i < count; ++i) {
+        latitudes[i] = stations.at(i).latitude;
+        longitudes[i] = stations.at(i).longitude;
+    }
+    distances(latitude, longitude, latitudes.constData(), longitudes.constData(), meters.data(), count);
+
+    const QString needle = query.simplified().toCaseFolded();
+    std::vector<Candidate> scored;
+    scored.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const Station &station = stations.at(i);
+        qreal score = orderWeight * (count - i) / count;
+        if (!needle.isEmpty())
+            score += textWeight * textMatch(station.name, needle);
+        if (hasPosition(station))
+            score += distanceWeight / (1 + meters.at(i) / distanceScale);
+        score += usageWeight * usageScore(uses(station));
+        // Ascending, ties keep the original order
+        scored.push_back(Candidate(-score, i));
+    }
+    std::sort(scored.begin(), scored.end());
+
+    StationsList result;
+    for (int i = 0; i < count; ++i)
+        result.append(stations.at(scored[i].second));
+    return result;
+}
+
+StationsList StationIndex::nearest(const StationsList &stations, qreal latitude, qreal longitude, int count)
+{
+    StationsList unique;
+    foreach (const Station &station, stations) {
+        if (!unique.contains(station))
+            unique.append(station);
+    }
+
+    const int size = unique.count();
+    QVector<qreal> latitudes(size);
+    QVector<qreal> longitudes(size);
+    QVector<qreal> meters(size);
+    for (int i = 0; i < size; ++i) {
+        latitudes[i] = unique.at(i).latitude;
+        longitudes[i] = unique.at(i).longitude;
+    }
+    distances(latitude, longitude, latitudes.constData(), longitudes.constData(), meters.data(), size);
+
+    std::vector<Candidate> found;
+    found.reserve(size);
+    for (int i = 0; i < size; ++i)
+        found.push_back(Candidate(hasPosition(unique.at(i)) ? meters.at(i) : std::numeric_limits<qreal>::max(), i));
+
+    const size_t taken = qMin(found.size(), size_t(qMax(count, 0)));
+    std::partial_sort(found.begin(), found.begin() + taken, found.end());
+
+    StationsList result;
+    for (size_t i = 0; i < taken; ++i)
+        result.append(unique.at(found[i].second));
+    return result;
+}
+
+qreal StationIndex::distance(qreal latitude1, qreal longitude1, qreal latitude2, qreal longitude2)
+{
+    qreal meters;
+    distances(latitude1, longitude1, &latitude2, &longitude2, &meters, 1);
+    return meters;
+}
+
+void StationIndex::distances(qreal latitude, qreal longitude, const qreal *latitudes, const qreal *longitudes,
+                             qreal *meters, int count)
+{
+    // Haversine, good to a few meters at these distances. Nothing but
+    // arithmetic and math functions in the loop, so it vectorizes where
+    // the compiler has vector versions of them (GCC with -ffast-math).
+    const qreal cosLatitude = std::cos(toRadians(latitude));
+    for (int i = 0; i < count; ++i) {
+        const qreal sinLatitude = std::sin(toRadians(latitudes[i] - latitude) / 2);
+        const qreal sinLongitude = std::sin(toRadians(longitudes[i] - longitude) / 2);
+        const qreal a = sinLatitude * sinLatitude
+                + cosLatitude * std::cos(toRadians(latitudes[i])) * sinLongitude * sinLongitude;
+        meters[i] = 2 * earthRadius * std::asin(std::sqrt(a < 1 ? a : qreal(1)));
+    }
+}
+
+QString StationIndex::fileName() const
+{
+#if defined(BUILD_FOR_QT5)
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+    const QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+    return dir + QString("/stations/%1.index").arg(m_backend);
+}
+
+void StationIndex::load()
+{
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_7);
+    quint32 magic;
+    quint32 version;
+    qint32 count;
+    in >> magic >> version >> count;
+    if (magic != fileMagic || version != fileVersion || count < 0) {
+        fahrplanWarning(logGui) << "Ignoring station index" << file.fileName();
+        return;
+    }
+
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        Station station(true);
+        double latitude;
+        double longitude;
+        qint64 lastSeen;
+        quint32 uses;
+        in >> station.id >> station.name >> station.type >> latitude >> longitude >> lastSeen >> uses;
+        station.latitude = latitude;
+        station.longitude = longitude;
+        if (in.status() == QDataStream::Ok)
+            add(station, lastSeen, uses);
+    }
+    fahrplanDebug(logGui) << "Loaded" << m_entries.count() << "stations from" << file.fileName();
+}
+
+void StationIndex::save()
+{
+    m_saveTimer->stop();
+    if (m_backend.isEmpty())
+        return;
+
+    const QString name = fileName();
+    QDir().mkpath(QFileInfo(name).absolutePath());
+
+    // Written aside and renamed, a crash never leaves half an index
+    QFile file(name + QLatin1String(".part"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fahrplanWarning(logGui) << "Cannot write station index" << file.fileName();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_7);
+    out << fileMagic << fileVersion << qint32(m_entries.count());
+    foreach (const Entry &entry, m_entries) {
+        const Station &station = entry.station;
+        out << station.id << station.name << station.type
+            << double(station.latitude) << double(station.longitude) << entry.lastSeen << entry.uses;
+    }
+    file.close();
+
+    QFile::remove(name);
+    if (!file.rename(name))
+        fahrplanWarning(logGui) << "Cannot write station index" << name;
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef FAHRPLAN_STATION_INDEX_H
+#define FAHRPLAN_STATION_INDEX_H
+
+#include "parser/parser_definitions.h"
+
+#include <QHash>
+#include <QObject>
+#include <QVector>
+
+class QTimer;
+
+// Every station with coordinates the current backend ever returned, on a
+// grid of cells a few kilometers wide. Answers nearest-N and radius
+// queries without the network, ranked by great-circle distance, so a GPS
+// search can show stations right away while the backend is still asked.
+// It also counts how often the user picked each station, which rank()
+// blends with the distance and the text match to reorder search results.
+//
+// One index per backend, kept in the data location and written a few
+// seconds after it changed. The least recently seen stations are dropped
+// beyond MaxStations.
+class StationIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MaxStations = 5000;
+
+    explicit StationIndex(QObject *parent = 0);
+    ~StationIndex();
+
+    // Saves the index of the previous backend and loads the one of uid
+    void setBackend(const QString &uid);
+
+    void insert(const Station &station);
+    void insert(const StationsList &stations);
+    // Inserts station and counts one more use of it
+    void recordUse(const Station &station);
+
+    int count() const { return m_entries.count(); }
+    int uses(const Station &station) const;
+    StationsList nearest(qreal latitude, qreal longitude, int count) const;
+    StationsList withinRadius(qreal latitude, qreal longitude, qreal radius) const;
+
+    // Orders stations by a blend of how well the name matches query (may
+    // be empty), the distance from latitude/longitude, how often they were
+    // used and their original order, best first.
+    StationsList rank(const StationsList &stations, const QString &query, qreal latitude, qreal longitude) const;
+
+    // The count stations nearest to latitude/longitude, duplicates
+    // dropped. Stations without coordinates come last in their order.
+    static StationsList nearest(const StationsList &stations, qreal latitude, qreal longitude, int count);
+
+    // Great-circle distance in meters
+    static qreal distance(qreal latitude1, qreal longitude1, qreal latitude2, qreal longitude2);
+    // The same from one point to count others, in one branch free loop
+    static void distances(qreal latitude, qreal longitude, const qreal *latitudes, const qreal *longitudes,
+                          qreal *meters, int count);
+
+public slots:
+    void save();
+
+private:
+    struct Entry
+    {
+        Station station;
+        qint64 lastSeen;    // seconds since the epoch
+        quint32 uses;
+    };
+
+    QString m_backend;
+    QVector<Entry> m_entries;
+    QHash<QString, int> m_byId;
+    QHash<qint64, QVector<int> > m_cells;
+    QTimer *m_saveTimer;
+
+    QString fileName() const;
+    void load();
+    bool add(const Station &station, qint64 lastSeen, quint32 uses = 0);
+    void evict();
+    void rebuild();
+};
+
+#endif // FAHRPLAN_STATION_INDEX_H
@@ -0,0 +1,281 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "fahrplan_trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+#include <atomic>
+
+namespace
+{
+    const int bufferCapacity = 4096;
+
+    // Seqlock protected slot: the owning thread is the only writer, dump()
+    // may read concurrently and skips slots that change underneath it.
+    struct TraceEvent
+    {
+        std::atomic<quint32> sequence;
+        const char *category;
+        const char *name;
+        qint64 start;
+        qint64 duration; // -1 for instant events
+    };
+
+    struct TraceBuffer
+    {
+        TraceEvent events[bufferCapacity];
+        std::atomic<quint32> head;
+        int tid;
+        QString threadName;
+        bool free;          // its thread quit, may be handed to a new one
+    };
+
+    struct TraceEventCopy
+    {
+        const char *category;
+        const char *name;
+        qint64 start;
+        qint64 duration;
+    };
+
+    // Events of threads that quit, their buffers went back to the pool
+    struct RetiredThread
+    {
+        int tid;
+        QString threadName;
+        QList<TraceEventCopy> events;
+    };
+
+    const int maxRetiredThreads = 16;
+
+    std::atomic<bool> tracingEnabled(false);
+
+    // Guards the list of buffers and the retired threads, never the events.
+    QMutex registryMutex;
+    QList<TraceBuffer *> registry;
+    QList<RetiredThread> retired;
+    int nextTid = 1;
+
+    // Copies out what the owning thread is not writing to right now
+    QList<TraceEventCopy> copyEvents(const TraceBuffer *buffer)
+    {
+        QList<TraceEventCopy> events;
+        quint32 head = buffer->head.load(std::memory_order_acquire);
+        quint32 begin = head > quint32(bufferCapacity) ? head - bufferCapacity : 0;
+        for (quint32 i = begin; i != head; ++i) {
+            const TraceEvent &event = buffer->events[i % bufferCapacity];
+            quint32 before = event.sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+            TraceEventCopy copy;
+            copy.category = event.category;
+            copy.name = event.name;
+            copy.start = event.start;
+            copy.duration = event.duration;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.sequence.load(std::memory_order_relaxed) != before)
+                continue;
+            events.append(copy);
+        }
+        return events;
+    }
+
+    // Keeps the events of a quitting thread for dump() and puts its
+    // buffer back, so threads coming and going don't add up.
+    struct BufferOwner
+    {
+        TraceBuffer *buffer;
+
+        ~BufferOwner()
+        {
+            if (!buffer)
+                return;
+
+            QMutexLocker locker(&registryMutex);
+            RetiredThread thread;
+            thread.tid = buffer->tid;
+            thread.threadName = buffer->threadName;
+            thread.events = copyEvents(buffer);
+            if (!thread.events.isEmpty()) {
+                retired.append(thread);
+                while (retired.count() > maxRetiredThreads)
+                    retired.removeFirst();
+            }
+            buffer->free = true;
+        }
+    };
+
+    thread_local BufferOwner localBuffer = { 0 };
+
+    TraceBuffer *threadBuffer()
+    {
+        if (localBuffer.buffer)
+            return localBuffer.buffer;
+
+        QMutexLocker locker(&registryMutex);
+        TraceBuffer *buffer = 0;
+        foreach (TraceBuffer *candidate, registry) {
+            if (candidate->free) {
+                buffer = candidate;
+                break;
+            }
+        }
+        if (!buffer) {
+            buffer = new TraceBuffer();
+            registry.append(buffer);
+        }
+
+        for (int i = 0; i < bufferCapacity; ++i)
+            buffer->events[i].sequence.store(0, std::memory_order_relaxed);
+        buffer->head.store(0, std::memory_order_relaxed);
+        buffer->free = false;
+        buffer->tid = nextTid++;
+        QThread *thread = QThread::currentThread();
+        if (thread && !thread->objectName().isEmpty())
+            buffer->threadName = thread->objectName();
+        else
+            buffer->threadName = QString("Thread %1").arg(buffer->tid);
+
+        localBuffer.buffer = buffer;
+        return buffer;
+    }
+
+    void addEvent(const char *category, const char *name, qint64 start, qint64 duration)
+    {
+        TraceBuffer *buffer = threadBuffer();
+        quint32 head = buffer->head.load(std::memory_order_relaxed);
+        TraceEvent &event = buffer->events[head % bufferCapacity];
+
+        quint32 sequence = event.sequence.load(std::memory_order_relaxed);
+        event.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        event.category = category;
+        event.name = name;
+        event.start = start;
+        event.duration = duration;
+        event.sequence.store(sequence + 2, std::memory_order_release);
+
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    QString jsonString(const char *text)
+    {
+        QString result = QString::fromLatin1(text);
+        result.replace('\\', QLatin1String("\\\\"));
+        result.replace('"', QLatin1String("\\\""));
+        return QLatin1Char('"') + result + QLatin1Char('"');
+    }
+
+    QString jsonString(const QString &text)
+    {
+        QString result = text;
+        result.replace('\\', QLatin1String("\\\\"));
+        result.replace('"', QLatin1String("\\\""));
+        return QLatin1Char('"') + result + QLatin1Char('"');
+    }
+}
+
+bool FahrplanTrace::isEnabled()
+{
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void FahrplanTrace::setEnabled(bool enabled)
+{
+    tracingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 FahrplanTrace::timestampUs()
+{
+    static const QElapsedTimer clock = []() {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.nsecsElapsed() / 1000;
+}
+
+void FahrplanTrace::addCompleteEvent(const char *category, const char *name, qint64 startUs, qint64 durationUs)
+{
+    addEvent(category, name, startUs, qMax(Q_INT64_C(0), durationUs));
+}
+
+void FahrplanTrace::addInstantEvent(const char *category, const char *name)
+{
+    addEvent(category, name, timestampUs(), -1);
+}
+
+bool FahrplanTrace::dump(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Cannot write trace to" << fileName;
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+
+    QMutexLocker locker(&registryMutex);
+    QList<RetiredThread> threads = retired;
+    foreach (TraceBuffer *buffer, registry) {
+        if (buffer->free)
+            continue;
+        // Copy out first, the owning thread keeps writing meanwhile.
+        RetiredThread thread;
+        thread.tid = buffer->tid;
+        thread.threadName = buffer->threadName;
+        thread.events = copyEvents(buffer);
+        threads.append(thread);
+    }
+    locker.unlock();
+
+    foreach (const RetiredThread &thread, threads) {
+        if (!first)
+            out << ",\n";
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << thread.tid
+            << ",\"args\":{\"name\":" << jsonString(thread.threadName) << "}}";
+
+        foreach (const TraceEventCopy &event, thread.events) {
+            out << ",\n{\"name\":" << jsonString(event.name)
+                << ",\"cat\":" << jsonString(event.category);
+            if (event.duration < 0)
+                out << ",\"ph\":\"i\",\"s\":\"t\"";
+            else
+                out << ",\"ph\":\"X\",\"dur\":" << event.duration;
+            out << ",\"ts\":" << event.start << ",\"pid\":" << pid << ",\"tid\":" << thread.tid << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    return true;
+}
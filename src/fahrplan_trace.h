@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef FAHRPLAN_TRACE_H
+#define FAHRPLAN_TRACE_H
+
+#include <QString>
+
+// Low overhead timeline tracing. Every thread records into its own ring
+// buffer without taking locks; dump() writes all buffers as Chrome
+// trace_event JSON which can be loaded into chrome://tracing or Perfetto.
+//
+// Names and categories must be string literals, only the pointers are
+// stored. When tracing is disabled a scope costs one atomic load. Threads
+// are labelled with their QThread::objectName().
+namespace FahrplanTrace
+{
+    bool isEnabled();
+    void setEnabled(bool enabled);
+
+    void addCompleteEvent(const char *category, const char *name, qint64 startUs, qint64 durationUs);
+    void addInstantEvent(const char *category, const char *name);
+    qint64 timestampUs();
+
+    bool dump(const QString &fileName);
+
+    class Scope
+    {
+    public:
+        Scope(const char *category, const char *name)
+            : m_category(category), m_name(name), m_start(isEnabled() ? timestampUs() : -1)
+        {}
+
+        ~Scope()
+        {
+            if (m_start >= 0)
+                addCompleteEvent(m_category, m_name, m_start, timestampUs() - m_start);
+        }
+
+    private:
+        const char *m_category;
+        const char *m_name;
+        qint64 m_start;
+    };
+}
+
+#ifdef FAHRPLAN_NO_TRACE
+    #define FAHRPLAN_TRACE_SCOPE(category, name)
+    #define FAHRPLAN_TRACE_INSTANT(category, name)
+#else
+    #define FAHRPLAN_TRACE_CONCAT_(a, b) a##b
+    #define FAHRPLAN_TRACE_CONCAT(a, b) FAHRPLAN_TRACE_CONCAT_(a, b)
+    #define FAHRPLAN_TRACE_SCOPE(category, name) \
+        FahrplanTrace::Scope FAHRPLAN_TRACE_CONCAT(fahrplanTraceScope, __LINE__)(category, name)
+    #define FAHRPLAN_TRACE_INSTANT(category, name) \
+        do { if (FahrplanTrace::isEnabled()) FahrplanTrace::addInstantEvent(category, name); } while (0)
+#endif
+
+#endif // FAHRPLAN_TRACE_H
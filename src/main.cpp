@@ -63,12 +63,15 @@
 #include "parser/parser_abstract.h"
 #include "fahrplan_parser_thread.h"
 #include "fahrplan_calendar_manager.h"
+#include "fahrplan_log.h"
 #include "models/stationsearchresults.h"
 #include "models/favorites.h"
 #include "models/timetable.h"
 #include "models/recentstations.h"
 #include "models/trainrestrictions.h"
 #include "models/backends.h"
+#include "models/requeststatistics.h"
+#include "models/bandwidthstatistics.h"
 
 #if defined(BUILD_FOR_SAILFISHOS)
 // since we don't clean up on calendar export at runtime
@@ -108,6 +111,8 @@ int main(int argc, char *argv[])
 {
     qsrand(QDateTime::currentDateTimeUtc().toTime_t());
 
+    FahrplanLog::setRules(QString::fromLocal8Bit(qgetenv("FAHRPLAN_LOG_RULES")));
+
     #if defined(BUILD_FOR_SAILFISHOS)
         //To support calendar access
         #if defined(BUILD_FOR_OPENREPOS)
@@ -153,6 +158,7 @@ int main(int argc, char *argv[])
     qRegisterMetaType<TimetableEntriesList>();
     qRegisterMetaType<Fahrplan::StationType>();
     qRegisterMetaType<Fahrplan::Mode>();
+    qRegisterMetaType<RequestTimings>("RequestTimings");
 
     #if defined(BUILD_FOR_HARMATTAN) || defined(BUILD_FOR_MAEMO_5) || defined(BUILD_FOR_SYMBIAN) || defined(BUILD_FOR_BLACKBERRY) || defined(BUILD_FOR_UBUNTU) || defined(BUILD_FOR_SAILFISHOS)
         qDebug()<<"QML";
@@ -178,6 +184,12 @@ int main(int argc, char *argv[])
         qmlRegisterUncreatableType<Backends>("Fahrplan", 1, 0, "Backends"
             , "Backends cannot be created from QML. "
               "Access it through FahrplanBackend.backends.");
+        qmlRegisterUncreatableType<RequestStatistics>("Fahrplan", 1, 0, "RequestStatistics"
+            , "RequestStatistics cannot be created from QML. "
+              "Access it through FahrplanBackend.requestStatistics.");
+        qmlRegisterUncreatableType<BandwidthStatistics>("Fahrplan", 1, 0, "BandwidthStatistics"
+            , "BandwidthStatistics cannot be created from QML. "
+              "Access it through FahrplanBackend.bandwidthStatistics.");
         qmlRegisterType<JourneyResultList>("Fahrplan", 1, 0, "JourneyResultList");
         qmlRegisterType<JourneyResultItem>("Fahrplan", 1, 0, "JourneyResultItem");
         qmlRegisterType<JourneyDetailResultList>("Fahrplan", 1, 0, "JourneyDetailResultList");
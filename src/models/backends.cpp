@@ -18,6 +18,7 @@
 ****************************************************************************/
 
 #include "backends.h"
+#include "fahrplan_trace.h"
 
 Backends::Backends(QObject *parent)
     : QAbstractListModel(parent)
@@ -84,6 +85,7 @@ int Backends::getParserIdForItemIndex(int index) const {
 
 void Backends::setBackendParserList(const QStringList &list)
 {
+    FAHRPLAN_TRACE_SCOPE("model", "Backends::setBackendParserList");
     beginResetModel();
     m_list = list;
     m_ordered.clear();
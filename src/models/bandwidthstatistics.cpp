@@ -0,0 +1,135 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "bandwidthstatistics.h"
+
+BandwidthStatistics::BandwidthStatistics(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_totalBytesSent(0)
+    , m_totalBytesReceived(0)
+{
+#if QT_VERSION < QT_VERSION_CHECK(5,0,0)
+    setRoleNames(roleNames());
+#endif
+}
+
+QHash<int, QByteArray> BandwidthStatistics::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(Backend, "backend");
+    roles.insert(Request, "request");
+    roles.insert(Requests, "requests");
+    roles.insert(BytesSent, "bytesSent");
+    roles.insert(BytesReceived, "bytesReceived");
+    roles.insert(BytesDecoded, "bytesDecoded");
+    return roles;
+}
+
+int BandwidthStatistics::count() const
+{
+    return rowCount();
+}
+
+int BandwidthStatistics::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_items.count();
+}
+
+QVariant BandwidthStatistics::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (index.row() < 0) || (index.row() >= m_items.count()))
+        return QVariant();
+
+    const Counters &item = m_items.at(index.row());
+
+    switch (role) {
+    case Backend:
+        return item.backend;
+    case Request:
+    case Qt::DisplayRole:
+        return RequestTimings::requestName(item.request);
+    case Requests:
+        return item.requests;
+    case BytesSent:
+        return item.bytesSent;
+    case BytesReceived:
+        return item.bytesReceived;
+    case BytesDecoded:
+        return item.bytesDecoded;
+    default:
+        return QVariant();
+    }
+}
+
+qint64 BandwidthStatistics::totalBytesSent() const
+{
+    return m_totalBytesSent;
+}
+
+qint64 BandwidthStatistics::totalBytesReceived() const
+{
+    return m_totalBytesReceived;
+}
+
+void BandwidthStatistics::addTimings(const RequestTimings &timings)
+{
+    if (!timings.isValid() || timings.bytesReceived < 0)
+        return;
+
+    int row = 0;
+    while (row < m_items.count() && (m_items.at(row).backend != timings.backend || m_items.at(row).request != timings.request))
+        ++row;
+
+    if (row == m_items.count()) {
+        beginInsertRows(QModelIndex(), row, row);
+        Counters item;
+        item.backend = timings.backend;
+        item.request = timings.request;
+        m_items.append(item);
+        endInsertRows();
+        emit countChanged();
+    }
+
+    Counters &item = m_items[row];
+    ++item.requests;
+    item.bytesSent += qMax(Q_INT64_C(0), timings.bytesSent);
+    item.bytesReceived += timings.bytesReceived;
+    item.bytesDecoded += qMax(Q_INT64_C(0), timings.bytesDecoded);
+    emit dataChanged(index(row), index(row));
+
+    m_totalBytesSent += qMax(Q_INT64_C(0), timings.bytesSent);
+    m_totalBytesReceived += timings.bytesReceived;
+    emit totalsChanged();
+}
+
+void BandwidthStatistics::clear()
+{
+    beginResetModel();
+    m_items.clear();
+    endResetModel();
+    emit countChanged();
+
+    m_totalBytesSent = 0;
+    m_totalBytesReceived = 0;
+    emit totalsChanged();
+}
@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef BANDWIDTHSTATISTICS_H
+#define BANDWIDTHSTATISTICS_H
+
+#include "fahrplan_request_timings.h"
+
+#include <QAbstractListModel>
+#include <QList>
+
+// Data used per backend and request type since the application started.
+class BandwidthStatistics : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(qint64 totalBytesSent READ totalBytesSent NOTIFY totalsChanged)
+    Q_PROPERTY(qint64 totalBytesReceived READ totalBytesReceived NOTIFY totalsChanged)
+
+public:
+    enum DisplayRoles {
+        Backend = Qt::UserRole,
+        Request,
+        Requests,
+        BytesSent,
+        BytesReceived,
+        BytesDecoded
+    };
+
+    explicit BandwidthStatistics(QObject *parent = 0);
+
+    QHash<int, QByteArray> roleNames() const;
+
+    int count() const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Backend) const;
+
+    qint64 totalBytesSent() const;
+    qint64 totalBytesReceived() const;
+
+    void addTimings(const RequestTimings &timings);
+
+public slots:
+    void clear();
+
+signals:
+    void countChanged();
+    void totalsChanged();
+
+private:
+    struct Counters
+    {
+        QString backend;
+        int request;
+        int requests;
+        qint64 bytesSent;
+        qint64 bytesReceived;
+        qint64 bytesDecoded;
+
+        Counters() : request(0), requests(0), bytesSent(0), bytesReceived(0), bytesDecoded(0) {}
+    };
+
+    QList<Counters> m_items;
+    qint64 m_totalBytesSent;
+    qint64 m_totalBytesReceived;
+};
+
+#endif // BANDWIDTHSTATISTICS_H
@@ -0,0 +1,205 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#include "requeststatistics.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+// Rotate the log once it grows beyond this, keeping one old generation.
+static const qint64 maxLogSize = 256 * 1024;
+
+static qint64 percentile(const QList<qint64> &sorted, int percent)
+{
+    if (sorted.isEmpty())
+        return -1;
+
+    // Nearest-rank method
+    int rank = (percent * sorted.count() + 99) / 100;
+    return sorted.at(qBound(0, rank - 1, sorted.count() - 1));
+}
+
+void RequestStatistics::PhaseSamples::add(qint64 value)
+{
+    samples.append(value);
+    if (samples.count() > MaxSamples)
+        samples.removeFirst();
+
+    QList<qint64> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    p50 = percentile(sorted, 50);
+    p95 = percentile(sorted, 95);
+    p99 = percentile(sorted, 99);
+}
+
+RequestStatistics::RequestStatistics(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_logEnabled(false)
+{
+#if QT_VERSION < QT_VERSION_CHECK(5,0,0)
+    setRoleNames(roleNames());
+#endif
+}
+
+QHash<int, QByteArray> RequestStatistics::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(Backend, "backend");
+    roles.insert(Phase, "phase");
+    roles.insert(Samples, "samples");
+    roles.insert(Last, "last");
+    roles.insert(P50, "p50");
+    roles.insert(P95, "p95");
+    roles.insert(P99, "p99");
+    return roles;
+}
+
+int RequestStatistics::count() const
+{
+    return rowCount();
+}
+
+int RequestStatistics::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return m_backends.count() * RequestTimings::PhaseCount;
+}
+
+QVariant RequestStatistics::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || (index.row() < 0) || (index.row() >= rowCount()))
+        return QVariant();
+
+    int backend = index.row() / RequestTimings::PhaseCount;
+    RequestTimings::Phase phase = static_cast<RequestTimings::Phase>(index.row() % RequestTimings::PhaseCount);
+    const PhaseSamples &item = m_phases.at(backend).at(phase);
+
+    switch (role) {
+    case Backend:
+        return m_backends.at(backend);
+    case Phase:
+    case Qt::DisplayRole:
+        return RequestTimings::phaseName(phase);
+    case Samples:
+        return item.samples.count();
+    case Last:
+        return item.samples.isEmpty() ? -1 : item.samples.last();
+    case P50:
+        return item.p50;
+    case P95:
+        return item.p95;
+    case P99:
+        return item.p99;
+    default:
+        return QVariant();
+    }
+}
+
+bool RequestStatistics::logEnabled() const
+{
+    return m_logEnabled;
+}
+
+void RequestStatistics::setLogEnabled(bool enabled)
+{
+    if (m_logEnabled == enabled)
+        return;
+
+    m_logEnabled = enabled;
+    emit logEnabledChanged();
+}
+
+void RequestStatistics::setLogFile(const QString &fileName)
+{
+    m_logFileName = fileName;
+}
+
+void RequestStatistics::addTimings(const RequestTimings &timings)
+{
+    if (!timings.isValid())
+        return;
+
+    int backend = m_backends.indexOf(timings.backend);
+    if (backend < 0) {
+        backend = m_backends.count();
+        beginInsertRows(QModelIndex(), backend * RequestTimings::PhaseCount, (backend + 1) * RequestTimings::PhaseCount - 1);
+        m_backends.append(timings.backend);
+        m_phases.append(QVector<PhaseSamples>(RequestTimings::PhaseCount));
+        endInsertRows();
+        emit countChanged();
+    }
+
+    QVector<PhaseSamples> &phases = m_phases[backend];
+    for (int i = 0; i < RequestTimings::PhaseCount; ++i) {
+        qint64 value = timings.duration(static_cast<RequestTimings::Phase>(i));
+        if (value >= 0)
+            phases[i].add(value);
+    }
+
+    emit dataChanged(index(backend * RequestTimings::PhaseCount), index((backend + 1) * RequestTimings::PhaseCount - 1));
+
+    if (m_logEnabled)
+        writeLog(timings);
+}
+
+void RequestStatistics::clear()
+{
+    beginResetModel();
+    m_backends.clear();
+    m_phases.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+void RequestStatistics::writeLog(const RequestTimings &timings)
+{
+    if (m_logFileName.isEmpty())
+        return;
+
+    QFile file(m_logFileName);
+    if (file.size() > maxLogSize) {
+        QFile::remove(m_logFileName + QLatin1String(".1"));
+        file.rename(m_logFileName + QLatin1String(".1"));
+        file.setFileName(m_logFileName);
+    }
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Cannot write request log" << m_logFileName;
+        return;
+    }
+
+    QTextStream out(&file);
+    out << QDateTime::currentDateTime().toString(Qt::ISODate)
+        << ' ' << timings.backend
+        << ' ' << RequestTimings::requestName(timings.request);
+    for (int i = 0; i < RequestTimings::PhaseCount; ++i) {
+        RequestTimings::Phase phase = static_cast<RequestTimings::Phase>(i);
+        out << ' ' << RequestTimings::phaseName(phase) << '=' << timings.duration(phase);
+    }
+    out << " sent=" << timings.bytesSent
+        << " received=" << timings.bytesReceived
+        << " decoded=" << timings.bytesDecoded;
+    out << '\n';
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+#ifndef REQUESTSTATISTICS_H
+#define REQUESTSTATISTICS_H
+
+#include "fahrplan_request_timings.h"
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+
+class RequestStatistics : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool logEnabled READ logEnabled WRITE setLogEnabled NOTIFY logEnabledChanged)
+
+public:
+    enum DisplayRoles {
+        Backend = Qt::UserRole,
+        Phase,
+        Samples,
+        Last,
+        P50,
+        P95,
+        P99
+    };
+
+    explicit RequestStatistics(QObject *parent = 0);
+
+    QHash<int, QByteArray> roleNames() const;
+
+    int count() const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Backend) const;
+
+    bool logEnabled() const;
+    void setLogEnabled(bool enabled);
+    void setLogFile(const QString &fileName);
+
+    void addTimings(const RequestTimings &timings);
+
+public slots:
+    void clear();
+
+signals:
+    void countChanged();
+    void logEnabledChanged();
+
+private:
+    // Only the most recent samples are kept, which is plenty for
+    // percentiles and keeps memory bounded on long running sessions.
+    static const int MaxSamples = 200;
+
+    struct PhaseSamples
+    {
+        QList<qint64> samples;
+        qint64 p50;
+        qint64 p95;
+        qint64 p99;
+
+        PhaseSamples() : p50(-1), p95(-1), p99(-1) {}
+        void add(qint64 value);
+    };
+
+    QStringList m_backends;
+    QList<QVector<PhaseSamples> > m_phases;
+    bool m_logEnabled;
+    QString m_logFileName;
+
+    void writeLog(const RequestTimings &timings);
+};
+
+#endif // REQUESTSTATISTICS_H
@@ -18,6 +18,7 @@
 ****************************************************************************/
 
 #include "stationslistmodel.h"
+#include "fahrplan_trace.h"
 
 StationsListModel::StationsListModel(QObject *parent)
     : QAbstractListModel(parent)
@@ -88,8 +89,14 @@ Station StationsListModel::getStation(int index) const
     return m_list.at(index);
 }
 
+StationsList StationsListModel::stationsList() const
+{
+    return m_list;
+}
+
 void StationsListModel::setStationsList(const StationsList &list)
 {
+    FAHRPLAN_TRACE_SCOPE("model", "StationsListModel::setStationsList");
     beginResetModel();
     m_list = list;
     endResetModel();
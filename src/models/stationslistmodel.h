@@ -50,6 +50,7 @@ public:
     QVariant data(const QModelIndex &index, int role = Name) const;
 
     Station getStation(int index) const;
+    StationsList stationsList() const;
     void setStationsList(const StationsList &list);
 
 public slots:
@@ -18,9 +18,11 @@
 ****************************************************************************/
 
 #include "timetable.h"
+#include "fahrplan_trace.h"
 
 Timetable::Timetable(QObject *parent)
     : QAbstractListModel(parent)
+    , m_partialCount(0)
 {
 #if QT_VERSION < QT_VERSION_CHECK(5,0,0)
     setRoleNames(roleNames());
@@ -84,14 +86,62 @@ QVariant Timetable::data(const QModelIndex &index, int role) const
 
 void Timetable::setTimetableEntries(const TimetableEntriesList &list)
 {
+    FAHRPLAN_TRACE_SCOPE("model", "Timetable::setTimetableEntries");
+
+    // Only add what did not arrive as partial result yet, so the view
+    // keeps its position.
+    if (m_partialCount > 0 && m_partialCount == m_list.count() && list.count() >= m_partialCount) {
+        const int partialCount = m_partialCount;
+        m_partialCount = 0;
+        if (list.count() > partialCount) {
+            beginInsertRows(QModelIndex(), partialCount, list.count() - 1);
+            m_list = list;
+            endInsertRows();
+            emit countChanged();
+        } else {
+            m_list = list;
+        }
+        // The complete reply may still differ in the rows shown before
+        emit dataChanged(index(0), index(partialCount - 1));
+        return;
+    }
+
+    m_partialCount = 0;
     beginResetModel();
     m_list = list;
     endResetModel();
     emit countChanged();
 }
 
+void Timetable::appendTimetableEntries(const TimetableEntriesList &list)
+{
+    FAHRPLAN_TRACE_SCOPE("model", "Timetable::appendTimetableEntries");
+
+    // First rows of a new reply replace whatever was shown before
+    if (m_partialCount == 0 && !m_list.isEmpty()) {
+        beginResetModel();
+        m_list.clear();
+        endResetModel();
+    }
+
+    if (!list.isEmpty()) {
+        beginInsertRows(QModelIndex(), m_list.count(), m_list.count() + list.count() - 1);
+        m_list.append(list);
+        m_partialCount = m_list.count();
+        endInsertRows();
+    }
+    emit countChanged();
+}
+
+// The rows shown stay, but the next partial result starts a new list
+void Timetable::resetPartialEntries()
+{
+    m_partialCount = 0;
+}
+
 void Timetable::clear()
 {
+    m_partialCount = 0;
     beginResetModel();
     m_list.clear();
     endResetModel();
@@ -50,8 +50,10 @@ public:
     QVariant data(const QModelIndex &index, int role = CurrentStation) const;
 
     void setTimetableEntries(const TimetableEntriesList &list);
+    void appendTimetableEntries(const TimetableEntriesList &list);
 
 public slots:
+    void resetPartialEntries();
     void clear();
 
 signals:
@@ -59,6 +61,9 @@ signals:
 
 private:
     TimetableEntriesList m_list;
+    // Rows appended while the reply was still downloading. They are the
+    // head of the complete list which setTimetableEntries() receives.
+    int m_partialCount;
 };
 
 #endif // TIMETABLERESULTS_H
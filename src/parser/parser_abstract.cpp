@@ -18,8 +18,10 @@
 ****************************************************************************/
 
 #include "parser_abstract.h"
+#include "fahrplan_network_thread.h"
+#include "fahrplan_trace.h"
+#include "fahrplan_log.h"
 
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QSslError>
@@ -27,13 +29,11 @@
 
 #include <zlib.h>
 
+#include <atomic>
+
 #ifdef BUILD_FOR_QT5
-#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#else
-#include <QScriptEngine>
-#include <QScriptValue>
 #endif
 
 #ifdef BUILD_FOR_UBUNTU
@@ -46,13 +46,16 @@
 #include "3rdparty/qcustomnetworkreply/qcustomnetworkreply.h"
 #endif
 
+static std::atomic<bool> dataSaver(false);
+
 ParserAbstract::ParserAbstract(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    sessionStrings(4096)
 {
-    NetworkManager = new QNetworkAccessManager(this);
+    // Requests are carried out by the shared network thread, the parser
+    // only gets the completed reply handed back.
+    NetworkManager = new FahrplanNetworkManager(this);
     connect(NetworkManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(networkReplyFinished(QNetworkReply*)));
-    connect(NetworkManager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)),
-            this, SLOT(networkReplySslErrors(QNetworkReply*,QList<QSslError>)));
 
     currentRequestState = FahrplanNS::noneRequest;
 
@@ -76,6 +79,7 @@ void ParserAbstract::networkReplyFinished(QNetworkReply *networkReply)
     FahrplanNS::curReqStates internalRequestState = currentRequestState;
 
     disconnect(lastRequest, SIGNAL(downloadProgress(qint64,qint64)), 0, 0);
+    disconnect(lastRequest, SIGNAL(readyRead()), 0, 0);
     requestTimeout->stop();
 
     lastRequest = NULL;
@@ -84,23 +88,53 @@ void ParserAbstract::networkReplyFinished(QNetworkReply *networkReply)
     //if needed inside the parser
     currentRequestState = FahrplanNS::noneRequest;
 
+    FahrplanNetworkReply *reply = qobject_cast<FahrplanNetworkReply *>(networkReply);
+    currentRequestTimings = reply ? reply->timings() : RequestTimings();
+    currentRequestTimings.backend = shortName();
+    currentRequestTimings.request = internalRequestState;
+    const qint64 parseStartedAt = RequestTimings::now();
+
     if (internalRequestState == FahrplanNS::stationsByNameRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseStationsByName");
         parseStationsByName(networkReply);
     } else if (internalRequestState == FahrplanNS::stationsByCoordinatesRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseStationsByCoordinates");
         parseStationsByCoordinates(networkReply);
     } else if (internalRequestState == FahrplanNS::searchJourneyRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseSearchJourney");
         parseSearchJourney(networkReply);
     } else if (internalRequestState == FahrplanNS::searchJourneyLaterRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseSearchLaterJourney");
         parseSearchLaterJourney(networkReply);
     } else if (internalRequestState == FahrplanNS::searchJourneyEarlierRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseSearchEarlierJourney");
         parseSearchEarlierJourney(networkReply);
     } else if (internalRequestState == FahrplanNS::journeyDetailsRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseJourneyDetails");
         parseJourneyDetails(networkReply);
     } else if (internalRequestState == FahrplanNS::getTimeTableForStationRequest) {
+        FAHRPLAN_TRACE_SCOPE("parser", "parseTimeTable");
         parseTimeTable(networkReply);
     } else {
-        qDebug()<<"Current request unhandled!";
+        fahrplanDebug(logParser) << "Current request unhandled!";
     }
+
+    responseStrings.clear();
+
+    currentRequestTimings.parsedAt = RequestTimings::now();
+    currentRequestTimings.parseTime = qMax(Q_INT64_C(0), currentRequestTimings.parsedAt - parseStartedAt - currentRequestTimings.decompressTime);
+    if (currentRequestTimings.isValid())
+        emit requestTimingsRecorded(currentRequestTimings);
+}
+
+bool ParserAbstract::dataSaverEnabled()
+{
+    return dataSaver.load(std::memory_order_relaxed);
+}
+
+void ParserAbstract::setDataSaverEnabled(bool enabled)
+{
+    dataSaver.store(enabled, std::memory_order_relaxed);
 }
 
 void ParserAbstract::cancelRequest()
@@ -123,17 +157,23 @@ void ParserAbstract::sendHttpRequest(QUrl url, QByteArray data, const QList<QPai
     }
     #endif
 
+    FAHRPLAN_TRACE_SCOPE("parser", "ParserAbstract::sendHttpRequest");
+
     QNetworkRequest request;
     request.setUrl(url);
     request.setHeader(QNetworkRequest::ContentTypeHeader, QLatin1String("application/x-www-form-urlencoded"));
     request.setRawHeader("User-Agent", userAgent.toLatin1());
-    request.setRawHeader("Cache-Control", "no-cache");
+    // Without no-cache the disk cache answers or revalidates responses
+    // which the server declared fresh.
+    if (!dataSaverEnabled())
+        request.setRawHeader("Cache-Control", "no-cache");
     for (QList<QPair<QByteArray,QByteArray> >::ConstIterator it = additionalHeaders.constBegin(); it != additionalHeaders.constEnd(); ++it)
         request.setRawHeader(it->first, it->second);
     if (!acceptEncoding.isEmpty()) {
         request.setRawHeader("Accept-Encoding", acceptEncoding);
     }
 
+    NetworkManager->setIgnoredSslErrors(ignoredSslErrors);
     if (data.isNull()) {
         lastRequest = NetworkManager->get(request);
     } else {
@@ -143,28 +183,12 @@ void ParserAbstract::sendHttpRequest(QUrl url, QByteArray data, const QList<QPai
     requestTimeout->start(30000);
 
     connect(lastRequest, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(networkReplyDownloadProgress(qint64,qint64)));
+    connect(lastRequest, SIGNAL(readyRead()), this, SLOT(networkReplyReadyRead()));
 }
 
-QVariantMap ParserAbstract::parseJson(const QByteArray &json) const
+JsonValue ParserAbstract::parseJson(const QByteArray &json) const
 {
-    QVariantMap doc;
-#ifdef BUILD_FOR_QT5
-    doc = QJsonDocument::fromJson(json).toVariant().toMap();
-#else
-    QString utf8(QString::fromUtf8(json));
-
-    // Validation of JSON according to RFC 4627, section 6
-    QString tmp(utf8);
-    if (tmp.replace(QRegExp("\"(\\\\.|[^\"\\\\])*\""), "")
-           .contains(QRegExp("[^,:{}\\[\\]0-9.\\-+Eaeflnr-u \\n\\r\\t]")))
-        return doc;
-
-    QScriptEngine *engine = new QScriptEngine();
-    doc = engine->evaluate("(" + utf8 + ")").toVariant().toMap();
-    delete engine;
-#endif
-
-    return doc;
+    return JsonValue::fromJson(json);
 }
 
 #ifdef BUILD_FOR_QT5
@@ -207,7 +231,7 @@ QByteArray toJson(const QVariant& value)
         return "[" + elements.join(", ").toUtf8() + "]";
     }
     default:
-        qDebug() << "Failed to serialize" << value << "to JSON";
+        fahrplanDebug(logParser) << "Failed to serialize" << value << "to JSON";
         return "";
     }
 }
@@ -226,27 +250,21 @@ void ParserAbstract::networkReplyDownloadProgress(qint64 bytesReceived, qint64 b
     requestTimeout->start(30000);
 }
 
-void ParserAbstract::networkReplyTimedOut()
+void ParserAbstract::networkReplyReadyRead()
 {
-    cancelRequest();
-    emit errorOccured(tr("Request timed out."));
+    // The completed reply goes through networkReplyFinished()
+    FahrplanNetworkReply *reply = qobject_cast<FahrplanNetworkReply *>(sender());
+    if (!reply || reply != lastRequest || reply->isComplete())
+        return;
+
+    FAHRPLAN_TRACE_SCOPE("parser", "parsePartialReply");
+    parsePartialReply(currentRequestState, reply, reply->receivedData());
 }
 
-void ParserAbstract::networkReplySslErrors(QNetworkReply *reply, const QList<QSslError> &errors)
+void ParserAbstract::networkReplyTimedOut()
 {
-    if (lastRequest != reply) {
-        qDebug() << Q_FUNC_INFO << "Wrong network reply - ignoring. Expected" << lastRequest
-                 << "received" << reply;
-        return;
-    }
-
-    foreach (const QSslError &error, errors) {
-        qDebug() << Q_FUNC_INFO << error;
-        if (ignoredSslErrors.contains(error.error())) {
-            reply->ignoreSslErrors();
-            return;
-        }
-    }
+    cancelRequest();
+    emit errorOccured(tr("Request timed out."));
 }
 
 void ParserAbstract::sendHttpRequest(QUrl url)
@@ -282,7 +300,7 @@ QStringList ParserAbstract::getTrainRestrictions()
 
 void ParserAbstract::getTimeTableForStation(const Station &currentStation, const Station &directionStation, const QDateTime &dateTtime, Mode mode, int trainrestrictions)
 {
-    qDebug() << "ParserAbstract::getTimeTableForStation";
+    fahrplanDebug(logParser) << "ParserAbstract::getTimeTableForStation";
     Q_UNUSED(currentStation);
     Q_UNUSED(directionStation);
     Q_UNUSED(dateTtime);
@@ -293,7 +311,7 @@ void ParserAbstract::getTimeTableForStation(const Station &currentStation, const
 void ParserAbstract::parseTimeTable(QNetworkReply *networkReply)
 {
    Q_UNUSED(networkReply);
-   qDebug() << "ParserAbstract::parseTimeTable";
+   fahrplanDebug(logParser) << "ParserAbstract::parseTimeTable";
 }
 
 void ParserAbstract::findStationsByName(const QString &stationName)
@@ -310,13 +328,13 @@ void ParserAbstract::findStationsByCoordinates(qreal longitude, qreal latitude)
  void ParserAbstract::parseStationsByName(QNetworkReply *networkReply)
  {
     Q_UNUSED(networkReply);
-    qDebug() << "ParserAbstract::parseStationsByName";
+    fahrplanDebug(logParser) << "ParserAbstract::parseStationsByName";
  }
 
  void ParserAbstract::parseStationsByCoordinates(QNetworkReply *networkReply)
  {
      Q_UNUSED(networkReply);
-     qDebug() << "ParserAbstract::parseStationsByCoordinates";
+     fahrplanDebug(logParser) << "ParserAbstract::parseStationsByCoordinates";
  }
 
  void ParserAbstract::searchJourney(const Station &departureStation, const Station &viaStation, const Station &arrivalStation, const QDateTime &dateTime, Mode mode, int trainrestrictions)
@@ -327,52 +345,62 @@ void ParserAbstract::findStationsByCoordinates(qreal longitude, qreal latitude)
      Q_UNUSED(dateTime);
      Q_UNUSED(mode);
      Q_UNUSED(trainrestrictions);
-     qDebug() << "ParserAbstract::searchJourney";
+     fahrplanDebug(logParser) << "ParserAbstract::searchJourney";
  }
 
  void ParserAbstract::parseSearchJourney(QNetworkReply *networkReply)
  {
      Q_UNUSED(networkReply);
-     qDebug() << "ParserAbstract::parseSearchJourney";
+     fahrplanDebug(logParser) << "ParserAbstract::parseSearchJourney";
  }
 
  void ParserAbstract::searchJourneyLater()
  {
-     qDebug() << "ParserAbstract::searchJourneyLater";
+     fahrplanDebug(logParser) << "ParserAbstract::searchJourneyLater";
  }
 
  void ParserAbstract::searchJourneyEarlier()
  {
-     qDebug() << "ParserAbstract::searchJourneyEarlier";
+     fahrplanDebug(logParser) << "ParserAbstract::searchJourneyEarlier";
  }
 
  void ParserAbstract::parseSearchLaterJourney(QNetworkReply *networkReply)
  {
      Q_UNUSED(networkReply);
-     qDebug() << "ParserAbstract::parseSearchLaterJourney";
+     fahrplanDebug(logParser) << "ParserAbstract::parseSearchLaterJourney";
  }
 
  void ParserAbstract::parseSearchEarlierJourney(QNetworkReply *networkReply)
  {
      Q_UNUSED(networkReply);
-     qDebug() << "ParserAbstract::parseSearchEarlierJourney";
+     fahrplanDebug(logParser) << "ParserAbstract::parseSearchEarlierJourney";
  }
 
  void ParserAbstract::getJourneyDetails(const QString &id)
  {
      Q_UNUSED(id);
-     qDebug() << "ParserAbstract::getJourneyDetails";
+     fahrplanDebug(logParser) << "ParserAbstract::getJourneyDetails";
  }
 
  void ParserAbstract::parseJourneyDetails(QNetworkReply *networkReply)
  {
      Q_UNUSED(networkReply);
-     qDebug() << "ParserAbstract::parseJourneyDetails";
+     fahrplanDebug(logParser) << "ParserAbstract::parseJourneyDetails";
+ }
+
+ // Parsers which can decode a partial reply override this and emit the
+ // *PartialResult signals. The default waits for the complete reply.
+ void ParserAbstract::parsePartialReply(FahrplanNS::curReqStates request, QNetworkReply *networkReply, const QByteArray &received)
+ {
+     Q_UNUSED(request);
+     Q_UNUSED(networkReply);
+     Q_UNUSED(received);
  }
 
  QByteArray ParserAbstract::gzipDecompress(QByteArray compressData)
  {
      //decompress GZIP data
+     const qint64 startedAt = RequestTimings::now();
 
      const int buffersize = 16384;
      quint8 buffer[buffersize];
@@ -388,7 +416,7 @@ void ParserAbstract::findStationsByCoordinates(qreal longitude, qreal latitude)
      // We get data in gzip format, and to parse it, according
      // to the documentation, we need to add 16 to windowBits.
      if (inflateInit2(&cmpr_stream, MAX_WBITS + 16) != Z_OK) {
-         qDebug() << "cmpr_stream error!";
+         fahrplanDebug(logParser) << "cmpr_stream error!";
      }
 
      QByteArray uncompressed;
@@ -409,6 +437,10 @@ void ParserAbstract::findStationsByCoordinates(qreal longitude, qreal latitude)
              break;
          }
      } while(cmpr_stream.avail_out == 0);
+
+     currentRequestTimings.decompressTime += RequestTimings::now() - startedAt;
+     if (currentRequestTimings.bytesDecoded >= 0)
+         currentRequestTimings.bytesDecoded += uncompressed.size() - compressData.size();
      return uncompressed;
  }
 
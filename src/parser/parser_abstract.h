@@ -24,8 +24,11 @@
 #include <QStringList>
 #include <QSslError>
 #include "parser_definitions.h"
+#include "parser_json.h"
+#include "parser_stringpool.h"
+#include "fahrplan_request_timings.h"
 
-class QNetworkAccessManager;
+class FahrplanNetworkManager;
 class QNetworkReply;
 class QTimer;
 class QUrl;
@@ -45,6 +48,11 @@ public:
     virtual QString shortName() { return getName(); }
     virtual QString uid() { return metaObject()->className(); }
 
+    // Shared by all parsers, parsers ask for smaller result sets and
+    // cached responses are reused while it is enabled.
+    static bool dataSaverEnabled();
+    static void setDataSaverEnabled(bool enabled);
+
 public slots:
     virtual void getTimeTableForStation(const Station &currentStation, const Station &directionStation, const QDateTime &dateTtime, ParserAbstract::Mode mode, int trainrestrictions);
     virtual void findStationsByName(const QString &stationName);
@@ -65,23 +73,35 @@ signals:
     void journeyResult(JourneyResultList *result);
     void journeyDetailsResult(JourneyDetailResultList *result);
     void timetableResult(const TimetableEntriesList &timetableEntries);
+    // Emitted while a reply is still downloading. journeyPartialResult
+    // carries all journeys decoded so far, timetablePartialResult only the
+    // entries decoded since the last emission. The complete result follows
+    // through journeyResult / timetableResult as usual.
+    void journeyPartialResult(JourneyResultList *result);
+    void timetablePartialResult(const TimetableEntriesList &timetableEntries);
     void errorOccured(QString msg);
+    void requestTimingsRecorded(const RequestTimings &timings);
 
 protected slots:
     void networkReplyFinished(QNetworkReply*);
+    void networkReplyReadyRead();
     void networkReplyDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void networkReplyTimedOut();
-    void networkReplySslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
 
 protected:
     QString userAgent;
-    QNetworkAccessManager *NetworkManager;
+    FahrplanNetworkManager *NetworkManager;
     FahrplanNS::curReqStates currentRequestState;
+    RequestTimings currentRequestTimings;
     QNetworkReply *lastRequest;
     QTimer *requestTimeout;
     QByteArray acceptEncoding;
     QSet<QSslError::SslError> ignoredSslErrors;
     bool sendHttpRequestViaCurl;
+    // Shared copies of repeating strings. responseStrings is cleared after
+    // every reply, sessionStrings lives as long as the parser.
+    ParserStringPool responseStrings;
+    ParserStringPool sessionStrings;
 
     virtual void parseTimeTable(QNetworkReply *networkReply);
     virtual void parseStationsByName(QNetworkReply *networkReply);
@@ -90,9 +110,10 @@ protected:
     virtual void parseSearchLaterJourney(QNetworkReply *networkReply);
     virtual void parseSearchEarlierJourney(QNetworkReply *networkReply);
     virtual void parseJourneyDetails(QNetworkReply *networkReply);
+    virtual void parsePartialReply(FahrplanNS::curReqStates request, QNetworkReply *networkReply, const QByteArray &received);
     void sendHttpRequest(QUrl url, QByteArray data, const QList<QPair<QByteArray,QByteArray> > &additionalHeaders = QList<QPair<QByteArray,QByteArray> >());
     void sendHttpRequest(QUrl url);
-    QVariantMap parseJson(const QByteArray &data) const;
+    JsonValue parseJson(const QByteArray &data) const;
     QByteArray serializeToJson(const QVariantMap &doc) const;
     QByteArray gzipDecompress(QByteArray compressData);
 
@@ -0,0 +1,228 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_coordinates.h"
+
+#include "3rdparty/gauss-kruger-cpp/gausskruger_static.h"
+
+#include <QtGlobal>
+
+#include <cmath>
+
+namespace
+{
+    // German Gauss-Krüger zones, the first digit of the easting.
+    const int minZone = 2;
+    const int maxZone = 5;
+
+    int gaussKrugerZone(double easting)
+    {
+        const int zone = int(easting / 1000000);
+        return (zone >= minZone && zone <= maxZone) ? zone : 0;
+    }
+
+    // Seven parameter Helmert transformation from DHDN (Bessel ellipsoid) to
+    // WGS84 with the EPSG:1777 parameters for all of Germany, position vector
+    // convention. Good to about three metres; without it the positions are
+    // off by well over a hundred metres.
+    void dhdnToWgs84(double *latitude, double *longitude, int count)
+    {
+        const double degree = M_PI / 180;
+        const double arcSecond = degree / 3600;
+
+        const double besselA = gausskruger::Bessel1841::equatorialRadius();
+        const double besselF = gausskruger::Bessel1841::flattening();
+        const double besselE2 = besselF * (2 - besselF);
+
+        const double wgsA = gausskruger::WGS84::equatorialRadius();
+        const double wgsF = gausskruger::WGS84::flattening();
+        const double wgsB = wgsA * (1 - wgsF);
+        const double wgsE2 = wgsF * (2 - wgsF);
+        const double wgsEp2 = wgsE2 / (1 - wgsE2);
+
+        const double tx = 598.1;
+        const double ty = 73.7;
+        const double tz = 418.2;
+        const double rx = 0.202 * arcSecond;
+        const double ry = 0.045 * arcSecond;
+        const double rz = -2.455 * arcSecond;
+        const double scale = 1 + 6.7e-6;
+
+        for (int i = 0; i < count; ++i) {
+            const double phi = latitude[i] * degree;
+            const double lambda = longitude[i] * degree;
+            const double sinPhi = sin(phi);
+            const double cosPhi = cos(phi);
+            const double n = besselA / sqrt(1 - besselE2 * sinPhi * sinPhi);
+
+            const double x = n * cosPhi * cos(lambda);
+            const double y = n * cosPhi * sin(lambda);
+            const double z = n * (1 - besselE2) * sinPhi;
+
+            const double wx = tx + scale * (x - rz * y + ry * z);
+            const double wy = ty + scale * (rz * x + y - rx * z);
+            const double wz = tz + scale * (-ry * x + rx * y + z);
+
+            // Bowring's formula, exact to well below a millimetre near the surface
+            const double p = sqrt(wx * wx + wy * wy);
+            const double theta = atan2(wz * wgsA, p * wgsB);
+            const double sinTheta = sin(theta);
+            const double cosTheta = cos(theta);
+            latitude[i] = atan2(wz + wgsEp2 * wgsB * sinTheta * sinTheta * sinTheta,
+                                p - wgsE2 * wgsA * cosTheta * cosTheta * cosTheta) / degree;
+            longitude[i] = atan2(wy, wx) / degree;
+        }
+    }
+
+    template <int Zone>
+    void gaussKrugerToWgs84(const double *northing, const double *easting, double *latitude, double *longitude, int count)
+    {
+        gausskruger::StaticProjection<gausskruger::GaussKrugerZone<Zone> >::gridToGeodetic(northing, easting, latitude, longitude, count);
+        dhdnToWgs84(latitude, longitude, count);
+    }
+
+    void gaussKrugerToWgs84(int zone, const double *northing, const double *easting, double *latitude, double *longitude, int count)
+    {
+        switch (zone) {
+        case 2:
+            gaussKrugerToWgs84<2>(northing, easting, latitude, longitude, count);
+            break;
+        case 3:
+            gaussKrugerToWgs84<3>(northing, easting, latitude, longitude, count);
+            break;
+        case 4:
+            gaussKrugerToWgs84<4>(northing, easting, latitude, longitude, count);
+            break;
+        case 5:
+            gaussKrugerToWgs84<5>(northing, easting, latitude, longitude, count);
+            break;
+        }
+    }
+}
+
+ParserCoordinates::System ParserCoordinates::efaSystem(const QString &mapName, double x, double y)
+{
+    if (x == 0 && y == 0)
+        return UnknownSystem;
+
+    // NBWT is the Gauss-Krüger grid of Baden-Württemberg
+    if (mapName == QLatin1String("NBWT") || mapName.startsWith(QLatin1String("GK")))
+        return gaussKrugerZone(x) ? GaussKruger : UnknownSystem;
+
+    // Without a mapName the reply is in what coordOutputFormat asked for.
+    // Plain "WGS84" comes in microdegrees, "WGS84[DD.ddddd]" in degrees.
+    if (mapName.isEmpty() || mapName.startsWith(QLatin1String("WGS84"))) {
+        if (qAbs(x) <= 180 && qAbs(y) <= 90)
+            return Wgs84;
+        if (qAbs(x) <= 180000000 && qAbs(y) <= 90000000)
+            return Wgs84Microdegrees;
+    }
+
+    return UnknownSystem;
+}
+
+void ParserCoordinates::reserve(int size)
+{
+    m_systems.reserve(size);
+    m_x.reserve(size);
+    m_y.reserve(size);
+}
+
+void ParserCoordinates::append(System system, double x, double y)
+{
+    m_systems.append(system);
+    m_x.append(x);
+    m_y.append(y);
+}
+
+int ParserCoordinates::size() const
+{
+    return m_systems.size();
+}
+
+void ParserCoordinates::clear()
+{
+    m_systems.clear();
+    m_x.clear();
+    m_y.clear();
+}
+
+void ParserCoordinates::toStations(StationsList &stations) const
+{
+    const int count = qMin(size(), stations.size());
+    bool hasGaussKruger = false;
+
+    for (int i = 0; i < count; ++i) {
+        Station &station = stations[i];
+        switch (m_systems.at(i)) {
+        case Wgs84:
+            station.latitude = m_y.at(i);
+            station.longitude = m_x.at(i);
+            break;
+        case Wgs84Microdegrees:
+            station.latitude = m_y.at(i) / 1000000;
+            station.longitude = m_x.at(i) / 1000000;
+            break;
+        case GaussKruger:
+            // Projected below
+            hasGaussKruger = true;
+            break;
+        case UnknownSystem:
+            station.latitude = 0;
+            station.longitude = 0;
+            break;
+        }
+    }
+
+    if (!hasGaussKruger)
+        return;
+
+    // Gather the points of each zone into contiguous arrays, project them
+    // in one batch and scatter the results back.
+    QVector<int> index;
+    QVector<double> northing;
+    QVector<double> easting;
+    QVector<double> latitude;
+    QVector<double> longitude;
+    for (int zone = minZone; zone <= maxZone; ++zone) {
+        index.clear();
+        northing.clear();
+        easting.clear();
+        for (int i = 0; i < count; ++i) {
+            if (m_systems.at(i) == GaussKruger && gaussKrugerZone(m_x.at(i)) == zone) {
+                index.append(i);
+                northing.append(m_y.at(i));
+                easting.append(m_x.at(i));
+            }
+        }
+        if (index.isEmpty())
+            continue;
+
+        latitude.resize(index.size());
+        longitude.resize(index.size());
+        gaussKrugerToWgs84(zone, northing.constData(), easting.constData(), latitude.data(), longitude.data(), index.size());
+
+        for (int j = 0; j < index.size(); ++j) {
+            Station &station = stations[index.at(j)];
+            station.latitude = latitude.at(j);
+            station.longitude = longitude.at(j);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_COORDINATES_H
+#define PARSER_COORDINATES_H
+
+#include "parser_definitions.h"
+
+#include <QString>
+#include <QVector>
+
+// Brings the stop positions backends report in projected or scaled
+// coordinate systems to WGS84 degrees. EFA servers send x/y in whatever
+// system the element's mapName names, which is not always the WGS84
+// asked for with coordOutputFormat. Parsers append the raw values while
+// reading a reply and convert them all at once afterwards, so the
+// projection runs as one batch per grid instead of once per stop.
+class ParserCoordinates
+{
+public:
+    enum System {
+        UnknownSystem,
+        Wgs84,              // x longitude, y latitude in degrees
+        Wgs84Microdegrees,  // the same times 1000000
+        GaussKruger         // DHDN Gauss-Krüger, x easting with zone prefix, y northing
+    };
+
+    // mapName may be empty, then the system is guessed from the range of
+    // the values. 0/0 means "no position" and gives UnknownSystem.
+    static System efaSystem(const QString &mapName, double x, double y);
+
+    void reserve(int size);
+    void append(System system, double x, double y);
+    int size() const;
+    void clear();
+
+    // Stores the WGS84 position of the i-th appended point in the i-th
+    // station. Points in an unknown system become 0/0.
+    void toStations(StationsList &stations) const;
+
+private:
+    QVector<System> m_systems;
+    QVector<double> m_x;
+    QVector<double> m_y;
+};
+
+#endif // PARSER_COORDINATES_H
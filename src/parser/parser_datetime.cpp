@@ -0,0 +1,261 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_datetime.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace
+{
+    // Value of the size digits at pos, -1 if any of them is not a digit
+    int readNumber(const QChar *data, int pos, int size)
+    {
+        int value = 0;
+        for (int i = pos; i < pos + size; ++i) {
+            const ushort c = data[i].unicode();
+            if (c < '0' || c > '9')
+                return -1;
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    }
+
+    bool isChar(const QChar *data, int pos, char c)
+    {
+        return data[pos].unicode() == ushort(c);
+    }
+
+    QDate readDate(const QChar *data, int length)
+    {
+        if (length < 10 || !isChar(data, 4, '-') || !isChar(data, 7, '-'))
+            return QDate();
+
+        const int year = readNumber(data, 0, 4);
+        const int month = readNumber(data, 5, 2);
+        const int day = readNumber(data, 8, 2);
+        if (year < 0 || month < 0 || day < 0)
+            return QDate();
+        return QDate(year, month, day);
+    }
+
+    // Reads "hh:mm[:ss[.zzz]]" at pos, moves pos behind it
+    QTime readTime(const QChar *data, int length, int *pos)
+    {
+        int p = *pos;
+        if (length - p < 5 || !isChar(data, p + 2, ':'))
+            return QTime();
+
+        const int hour = readNumber(data, p, 2);
+        const int minute = readNumber(data, p + 3, 2);
+        int second = 0;
+        int msec = 0;
+        p += 5;
+
+        if (length - p >= 3 && isChar(data, p, ':')) {
+            second = readNumber(data, p + 1, 2);
+            p += 3;
+            if (p < length && (isChar(data, p, '.') || isChar(data, p, ','))) {
+                ++p;
+                int digits = 0;
+                while (p < length && readNumber(data, p, 1) >= 0) {
+                    if (digits < 3)
+                        msec = msec * 10 + readNumber(data, p, 1);
+                    ++digits;
+                    ++p;
+                }
+                if (digits == 0)
+                    return QTime();
+                for (; digits < 3; ++digits)
+                    msec *= 10;
+            }
+        }
+
+        if (hour < 0 || minute < 0 || second < 0)
+            return QTime();
+
+        *pos = p;
+        return QTime(hour, minute, second, msec);
+    }
+
+    // Parses the offset at pos: "Z", "+hh", "+hhmm" or "+hh:mm". Returns
+    // false for trailing garbage.
+    bool readOffset(const QChar *data, int length, int pos, bool *hasOffset, int *offsetSeconds)
+    {
+        *hasOffset = false;
+        *offsetSeconds = 0;
+        if (pos == length)
+            return true;
+
+        if (isChar(data, pos, 'Z')) {
+            *hasOffset = true;
+            return pos + 1 == length;
+        }
+
+        if (!isChar(data, pos, '+') && !isChar(data, pos, '-'))
+            return false;
+
+        const int sign = isChar(data, pos, '-') ? -1 : 1;
+        const int rest = length - pos - 1;
+        int hours = -1;
+        int minutes = 0;
+        if (rest == 2) {
+            hours = readNumber(data, pos + 1, 2);
+        } else if (rest == 4) {
+            hours = readNumber(data, pos + 1, 2);
+            minutes = readNumber(data, pos + 3, 2);
+        } else if (rest == 5 && isChar(data, pos + 3, ':')) {
+            hours = readNumber(data, pos + 1, 2);
+            minutes = readNumber(data, pos + 4, 2);
+        }
+        if (hours < 0 || minutes < 0)
+            return false;
+
+        *hasOffset = true;
+        *offsetSeconds = sign * (hours * 3600 + minutes * 60);
+        return true;
+    }
+
+    // Date and wall clock time of an ISO timestamp, plus its offset
+    bool readIso(const QString &text, QDate *date, QTime *time, bool *hasOffset, int *offsetSeconds)
+    {
+        const QChar *data = text.unicode();
+        const int length = text.size();
+
+        *date = readDate(data, length);
+        if (!date->isValid())
+            return false;
+
+        if (length == 10) {
+            *time = QTime(0, 0);
+            *hasOffset = false;
+            *offsetSeconds = 0;
+            return true;
+        }
+        if (!isChar(data, 10, 'T') && !isChar(data, 10, ' '))
+            return false;
+
+        int pos = 11;
+        *time = readTime(data, length, &pos);
+        if (!time->isValid())
+            return false;
+
+        return readOffset(data, length, pos, hasOffset, offsetSeconds);
+    }
+}
+
+QDate ParserDateTime::dateFromIso(const QString &text)
+{
+    if (text.size() != 10)
+        return QDate();
+    return readDate(text.unicode(), text.size());
+}
+
+QDate ParserDateTime::dateFromCompact(const QString &text)
+{
+    if (text.size() != 8)
+        return QDate();
+
+    const QChar *data = text.unicode();
+    const int year = readNumber(data, 0, 4);
+    const int month = readNumber(data, 4, 2);
+    const int day = readNumber(data, 6, 2);
+    if (year < 0 || month < 0 || day < 0)
+        return QDate();
+    return QDate(year, month, day);
+}
+
+QTime ParserDateTime::timeFromString(const QString &text)
+{
+    if (text.size() != 5 && text.size() != 8)
+        return QTime();
+
+    int pos = 0;
+    const QTime time = readTime(text.unicode(), text.size(), &pos);
+    return pos == text.size() ? time : QTime();
+}
+
+QDateTime ParserDateTime::fromIso(const QString &text)
+{
+    QDate date;
+    QTime time;
+    bool hasOffset;
+    int offsetSeconds;
+    if (!readIso(text, &date, &time, &hasOffset, &offsetSeconds))
+        return QDateTime();
+
+    if (!hasOffset)
+        return QDateTime(date, time, Qt::LocalTime);
+#if defined(BUILD_FOR_QT5)
+    if (offsetSeconds == 0)
+        return QDateTime(date, time, Qt::UTC);
+    return QDateTime(date, time, Qt::OffsetFromUTC, offsetSeconds);
+#else
+    return QDateTime(date, time, Qt::UTC).addSecs(-offsetSeconds);
+#endif
+}
+
+bool ParserDateTime::hafasTime(const QString &text, int *days, QTime *time)
+{
+    const QChar *data = text.unicode();
+    const int length = text.size();
+    if (length != 11 || (!isChar(data, 2, 'd') && !isChar(data, 2, 'D')))
+        return false;
+
+    *days = readNumber(data, 0, 2);
+    int pos = 3;
+    *time = readTime(data, length, &pos);
+    return *days >= 0 && time->isValid() && pos == length;
+}
+
+QDateTime ParserDateTime::fromIso(const QString &text, const QByteArray &ianaId)
+{
+    QDate date;
+    QTime time;
+    bool hasOffset;
+    int offsetSeconds;
+    if (!readIso(text, &date, &time, &hasOffset, &offsetSeconds))
+        return QDateTime();
+
+#if defined(BUILD_FOR_QT5)
+    return QDateTime(date, time, timeZone(ianaId)).toLocalTime();
+#else
+    Q_UNUSED(ianaId);
+    return QDateTime(date, time, Qt::LocalTime);
+#endif
+}
+
+#if defined(BUILD_FOR_QT5)
+QTimeZone ParserDateTime::timeZone(const QByteArray &ianaId)
+{
+    static QMutex mutex;
+    static QHash<QByteArray, QTimeZone> zones;
+
+    QMutexLocker locker(&mutex);
+    QHash<QByteArray, QTimeZone>::const_iterator it = zones.constFind(ianaId);
+    if (it != zones.constEnd())
+        return it.value();
+
+    const QTimeZone zone(ianaId);
+    zones.insert(ianaId, zone);
+    return zone;
+}
+#endif
@@ -0,0 +1,66 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_DATETIME_H
+#define PARSER_DATETIME_H
+
+#include <QDateTime>
+#include <QString>
+
+#if defined(BUILD_FOR_QT5)
+    #include <QTimeZone>
+#endif
+
+// Fixed format date and time parsing for the backends. These run for
+// every row of every reply, so they read the characters directly instead
+// of going through QDateTime::fromString() or regular expressions, and
+// they don't allocate. Malformed input gives an invalid result.
+namespace ParserDateTime
+{
+    // "yyyy-MM-dd"
+    QDate dateFromIso(const QString &text);
+    // "yyyyMMdd"
+    QDate dateFromCompact(const QString &text);
+    // "hh:mm" or "hh:mm:ss"
+    QTime timeFromString(const QString &text);
+
+    // ISO 8601 as sent by the backends: "yyyy-MM-ddThh:mm[:ss[.zzz]]", the
+    // 'T' may be a space, optionally followed by "Z" or an offset like
+    // "+01:00". Without an offset the result is in local time, just like
+    // QDateTime::fromString(text, Qt::ISODate).
+    QDateTime fromIso(const QString &text);
+
+    // HAFAS durations and times "ddDhh:mm:ss", where dd counts the days
+    // after the reference date. Returns false if text doesn't match.
+    bool hafasTime(const QString &text, int *days, QTime *time);
+
+    // The wall clock time of text in the backend's zone, converted to the
+    // device's local time. Offsets in text are ignored like setTimeZone()
+    // does. Qt 4 has no time zones and takes text as local time.
+    QDateTime fromIso(const QString &text, const QByteArray &ianaId);
+
+#if defined(BUILD_FOR_QT5)
+    // Building a QTimeZone reads the zone database, so parsers share one
+    // instance per zone. Safe to call from every parser thread.
+    QTimeZone timeZone(const QByteArray &ianaId);
+#endif
+}
+
+#endif // PARSER_DATETIME_H
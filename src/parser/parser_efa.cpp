@@ -91,6 +91,8 @@
 
 
 #include "parser_efa.h"
+#include "parser_coordinates.h"
+#include "fahrplan_log.h"
 
 #include <QBuffer>
 #include <QFile>
@@ -104,6 +106,17 @@
 
 QHash<QString, JourneyDetailResultList *> cachedJourneyDetailsEfa;
 
+FAHRPLAN_LOG_CATEGORY(logEfa, "parser.efa")
+
+// Stop positions come as x/y in the coordinate system named by mapName,
+// they are converted for the whole reply by ParserCoordinates::toStations().
+static void appendCoordinates(ParserCoordinates *coordinates, const QDomElement &element)
+{
+    const double x = element.attribute("x").toDouble();
+    const double y = element.attribute("y").toDouble();
+    coordinates->append(ParserCoordinates::efaSystem(element.attribute("mapName"), x, y), x, y);
+}
+
 ParserEFA::ParserEFA(QObject *parent) :
     ParserAbstract(parent){
 
@@ -150,7 +163,7 @@ void ParserEFA::findStationsByName(const QString &stationName)
     // https://jp.ptv.vic.gov.au/ptv/XML_STOPFINDER_REQUEST?locationServerActive=1&outputFormat=XML&type_sf=any&name_sf=lilydale
     //https://www.journeyplanner.transportforireland.ie/nta/XML_DM_REQUEST?language=en&type_sf=any&type_dm=any&coordOutputFormat=WGS84&name_dm=cork&name_sf=cork&itdDateDay=26&itDateYearMonth=201309&itdTimeHour=09&itdTimeMinute=48&itdTripDateTimeDepArr=dep&deleteAssignedStops_dm=1&useRealtime=1&mode=direct
 
-    qDebug() << "ParserEFA::findStationsByName(" <<  stationName << ")";
+    fahrplanDebug(logEfa) << "ParserEFA::findStationsByName(" <<  stationName << ")";
     if (currentRequestState != FahrplanNS::noneRequest) {
         return;
     }
@@ -184,7 +197,7 @@ void ParserEFA::findStationsByName(const QString &stationName)
 
 void ParserEFA::getTimeTableForStation(const Station &currentStation, const Station &, const QDateTime &dateTime, Mode mode, int)
 {
-    qDebug() << "void ParserEFA::getTimeTableForStation(" << currentStation.name << dateTime;
+    fahrplanDebug(logEfa) << "void ParserEFA::getTimeTableForStation(" << currentStation.name << dateTime;
 
     // https://journeyplanner.tfl.gov.uk/user/XML_DM_REQUEST?language=en&sessionID=0&ptOptionsActive=&itdLPxx_tubeMap=&itdLPxx_request=&command=&lsShowTrainsExplicit=1&name_dm=1001180&nameState_dm=notidentified&place_dm=London&type_dm=stopID
     if (currentRequestState != FahrplanNS::noneRequest)
@@ -230,7 +243,7 @@ void ParserEFA::getTimeTableForStation(const Station &currentStation, const Stat
 
 void ParserEFA::findStationsByCoordinates(qreal longitude, qreal latitude)
 {
-    qDebug() << "ParserEFA::findStationsByCoordinates(longitude=" << longitude << ", latitude=" << latitude << ")";
+    fahrplanDebug(logEfa) << "ParserEFA::findStationsByCoordinates(longitude=" << longitude << ", latitude=" << latitude << ")";
 
     /* With EFA it's possible to send latitude and longitude and specify WGS84;
      *https://jp.ptv.vic.gov.au/ptv/XML_TRIP_REQUEST2?type_origin=coord&name_origin=-37.75587,145.347519:WGS84
@@ -267,13 +280,15 @@ void ParserEFA::findStationsByCoordinates(qreal longitude, qreal latitude)
 
 void ParserEFA::parseStationsByCoordinates(QNetworkReply *networkReply)
 {
-    qDebug() << "ParserEFA::parseStationsByCoordinates(networkReply.url()=" << networkReply->url().toString() << ")";
+    fahrplanDebug(logEfa) << "ParserEFA::parseStationsByCoordinates(networkReply.url()=" << networkReply->url().toString() << ")";
     StationsList result;
 
     QDomDocument doc("result");
     QByteArray data = readNetworkReply(networkReply);
     if (doc.setContent(data, false)) {
         QDomNodeList nodeList = doc.elementsByTagName("itdOdvAssignedStop");
+        ParserCoordinates coordinates;
+        coordinates.reserve(nodeList.size());
         for (int i = 0; i < nodeList.size(); ++i) {
             QDomElement assignedStop = nodeList.item(i).toElement();
             Station item;
@@ -282,12 +297,12 @@ void ParserEFA::parseStationsByCoordinates(QNetworkReply *networkReply)
             item.name=value.section(":",1,-1);
             item.id=value.section(":",0,0);
             item.type = "STATION";
-            item.latitude = assignedStop.attribute("x").toDouble();
-            item.longitude = assignedStop.attribute("y").toDouble();
             item.miscInfo = assignedStop.attribute("distance") + "m";
+            appendCoordinates(&coordinates, assignedStop);
 
             result << item;
         }
+        coordinates.toStations(result);
         checkForError(&doc);
     }
 
@@ -312,7 +327,7 @@ void ParserEFA::checkForError(QDomDocument *serverReplyDomDoc)
             QString errorText = message.text();
             if(errorText.length() < 1)
                 errorText = QString::number(code);
-            qDebug() << "Server Query Error:" << errorText << code;
+            fahrplanWarning(logEfa) << "Server Query Error:" << errorText << code;
             emit errorOccured(tr("Server Error: ") + errorText);
         }
     }
@@ -320,7 +335,7 @@ void ParserEFA::checkForError(QDomDocument *serverReplyDomDoc)
 
 void ParserEFA::parseStationsByName(QNetworkReply *networkReply)
 {
-    qDebug() << "ParserEFA::parseStationsByName(networkReply.url()=" << networkReply->url().toString() << ")";
+    fahrplanDebug(logEfa) << "ParserEFA::parseStationsByName(networkReply.url()=" << networkReply->url().toString() << ")";
 
     StationsList result;
     QDomDocument doc("result");
@@ -335,14 +350,15 @@ void ParserEFA::parseStationsByName(QNetworkReply *networkReply)
             QString error = message.attribute("type");
             if(error == "error")
             {
-                qDebug() << "Query Error:" << message.text();
+                fahrplanWarning(logEfa) << "Query Error:" << message.text();
             }
         }
 
         QDomElement requestInfo = doc.elementsByTagName("itdRequest").item(0).toElement();
         int version = requestInfo.attribute("version").section(".",0,0).toInt();
 
-        qDebug() << "EFA version:" << version << ", complete version:" << requestInfo.attribute("version");
+        fahrplanDebug(logEfa) << "EFA version:" << version << ", complete version:" << requestInfo.attribute("version");
+        ParserCoordinates coordinates;
         if(version < 10) {
             QDomNodeList nodeList = doc.elementsByTagName("odvNameElem");
             QDomNodeList modeNodeList = doc.elementsByTagName("itdStopModes");
@@ -356,8 +372,7 @@ void ParserEFA::parseStationsByName(QNetworkReply *networkReply)
                 item.name = nameElement.attribute("objectName");
                 item.id = nameElement.attribute("id");
                 idList.append(item.id.toString());
-                item.latitude = nameElement.attribute("x").toDouble();
-                item.longitude = nameElement.attribute("y").toDouble();
+                appendCoordinates(&coordinates, nameElement);
 
                 result << item;
             }
@@ -379,18 +394,16 @@ void ParserEFA::parseStationsByName(QNetworkReply *networkReply)
                 // sidney
                 if(item.name.isNull() || item.name == "")
                     item.name = nameElement.attribute("objectName");
-                qDebug() << "objectName: " << nameElement.attribute("objectName") ;
                 item.id = nameElement.attribute("stopID");
                 if(item.id.isNull())
                     item.id = nameElement.attribute("id");
-                item.latitude = nameElement.attribute("x").toDouble();
-                item.longitude = nameElement.attribute("y").toDouble();
+                appendCoordinates(&coordinates, nameElement);
 
                 result << item;
-                qDebug() << "Namelist: " << item.name ;
-                qDebug() << "id: " << item.id ;
+                fahrplanDebug(logEfa) << "Station" << item.id << item.name;
             }
         }
+        coordinates.toStations(result);
         checkForError(&doc);
     }
 
@@ -405,7 +418,7 @@ void ParserEFA::parseStationsByName(QNetworkReply *networkReply)
 
 void ParserEFA::searchJourney(const Station &departureStation, const Station &viaStation, const Station &arrivalStation, const QDateTime &dateTime, ParserAbstract::Mode mode, int trainrestrictions)
 {
-    qDebug() << "ParserEFA::searchJourney(" << departureStation.name << viaStation.name << arrivalStation.name << dateTime << ")";
+    fahrplanDebug(logEfa) << "ParserEFA::searchJourney(" << departureStation.name << viaStation.name << arrivalStation.name << dateTime << ")";
 
     if (currentRequestState != FahrplanNS::noneRequest)
         return;
@@ -506,13 +519,13 @@ void ParserEFA::searchJourney(const Station &departureStation, const Station &vi
 #endif
     sendHttpRequest(uri);
 
-    qDebug() << "query url:" << uri;
+    fahrplanDebug(logEfa) << "query url:" << uri;
 
 }
 
 void ParserEFA::parseSearchJourney(QNetworkReply *networkReply)
 {
-    qDebug() << "ParserEFA::parseSearchJourney(QNetworkReply *networkReply)";
+    fahrplanDebug(logEfa) << "ParserEFA::parseSearchJourney(QNetworkReply *networkReply)";
     lastJourneyResultList = new JourneyResultList();
 
     for (QHash<QString, JourneyDetailResultList *>::Iterator it = cachedJourneyDetailsEfa.begin(); it != cachedJourneyDetailsEfa.end();) {
@@ -554,13 +567,14 @@ void ParserEFA::parseSearchJourney(QNetworkReply *networkReply)
             }
             motNameList.append(motName);
             JourneyDetailResultItem *jdrItem = new JourneyDetailResultItem();
-            jdrItem->setTrain(motName);
+            jdrItem->setTrain(responseStrings.intern(motName));
             jdrItem->setInfo(info);
-            jdrItem->setDirection(motElement.attribute("destination"));
+            jdrItem->setDirection(sessionStrings.intern(motElement.attribute("destination")));
             QDomElement stationElement = partialRoute.firstChildElement("itdPoint");
             for (int k = 0; k < 2; k++) {
-                QString stationName = stationElement.attribute("name");
-                QString stationInfo = stationElement.attribute("platformName");
+                // Interchanges show up in most of the routes
+                QString stationName = sessionStrings.intern(stationElement.attribute("name"));
+                QString stationInfo = responseStrings.intern(stationElement.attribute("platformName"));
                 QDateTime dateTime = parseItdDateTime(stationElement.firstChildElement("itdDateTime"));
                 QString usage = stationElement.attribute("usage");
                 if (usage == "departure") {
@@ -615,12 +629,12 @@ void ParserEFA::parseSearchJourney(QNetworkReply *networkReply)
 
 void ParserEFA::getJourneyDetails(const QString &id)
 {
-    qDebug() << "ParserEFA::getJourneyDetails";
+    fahrplanDebug(logEfa) << "ParserEFA::getJourneyDetails";
     if (currentRequestState != FahrplanNS::noneRequest) {
         return;
     }
 
-    qDebug() << "ParserEFA::getJourneyDetails - 1";
+    fahrplanDebug(logEfa) << "ParserEFA::getJourneyDetails - 1";
     emit journeyDetailsResult(cachedJourneyDetailsEfa.value(id, NULL));
     return;
 }
@@ -628,15 +642,15 @@ void ParserEFA::getJourneyDetails(const QString &id)
 
 void ParserEFA::searchJourneyLater()
 {
-    qDebug() << "ParserEFA::searchJourneyLater()";
+    fahrplanDebug(logEfa) << "ParserEFA::searchJourneyLater()";
 
     if (m_latestResultDeparture.isValid())
     {
-        qDebug() << "m_latestResultDeparture.isValid()";
+        fahrplanDebug(logEfa) << "m_latestResultDeparture.isValid()";
         searchJourney(m_searchJourneyParameters.departureStation, m_searchJourneyParameters.viaStation, m_searchJourneyParameters.arrivalStation, m_latestResultDeparture, Departure, 0);
     }
     else {
-        qDebug() << "!m_latestResultDeparture.isValid(), ";
+        fahrplanDebug(logEfa) << "!m_latestResultDeparture.isValid(), ";
         //JourneyResultList *journeyResultList = new JourneyResultList();
          std::unique_ptr<JourneyResultList> journeyResultList{ new JourneyResultList};
 
@@ -651,7 +665,7 @@ void ParserEFA::searchJourneyLater()
 
 void ParserEFA::searchJourneyEarlier()
 {
-    qDebug() << "ParserEFA::searchJourneyEarlier()";
+    fahrplanDebug(logEfa) << "ParserEFA::searchJourneyEarlier()";
     if (m_earliestArrival.isValid())
         searchJourney(m_searchJourneyParameters.departureStation, m_searchJourneyParameters.viaStation, m_searchJourneyParameters.arrivalStation, m_earliestArrival, Arrival, 0);
     else {
@@ -668,7 +682,7 @@ void ParserEFA::searchJourneyEarlier()
 
 void ParserEFA::parseTimeTable(QNetworkReply *networkReply)
 {
-    qDebug() << "ParserEFA::parseTimeTable(networkReply.url()=" << networkReply->url().toString() << ")";
+    fahrplanDebug(logEfa) << "ParserEFA::parseTimeTable(networkReply.url()=" << networkReply->url().toString() << ")";
 
     TimetableEntriesList result;
     QDomDocument doc("result");
@@ -682,11 +696,11 @@ void ParserEFA::parseTimeTable(QNetworkReply *networkReply)
         QDomElement departure = departureMonitorRequestElement.firstChildElement("itdDepartureList").firstChildElement("itdDeparture");
         for (; !departure.isNull(); departure = departure.nextSiblingElement("itdDeparture")) {
             TimetableEntry item;
-            item.platform = departure.attribute("platformName");
+            item.platform = responseStrings.intern(departure.attribute("platformName"));
             QDomElement servingLineElement = departure.firstChildElement("itdServingLine");
 
-            item.destinationStation = servingLineElement.attribute("direction");
-            item.trainType = servingLineElement.attribute("motType");
+            item.destinationStation = sessionStrings.intern(servingLineElement.attribute("direction"));
+            item.trainType = responseStrings.intern(servingLineElement.attribute("motType"));
             QDomElement dateTimeElement = departure.firstChildElement("itdDateTime");
             const QDateTime scheduledDateTime = parseItdDateTime(dateTimeElement);
             item.time = scheduledDateTime.time();
@@ -23,17 +23,35 @@
 #include <QTimeZone>
 #endif
 #include <QLocale>
-#include <QRegExp>
 #include <QVariantMap>
 #include <QFile>
 
 #include "parser_finland_matka.h"
+#include "parser_datetime.h"
+#include "fahrplan_log.h"
 
 #define MULTILINE(...) #__VA_ARGS__
 
 #define APIBASE_URL_GEOCODING "https://api.digitransit.fi/geocoding/v1"
 #define APIBASE_URL_ROUTING "https://api.digitransit.fi/routing/v2"
 
+FAHRPLAN_LOG_CATEGORY(logFinland, "parser.finland")
+
+namespace
+{
+    // ICAO code like "EFVA"
+    bool isAirportCode(const QStringRef &code)
+    {
+        if (code.isEmpty())
+            return false;
+        for (int i = 0; i < code.size(); ++i) {
+            if (code.at(i) < QLatin1Char('A') || code.at(i) > QLatin1Char('Z'))
+                return false;
+        }
+        return true;
+    }
+}
+
 ParserFinlandMatka::ParserFinlandMatka(QObject *parent) :
         ParserAbstract(parent)
 {
@@ -148,34 +166,32 @@ void ParserFinlandMatka::parseStationsByName(QNetworkReply *networkReply)
     if (networkReply->rawHeader("Content-Encoding") == "gzip") {
         allData = gzipDecompress(allData);
     }
-   qDebug() << "Reply:\n" << allData;
+    fahrplanDebug(logFinland) << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
-    if (doc.value("geocoding").toMap().contains("errors")) {
+    if (doc.value("geocoding").contains("errors")) {
         QStringList errorMessages;
-        Q_FOREACH (const QVariant& error, doc.value("geocoding").toMap().value("errors").toList()) {
+        Q_FOREACH (const JsonValue& error, doc.value("geocoding").value("errors")) {
             errorMessages.append(error.toString());
         }
         emit errorOccured(tr("Server replied") + ":\n\n" + errorMessages.join("\n\n"));
         return;
     }
 
-    QVariantList features = doc.value("features").toList();
     StationsList results;
-    Q_FOREACH (const QVariant& featureData, features) {
-        const QVariantMap& feature(featureData.toMap());
-        const QVariantList& coordinates(feature.value("geometry").toMap().value("coordinates").toList());
+    Q_FOREACH (const JsonValue& feature, doc.value("features")) {
+        const JsonValue coordinates(feature.value("geometry").value("coordinates"));
         if (coordinates.size() != 2) {
-            qDebug() << "Invalid coordinates:" << feature;
+            fahrplanDebug(logFinland) << "Invalid coordinates:" << feature.toVariant();
             continue;
         }
-        const QVariantMap& properties(feature.value("properties").toMap());
+        const JsonValue properties(feature.value("properties"));
         Station s;
-        s.id = properties.value("id");
+        s.id = properties.value("id").toVariant();
         s.name = properties.value("label").toString();
         s.type = properties.value("layer").toString();
 
@@ -195,9 +211,9 @@ void ParserFinlandMatka::parseStationsByName(QNetworkReply *networkReply)
             s.miscInfo = prettyPlaceType(s.type);
         results.append(s);
 
-        qDebug() << s.miscInfo << s.id.toString() << s.name << s.latitude << s.longitude;
+        fahrplanDebug(logFinland) << s.miscInfo << s.id.toString() << s.name << s.latitude << s.longitude;
     }
-    qDebug() << "Found" << results.size() << "results";
+    fahrplanDebug(logFinland) << "Found" << results.size() << "results";
     emit stationsResult(results);
 }
 
@@ -282,13 +298,13 @@ void ParserFinlandMatka::getTimeTableForStation(const Station &currentStation,
     QVariantMap variables;
     variables["station"] = timetableStationID(currentStation.id.toString(), mode);
 #ifdef BUILD_FOR_QT5
-    QDateTime helsinkiTime(dateTime.toTimeZone(QTimeZone("Europe/Helsinki")));
+    QDateTime helsinkiTime(dateTime.toTimeZone(ParserDateTime::timeZone("Europe/Helsinki")));
     variables["startTime"] = QString::number(helsinkiTime.toMSecsSinceEpoch() / 1000);
 #else
     variables["startTime"] = QString::number(dateTime.toMSecsSinceEpoch() / 1000);
 #endif
     variables["timeRange"] = 86400; // Search for arrivals/departures the next 24 hours
-    variables["numberOfDepartures"] = 50;
+    variables["numberOfDepartures"] = dataSaverEnabled() ? 15 : 50;
     request["variables"] = variables;
     // FIXME: Make regional configureable
     sendRequest(QUrl(APIBASE_URL_ROUTING "/finland/gtfs/v1"), request);
@@ -301,31 +317,29 @@ void ParserFinlandMatka::parseTimeTable(QNetworkReply *networkReply)
     if (networkReply->rawHeader("Content-Encoding") == "gzip") {
         allData = gzipDecompress(allData);
     }
-qDebug() << "Reply:\n" << allData;
+    fahrplanDebug(logFinland) << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
     if (doc.contains("errors")) {
         QStringList errorMessages;
-        Q_FOREACH (const QVariant& error, doc.value("errors").toList()) {
-            errorMessages.append(error.toMap().value("message").toString());
+        Q_FOREACH (const JsonValue& error, doc.value("errors")) {
+            errorMessages.append(error.value("message").toString());
         }
         emit errorOccured(tr("Server replied") + ":\n\n" + errorMessages.join("\n\n"));
         return;
     }
     QMap<QDateTime, QString> timesAndPatternIDs;
-    QVariantMap stationOrStop(doc.value("data").toMap().value(lastTimetableSearch.currentStation.type).toMap());
-    const QVariantList& stopTimes(stationOrStop.value("stopTimes").toList());
-    Q_FOREACH (const QVariant& stopTimeData, stopTimes) {
-        const QVariantMap& stopTime(stopTimeData.toMap());
-        const QVariantMap& stop(stopTime.value("stop").toMap());
-        const QVariantMap& pattern(stopTime.value("trip").toMap().value("pattern").toMap());
-        const QVariantList& patternStops(pattern.value("stops").toList());
+    const JsonValue stationOrStop(doc.value("data").value(lastTimetableSearch.currentStation.type));
+    Q_FOREACH (const JsonValue& stopTime, stationOrStop.value("stopTimes")) {
+        const JsonValue stop(stopTime.value("stop"));
+        const JsonValue pattern(stopTime.value("trip").value("pattern"));
+        const JsonValue patternStops(pattern.value("stops"));
         const QString& patternID(pattern.value("id").toString());
-        const QVariantMap& route(pattern.value("route").toMap());
+        const JsonValue route(pattern.value("route"));
         const QString& stopName(stop.value("name").toString());
         QString transportMode(route.value("transportMode").toString());
         TimetableEntry entry;
@@ -355,20 +369,20 @@ qDebug() << "Reply:\n" << allData;
         QString routeName(route.value("shortName").toString());
         if (!routeName.isEmpty())
             entry.trainType += " " + routeName;
-        qDebug() << "Found departure with" << entry.trainType;
+        fahrplanDebug(logFinland) << "Found departure with" << entry.trainType;
 
         // Filter on transport type
         if (!transportModeIsSelected(transportMode, lastTimetableSearch.restrictions)) {
-            qDebug() << "Transport mode not selected";
+            fahrplanDebug(logFinland) << "Transport mode not selected";
             continue;
         }
 
         // Info that depends on whether we search for departures or arrivals
         int relativeTime;
         if (lastTimetableSearch.mode == Arrival) {
-            if (!patternStops.isEmpty() && patternStops.first().toMap().value("gtfsId").toString() ==
-                    stop.value("gtfsId")) {
-                qDebug() << "This is the first stop - skipping arrival from self";
+            if (!patternStops.isEmpty() && patternStops.first().value("gtfsId").toString() ==
+                    stop.value("gtfsId").toString()) {
+                fahrplanDebug(logFinland) << "This is the first stop - skipping arrival from self";
                 continue;
             }
             // "origin station" would be more correct for "destination station" in this case.
@@ -376,10 +390,9 @@ qDebug() << "Reply:\n" << allData;
             // headsign" to use, so look at the patterns for this route and if there are exactly
             // two patterns, the arrival pattern (reverse direction) should be the one with an
             // ID different from the departure pattern.
-            QVariantList routePatterns(route.value("patterns").toList());
+            const JsonValue routePatterns(route.value("patterns"));
             if (routePatterns.size() == 2) {
-                Q_FOREACH (const QVariant& routePatternData, routePatterns) {
-                    const QVariantMap& routePattern(routePatternData.toMap());
+                Q_FOREACH (const JsonValue& routePattern, routePatterns) {
                     if (routePattern.value("id").toString() != patternID) {
                         entry.destinationStation = routePattern.value("headsign").toString();
                     }
@@ -389,7 +402,7 @@ qDebug() << "Reply:\n" << allData;
                 // Fall back to the name of the first stop
                 if (patternStops.isEmpty())
                     continue;
-                entry.destinationStation = patternStops.first().toMap().value("name").toString();
+                entry.destinationStation = patternStops.first().value("name").toString();
             }
             if (stopTime.value("realtime").toBool()) {
                 relativeTime = stopTime.value("realtimeArrival").toInt();
@@ -398,9 +411,9 @@ qDebug() << "Reply:\n" << allData;
                 relativeTime = stopTime.value("scheduledArrival").toInt();
             }
         } else {
-            if (!patternStops.isEmpty() && patternStops.last().toMap().value("gtfsId").toString() ==
-                    stop.value("gtfsId")) {
-                qDebug() << "This is the last stop - skipping departure to self";
+            if (!patternStops.isEmpty() && patternStops.last().value("gtfsId").toString() ==
+                    stop.value("gtfsId").toString()) {
+                fahrplanDebug(logFinland) << "This is the last stop - skipping departure to self";
                 continue;
             }
             entry.destinationStation = stopTime.value("stopHeadsign").toString();
@@ -415,7 +428,7 @@ qDebug() << "Reply:\n" << allData;
         }
         QDateTime dateTime;
 #ifdef BUILD_FOR_QT5
-        dateTime.setTimeZone(QTimeZone("Europe/Helsinki"));
+        dateTime.setTimeZone(ParserDateTime::timeZone("Europe/Helsinki"));
 #endif
         qlonglong baseTime = stopTime.value("serviceDay").toLongLong();
         dateTime.setMSecsSinceEpoch((baseTime + relativeTime) * 1000);
@@ -425,7 +438,7 @@ qDebug() << "Reply:\n" << allData;
             // The service should not give duplicates but sometimes does anyway
             // (at least for airports). The different entries can even have
             // different route and pattern ID's.
-            qDebug() << "Skipping duplicate entry: " << entry.trainType << "at"
+            fahrplanDebug(logFinland) << "Skipping duplicate entry: " << entry.trainType << "at"
                      << dateTime.toLocalTime().toString() << "already exists";
             continue;
         }
@@ -444,18 +457,18 @@ qDebug() << "Reply:\n" << allData;
             bool foundNameMatch = false;
             if (lastTimetableSearch.mode == Arrival) {
                 if (entry.destinationStation.compare(directionStationName, Qt::CaseInsensitive) == 0) {
-                    qDebug() << "Origin station" << entry.destinationStation << "matches direction";
+                    fahrplanDebug(logFinland) << "Origin station" << entry.destinationStation << "matches direction";
                     foundNameMatch = true;
                 } else {
-                    qDebug() << "Origin station" << entry.destinationStation << "does not match direction"
+                    fahrplanDebug(logFinland) << "Origin station" << entry.destinationStation << "does not match direction"
                              << directionStationName;
                 }
             } else {
                 if (pattern.value("headsign").toString().compare(directionStationName, Qt::CaseInsensitive) == 0) {
-                    qDebug() << "Destination station" << entry.destinationStation << "matches direction";
+                    fahrplanDebug(logFinland) << "Destination station" << entry.destinationStation << "matches direction";
                     foundNameMatch = true;
                 } else {
-                    qDebug() << "Destination station" << entry.destinationStation << "does not match direction"
+                    fahrplanDebug(logFinland) << "Destination station" << entry.destinationStation << "does not match direction"
                              << directionStationName;
                 }
             }
@@ -467,7 +480,7 @@ qDebug() << "Reply:\n" << allData;
                 int indexOfCurrentStop = -1;
                 int indexOfDirectionStop = -1;
                 for (int i = 0; i < patternStops.size(); ++i) {
-                    QString stopID(patternStops.at(i).toMap().value("gtfsId").toString());
+                    QString stopID(patternStops.at(i).value("gtfsId").toString());
                     if (stopID == currentStopID) {
                         indexOfCurrentStop = i;
                         if (indexOfDirectionStop > -1)
@@ -479,18 +492,18 @@ qDebug() << "Reply:\n" << allData;
                     }
                 }
                 if (indexOfCurrentStop < 0 || indexOfDirectionStop < 0) {
-                    qDebug() << "Current stop or direction stop not found in list of stops for this pattern";
+                    fahrplanDebug(logFinland) << "Current stop or direction stop not found in list of stops for this pattern";
                     continue;
                 }
                 if (lastTimetableSearch.mode == Arrival) {
                     if (indexOfDirectionStop > indexOfCurrentStop) {
-                        qDebug() << "No arrivals from" << lastTimetableSearch.directionStation.name <<
+                        fahrplanDebug(logFinland) << "No arrivals from" << lastTimetableSearch.directionStation.name <<
                                     "for this pattern (only departures)";
                         continue;
                     }
                 } else {
                     if (indexOfDirectionStop < indexOfCurrentStop) {
-                        qDebug() << "No departures to" << lastTimetableSearch.directionStation.name <<
+                        fahrplanDebug(logFinland) << "No departures to" << lastTimetableSearch.directionStation.name <<
                                     "for this pattern (only arrivals)";
                         continue;
                     }
@@ -499,7 +512,7 @@ qDebug() << "Reply:\n" << allData;
         }
 
         // Agency info
-        const QVariantMap& agency(route.value("agency").toMap());
+        const JsonValue agency(route.value("agency"));
         QString agencyName = agency.value("name").toString();
         QString agencyURL = agency.value("url").toString();
         if (!agencyName.isEmpty()) {
@@ -537,11 +550,11 @@ void ParserFinlandMatka::sendRequest(QUrl url, QVariantMap request)
     additionalHeaders.append(QPair<QByteArray,QByteArray>("Accept-Encoding", "gzip"));
     additionalHeaders.append(QPair<QByteArray,QByteArray>("digitransit-subscription-key", "<insert-key>"));
 
-    qDebug() << "Sending request to " << url.toString();
+    fahrplanDebug(logFinland) << "Sending request to " << url.toString();
     if (request.isEmpty()) {
         sendHttpRequest(url, NULL, additionalHeaders);
     } else {
-        qDebug() << serializeToJson(request);
+        fahrplanDebug(logFinland) << serializeToJson(request);
         sendHttpRequest(url, serializeToJson(request), additionalHeaders);
     }
 }
@@ -639,7 +652,7 @@ void ParserFinlandMatka::internalSearchJourney(const Station &departureStation,
 
     QVariantMap variables;
 #ifdef BUILD_FOR_QT5
-    QDateTime helsinkiTime(dateTime.toTimeZone(QTimeZone("Europe/Helsinki")));
+    QDateTime helsinkiTime(dateTime.toTimeZone(ParserDateTime::timeZone("Europe/Helsinki")));
     variables["date"] = helsinkiTime.date().toString("yyyy-MM-dd");
     variables["time"] = helsinkiTime.time().toString("hh:mm");
 #else
@@ -670,26 +683,25 @@ void ParserFinlandMatka::parseSearchJourney(QNetworkReply *networkReply)
     if (networkReply->rawHeader("Content-Encoding") == "gzip") {
         allData = gzipDecompress(allData);
     }
-   qDebug() << "Reply:\n" << allData;
+    fahrplanDebug(logFinland) << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
     if (doc.contains("errors")) {
         QStringList errorMessages;
-        Q_FOREACH (const QVariant& error, doc.value("errors").toList()) {
-            errorMessages.append(error.toMap().value("message").toString());
+        Q_FOREACH (const JsonValue& error, doc.value("errors")) {
+            errorMessages.append(error.value("message").toString());
         }
         emit errorOccured(tr("Server replied") + ":\n\n" + errorMessages.join("\n\n"));
         return;
     }
-    const QVariantList& itineraries(doc.value("data").toMap().value("plan").toMap().value("itineraries").toList());
+    const JsonValue itineraries(doc.value("data").value("plan").value("itineraries"));
     int journeyCounter = 0;
     bool hasFoundWalkOnlyRoute = false;
-    Q_FOREACH (const QVariant itineraryVar, itineraries) {
-        const QVariantMap& itinerary(itineraryVar.toMap());
+    Q_FOREACH (const JsonValue& itinerary, itineraries) {
         QString journeyID = QString::number(journeyCounter);
         QList<JourneyDetailResultItem*> segments = parseJourneySegments(itinerary);
         bool walkDistanceOK;
@@ -715,7 +727,7 @@ void ParserFinlandMatka::parseSearchJourney(QNetworkReply *networkReply)
         if (transportModes.count() == 0 && segments.count() == 1) {
             if (hasFoundWalkOnlyRoute) {
                 // For some reason there sometimes are several "walk only" routes - only use the first one
-                qDebug() << "Skipping walk only route (have already got one)";
+                fahrplanDebug(logFinland) << "Skipping walk only route (have already got one)";
                 continue;
             } else {
                 transportModes.append(segments.first()->train());
@@ -787,23 +799,22 @@ void ParserFinlandMatka::parseSearchJourney(QNetworkReply *networkReply)
     emit journeyResult(journeyList);
 }
 
-QList<JourneyDetailResultItem*> ParserFinlandMatka::parseJourneySegments(const QVariantMap& itinerary)
+QList<JourneyDetailResultItem*> ParserFinlandMatka::parseJourneySegments(const JsonValue& itinerary)
 {
     QList<JourneyDetailResultItem*> results;
 
-    Q_FOREACH (const QVariant& legVar, itinerary.value("legs").toList()) {
-        const QVariantMap& leg(legVar.toMap());
-        qDebug() << "Parsing journey segment";
-        const QVariantMap from(leg.value("from").toMap());
-        const QVariantMap to(leg.value("to").toMap());
+    Q_FOREACH (const JsonValue& leg, itinerary.value("legs")) {
+        fahrplanDebug(logFinland) << "Parsing journey segment";
+        const JsonValue from(leg.value("from"));
+        const JsonValue to(leg.value("to"));
         if (from.isEmpty() || to.isEmpty())
             continue;
         JourneyDetailResultItem* journeySegment = new JourneyDetailResultItem();
         QString transportMode = leg.value("mode").toString();
-        qDebug() << "Transport mode:" << transportMode;
+        fahrplanDebug(logFinland) << "Transport mode:" << transportMode;
         if (!lastJourneySearch.restrictionStrings.contains("TRANSIT") &&
                 !lastJourneySearch.restrictionStrings.contains(transportMode)) {
-            qDebug() << "This journey segment is using an unselected transport mode - skipping journey";
+            fahrplanDebug(logFinland) << "This journey segment is using an unselected transport mode - skipping journey";
             Q_FOREACH (JourneyDetailResultItem* item, results) {
                 delete item;
                 item = NULL;
@@ -819,14 +830,14 @@ QList<JourneyDetailResultItem*> ParserFinlandMatka::parseJourneySegments(const Q
         journeySegment->setArrivalStation(parseNodeName(to));
         QDateTime depDt;
 #ifdef BUILD_FOR_QT5
-        depDt.setTimeZone(QTimeZone("Europe/Helsinki"));
+        depDt.setTimeZone(ParserDateTime::timeZone("Europe/Helsinki"));
 #endif
         depDt.setMSecsSinceEpoch(leg.value("startTime").toLongLong());
-        qDebug() << "departing" << journeySegment->departureStation() << depDt;
+        fahrplanDebug(logFinland) << "departing" << journeySegment->departureStation() << depDt;
         journeySegment->setDepartureDateTime(depDt.toLocalTime());
         QDateTime arrDt;
 #ifdef BUILD_FOR_QT5
-        arrDt.setTimeZone(QTimeZone("Europe/Helsinki"));
+        arrDt.setTimeZone(ParserDateTime::timeZone("Europe/Helsinki"));
 #endif
         arrDt.setMSecsSinceEpoch(leg.value("endTime").toLongLong());
         journeySegment->setArrivalDateTime(arrDt.toLocalTime());
@@ -836,13 +847,13 @@ QList<JourneyDetailResultItem*> ParserFinlandMatka::parseJourneySegments(const Q
             journeySegment->setInternalData1("WALK");
         } else {
             QString transportString(transportModeName(transportMode));
-            const QVariantMap& route(leg.value("route").toMap());
+            const JsonValue route(leg.value("route"));
             if (!route.isEmpty()) {
                 QString routeName(route.value("shortName").toString());
-                qDebug() << "Route short name:" << routeName;
+                fahrplanDebug(logFinland) << "Route short name:" << routeName;
                 if (!routeName.isEmpty())
                     transportString += " " + routeName;
-                const QVariantMap& agency(route.value("agency").toMap());
+                const JsonValue agency(route.value("agency"));
                 if (!agency.isEmpty()) {
                     QString agencyName = agency.value("name").toString();
                     QString agencyURL = agency.value("url").toString();
@@ -854,7 +865,7 @@ QList<JourneyDetailResultItem*> ParserFinlandMatka::parseJourneySegments(const Q
                     }
                 }
             }
-            const QVariantMap& trip(leg.value("trip").toMap());
+            const JsonValue trip(leg.value("trip"));
             if (!trip.isEmpty()) {
                 QString tripHeadSign(trip.value("tripHeadsign").toString());
                 if (!tripHeadSign.isEmpty())
@@ -982,7 +993,7 @@ QString ParserFinlandMatka::transportModeName(const QString& mode)
 
 bool ParserFinlandMatka::transportModeIsSelected(const QString& mode, int selectedFilter)
 {
-    qDebug() << "Checking if" << transportModeName(mode) << "is selected...";
+    fahrplanDebug(logFinland) << "Checking if" << transportModeName(mode) << "is selected...";
     bool busSelected = false;
     bool trainSelected = false;
     bool airplaneSelected = false;
@@ -1025,14 +1036,14 @@ bool ParserFinlandMatka::transportModeIsSelected(const QString& mode, int select
         return true;
 }
 
-QString ParserFinlandMatka::parseNodeName(const QVariantMap& node)
+QString ParserFinlandMatka::parseNodeName(const JsonValue& node)
 {
     QString name(node.value("name").toString());
     if (!node.value("stop").isNull()) {
-        QString stopCode(node.value("stop").toMap().value("code").toString());
+        QString stopCode(node.value("stop").value("code").toString());
         if (!stopCode.isEmpty())
             name += QString(" [%1]").arg(stopCode);
-        QString stopDesc(node.value("stop").toMap().value("desc").toString());
+        QString stopDesc(node.value("stop").value("desc").toString());
         if (!stopDesc.isEmpty() && stopDesc != node.value("name").toString())
             name += QString(" (%1)").arg(stopDesc);
     }
@@ -1042,8 +1053,12 @@ QString ParserFinlandMatka::parseNodeName(const QVariantMap& node)
 QString ParserFinlandMatka::timetableStationID(QString stationIDFromSearchResult,
                                                Mode mode)
 {
-    stationIDFromSearchResult.replace(QRegExp("^GTFS:"), "");
-    stationIDFromSearchResult.replace(QRegExp("^TAMPERE:"), "JOLI:");
+    static const QString gtfsPrefix("GTFS:");
+    static const QString tamperePrefix("TAMPERE:");
+    if (stationIDFromSearchResult.startsWith(gtfsPrefix))
+        stationIDFromSearchResult.remove(0, gtfsPrefix.length());
+    if (stationIDFromSearchResult.startsWith(tamperePrefix))
+        stationIDFromSearchResult.replace(0, tamperePrefix.length(), "JOLI:");
 
     // The geocoding API seems to filter out all but one node with the same position.
     // Many airports (e.g. Vaasa) are represented by one stop for departures and
@@ -1051,18 +1066,26 @@ QString ParserFinlandMatka::timetableStationID(QString stationIDFromSearchResult
     // and MATKA:30281_EFVA). Since all airports ID's seem to start with MATKA:30281,
     // we can identify airports ID's that should be changed to match arrivals
     // or departures. A workaround for bad API's...
-    static const QRegExp arr_airport_expr = QRegExp("(^MATKA:30281_)ARRIVAL_([A-Z]+)$");
-    static const QRegExp dep_airport_expr = QRegExp("(^MATKA:30281_)([A-Z]+)$");
-    if (mode == Departure && arr_airport_expr.exactMatch(stationIDFromSearchResult)) {
-        qDebug() << "Changing arrival airport stop to departure";
-        qDebug() << "Before:" << stationIDFromSearchResult;
-        stationIDFromSearchResult.replace(arr_airport_expr, "\\1\\2");
-        qDebug() << "After:" << stationIDFromSearchResult;
-    } else if (mode == Arrival && dep_airport_expr.exactMatch(stationIDFromSearchResult)){
-        qDebug() << "Changing departure airport stop to arrival";
-        qDebug() << "Before:" << stationIDFromSearchResult;
-        stationIDFromSearchResult.replace(dep_airport_expr, "\\1ARRIVAL_\\2");
-        qDebug() << "After:" << stationIDFromSearchResult;
+    static const QString airportPrefix("MATKA:30281_");
+    static const QString arrivalPrefix("ARRIVAL_");
+    if (!stationIDFromSearchResult.startsWith(airportPrefix))
+        return stationIDFromSearchResult;
+
+    const bool isArrival = stationIDFromSearchResult.midRef(airportPrefix.length()).startsWith(arrivalPrefix);
+    const int codeStart = airportPrefix.length() + (isArrival ? arrivalPrefix.length() : 0);
+    if (!isAirportCode(stationIDFromSearchResult.midRef(codeStart)))
+        return stationIDFromSearchResult;
+
+    if (mode == Departure && isArrival) {
+        fahrplanDebug(logFinland) << "Changing arrival airport stop to departure";
+        fahrplanDebug(logFinland) << "Before:" << stationIDFromSearchResult;
+        stationIDFromSearchResult.remove(airportPrefix.length(), arrivalPrefix.length());
+        fahrplanDebug(logFinland) << "After:" << stationIDFromSearchResult;
+    } else if (mode == Arrival && !isArrival) {
+        fahrplanDebug(logFinland) << "Changing departure airport stop to arrival";
+        fahrplanDebug(logFinland) << "Before:" << stationIDFromSearchResult;
+        stationIDFromSearchResult.insert(airportPrefix.length(), arrivalPrefix);
+        fahrplanDebug(logFinland) << "After:" << stationIDFromSearchResult;
     }
 
     return stationIDFromSearchResult;
@@ -138,14 +138,14 @@ private:
     void internalSearchJourney(const Station &departureStation, const Station &viaStation,
                                        const Station &arrivalStation, const QDateTime &dateTime,
                                        Mode mode, int trainrestrictions);
-    QList<JourneyDetailResultItem*> parseJourneySegments(const QVariantMap& itinerary);
+    QList<JourneyDetailResultItem*> parseJourneySegments(const JsonValue& itinerary);
     QString prettyPlaceType(const QString& type);
     static QString formatDistance(double distance);
     QString transportModeName(const QString& mode);
     bool transportModeIsSelected(const QString& mode, int selectedFilter);
     QStringList selectedTransportModes(int selection);
     QString languageCode() const;
-    QString parseNodeName(const QVariantMap& node);
+    QString parseNodeName(const JsonValue& node);
     QString timetableStationID(QString stationIDFromSearchResult, Mode mode);
 };
 
@@ -0,0 +1,761 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_gtfs.h"
+#include "parser_gtfs_importer.h"
+#include "parser_datetime.h"
+#include "fahrplan_log.h"
+#include "fahrplan_network_thread.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSettings>
+#include <QTimer>
+#include <QUrl>
+#if defined(BUILD_FOR_QT5)
+    #include <QStandardPaths>
+#else
+    #include <QDesktopServices>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+FAHRPLAN_LOG_CATEGORY(logGtfs, "parser.gtfs")
+
+namespace
+{
+    const int maxStations = 50;
+    const int maxNearbyStations = 30;
+    const int maxTimetableEntries = 50;
+    const int timetableSpan = 24 * 3600;
+    // Journey searches start with this window and double it up to the
+    // maximum until they found enough journeys.
+    const qint32 searchWindow = 2 * 3600;
+    const qint32 maxSearchWindow = 8 * 3600;
+    const int minJourneys = 4;
+    const int maxJourneys = 10;
+    // Seconds until a fetched realtime feed is fetched again
+    const int realtimeMaxAge = 60;
+    // Milliseconds a realtime fetch may take before results go out without
+    const int realtimeTimeout = 10 * 1000;
+
+    // Modes of the entries of getTrainRestrictions()
+    int restrictionModes(int restriction)
+    {
+        switch (restriction) {
+        case 1:
+            return GtfsTimetable::Rail;
+        case 2:
+            return GtfsTimetable::Rail | GtfsTimetable::Subway | GtfsTimetable::Tram;
+        case 3:
+            return GtfsTimetable::AllModes & ~GtfsTimetable::Bus;
+        default:
+            return GtfsTimetable::AllModes;
+        }
+    }
+
+    QString formatDuration(qint32 seconds)
+    {
+        const int minutes = seconds / 60;
+        return QString("%1:%2").arg(minutes / 60).arg(minutes % 60, 2, 10, QChar('0'));
+    }
+
+    // Worded like the online backends do
+    QString delayInfo(bool cancelled, qint32 delay)
+    {
+        if (cancelled)
+            return QString("<span style=\"color:#b30;\">%1</span>").arg(ParserGtfs::tr("Canceled!"));
+
+        const int minutes = delay / 60;
+        if (minutes > 0)
+            return QString("<span style=\"color:#b30;\">%1</span>").arg(ParserGtfs::tr("%n min late", "", minutes));
+        return QString("<span style=\"color:#093; font-weight: normal;\">%1</span>").arg(ParserGtfs::tr("on time"));
+    }
+
+    QString appendDelayInfo(const QString &info, qint32 delay)
+    {
+        const QString delayText = delayInfo(false, delay);
+        return info.isEmpty() ? delayText : info + "<br/>" + delayText;
+    }
+
+    struct BoardEntry
+    {
+        qint64 offset;          // scheduled, seconds after the requested time
+        int stopTime;
+        const GtfsRealtime::TripDelays *delays;
+    };
+
+    QString compiledFileName(const QString &feedDirectory)
+    {
+#if defined(BUILD_FOR_QT5)
+        const QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+        const QString dir = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+        // One file per feed, so switching feeds doesn't rebuild every time
+        return dir + QString("/gtfs/%1.timetable").arg(qHash(feedDirectory), 8, 16, QLatin1Char('0'));
+    }
+}
+
+ParserGtfs::ParserGtfs(QObject *parent)
+    : ParserAbstract(parent)
+    , m_realtimeReply(0)
+    , m_realtimeTimeout(new QTimer(this))
+    , m_pendingRequests(NoPendingRequest)
+    , m_timetableMode(Departure)
+    , m_timetableRestrictions(0)
+    , m_journeyMode(Departure)
+    , m_journeyRestrictions(0)
+{
+    m_realtimeTimeout->setSingleShot(true);
+    connect(m_realtimeTimeout, SIGNAL(timeout()), this, SLOT(onRealtimeTimedOut()));
+}
+
+ParserGtfs::~ParserGtfs()
+{
+    qDeleteAll(m_details);
+}
+
+QString ParserGtfs::feedDirectory()
+{
+#if defined(BUILD_FOR_QT5)
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+#else
+    const QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+#endif
+    QSettings settings(FAHRPLAN_SETTINGS_NAMESPACE, "fahrplan2");
+    return settings.value("gtfsFeedDirectory", dir + QLatin1String("/gtfs")).toString();
+}
+
+QStringList ParserGtfs::getTrainRestrictions()
+{
+    QStringList result;
+    result.append(tr("All"));
+    result.append(tr("Trains only"));
+    result.append(tr("Trains, subway and tram"));
+    result.append(tr("No buses"));
+    return result;
+}
+
+bool ParserGtfs::ensureTimetable()
+{
+    const QString feed = feedDirectory();
+    const QString fileName = compiledFileName(feed);
+    const bool needsImport = GtfsImporter::needsImport(feed, fileName);
+    if (m_timetable.isOpen() && fileName == m_fileName && !needsImport)
+        return true;
+
+    m_timetable.close();
+    m_fileName.clear();
+    m_activeServicesDate = QDate();
+    m_activeServices.clear();
+    // The overlay refers to trips by their index
+    m_realtime.clear();
+    m_realtimeSource.clear();
+
+    if (needsImport) {
+        if (!QFileInfo(QDir(feed).filePath("stops.txt")).exists()) {
+            emit errorOccured(tr("No GTFS feed found in %1").arg(feed));
+            return false;
+        }
+
+        fahrplanDebug(logGtfs) << "Importing" << feed << "into" << fileName;
+        GtfsImporter importer;
+        if (!importer.import(feed, fileName)) {
+            fahrplanWarning(logGtfs) << "Import failed:" << importer.errorString();
+            emit errorOccured(tr("Cannot import the GTFS feed: %1").arg(importer.errorString()));
+            return false;
+        }
+    }
+
+    if (!m_timetable.open(fileName)) {
+        fahrplanWarning(logGtfs) << m_timetable.errorString();
+        emit errorOccured(tr("Cannot open the offline timetable: %1").arg(m_timetable.errorString()));
+        return false;
+    }
+    m_fileName = fileName;
+    return true;
+}
+
+// False while the realtime feed is being fetched. The request is answered
+// as partial result then and repeated once the fetch finished.
+bool ParserGtfs::updateRealtime(PendingRequest request)
+{
+    QSettings settings(FAHRPLAN_SETTINGS_NAMESPACE, "fahrplan2");
+    const QString source = settings.value("gtfsRealtimeSource").toString().trimmed();
+    if (source.isEmpty()) {
+        m_realtime.clear();
+        m_realtimeSource.clear();
+        return true;
+    }
+
+    const QUrl url = QUrl::fromUserInput(source);
+    if (url.isLocalFile()) {
+        const QFileInfo info(url.toLocalFile());
+        if (source == m_realtimeSource && info.lastModified() == m_realtimeUpdated)
+            return true;
+
+        QFile file(info.filePath());
+        if (file.open(QIODevice::ReadOnly)) {
+            loadRealtime(file.readAll());
+        } else {
+            fahrplanWarning(logGtfs) << "Cannot read realtime data from" << info.filePath();
+            m_realtime.clear();
+        }
+        m_realtimeSource = source;
+        m_realtimeUpdated = info.lastModified();
+        return true;
+    }
+
+    if (!m_realtimeReply && source == m_realtimeSource && m_realtimeUpdated.isValid()
+            && m_realtimeUpdated.secsTo(QDateTime::currentDateTime()) < realtimeMaxAge)
+        return true;
+
+    m_pendingRequests |= request;
+    if (!m_realtimeReply) {
+        QNetworkRequest networkRequest(url);
+        networkRequest.setRawHeader("User-Agent", userAgent.toLatin1());
+        m_realtimeSource = source;
+        // Not sent through NetworkManager, as the feed must not end up in
+        // networkReplyFinished(..)
+        m_realtimeReply = FahrplanNetworkThread::get(networkRequest, this);
+        connect(m_realtimeReply, SIGNAL(finished()), this, SLOT(onRealtimeReplyFinished()));
+        m_realtimeTimeout->start(realtimeTimeout);
+    }
+    return false;
+}
+
+void ParserGtfs::loadRealtime(const QByteArray &feed)
+{
+    const GtfsRealtime::ServiceDayStart dayStart = [this](const QDate &date) {
+        return serviceDayStart(date).toMSecsSinceEpoch() / 1000;
+    };
+    if (!m_realtime.load(feed, m_timetable, QDate::currentDate(), dayStart))
+        fahrplanWarning(logGtfs) << m_realtime.errorString();
+    else
+        fahrplanDebug(logGtfs) << "Realtime data for" << m_realtime.tripCount() << "trips";
+}
+
+void ParserGtfs::onRealtimeReplyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    if (!reply || reply != m_realtimeReply)
+        return;
+
+    m_realtimeReply = 0;
+    m_realtimeTimeout->stop();
+    if (reply->error() == QNetworkReply::NoError) {
+        loadRealtime(reply->readAll());
+    } else {
+        fahrplanWarning(logGtfs) << "Cannot fetch realtime data:" << reply->errorString();
+        m_realtime.clear();
+    }
+    // Failures wait as well, the timetable works without
+    m_realtimeUpdated = QDateTime::currentDateTime();
+    reply->deleteLater();
+
+    const int requests = m_pendingRequests;
+    m_pendingRequests = NoPendingRequest;
+    if (requests & PendingTimetable)
+        getTimeTableForStation(m_timetableStation, m_timetableDirection, m_timetableDateTime,
+                               m_timetableMode, m_timetableRestrictions);
+    if (requests & PendingJourney)
+        searchJourney(m_journeyFrom, m_journeyVia, m_journeyTo, m_journeyWhen,
+                      m_journeyMode, m_journeyRestrictions);
+}
+
+// Older Qt versions have no transfer timeout, a stalled server would keep
+// the complete results back for good. The aborted reply finishes right
+// away and the pending requests are answered without delays.
+void ParserGtfs::onRealtimeTimedOut()
+{
+    if (!m_realtimeReply)
+        return;
+
+    fahrplanWarning(logGtfs) << "Realtime data took longer than" << realtimeTimeout << "ms";
+    m_realtimeReply->abort();
+}
+
+// GTFS times count from noon minus 12 hours in the agency's time zone,
+// which is midnight except on days with a daylight saving time switch.
+QDateTime ParserGtfs::serviceDayStart(const QDate &date) const
+{
+#if defined(BUILD_FOR_QT5)
+    const QByteArray zone = m_timetable.timeZone().toLatin1();
+    if (!zone.isEmpty()) {
+        const QTimeZone timeZone = ParserDateTime::timeZone(zone);
+        if (timeZone.isValid())
+            return QDateTime(date, QTime(12, 0), timeZone).addSecs(-12 * 3600).toLocalTime();
+    }
+#endif
+    return QDateTime(date, QTime(12, 0)).addSecs(-12 * 3600);
+}
+
+Station ParserGtfs::station(int stop) const
+{
+    Station result(true);
+    result.id = m_timetable.stopId(stop);
+    result.name = m_timetable.stopName(stop);
+    result.latitude = m_timetable.stopLatitude(stop);
+    result.longitude = m_timetable.stopLongitude(stop);
+    return result;
+}
+
+// The stop itself and, for a station, its platforms
+QList<int> ParserGtfs::platforms(int stop) const
+{
+    QList<int> result;
+    result.append(stop);
+
+    const qint32 *begin = m_timetable.column(GtfsTimetable::StopChildrenBegin);
+    const qint32 *children = m_timetable.column(GtfsTimetable::StopChildren);
+    for (int i = begin[stop]; i < begin[stop + 1]; ++i)
+        result.append(children[i]);
+    return result;
+}
+
+const std::vector<quint8> &ParserGtfs::activeServices(const QDate &date)
+{
+    if (date != m_activeServicesDate) {
+        m_activeServices = m_timetable.activeServices(date);
+        m_activeServicesDate = date;
+    }
+    return m_activeServices;
+}
+
+// Position of the direction station in every pattern calling there: the
+// last one for departures heading there, the first one for arrivals coming
+// from there.
+QHash<int, int> ParserGtfs::directionPositions(int stop, ParserAbstract::Mode mode) const
+{
+    const qint32 *begin = m_timetable.column(GtfsTimetable::StopPatternsBegin);
+    const qint32 *patterns = m_timetable.column(GtfsTimetable::StopPatterns);
+    const qint32 *positions = m_timetable.column(GtfsTimetable::StopPatternPositions);
+    const qint32 *patternStopsBegin = m_timetable.column(GtfsTimetable::PatternStopsBegin);
+    const qint32 *patternStops = m_timetable.column(GtfsTimetable::PatternStops);
+
+    QHash<int, int> result;
+    foreach (int platform, platforms(stop)) {
+        for (int i = begin[platform]; i < begin[platform + 1]; ++i) {
+            const int pattern = patterns[i];
+            int position = positions[i];
+            if (mode == Departure) {
+                // Patterns may loop back to a stop
+                const qint32 *stops = patternStops + patternStopsBegin[pattern];
+                for (int j = patternStopsBegin[pattern + 1] - patternStopsBegin[pattern] - 1; j > position; --j) {
+                    if (stops[j] == platform) {
+                        position = j;
+                        break;
+                    }
+                }
+                if (position > result.value(pattern, -1))
+                    result.insert(pattern, position);
+            } else if (!result.contains(pattern) || position < result.value(pattern)) {
+                result.insert(pattern, position);
+            }
+        }
+    }
+    return result;
+}
+
+void ParserGtfs::findStationsByName(const QString &stationName)
+{
+    if (!ensureTimetable())
+        return;
+
+    const QString needle = stationName.trimmed();
+    StationsList prefixMatches;
+    StationsList otherMatches;
+    for (int stop = 0; stop < m_timetable.stopCount() && prefixMatches.count() < maxStations; ++stop) {
+        // Platforms are found through their station
+        if (m_timetable.stopParent(stop) >= 0)
+            continue;
+
+        const int index = m_timetable.stopName(stop).indexOf(needle, 0, Qt::CaseInsensitive);
+        if (index == 0)
+            prefixMatches.append(station(stop));
+        else if (index > 0 && otherMatches.count() < maxStations)
+            otherMatches.append(station(stop));
+    }
+
+    emit stationsResult((prefixMatches + otherMatches).mid(0, maxStations));
+}
+
+void ParserGtfs::findStationsByCoordinates(qreal longitude, qreal latitude)
+{
+    if (!ensureTimetable())
+        return;
+
+    const qint32 *latitudes = m_timetable.column(GtfsTimetable::StopLatitudes);
+    const qint32 *longitudes = m_timetable.column(GtfsTimetable::StopLongitudes);
+    const qreal scale = std::cos(latitude * 3.14159265358979323846 / 180);
+    const qint32 x = qint32(longitude * 1000000);
+    const qint32 y = qint32(latitude * 1000000);
+
+    // Equirectangular distances are plenty for ranking the nearest stops
+    std::vector<std::pair<qreal, int> > distances;
+    for (int stop = 0; stop < m_timetable.stopCount(); ++stop) {
+        if (m_timetable.stopParent(stop) >= 0)
+            continue;
+        const qreal dx = (longitudes[stop] - x) * scale;
+        const qreal dy = latitudes[stop] - y;
+        distances.push_back(std::make_pair(dx * dx + dy * dy, stop));
+    }
+
+    const size_t count = qMin(distances.size(), size_t(maxNearbyStations));
+    std::partial_sort(distances.begin(), distances.begin() + count, distances.end());
+
+    StationsList result;
+    for (size_t i = 0; i < count; ++i)
+        result.append(station(distances[i].second));
+    emit stationsResult(result);
+}
+
+void ParserGtfs::getTimeTableForStation(const Station &currentStation,
+                                        const Station &directionStation,
+                                        const QDateTime &dateTime,
+                                        ParserAbstract::Mode mode,
+                                        int trainrestrictions)
+{
+    m_timetableStation = currentStation;
+    m_timetableDirection = directionStation;
+    m_timetableDateTime = dateTime;
+    m_timetableMode = mode;
+    m_timetableRestrictions = trainrestrictions;
+
+    if (!ensureTimetable())
+        return;
+
+    const int stop = m_timetable.findStop(currentStation.id.toString());
+    if (stop < 0) {
+        emit errorOccured(tr("Station not found in the offline timetable"));
+        return;
+    }
+
+    const int direction = directionStation.valid ? m_timetable.findStop(directionStation.id.toString()) : -1;
+    if (directionStation.valid && direction < 0) {
+        emit errorOccured(tr("Station not found in the offline timetable"));
+        return;
+    }
+    const QHash<int, int> towards = direction >= 0 ? directionPositions(direction, mode) : QHash<int, int>();
+    const bool realtimeCurrent = updateRealtime(PendingTimetable);
+
+    const QList<int> stops = platforms(stop);
+    const int modes = restrictionModes(trainrestrictions);
+    const std::vector<quint8> &active = activeServices(dateTime.date());
+    const qint32 *eventsBegin = m_timetable.column(GtfsTimetable::StopEventsBegin);
+    const qint32 *events = m_timetable.column(GtfsTimetable::StopEvents);
+    const qint32 *stopTimeStops = m_timetable.column(GtfsTimetable::StopTimeStops);
+    const qint32 *stopTimeTrips = m_timetable.column(GtfsTimetable::StopTimeTrips);
+    const qint32 *departures = m_timetable.column(GtfsTimetable::StopTimeDepartures);
+    const qint32 *times = mode == Departure ? departures : m_timetable.column(GtfsTimetable::StopTimeArrivals);
+    const qint32 *tripServices = m_timetable.column(GtfsTimetable::TripServices);
+    const qint32 *tripRoutes = m_timetable.column(GtfsTimetable::TripRoutes);
+    const qint32 *tripPatterns = m_timetable.column(GtfsTimetable::TripPatterns);
+
+    // Trips of the previous service day may still run after midnight.
+    // Delayed ones are searched from up to the largest delay earlier.
+    std::vector<BoardEntry> found;
+    for (int day = -1; day <= 0; ++day) {
+        const QDate serviceDate = dateTime.date().addDays(day);
+        const qint64 from = serviceDayStart(serviceDate).secsTo(dateTime);
+        foreach (int platform, stops) {
+            // The events are sorted by departure, and no arrival comes
+            // after its departure.
+            const qint32 *last = events + eventsBegin[platform + 1];
+            const qint32 *it = std::lower_bound(events + eventsBegin[platform], last, from - m_realtime.maxDelay(),
+                                                [departures](qint32 stopTime, qint64 time) {
+                return departures[stopTime] < time;
+            });
+
+            int taken = 0;
+            for (; it != last && taken < maxTimetableEntries; ++it) {
+                const int stopTime = *it;
+                if (departures[stopTime] - from >= timetableSpan)
+                    break;
+                const qint64 offset = times[stopTime] - from;
+                if (offset + m_realtime.maxDelay() < 0)
+                    continue;
+
+                const int trip = stopTimeTrips[stopTime];
+                if (!(active[tripServices[trip]] & (1 << (day + 1))))
+                    continue;
+                if (!(m_timetable.routeMode(tripRoutes[trip]) & modes))
+                    continue;
+                if (stopTime == (mode == Departure ? m_timetable.tripLastStopTime(trip)
+                                                   : m_timetable.tripFirstStopTime(trip)))
+                    continue;
+                if (direction >= 0) {
+                    const QHash<int, int>::const_iterator position = towards.constFind(tripPatterns[trip]);
+                    if (position == towards.constEnd())
+                        continue;
+                    const int here = stopTime - m_timetable.tripFirstStopTime(trip);
+                    if (mode == Departure ? here >= position.value() : here <= position.value())
+                        continue;
+                }
+
+                const GtfsRealtime::TripDelays *delays = m_realtime.trip(trip, serviceDate);
+                if (delays) {
+                    const int here = stopTime - m_timetable.tripFirstStopTime(trip);
+                    if (offset + (mode == Departure ? delays->departureDelay(here) : delays->arrivalDelay(here)) < 0)
+                        continue;
+                } else if (offset < 0) {
+                    continue;
+                }
+
+                const BoardEntry entry = { offset, stopTime, delays };
+                found.push_back(entry);
+                ++taken;
+            }
+        }
+    }
+
+    const size_t count = qMin(found.size(), size_t(maxTimetableEntries));
+    std::partial_sort(found.begin(), found.begin() + count, found.end(), [](const BoardEntry &a, const BoardEntry &b) {
+        return a.offset < b.offset || (a.offset == b.offset && a.stopTime < b.stopTime);
+    });
+
+    const QString stationName = m_timetable.stopName(stop);
+    TimetableEntriesList result;
+    for (size_t i = 0; i < count; ++i) {
+        const int stopTime = found[i].stopTime;
+        const int trip = stopTimeTrips[stopTime];
+        const int platform = stopTimeStops[stopTime];
+
+        TimetableEntry entry;
+        entry.currentStation = stationName;
+        if (mode == Departure) {
+            entry.destinationStation = m_timetable.tripHeadsign(trip);
+            if (entry.destinationStation.isEmpty())
+                entry.destinationStation = m_timetable.stopName(stopTimeStops[m_timetable.tripLastStopTime(trip)]);
+        } else {
+            entry.destinationStation = m_timetable.stopName(stopTimeStops[m_timetable.tripFirstStopTime(trip)]);
+        }
+        entry.trainType = m_timetable.routeName(tripRoutes[trip]);
+        entry.platform = m_timetable.stopPlatform(platform);
+        entry.time = dateTime.addSecs(found[i].offset).time();
+        if (const GtfsRealtime::TripDelays *delays = found[i].delays) {
+            const int here = stopTime - m_timetable.tripFirstStopTime(trip);
+            entry.miscInfo = delayInfo(delays->cancelled, mode == Departure ? delays->departureDelay(here)
+                                                                            : delays->arrivalDelay(here));
+        }
+        entry.latitude = m_timetable.stopLatitude(platform);
+        entry.longitude = m_timetable.stopLongitude(platform);
+        result.append(entry);
+    }
+
+    if (realtimeCurrent)
+        emit timetableResult(result);
+    else
+        emit timetablePartialResult(result);
+}
+
+QList<GtfsRouter::Journey> ParserGtfs::findJourneys(const GtfsRouter &router, const QList<int> &from,
+                                                    const QList<int> &via, const QList<int> &to,
+                                                    qint32 begin, qint32 end) const
+{
+    if (via.isEmpty())
+        return router.range(from, to, begin, end);
+
+    // Every way to the via station, continued as fast as possible
+    QList<GtfsRouter::Journey> journeys;
+    foreach (const GtfsRouter::Journey &first, router.range(from, via, begin, end)) {
+        const QList<GtfsRouter::Journey> onwards = router.earliestArrival(via, to, first.arrival);
+        if (onwards.isEmpty())
+            continue;
+
+        const GtfsRouter::Journey *fastest = &onwards.first();
+        foreach (const GtfsRouter::Journey &second, onwards) {
+            if (second.arrival < fastest->arrival)
+                fastest = &second;
+        }
+
+        GtfsRouter::Journey journey = first;
+        journey.arrival = fastest->arrival;
+        journey.legs += fastest->legs;
+        journeys.append(journey);
+    }
+    return GtfsRouter::paretoOptimal(journeys);
+}
+
+void ParserGtfs::searchJourney(const Station &departureStation,
+                               const Station &viaStation,
+                               const Station &arrivalStation,
+                               const QDateTime &dateTime,
+                               ParserAbstract::Mode mode,
+                               int trainrestrictions)
+{
+    m_journeyFrom = departureStation;
+    m_journeyVia = viaStation;
+    m_journeyTo = arrivalStation;
+    m_journeyWhen = dateTime;
+    m_journeyMode = mode;
+    m_journeyRestrictions = trainrestrictions;
+
+    if (!ensureTimetable())
+        return;
+
+    const int fromStop = m_timetable.findStop(departureStation.id.toString());
+    const int toStop = m_timetable.findStop(arrivalStation.id.toString());
+    const int viaStop = viaStation.valid ? m_timetable.findStop(viaStation.id.toString()) : -1;
+    if (fromStop < 0 || toStop < 0 || (viaStation.valid && viaStop < 0)) {
+        emit errorOccured(tr("Station not found in the offline timetable"));
+        return;
+    }
+    const bool realtimeCurrent = updateRealtime(PendingJourney);
+
+    const QList<int> from = platforms(fromStop);
+    const QList<int> via = viaStop >= 0 ? platforms(viaStop) : QList<int>();
+    const QList<int> to = platforms(toStop);
+
+    const QDateTime dayStart = serviceDayStart(dateTime.date());
+    const qint32 time = qint32(dayStart.secsTo(dateTime));
+    const GtfsRouter router(m_timetable, dateTime.date(), restrictionModes(trainrestrictions), &m_realtime);
+
+    QList<GtfsRouter::Journey> journeys;
+    for (qint32 window = searchWindow; window <= maxSearchWindow && journeys.count() < minJourneys; window *= 2) {
+        if (mode == Departure) {
+            journeys = findJourneys(router, from, via, to, time, time + window);
+        } else {
+            journeys = findJourneys(router, from, via, to, time - window, time);
+            for (int i = journeys.count() - 1; i >= 0; --i) {
+                if (journeys.at(i).arrival > time)
+                    journeys.removeAt(i);
+            }
+        }
+    }
+    if (mode == Departure)
+        journeys = journeys.mid(0, maxJourneys);
+    else
+        journeys = journeys.mid(qMax(0, journeys.count() - maxJourneys));
+
+    JourneyResultList *result = new JourneyResultList();
+    result->setDepartureStation(departureStation.name);
+    if (viaStation.valid)
+        result->setViaStation(viaStation.name);
+    result->setArrivalStation(arrivalStation.name);
+    if (mode == Arrival)
+        result->setTimeInfo(tr("Arrivals %1").arg(dateTime.toString(tr("ddd MMM d, HH:mm"))));
+    else
+        result->setTimeInfo(tr("Departures %1").arg(dateTime.toString(tr("ddd MMM d, HH:mm"))));
+
+    qDeleteAll(m_details);
+    m_details.clear();
+
+    const qint32 *tripRoutes = m_timetable.column(GtfsTimetable::TripRoutes);
+    const qint32 *stopTimeStops = m_timetable.column(GtfsTimetable::StopTimeStops);
+    foreach (const GtfsRouter::Journey &journey, journeys) {
+        const QDateTime departure = dayStart.addSecs(journey.departure);
+        const QDateTime arrival = dayStart.addSecs(journey.arrival);
+
+        JourneyResultItem *item = new JourneyResultItem();
+        item->setId(QString::number(m_details.count()));
+        item->setDate(departure.date());
+        item->setDepartureTime(departure.toString("HH:mm"));
+        item->setArrivalTime(arrival.toString("HH:mm"));
+        item->setDuration(formatDuration(journey.arrival - journey.departure));
+        if (journey.transfers() > 0)
+            item->setTransfers(QString::number(journey.transfers()));
+
+        JourneyDetailResultList *details = new JourneyDetailResultList();
+        details->setId(item->id());
+        details->setDepartureStation(departureStation.name);
+        if (viaStation.valid)
+            details->setViaStation(viaStation.name);
+        details->setArrivalStation(arrivalStation.name);
+        details->setDepartureDateTime(departure);
+        details->setArrivalDateTime(arrival);
+        details->setDuration(item->duration());
+
+        QStringList trainTypes;
+        foreach (const GtfsRouter::Leg &leg, journey.legs) {
+            // Scheduled times with the delays beside, like online
+            JourneyDetailResultItem *segment = new JourneyDetailResultItem();
+            segment->setDepartureStation(m_timetable.stopName(leg.fromStop));
+            segment->setDepartureInfo(m_timetable.stopPlatform(leg.fromStop));
+            segment->setDepartureDateTime(dayStart.addSecs(leg.departure - leg.departureDelay));
+            segment->setArrivalStation(m_timetable.stopName(leg.toStop));
+            segment->setArrivalInfo(m_timetable.stopPlatform(leg.toStop));
+            segment->setArrivalDateTime(dayStart.addSecs(leg.arrival - leg.arrivalDelay));
+            if (leg.hasRealtime) {
+                segment->setDepartureInfo(appendDelayInfo(segment->departureInfo(), leg.departureDelay));
+                segment->setArrivalInfo(appendDelayInfo(segment->arrivalInfo(), leg.arrivalDelay));
+            }
+            if (leg.trip < 0) {
+                segment->setTrain(tr("Walk"));
+            } else {
+                const QString line = m_timetable.routeName(tripRoutes[leg.trip]);
+                QString direction = m_timetable.tripHeadsign(leg.trip);
+                if (direction.isEmpty())
+                    direction = m_timetable.stopName(stopTimeStops[m_timetable.tripLastStopTime(leg.trip)]);
+                segment->setTrain(line);
+                segment->setDirection(direction);
+                trainTypes.append(line);
+            }
+            details->appendItem(segment);
+        }
+        item->setTrainType(trainTypes.join(" "));
+
+        result->appendItem(item);
+        m_details.append(details);
+    }
+
+    if (realtimeCurrent)
+        emit journeyResult(result);
+    else
+        emit journeyPartialResult(result);
+}
+
+void ParserGtfs::getJourneyDetails(const QString &id)
+{
+    const int i = id.toInt();
+    if (i >= 0 && i < m_details.count())
+        emit journeyDetailsResult(m_details.at(i));
+    else
+        emit errorOccured(tr("No journey details found."));
+}
+
+void ParserGtfs::searchJourneyLater()
+{
+    QDateTime nextQueryTime;
+    if (!m_details.isEmpty())
+        nextQueryTime = m_details.last()->departureDateTime().addSecs(60);
+    else
+        nextQueryTime = m_journeyWhen.addSecs(3600);
+
+    searchJourney(m_journeyFrom, m_journeyVia, m_journeyTo, nextQueryTime, Departure, m_journeyRestrictions);
+}
+
+void ParserGtfs::searchJourneyEarlier()
+{
+    QDateTime nextQueryTime;
+    if (!m_details.isEmpty())
+        nextQueryTime = m_details.first()->arrivalDateTime().addSecs(-60);
+    else
+        nextQueryTime = m_journeyWhen.addSecs(-3600);
+
+    searchJourney(m_journeyFrom, m_journeyVia, m_journeyTo, nextQueryTime, Arrival, m_journeyRestrictions);
+}
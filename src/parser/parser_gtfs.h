@@ -0,0 +1,133 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_GTFS_H
+#define PARSER_GTFS_H
+
+#include "parser_abstract.h"
+#include "parser_gtfs_realtime.h"
+#include "parser_gtfs_router.h"
+#include "parser_gtfs_timetable.h"
+
+#include <QHash>
+
+// Offline backend for an unpacked GTFS feed on the device. The feed is
+// compiled into a GtfsTimetable on first use and whenever it changes, all
+// queries then run against the memory mapped result without any network.
+// Journeys are planned by GtfsRouter.
+//
+// The feed is read from the "gtfsFeedDirectory" setting, by default the
+// "gtfs" directory in the application's data location.
+//
+// Delays come from a GTFS-Realtime TripUpdates feed in the
+// "gtfsRealtimeSource" setting, a local file or an URL. It is laid over
+// the timetable as a GtfsRealtime and fetched again once it is older than
+// a minute. While it is fetched, boards and journeys are answered from the
+// static timetable as partial result, the complete result follows with
+// the delays, or without them if the feed fails or takes too long.
+class ParserGtfs : public ParserAbstract
+{
+    Q_OBJECT
+
+public:
+    explicit ParserGtfs(QObject *parent = 0);
+    ~ParserGtfs();
+
+    static QString getName() { return tr("Offline (GTFS)"); }
+    virtual QString name() { return getName(); }
+    virtual QString shortName() { return "GTFS"; }
+
+    static QString feedDirectory();
+
+public slots:
+    void getTimeTableForStation(const Station &currentStation,
+                                const Station &directionStation,
+                                const QDateTime &dateTime,
+                                ParserAbstract::Mode mode,
+                                int trainrestrictions);
+    void findStationsByName(const QString &stationName);
+    void findStationsByCoordinates(qreal longitude, qreal latitude);
+    void searchJourney(const Station &departureStation,
+                       const Station &viaStation,
+                       const Station &arrivalStation,
+                       const QDateTime &dateTime,
+                       ParserAbstract::Mode mode,
+                       int trainrestrictions);
+    void searchJourneyLater();
+    void searchJourneyEarlier();
+    void getJourneyDetails(const QString &id);
+    bool supportsGps() { return true; }
+    bool supportsVia() { return true; }
+    bool supportsTimeTable() { return true; }
+    bool supportsTimeTableDirection() { return true; }
+    QStringList getTrainRestrictions();
+
+private slots:
+    void onRealtimeReplyFinished();
+    void onRealtimeTimedOut();
+
+private:
+    enum PendingRequest {
+        NoPendingRequest = 0,
+        PendingTimetable = 1,
+        PendingJourney = 2
+    };
+
+    GtfsTimetable m_timetable;
+    QString m_fileName;
+    // Boards are asked for the same day over and over
+    QDate m_activeServicesDate;
+    std::vector<quint8> m_activeServices;
+
+    GtfsRealtime m_realtime;
+    QString m_realtimeSource;
+    QDateTime m_realtimeUpdated;        // file modified or URL fetched
+    QNetworkReply *m_realtimeReply;
+    QTimer *m_realtimeTimeout;
+    int m_pendingRequests;              // PendingRequest flags
+
+    Station m_timetableStation;
+    Station m_timetableDirection;
+    QDateTime m_timetableDateTime;
+    ParserAbstract::Mode m_timetableMode;
+    int m_timetableRestrictions;
+
+    Station m_journeyFrom;
+    Station m_journeyVia;
+    Station m_journeyTo;
+    QDateTime m_journeyWhen;
+    ParserAbstract::Mode m_journeyMode;
+    int m_journeyRestrictions;
+    QList<JourneyDetailResultList *> m_details;
+
+    bool ensureTimetable();
+    bool updateRealtime(PendingRequest request);
+    void loadRealtime(const QByteArray &feed);
+    QDateTime serviceDayStart(const QDate &date) const;
+    Station station(int stop) const;
+    QList<int> platforms(int stop) const;
+    const std::vector<quint8> &activeServices(const QDate &date);
+    QHash<int, int> directionPositions(int stop, ParserAbstract::Mode mode) const;
+    QList<GtfsRouter::Journey> findJourneys(const GtfsRouter &router, const QList<int> &from,
+                                            const QList<int> &via, const QList<int> &to,
+                                            qint32 begin, qint32 end) const;
+};
+
+#endif // PARSER_GTFS_H
@@ -0,0 +1,953 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_gtfs_importer.h"
+#include "parser_gtfs_timetable.h"
+
+#include <QDate>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Footpaths the router may take between stops
+    const qreal maxWalkingDistance = 250;   // metres
+    const qreal walkingSpeed = 1.2;         // metres per second
+    const qint32 transferOverhead = 60;     // seconds on top of walking
+    const qint32 minimumPlatformChange = 120;
+
+    const char * const feedFiles[] = {
+        "agency.txt",
+        "stops.txt",
+        "routes.txt",
+        "trips.txt",
+        "stop_times.txt",
+        "calendar.txt",
+        "calendar_dates.txt",
+        "transfers.txt"
+    };
+
+    // Streaming reader for the CSV dialect of GTFS: RFC 4180, UTF-8 with
+    // an optional BOM. The fields of the current record are kept NUL
+    // terminated in one reused buffer, so reading a number copies nothing.
+    class CsvReader
+    {
+    public:
+        CsvReader() : m_pos(0), m_atEnd(false) {}
+
+        bool open(const QString &fileName)
+        {
+            m_file.setFileName(fileName);
+            if (!m_file.open(QIODevice::ReadOnly) || !next())
+                return false;
+
+            for (int i = 0; i < count(); ++i) {
+                QByteArray name(field(i));
+                if (i == 0 && name.startsWith("\xEF\xBB\xBF"))
+                    name.remove(0, 3);
+                m_columns.insert(name.trimmed(), i);
+            }
+            return true;
+        }
+
+        // Index of the named column, -1 if the file doesn't have it.
+        // Reading a missing column gives an empty field.
+        int column(const char *name) const
+        {
+            return m_columns.value(QByteArray(name), -1);
+        }
+
+        bool next()
+        {
+            for (;;) {
+                m_record.clear();
+                m_starts.clear();
+                m_starts.push_back(0);
+
+                bool inQuotes = false;
+                bool any = false;
+                for (;;) {
+                    if (!inQuotes)
+                        copyPlainRun(&any);
+
+                    const int c = get();
+                    if (c < 0)
+                        break;
+                    if (!inQuotes && c == '\n')
+                        break;
+                    if (!inQuotes && c == '\r')
+                        continue;
+
+                    any = true;
+                    if (inQuotes) {
+                        if (c != '"') {
+                            m_record.push_back(char(c));
+                        } else if (peek() == '"') {
+                            m_record.push_back('"');
+                            ++m_pos;
+                        } else {
+                            inQuotes = false;
+                        }
+                    } else if (c == '"') {
+                        inQuotes = true;
+                    } else if (c == ',') {
+                        m_record.push_back('\0');
+                        m_starts.push_back(int(m_record.size()));
+                    } else {
+                        m_record.push_back(char(c));
+                    }
+                }
+                m_record.push_back('\0');
+
+                if (any)
+                    return true;
+                if (m_atEnd)
+                    return false;
+                // Blank line
+            }
+        }
+
+        int count() const
+        {
+            return int(m_starts.size());
+        }
+
+        const char *field(int column) const
+        {
+            if (column < 0 || column >= count())
+                return "";
+            return &m_record[m_starts[column]];
+        }
+
+        bool isEmpty(int column) const
+        {
+            return *field(column) == '\0';
+        }
+
+        int toInt(int column, int fallback = 0) const
+        {
+            const char *text = field(column);
+            while (*text == ' ')
+                ++text;
+            const bool negative = *text == '-';
+            if (negative)
+                ++text;
+            if (*text < '0' || *text > '9')
+                return fallback;
+
+            int value = 0;
+            for (; *text >= '0' && *text <= '9'; ++text)
+                value = value * 10 + (*text - '0');
+            return negative ? -value : value;
+        }
+
+        // strtod() would follow the locale's decimal separator.
+        qint32 toMicroDegrees(int column) const
+        {
+            const char *text = field(column);
+            return qint32(qRound64(QByteArray::fromRawData(text, qstrlen(text)).toDouble() * 1000000));
+        }
+
+        // "H:MM:SS", hours may go beyond 24. -1 if empty or malformed.
+        qint32 toSeconds(int column) const
+        {
+            const char *text = field(column);
+            while (*text == ' ')
+                ++text;
+
+            int parts[3] = { 0, 0, 0 };
+            int part = 0;
+            bool digits = false;
+            for (; *text; ++text) {
+                if (*text >= '0' && *text <= '9') {
+                    parts[part] = parts[part] * 10 + (*text - '0');
+                    digits = true;
+                } else if (*text == ':' && part < 2) {
+                    ++part;
+                } else {
+                    break;
+                }
+            }
+            if (!digits || part != 2)
+                return -1;
+            return parts[0] * 3600 + parts[1] * 60 + parts[2];
+        }
+
+        // "YYYYMMDD" as julian day, 0 if malformed
+        qint32 toJulianDay(int column) const
+        {
+            const int value = toInt(column, -1);
+            const QDate date(value / 10000, value / 100 % 100, value % 100);
+            return date.isValid() ? qint32(date.toJulianDay()) : 0;
+        }
+
+    private:
+        QFile m_file;
+        QByteArray m_buffer;
+        int m_pos;
+        bool m_atEnd;
+        std::vector<char> m_record;
+        std::vector<int> m_starts;
+        QHash<QByteArray, int> m_columns;
+
+        bool fill()
+        {
+            m_buffer = m_file.read(64 * 1024);
+            m_pos = 0;
+            m_atEnd = m_buffer.isEmpty();
+            return !m_atEnd;
+        }
+
+        int get()
+        {
+            if (m_pos == m_buffer.size() && !fill())
+                return -1;
+            return uchar(m_buffer.at(m_pos++));
+        }
+
+        int peek()
+        {
+            if (m_pos == m_buffer.size() && !fill())
+                return -1;
+            return uchar(m_buffer.at(m_pos));
+        }
+
+        // Unquoted text is copied up to the next special character at once.
+        void copyPlainRun(bool *any)
+        {
+            const char *begin = m_buffer.constData() + m_pos;
+            const char *end = m_buffer.constData() + m_buffer.size();
+            const char *p = begin;
+            while (p < end && *p != ',' && *p != '\n' && *p != '\r' && *p != '"')
+                ++p;
+            if (p != begin) {
+                m_record.insert(m_record.end(), begin, p);
+                m_pos += int(p - begin);
+                *any = true;
+            }
+        }
+    };
+
+    // All strings of the timetable, each stored once. Offset 0 is "".
+    class StringTable
+    {
+    public:
+        StringTable() : m_data(1, '\0') {}
+
+        qint32 add(const char *text)
+        {
+            if (!*text)
+                return 0;
+
+            const QByteArray key(text);
+            QHash<QByteArray, qint32>::const_iterator it = m_offsets.constFind(key);
+            if (it != m_offsets.constEnd())
+                return it.value();
+
+            const qint32 offset = m_data.size();
+            m_data.append(key);
+            m_data.append('\0');
+            m_offsets.insert(key, offset);
+            return offset;
+        }
+
+        const QByteArray &data() const
+        {
+            return m_data;
+        }
+
+    private:
+        QByteArray m_data;
+        QHash<QByteArray, qint32> m_offsets;
+    };
+
+    struct StopRow
+    {
+        QByteArray id;
+        QByteArray parent;
+        qint32 name;
+        qint32 platform;
+        qint32 latitude;
+        qint32 longitude;
+    };
+
+    struct ExceptionRow
+    {
+        qint32 service;
+        qint32 day;
+        qint32 type;
+    };
+
+    struct StopTimeRow
+    {
+        qint32 trip;
+        qint32 sequence;
+        qint32 stop;
+        qint32 arrival;
+        qint32 departure;
+    };
+
+    // GTFS only requires times at timepoints; the stops in between are
+    // interpolated by their position. Returns false if the trip has no
+    // times at all.
+    bool fillTimes(std::vector<StopTimeRow> &rows, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i) {
+            if (rows[i].arrival < 0)
+                rows[i].arrival = rows[i].departure;
+            if (rows[i].departure < 0)
+                rows[i].departure = rows[i].arrival;
+        }
+
+        size_t previous = end;
+        for (size_t i = begin; i < end; ++i) {
+            if (rows[i].departure >= 0) {
+                previous = i;
+                continue;
+            }
+
+            size_t next = i + 1;
+            while (next < end && rows[next].arrival < 0)
+                ++next;
+            if (previous == end && next == end)
+                return false;
+
+            for (size_t j = i; j < next; ++j) {
+                qint32 time;
+                if (previous == end)
+                    time = rows[next].arrival;
+                else if (next == end)
+                    time = rows[previous].departure;
+                else
+                    time = rows[previous].departure + qint32(qint64(rows[next].arrival - rows[previous].departure)
+                                                             * qint64(j - previous) / qint64(next - previous));
+                rows[j].arrival = rows[j].departure = time;
+            }
+            i = next - 1;
+        }
+        return true;
+    }
+
+    // Turns per entity counts into begin offsets, count.size() + 1 entries
+    std::vector<qint32> beginOffsets(const std::vector<qint32> &counts)
+    {
+        std::vector<qint32> begin(counts.size() + 1, 0);
+        for (size_t i = 0; i < counts.size(); ++i)
+            begin[i + 1] = begin[i] + counts[i];
+        return begin;
+    }
+}
+
+bool GtfsImporter::needsImport(const QString &feedDirectory, const QString &fileName)
+{
+    const QFileInfo compiled(fileName);
+    if (!compiled.exists() || !GtfsTimetable::isCurrentVersion(fileName))
+        return true;
+
+    const QDir feed(feedDirectory);
+    for (const char *name : feedFiles) {
+        const QFileInfo source(feed.filePath(QLatin1String(name)));
+        if (source.exists() && source.lastModified() > compiled.lastModified())
+            return true;
+    }
+    return false;
+}
+
+QString GtfsImporter::errorString() const
+{
+    return m_errorString;
+}
+
+bool GtfsImporter::import(const QString &feedDirectory, const QString &fileName)
+{
+    typedef GtfsTimetable T;
+
+    const QDir feed(feedDirectory);
+    StringTable strings;
+    std::vector<qint32> columns[T::ColumnCount];
+    CsvReader reader;
+
+    //-------------- agency.txt
+    qint32 timeZone = 0;
+    {
+        CsvReader agency;
+        if (agency.open(feed.filePath("agency.txt")) && agency.next())
+            timeZone = strings.add(agency.field(agency.column("agency_timezone")));
+    }
+
+    //-------------- stops.txt
+    if (!reader.open(feed.filePath("stops.txt"))) {
+        m_errorString = QString("Cannot read %1").arg(feed.filePath("stops.txt"));
+        return false;
+    }
+
+    std::vector<StopRow> stops;
+    {
+        const int id = reader.column("stop_id");
+        const int name = reader.column("stop_name");
+        const int platform = reader.column("platform_code");
+        const int latitude = reader.column("stop_lat");
+        const int longitude = reader.column("stop_lon");
+        const int parent = reader.column("parent_station");
+        const int locationType = reader.column("location_type");
+        while (reader.next()) {
+            // Entrances, generic nodes and boarding areas have no departures
+            if (reader.isEmpty(id) || reader.toInt(locationType) >= 2)
+                continue;
+
+            StopRow row;
+            row.id = reader.field(id);
+            row.parent = reader.field(parent);
+            row.name = strings.add(reader.field(name));
+            row.platform = strings.add(reader.field(platform));
+            row.latitude = reader.toMicroDegrees(latitude);
+            row.longitude = reader.toMicroDegrees(longitude);
+            stops.push_back(row);
+        }
+    }
+    std::sort(stops.begin(), stops.end(), [](const StopRow &a, const StopRow &b) {
+        return a.id < b.id;
+    });
+
+    QHash<QByteArray, qint32> stopIndex;
+    for (size_t i = 0; i < stops.size(); ++i)
+        stopIndex.insert(stops[i].id, qint32(i));
+
+    std::vector<qint32> childCounts(stops.size(), 0);
+    for (const StopRow &stop : stops) {
+        const qint32 parent = stopIndex.value(stop.parent, -1);
+        columns[T::StopIds].push_back(strings.add(stop.id.constData()));
+        columns[T::StopNames].push_back(stop.name);
+        columns[T::StopPlatforms].push_back(stop.platform);
+        columns[T::StopLatitudes].push_back(stop.latitude);
+        columns[T::StopLongitudes].push_back(stop.longitude);
+        columns[T::StopParents].push_back(parent);
+        if (parent >= 0)
+            ++childCounts[parent];
+    }
+    columns[T::StopChildrenBegin] = beginOffsets(childCounts);
+    columns[T::StopChildren].resize(columns[T::StopChildrenBegin].back());
+    {
+        std::vector<qint32> next(columns[T::StopChildrenBegin].begin(), columns[T::StopChildrenBegin].end() - 1);
+        for (size_t i = 0; i < stops.size(); ++i) {
+            const qint32 parent = columns[T::StopParents][i];
+            if (parent >= 0)
+                columns[T::StopChildren][next[parent]++] = qint32(i);
+        }
+    }
+    stops.clear();
+
+    //-------------- routes.txt
+    if (!reader.open(feed.filePath("routes.txt"))) {
+        m_errorString = QString("Cannot read %1").arg(feed.filePath("routes.txt"));
+        return false;
+    }
+
+    QHash<QByteArray, qint32> routeIndex;
+    {
+        const int id = reader.column("route_id");
+        const int shortName = reader.column("route_short_name");
+        const int longName = reader.column("route_long_name");
+        const int type = reader.column("route_type");
+        while (reader.next()) {
+            routeIndex.insert(reader.field(id), qint32(columns[T::RouteTypes].size()));
+            columns[T::RouteShortNames].push_back(strings.add(reader.field(shortName)));
+            columns[T::RouteLongNames].push_back(strings.add(reader.field(longName)));
+            columns[T::RouteTypes].push_back(reader.toInt(type, 3));
+        }
+    }
+
+    //-------------- calendar.txt and calendar_dates.txt
+    QHash<QByteArray, qint32> serviceIndex;
+    auto service = [&](const char *id) {
+        const QByteArray key(id);
+        QHash<QByteArray, qint32>::const_iterator it = serviceIndex.constFind(key);
+        if (it != serviceIndex.constEnd())
+            return it.value();
+
+        const qint32 index = qint32(columns[T::ServiceIds].size());
+        serviceIndex.insert(key, index);
+        columns[T::ServiceIds].push_back(strings.add(id));
+        columns[T::ServiceStartDays].push_back(0);
+        columns[T::ServiceEndDays].push_back(0);
+        columns[T::ServiceWeekdays].push_back(0);
+        return index;
+    };
+
+    if (reader.open(feed.filePath("calendar.txt"))) {
+        static const char * const weekdays[] = {
+            "monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"
+        };
+        int weekdayColumns[7];
+        for (int i = 0; i < 7; ++i)
+            weekdayColumns[i] = reader.column(weekdays[i]);
+        const int id = reader.column("service_id");
+        const int startDate = reader.column("start_date");
+        const int endDate = reader.column("end_date");
+
+        while (reader.next()) {
+            const qint32 index = service(reader.field(id));
+            qint32 mask = 0;
+            for (int i = 0; i < 7; ++i) {
+                if (reader.toInt(weekdayColumns[i]) == 1)
+                    mask |= 1 << i;
+            }
+            columns[T::ServiceWeekdays][index] = mask;
+            columns[T::ServiceStartDays][index] = reader.toJulianDay(startDate);
+            columns[T::ServiceEndDays][index] = reader.toJulianDay(endDate);
+        }
+    }
+
+    std::vector<ExceptionRow> exceptions;
+    if (reader.open(feed.filePath("calendar_dates.txt"))) {
+        const int id = reader.column("service_id");
+        const int date = reader.column("date");
+        const int type = reader.column("exception_type");
+        while (reader.next()) {
+            ExceptionRow row;
+            row.service = service(reader.field(id));
+            row.day = reader.toJulianDay(date);
+            row.type = reader.toInt(type);
+            exceptions.push_back(row);
+        }
+    }
+    std::stable_sort(exceptions.begin(), exceptions.end(), [](const ExceptionRow &a, const ExceptionRow &b) {
+        return a.service < b.service;
+    });
+
+    std::vector<qint32> exceptionCounts(columns[T::ServiceIds].size(), 0);
+    for (const ExceptionRow &row : exceptions) {
+        ++exceptionCounts[row.service];
+        columns[T::ServiceExceptionDays].push_back(row.day);
+        columns[T::ServiceExceptionTypes].push_back(row.type);
+    }
+    columns[T::ServiceExceptionsBegin] = beginOffsets(exceptionCounts);
+
+    if (serviceIndex.isEmpty()) {
+        m_errorString = QString("%1 has neither calendar.txt nor calendar_dates.txt").arg(feedDirectory);
+        return false;
+    }
+
+    //-------------- trips.txt
+    if (!reader.open(feed.filePath("trips.txt"))) {
+        m_errorString = QString("Cannot read %1").arg(feed.filePath("trips.txt"));
+        return false;
+    }
+
+    QHash<QByteArray, qint32> tripIndex;
+    {
+        const int id = reader.column("trip_id");
+        const int route = reader.column("route_id");
+        const int serviceId = reader.column("service_id");
+        const int headsign = reader.column("trip_headsign");
+        while (reader.next()) {
+            const qint32 routeNumber = routeIndex.value(reader.field(route), -1);
+            const qint32 serviceNumber = serviceIndex.value(reader.field(serviceId), -1);
+            if (routeNumber < 0 || serviceNumber < 0)
+                continue;
+
+            tripIndex.insert(reader.field(id), qint32(columns[T::TripIds].size()));
+            columns[T::TripIds].push_back(strings.add(reader.field(id)));
+            columns[T::TripRoutes].push_back(routeNumber);
+            columns[T::TripServices].push_back(serviceNumber);
+            columns[T::TripHeadsigns].push_back(strings.add(reader.field(headsign)));
+        }
+    }
+
+    {
+        const char *data = strings.data().constData();
+        const std::vector<qint32> &ids = columns[T::TripIds];
+        std::vector<qint32> &byId = columns[T::TripsById];
+        byId.resize(ids.size());
+        for (size_t i = 0; i < byId.size(); ++i)
+            byId[i] = qint32(i);
+        std::sort(byId.begin(), byId.end(), [&](qint32 a, qint32 b) {
+            return qstrcmp(data + ids[a], data + ids[b]) < 0;
+        });
+    }
+
+    //-------------- stop_times.txt
+    if (!reader.open(feed.filePath("stop_times.txt"))) {
+        m_errorString = QString("Cannot read %1").arg(feed.filePath("stop_times.txt"));
+        return false;
+    }
+
+    std::vector<StopTimeRow> rows;
+    {
+        const int tripId = reader.column("trip_id");
+        const int stopId = reader.column("stop_id");
+        const int sequence = reader.column("stop_sequence");
+        const int arrival = reader.column("arrival_time");
+        const int departure = reader.column("departure_time");
+
+        // Stop times come grouped by trip, look the trip up once per group
+        QByteArray lastTripId;
+        qint32 lastTrip = -1;
+        while (reader.next()) {
+            const char *trip = reader.field(tripId);
+            if (lastTripId.isNull() || qstrcmp(trip, lastTripId.constData()) != 0) {
+                lastTripId = trip;
+                lastTrip = tripIndex.value(lastTripId, -1);
+            }
+            if (lastTrip < 0)
+                continue;
+
+            const char *stop = reader.field(stopId);
+            const qint32 stopNumber = stopIndex.value(QByteArray::fromRawData(stop, qstrlen(stop)), -1);
+            if (stopNumber < 0)
+                continue;
+
+            StopTimeRow row;
+            row.trip = lastTrip;
+            row.sequence = reader.toInt(sequence);
+            row.stop = stopNumber;
+            row.arrival = reader.toSeconds(arrival);
+            row.departure = reader.toSeconds(departure);
+            rows.push_back(row);
+        }
+    }
+    tripIndex.clear();
+
+    std::sort(rows.begin(), rows.end(), [](const StopTimeRow &a, const StopTimeRow &b) {
+        return a.trip < b.trip || (a.trip == b.trip && a.sequence < b.sequence);
+    });
+
+    for (size_t begin = 0; begin < rows.size(); ) {
+        size_t end = begin + 1;
+        while (end < rows.size() && rows[end].trip == rows[begin].trip)
+            ++end;
+        if (!fillTimes(rows, begin, end)) {
+            for (size_t i = begin; i < end; ++i)
+                rows[i].trip = -1;
+        }
+        begin = end;
+    }
+    rows.erase(std::remove_if(rows.begin(), rows.end(), [](const StopTimeRow &row) {
+        return row.trip < 0;
+    }), rows.end());
+
+    std::vector<qint32> tripCounts(columns[T::TripIds].size(), 0);
+    for (const StopTimeRow &row : rows) {
+        ++tripCounts[row.trip];
+        columns[T::StopTimeStops].push_back(row.stop);
+        columns[T::StopTimeTrips].push_back(row.trip);
+        columns[T::StopTimeArrivals].push_back(row.arrival);
+        columns[T::StopTimeDepartures].push_back(row.departure);
+        columns[T::StopTimeSequences].push_back(row.sequence);
+    }
+    columns[T::TripStopTimesBegin] = beginOffsets(tripCounts);
+    std::vector<StopTimeRow>().swap(rows);
+
+    //-------------- Stop event index
+    {
+        const std::vector<qint32> &stopOf = columns[T::StopTimeStops];
+        const std::vector<qint32> &departureOf = columns[T::StopTimeDepartures];
+        std::vector<qint32> &events = columns[T::StopEvents];
+        events.resize(stopOf.size());
+        for (size_t i = 0; i < events.size(); ++i)
+            events[i] = qint32(i);
+        std::sort(events.begin(), events.end(), [&](qint32 a, qint32 b) {
+            if (stopOf[a] != stopOf[b])
+                return stopOf[a] < stopOf[b];
+            if (departureOf[a] != departureOf[b])
+                return departureOf[a] < departureOf[b];
+            return a < b;
+        });
+
+        std::vector<qint32> eventCounts(columns[T::StopIds].size(), 0);
+        for (qint32 stop : stopOf)
+            ++eventCounts[stop];
+        columns[T::StopEventsBegin] = beginOffsets(eventCounts);
+    }
+
+    //-------------- Patterns
+    {
+        const std::vector<qint32> &begin = columns[T::TripStopTimesBegin];
+        const std::vector<qint32> &stopOf = columns[T::StopTimeStops];
+        const std::vector<qint32> &arrivals = columns[T::StopTimeArrivals];
+        const std::vector<qint32> &departures = columns[T::StopTimeDepartures];
+
+        // Trips by route and stop sequence
+        QHash<QByteArray, qint32> groupIndex;
+        std::vector<std::vector<qint32> > groups;
+        for (qint32 trip = 0; trip < qint32(columns[T::TripIds].size()); ++trip) {
+            if (begin[trip] == begin[trip + 1])
+                continue;
+
+            QByteArray key(reinterpret_cast<const char *>(&columns[T::TripRoutes][trip]), sizeof(qint32));
+            key.append(reinterpret_cast<const char *>(&stopOf[begin[trip]]), (begin[trip + 1] - begin[trip]) * sizeof(qint32));
+            qint32 group = groupIndex.value(key, -1);
+            if (group < 0) {
+                group = qint32(groups.size());
+                groupIndex.insert(key, group);
+                groups.push_back(std::vector<qint32>());
+            }
+            groups[group].push_back(trip);
+        }
+        groupIndex.clear();
+
+        std::vector<qint32> stopCounts;
+        std::vector<qint32> tripCounts;
+        columns[T::TripPatterns].assign(columns[T::TripIds].size(), -1);
+        for (std::vector<qint32> &trips : groups) {
+            std::sort(trips.begin(), trips.end(), [&](qint32 a, qint32 b) {
+                if (departures[begin[a]] != departures[begin[b]])
+                    return departures[begin[a]] < departures[begin[b]];
+                return a < b;
+            });
+
+            // A trip overtaking another goes into a pattern of its own, so
+            // the router can binary search the trips at every stop.
+            const qint32 length = begin[trips.front() + 1] - begin[trips.front()];
+            std::vector<std::vector<qint32> > patterns;
+            for (qint32 trip : trips) {
+                size_t pattern = 0;
+                for (; pattern < patterns.size(); ++pattern) {
+                    const qint32 previous = patterns[pattern].back();
+                    bool ordered = true;
+                    for (qint32 i = 0; i < length && ordered; ++i) {
+                        ordered = departures[begin[previous] + i] <= departures[begin[trip] + i]
+                                && arrivals[begin[previous] + i] <= arrivals[begin[trip] + i];
+                    }
+                    if (ordered)
+                        break;
+                }
+                if (pattern == patterns.size())
+                    patterns.push_back(std::vector<qint32>());
+                patterns[pattern].push_back(trip);
+            }
+
+            for (const std::vector<qint32> &pattern : patterns) {
+                for (qint32 trip : pattern)
+                    columns[T::TripPatterns][trip] = qint32(stopCounts.size());
+                const std::vector<qint32>::const_iterator stops = stopOf.begin() + begin[pattern.front()];
+                columns[T::PatternRoutes].push_back(columns[T::TripRoutes][pattern.front()]);
+                columns[T::PatternStops].insert(columns[T::PatternStops].end(), stops, stops + length);
+                columns[T::PatternTrips].insert(columns[T::PatternTrips].end(), pattern.begin(), pattern.end());
+                stopCounts.push_back(length);
+                tripCounts.push_back(qint32(pattern.size()));
+            }
+        }
+        columns[T::PatternStopsBegin] = beginOffsets(stopCounts);
+        columns[T::PatternTripsBegin] = beginOffsets(tripCounts);
+    }
+
+    //-------------- Patterns of every stop
+    {
+        struct StopPattern
+        {
+            qint32 stop;
+            qint32 pattern;
+            qint32 position;
+        };
+        std::vector<StopPattern> stopPatterns;
+
+        const std::vector<qint32> &begin = columns[T::PatternStopsBegin];
+        const std::vector<qint32> &patternStops = columns[T::PatternStops];
+        std::vector<qint32> seenIn(columns[T::StopIds].size(), -1);
+        for (qint32 pattern = 0; pattern + 1 < qint32(begin.size()); ++pattern) {
+            for (qint32 i = begin[pattern]; i < begin[pattern + 1]; ++i) {
+                const qint32 stop = patternStops[i];
+                if (seenIn[stop] == pattern)
+                    continue;
+                seenIn[stop] = pattern;
+                StopPattern entry = { stop, pattern, i - begin[pattern] };
+                stopPatterns.push_back(entry);
+            }
+        }
+        std::sort(stopPatterns.begin(), stopPatterns.end(), [](const StopPattern &a, const StopPattern &b) {
+            return a.stop < b.stop || (a.stop == b.stop && a.pattern < b.pattern);
+        });
+
+        std::vector<qint32> counts(columns[T::StopIds].size(), 0);
+        for (const StopPattern &entry : stopPatterns) {
+            ++counts[entry.stop];
+            columns[T::StopPatterns].push_back(entry.pattern);
+            columns[T::StopPatternPositions].push_back(entry.position);
+        }
+        columns[T::StopPatternsBegin] = beginOffsets(counts);
+    }
+
+    //-------------- Transfers
+    {
+        struct TransferRow
+        {
+            qint32 from;
+            qint32 to;
+            qint32 time;        // -1 if transfers.txt forbids it
+            qint32 priority;    // transfers.txt wins over guesses
+        };
+        std::vector<TransferRow> transfers;
+
+        const std::vector<qint32> &latitudes = columns[T::StopLatitudes];
+        const std::vector<qint32> &longitudes = columns[T::StopLongitudes];
+        const std::vector<qint32> &eventsBegin = columns[T::StopEventsBegin];
+        const qint32 stopCount = qint32(columns[T::StopIds].size());
+        auto hasEvents = [&](qint32 stop) {
+            return eventsBegin[stop] != eventsBegin[stop + 1];
+        };
+        // Metres, equirectangular; 1e-6 degrees are 0.111 m
+        auto distance = [&](qint32 a, qint32 b) {
+            const qreal scale = std::cos(latitudes[a] / 1000000.0 * 3.14159265358979323846 / 180);
+            const qreal dx = (longitudes[a] - longitudes[b]) * scale * 0.111195;
+            const qreal dy = (latitudes[a] - latitudes[b]) * 0.111195;
+            return std::sqrt(dx * dx + dy * dy);
+        };
+        auto walkingTime = [&](qint32 a, qint32 b) {
+            return qint32(transferOverhead + distance(a, b) / walkingSpeed);
+        };
+
+        // Between the platforms of a station
+        const std::vector<qint32> &childrenBegin = columns[T::StopChildrenBegin];
+        const std::vector<qint32> &children = columns[T::StopChildren];
+        for (qint32 parent = 0; parent < stopCount; ++parent) {
+            for (qint32 i = childrenBegin[parent]; i < childrenBegin[parent + 1]; ++i) {
+                for (qint32 j = childrenBegin[parent]; j < childrenBegin[parent + 1]; ++j) {
+                    if (i == j || !hasEvents(children[i]) || !hasEvents(children[j]))
+                        continue;
+                    TransferRow row = { children[i], children[j],
+                                        qMax(walkingTime(children[i], children[j]), minimumPlatformChange), 1 };
+                    transfers.push_back(row);
+                }
+            }
+        }
+
+        // Stops in walking distance
+        std::vector<qint32> byLatitude;
+        for (qint32 stop = 0; stop < stopCount; ++stop) {
+            if (hasEvents(stop))
+                byLatitude.push_back(stop);
+        }
+        std::sort(byLatitude.begin(), byLatitude.end(), [&](qint32 a, qint32 b) {
+            return latitudes[a] < latitudes[b];
+        });
+        const qint32 latitudeRange = qint32(maxWalkingDistance / 0.111195);
+        for (size_t i = 0; i < byLatitude.size(); ++i) {
+            const qint32 a = byLatitude[i];
+            for (size_t j = i + 1; j < byLatitude.size() && latitudes[byLatitude[j]] - latitudes[a] <= latitudeRange; ++j) {
+                const qint32 b = byLatitude[j];
+                if (distance(a, b) > maxWalkingDistance)
+                    continue;
+                const qint32 time = walkingTime(a, b);
+                TransferRow there = { a, b, time, 2 };
+                TransferRow back = { b, a, time, 2 };
+                transfers.push_back(there);
+                transfers.push_back(back);
+            }
+        }
+
+        if (reader.open(feed.filePath("transfers.txt"))) {
+            const int from = reader.column("from_stop_id");
+            const int to = reader.column("to_stop_id");
+            const int type = reader.column("transfer_type");
+            const int minTime = reader.column("min_transfer_time");
+            while (reader.next()) {
+                TransferRow row;
+                row.from = stopIndex.value(reader.field(from), -1);
+                row.to = stopIndex.value(reader.field(to), -1);
+                if (row.from < 0 || row.to < 0 || row.from == row.to)
+                    continue;
+                if (reader.toInt(type) == 3)
+                    row.time = -1;
+                else
+                    row.time = reader.toInt(minTime, walkingTime(row.from, row.to));
+                row.priority = 0;
+                transfers.push_back(row);
+            }
+        }
+
+        std::sort(transfers.begin(), transfers.end(), [](const TransferRow &a, const TransferRow &b) {
+            if (a.from != b.from)
+                return a.from < b.from;
+            if (a.to != b.to)
+                return a.to < b.to;
+            return a.priority < b.priority;
+        });
+
+        std::vector<qint32> counts(stopCount, 0);
+        for (size_t i = 0; i < transfers.size(); ++i) {
+            const TransferRow &row = transfers[i];
+            if (i > 0 && transfers[i - 1].from == row.from && transfers[i - 1].to == row.to)
+                continue;
+            if (row.time < 0)
+                continue;
+            ++counts[row.from];
+            columns[T::TransferStops].push_back(row.to);
+            columns[T::TransferTimes].push_back(row.time);
+        }
+        columns[T::TransfersBegin] = beginOffsets(counts);
+    }
+    stopIndex.clear();
+
+    //-------------- Write
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QFile file(fileName + QLatin1String(".part"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+
+    T::Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = T::Magic;
+    header.version = T::Version;
+    header.timeZone = timeZone;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    static const char padding[sizeof(qint32)] = { 0, 0, 0, 0 };
+    for (int i = 0; i < T::ColumnCount; ++i) {
+        const qint64 misalignment = file.pos() % sizeof(qint32);
+        if (misalignment)
+            file.write(padding, sizeof(qint32) - misalignment);
+
+        header.columns[i].offset = quint32(file.pos());
+        if (i == T::Strings) {
+            header.columns[i].count = strings.data().size();
+            file.write(strings.data());
+        } else {
+            header.columns[i].count = quint32(columns[i].size());
+            if (!columns[i].empty())
+                file.write(reinterpret_cast<const char *>(columns[i].data()), columns[i].size() * sizeof(qint32));
+        }
+    }
+
+    file.seek(0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (file.error() != QFile::NoError) {
+        m_errorString = file.errorString();
+        file.remove();
+        return false;
+    }
+    file.close();
+
+    QFile::remove(fileName);
+    if (!file.rename(fileName)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_GTFS_IMPORTER_H
+#define PARSER_GTFS_IMPORTER_H
+
+#include <QString>
+
+// Compiles an unpacked GTFS feed (agency.txt, stops.txt, routes.txt,
+// trips.txt, stop_times.txt, calendar.txt, calendar_dates.txt and the
+// optional transfers.txt) into the GtfsTimetable format. Footpaths between
+// platforms of a station and stops a few hundred metres apart are added
+// to the transfers. The CSV files are streamed; only stop_times.txt is
+// kept in memory, as compact integer rows, to sort it.
+class GtfsImporter
+{
+public:
+    // True if fileName is missing, outdated or older than the feed.
+    static bool needsImport(const QString &feedDirectory, const QString &fileName);
+
+    bool import(const QString &feedDirectory, const QString &fileName);
+    QString errorString() const;
+
+private:
+    QString m_errorString;
+};
+
+#endif // PARSER_GTFS_IMPORTER_H
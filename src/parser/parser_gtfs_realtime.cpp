@@ -0,0 +1,450 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_gtfs_realtime.h"
+#include "parser_gtfs_timetable.h"
+
+#include <QList>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const qint32 unknownDelay = std::numeric_limits<qint32>::min();
+
+    enum WireType {
+        Varint = 0,
+        Fixed64 = 1,
+        LengthDelimited = 2,
+        Fixed32 = 5
+    };
+
+    // Just enough of the protobuf wire format for GTFS-Realtime. Fields
+    // are read one at a time, unknown ones and extensions are skipped.
+    class ProtobufReader
+    {
+    public:
+        ProtobufReader(const char *data, int size)
+            : m_data(data), m_end(data + size), m_field(0), m_wireType(0), m_error(false)
+        {}
+
+        bool next()
+        {
+            if (m_error || m_data >= m_end)
+                return false;
+            const quint64 key = readVarint();
+            m_field = int(key >> 3);
+            m_wireType = int(key & 7);
+            return !m_error;
+        }
+
+        int field() const { return m_field; }
+        bool hasError() const { return m_error; }
+
+        // int32 and int64 fields carry negative numbers sign extended
+        qint64 integer()
+        {
+            if (m_wireType != Varint) {
+                skip();
+                return 0;
+            }
+            return qint64(readVarint());
+        }
+
+        QByteArray bytes()
+        {
+            const char *begin;
+            int size;
+            if (!lengthDelimited(&begin, &size))
+                return QByteArray();
+            return QByteArray(begin, size);
+        }
+
+        ProtobufReader message()
+        {
+            const char *begin;
+            int size;
+            if (!lengthDelimited(&begin, &size))
+                return ProtobufReader(m_end, 0);
+            return ProtobufReader(begin, size);
+        }
+
+        void skip()
+        {
+            const char *begin;
+            int size;
+            switch (m_wireType) {
+            case Varint:
+                readVarint();
+                break;
+            case Fixed64:
+                advance(8);
+                break;
+            case LengthDelimited:
+                lengthDelimited(&begin, &size);
+                break;
+            case Fixed32:
+                advance(4);
+                break;
+            default:
+                m_error = true;
+            }
+        }
+
+    private:
+        const char *m_data;
+        const char *m_end;
+        int m_field;
+        int m_wireType;
+        bool m_error;
+
+        quint64 readVarint()
+        {
+            quint64 value = 0;
+            for (int shift = 0; shift < 64 && m_data < m_end; shift += 7) {
+                const quint8 byte = quint8(*m_data++);
+                value |= quint64(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return value;
+            }
+            m_error = true;
+            return 0;
+        }
+
+        void advance(int size)
+        {
+            if (size > m_end - m_data) {
+                m_error = true;
+                m_data = m_end;
+            } else {
+                m_data += size;
+            }
+        }
+
+        bool lengthDelimited(const char **begin, int *size)
+        {
+            if (m_wireType != LengthDelimited) {
+                skip();
+                return false;
+            }
+            const quint64 length = readVarint();
+            if (m_error || length > quint64(m_end - m_data)) {
+                m_error = true;
+                return false;
+            }
+            *begin = m_data;
+            *size = int(length);
+            m_data += length;
+            return true;
+        }
+    };
+
+    // The messages of gtfs-realtime.proto we need, with its field numbers
+    struct StopTimeEvent
+    {
+        qint32 delay;
+        qint64 time;            // 0 if not given
+
+        StopTimeEvent() : delay(unknownDelay), time(0) {}
+    };
+
+    struct StopTimeUpdate
+    {
+        qint32 sequence;        // -1 if not given
+        QByteArray stopId;
+        StopTimeEvent arrival;
+        StopTimeEvent departure;
+        bool skipped;
+
+        StopTimeUpdate() : sequence(-1), skipped(false) {}
+    };
+
+    struct TripUpdate
+    {
+        QByteArray tripId;
+        QByteArray startDate;
+        bool cancelled;
+        qint32 delay;
+        QList<StopTimeUpdate> stops;
+
+        TripUpdate() : cancelled(false), delay(unknownDelay) {}
+    };
+
+    bool readStopTimeEvent(ProtobufReader reader, StopTimeEvent *event)
+    {
+        while (reader.next()) {
+            switch (reader.field()) {
+            case 1:
+                event->delay = qint32(reader.integer());
+                break;
+            case 2:
+                event->time = reader.integer();
+                break;
+            default:
+                reader.skip();
+            }
+        }
+        return !reader.hasError();
+    }
+
+    bool readStopTimeUpdate(ProtobufReader reader, StopTimeUpdate *update)
+    {
+        bool ok = true;
+        while (ok && reader.next()) {
+            switch (reader.field()) {
+            case 1:
+                update->sequence = qint32(reader.integer());
+                break;
+            case 2:
+                ok = readStopTimeEvent(reader.message(), &update->arrival);
+                break;
+            case 3:
+                ok = readStopTimeEvent(reader.message(), &update->departure);
+                break;
+            case 4:
+                update->stopId = reader.bytes();
+                break;
+            case 5:
+                // SKIPPED and NO_DATA carry no delay
+                update->skipped = reader.integer() != 0;
+                break;
+            default:
+                reader.skip();
+            }
+        }
+        return ok && !reader.hasError();
+    }
+
+    bool readTripDescriptor(ProtobufReader reader, TripUpdate *update)
+    {
+        while (reader.next()) {
+            switch (reader.field()) {
+            case 1:
+                update->tripId = reader.bytes();
+                break;
+            case 3:
+                update->startDate = reader.bytes();
+                break;
+            case 4:
+                update->cancelled = reader.integer() == 3;
+                break;
+            default:
+                reader.skip();
+            }
+        }
+        return !reader.hasError();
+    }
+
+    bool readTripUpdate(ProtobufReader reader, TripUpdate *update)
+    {
+        bool ok = true;
+        while (ok && reader.next()) {
+            switch (reader.field()) {
+            case 1:
+                ok = readTripDescriptor(reader.message(), update);
+                break;
+            case 2: {
+                StopTimeUpdate stop;
+                ok = readStopTimeUpdate(reader.message(), &stop);
+                update->stops.append(stop);
+                break;
+            }
+            case 5:
+                update->delay = qint32(reader.integer());
+                break;
+            default:
+                reader.skip();
+            }
+        }
+        return ok && !reader.hasError();
+    }
+
+    qint64 tripKey(int trip, const QDate &serviceDate)
+    {
+        return (qint64(trip) << 32) | quint32(serviceDate.toJulianDay());
+    }
+
+    bool byPosition(const GtfsRealtime::StopDelay &a, const GtfsRealtime::StopDelay &b)
+    {
+        return a.position < b.position;
+    }
+}
+
+const GtfsRealtime::StopDelay *GtfsRealtime::TripDelays::lastUpdate(int position) const
+{
+    const StopDelay key = { position, 0, 0 };
+    QVector<StopDelay>::const_iterator it = std::upper_bound(stops.constBegin(), stops.constEnd(), key, byPosition);
+    return it != stops.constBegin() ? &*(it - 1) : 0;
+}
+
+qint32 GtfsRealtime::TripDelays::arrivalDelay(int position) const
+{
+    const StopDelay *update = lastUpdate(position);
+    if (!update)
+        return delay;
+    return update->position == position ? update->arrival : update->departure;
+}
+
+qint32 GtfsRealtime::TripDelays::departureDelay(int position) const
+{
+    const StopDelay *update = lastUpdate(position);
+    return update ? update->departure : delay;
+}
+
+GtfsRealtime::GtfsRealtime()
+    : m_maxDelay(0)
+    , m_minDelay(0)
+{
+}
+
+void GtfsRealtime::clear()
+{
+    m_trips.clear();
+    m_maxDelay = 0;
+    m_minDelay = 0;
+}
+
+QString GtfsRealtime::errorString() const
+{
+    return m_errorString;
+}
+
+const GtfsRealtime::TripDelays *GtfsRealtime::trip(int trip, const QDate &serviceDate) const
+{
+    if (m_trips.isEmpty())
+        return 0;
+
+    QHash<qint64, TripDelays>::const_iterator it = m_trips.constFind(tripKey(trip, serviceDate));
+    return it != m_trips.constEnd() ? &it.value() : 0;
+}
+
+bool GtfsRealtime::load(const QByteArray &feed, const GtfsTimetable &timetable,
+                        const QDate &today, const ServiceDayStart &serviceDayStart)
+{
+    clear();
+    m_errorString.clear();
+
+    const qint32 *stopTimeStops = timetable.column(GtfsTimetable::StopTimeStops);
+    const qint32 *sequences = timetable.column(GtfsTimetable::StopTimeSequences);
+    const qint32 *arrivals = timetable.column(GtfsTimetable::StopTimeArrivals);
+    const qint32 *departures = timetable.column(GtfsTimetable::StopTimeDepartures);
+
+    ProtobufReader message(feed.constData(), feed.size());
+    bool ok = true;
+    while (ok && message.next()) {
+        // FeedMessage.entity
+        if (message.field() != 2) {
+            message.skip();
+            continue;
+        }
+
+        ProtobufReader entity = message.message();
+        TripUpdate update;
+        bool hasUpdate = false;
+        bool deleted = false;
+        while (ok && entity.next()) {
+            switch (entity.field()) {
+            case 2:
+                deleted = entity.integer() != 0;
+                break;
+            case 3:
+                ok = readTripUpdate(entity.message(), &update);
+                hasUpdate = true;
+                break;
+            default:
+                entity.skip();
+            }
+        }
+        ok = ok && !entity.hasError();
+        if (!ok || !hasUpdate || deleted)
+            continue;
+
+        const int trip = timetable.findTrip(update.tripId);
+        const QDate date = update.startDate.isEmpty()
+                ? today : QDate::fromString(QString::fromLatin1(update.startDate), "yyyyMMdd");
+        if (trip < 0 || !date.isValid())
+            continue;
+        const int first = timetable.tripFirstStopTime(trip);
+        const int count = timetable.tripLastStopTime(trip) - first + 1;
+        if (count <= 0)
+            continue;
+
+        TripDelays delays;
+        delays.cancelled = update.cancelled;
+        delays.delay = update.delay != unknownDelay ? update.delay : 0;
+        qint64 dayStart = -1;
+        // Stop ids are matched from the last update on, trips may loop
+        int position = 0;
+        foreach (const StopTimeUpdate &stop, update.stops) {
+            int at = -1;
+            if (stop.sequence >= 0) {
+                for (int i = 0; i < count && at < 0; ++i) {
+                    if (sequences[first + i] == stop.sequence)
+                        at = i;
+                }
+            } else if (!stop.stopId.isEmpty()) {
+                const int stopIndex = timetable.findStop(QString::fromUtf8(stop.stopId));
+                for (int i = position; i < count && at < 0 && stopIndex >= 0; ++i) {
+                    if (stopTimeStops[first + i] == stopIndex)
+                        at = i;
+                }
+            }
+            if (at < 0 || stop.skipped)
+                continue;
+            position = at + 1;
+
+            // Absolute times win over delays, as the specification says
+            qint32 arrival = stop.arrival.delay;
+            qint32 departure = stop.departure.delay;
+            if (stop.arrival.time || stop.departure.time) {
+                if (dayStart < 0)
+                    dayStart = serviceDayStart(date);
+                if (stop.arrival.time)
+                    arrival = qint32(stop.arrival.time - dayStart - arrivals[first + at]);
+                if (stop.departure.time)
+                    departure = qint32(stop.departure.time - dayStart - departures[first + at]);
+            }
+            if (arrival == unknownDelay && departure == unknownDelay)
+                continue;
+            if (arrival == unknownDelay)
+                arrival = departure;
+            if (departure == unknownDelay)
+                departure = arrival;
+
+            const StopDelay delay = { at, arrival, departure };
+            delays.stops.append(delay);
+            m_maxDelay = qMax(m_maxDelay, qMax(arrival, departure));
+            m_minDelay = qMin(m_minDelay, qMin(arrival, departure));
+        }
+        std::stable_sort(delays.stops.begin(), delays.stops.end(), byPosition);
+        m_maxDelay = qMax(m_maxDelay, delays.delay);
+        m_minDelay = qMin(m_minDelay, delays.delay);
+
+        m_trips.insert(tripKey(trip, date), delays);
+    }
+
+    if (!ok || message.hasError()) {
+        clear();
+        m_errorString = QString("Malformed GTFS-Realtime feed");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_GTFS_REALTIME_H
+#define PARSER_GTFS_REALTIME_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+class GtfsTimetable;
+
+// Delays and cancellations of a GTFS-Realtime TripUpdates feed, laid over
+// a GtfsTimetable without touching it. Only trips the feed mentions take
+// memory, so a lookup costs one hash probe and unaffected trips nothing.
+//
+// Delays are seconds. A stop without an update of its own inherits the
+// departure delay of the last update before it, stops before the first
+// update get the delay of the whole trip, if the feed gave one.
+class GtfsRealtime
+{
+public:
+    struct StopDelay
+    {
+        qint32 position;        // within the trip
+        qint32 arrival;
+        qint32 departure;
+    };
+
+    struct TripDelays
+    {
+        bool cancelled;
+        qint32 delay;           // before the first stop update
+        QVector<StopDelay> stops;
+
+        qint32 arrivalDelay(int position) const;
+        qint32 departureDelay(int position) const;
+        const StopDelay *lastUpdate(int position) const;
+    };
+
+    // Start of a service day in seconds since the epoch, for updates
+    // giving absolute times instead of delays
+    typedef std::function<qint64(const QDate &)> ServiceDayStart;
+
+    GtfsRealtime();
+
+    // Replaces the overlay with a FeedMessage. today is the service date
+    // of trips without a start date.
+    bool load(const QByteArray &feed, const GtfsTimetable &timetable,
+              const QDate &today, const ServiceDayStart &serviceDayStart);
+    void clear();
+    QString errorString() const;
+
+    bool isEmpty() const { return m_trips.isEmpty(); }
+    int tripCount() const { return m_trips.count(); }
+    // The range of all delays, for searches over scheduled times
+    qint32 maxDelay() const { return m_maxDelay; }
+    qint32 minDelay() const { return m_minDelay; }
+
+    // 0 if the feed says nothing about the trip on that service date
+    const TripDelays *trip(int trip, const QDate &serviceDate) const;
+
+private:
+    QHash<qint64, TripDelays> m_trips;  // by trip and julian day
+    qint32 m_maxDelay;
+    qint32 m_minDelay;
+    QString m_errorString;
+};
+
+#endif // PARSER_GTFS_REALTIME_H
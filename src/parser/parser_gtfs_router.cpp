@@ -0,0 +1,564 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_gtfs_router.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const qint32 unreached = std::numeric_limits<qint32>::max();
+    const qint32 dayLength = 24 * 3600;
+    // Changing trips without leaving the platform
+    const qint32 minimumChangeTime = 60;
+    const int maxRounds = GtfsRouter::MaxTransfers + 1;
+    // Below this many departures per thread a range query isn't split
+    const int minDeparturesPerThread = 8;
+
+    enum ParentKind {
+        NoParent,
+        SourceParent,
+        TripParent,
+        WalkParent
+    };
+
+    // How a label was reached: on a trip from the board stop time (from)
+    // to the alight stop time (to), or walking from a stop (from) for
+    // some seconds (to).
+    struct Parent
+    {
+        qint8 kind;
+        qint8 day;
+        qint32 from;
+        qint32 to;
+    };
+
+    // A trip running on the service day before, of or after the search
+    struct Boarding
+    {
+        int trip;
+        int day;
+        const GtfsRealtime::TripDelays *delays;
+    };
+
+    // The labels of one search. rRAPTOR keeps them from one departure to
+    // the next earlier one, since arriving earlier than a later departure
+    // did is the only thing worth reporting.
+    class Raptor
+    {
+    public:
+        Raptor(const GtfsRouter &router, const QList<int> &targets);
+
+        void run(const QList<int> &sources, qint32 departure);
+        // Appends the journeys improved by the last run()
+        void collect(QList<GtfsRouter::Journey> *journeys);
+
+    private:
+        const GtfsRouter &m_router;
+        const GtfsTimetable &m_timetable;
+        const int m_stopCount;
+        QList<int> m_targets;
+
+        std::vector<qint32> m_labels;           // by round, then stop
+        std::vector<Parent> m_parents;
+        std::vector<qint32> m_bestArrivals;     // over all rounds
+        std::vector<quint8> m_isTarget;
+        qint32 m_targetBound;
+        qint32 m_reported[maxRounds + 1];
+
+        std::vector<quint8> m_marked;
+        std::vector<qint32> m_markedStops;
+        std::vector<qint32> m_queuedPositions;
+        std::vector<qint32> m_queuedPatterns;
+        std::vector<std::pair<qint32, qint32> > m_walkSources;
+
+        qint32 &label(int round, int stop) { return m_labels[round * m_stopCount + stop]; }
+        Parent &parent(int round, int stop) { return m_parents[round * m_stopCount + stop]; }
+
+        void improve(int round, int stop, qint32 arrival, const Parent &parent);
+        void scanPatterns(int round);
+        void scanPattern(int round, int pattern, int position);
+        void relaxFootpaths(int round);
+        qint32 departure(const Boarding &boarding, int position) const;
+        qint32 arrival(const Boarding &boarding, int position) const;
+        bool earliestTrip(int pattern, int position, qint32 time, Boarding *boarding) const;
+        bool reconstruct(int round, int target, GtfsRouter::Journey *journey);
+    };
+
+    Raptor::Raptor(const GtfsRouter &router, const QList<int> &targets)
+        : m_router(router)
+        , m_timetable(router.timetable())
+        , m_stopCount(router.timetable().stopCount())
+        , m_targets(targets)
+        , m_labels((maxRounds + 1) * m_stopCount, unreached)
+        , m_parents((maxRounds + 1) * m_stopCount)
+        , m_bestArrivals(m_stopCount, unreached)
+        , m_isTarget(m_stopCount, 0)
+        , m_targetBound(unreached)
+        , m_marked(m_stopCount, 0)
+        , m_queuedPositions(m_timetable.patternCount(), -1)
+    {
+        foreach (int target, targets)
+            m_isTarget[target] = 1;
+        for (int round = 0; round <= maxRounds; ++round)
+            m_reported[round] = unreached;
+        const Parent none = { NoParent, 0, -1, -1 };
+        std::fill(m_parents.begin(), m_parents.end(), none);
+    }
+
+    void Raptor::run(const QList<int> &sources, qint32 departure)
+    {
+        const Parent source = { SourceParent, 0, -1, -1 };
+        foreach (int stop, sources)
+            improve(0, stop, departure, source);
+        relaxFootpaths(0);
+
+        for (int round = 1; round <= maxRounds && !m_markedStops.empty(); ++round) {
+            scanPatterns(round);
+            relaxFootpaths(round);
+        }
+
+        foreach (qint32 stop, m_markedStops)
+            m_marked[stop] = 0;
+        m_markedStops.clear();
+    }
+
+    void Raptor::improve(int round, int stop, qint32 arrival, const Parent &parent)
+    {
+        // Local and target pruning
+        if (arrival >= m_bestArrivals[stop] || arrival >= m_targetBound)
+            return;
+
+        label(round, stop) = arrival;
+        this->parent(round, stop) = parent;
+        m_bestArrivals[stop] = arrival;
+        if (m_isTarget[stop])
+            m_targetBound = arrival;
+        if (!m_marked[stop]) {
+            m_marked[stop] = 1;
+            m_markedStops.push_back(stop);
+        }
+    }
+
+    void Raptor::scanPatterns(int round)
+    {
+        // Every pattern once, from the first stop improved last round
+        const qint32 *begin = m_timetable.column(GtfsTimetable::StopPatternsBegin);
+        const qint32 *patterns = m_timetable.column(GtfsTimetable::StopPatterns);
+        const qint32 *positions = m_timetable.column(GtfsTimetable::StopPatternPositions);
+        foreach (qint32 stop, m_markedStops) {
+            m_marked[stop] = 0;
+            for (int i = begin[stop]; i < begin[stop + 1]; ++i) {
+                const qint32 pattern = patterns[i];
+                if (!m_router.isPatternAllowed(pattern))
+                    continue;
+                qint32 &queued = m_queuedPositions[pattern];
+                if (queued < 0)
+                    m_queuedPatterns.push_back(pattern);
+                if (queued < 0 || positions[i] < queued)
+                    queued = positions[i];
+            }
+        }
+        m_markedStops.clear();
+
+        foreach (qint32 pattern, m_queuedPatterns) {
+            const qint32 position = m_queuedPositions[pattern];
+            m_queuedPositions[pattern] = -1;
+            scanPattern(round, pattern, position);
+        }
+        m_queuedPatterns.clear();
+    }
+
+    void Raptor::scanPattern(int round, int pattern, int position)
+    {
+        const qint32 *patternStopsBegin = m_timetable.column(GtfsTimetable::PatternStopsBegin);
+        const qint32 *stops = m_timetable.column(GtfsTimetable::PatternStops) + patternStopsBegin[pattern];
+        const int length = patternStopsBegin[pattern + 1] - patternStopsBegin[pattern];
+        const qint32 *tripBegin = m_timetable.column(GtfsTimetable::TripStopTimesBegin);
+
+        Boarding trip = { -1, 0, 0 };
+        int board = -1;
+        for (int i = position; i < length; ++i) {
+            const int stop = stops[i];
+            if (trip.trip >= 0) {
+                const Parent onTrip = { TripParent, qint8(trip.day), board, tripBegin[trip.trip] + i };
+                improve(round, stop, arrival(trip, i), onTrip);
+            }
+
+            // Catch an earlier trip here?
+            qint32 ready = label(round - 1, stop);
+            if (ready == unreached)
+                continue;
+            if (parent(round - 1, stop).kind == TripParent)
+                ready += minimumChangeTime;
+            if (trip.trip >= 0 && ready > departure(trip, i))
+                continue;
+
+            Boarding earlier;
+            if (!earliestTrip(pattern, i, ready, &earlier))
+                continue;
+            if (trip.trip < 0 || departure(earlier, i) < departure(trip, i)) {
+                trip = earlier;
+                board = tripBegin[trip.trip] + i;
+            }
+        }
+    }
+
+    void Raptor::relaxFootpaths(int round)
+    {
+        // Only from stops reached on a trip (or the origin), the stops
+        // walked to are marked for the next round as well.
+        m_walkSources.clear();
+        foreach (qint32 stop, m_markedStops)
+            m_walkSources.push_back(std::make_pair(stop, label(round, stop)));
+
+        const qint32 *begin = m_timetable.column(GtfsTimetable::TransfersBegin);
+        const qint32 *stops = m_timetable.column(GtfsTimetable::TransferStops);
+        const qint32 *times = m_timetable.column(GtfsTimetable::TransferTimes);
+        for (size_t i = 0; i < m_walkSources.size(); ++i) {
+            const qint32 from = m_walkSources[i].first;
+            const qint32 arrival = m_walkSources[i].second;
+            for (int j = begin[from]; j < begin[from + 1]; ++j) {
+                const Parent walk = { WalkParent, 0, from, times[j] };
+                improve(round, stops[j], arrival + times[j], walk);
+            }
+        }
+    }
+
+    qint32 Raptor::departure(const Boarding &boarding, int position) const
+    {
+        const int stopTime = m_timetable.tripFirstStopTime(boarding.trip) + position;
+        return m_timetable.column(GtfsTimetable::StopTimeDepartures)[stopTime] + boarding.day * dayLength
+                + (boarding.delays ? boarding.delays->departureDelay(position) : 0);
+    }
+
+    qint32 Raptor::arrival(const Boarding &boarding, int position) const
+    {
+        const int stopTime = m_timetable.tripFirstStopTime(boarding.trip) + position;
+        return m_timetable.column(GtfsTimetable::StopTimeArrivals)[stopTime] + boarding.day * dayLength
+                + (boarding.delays ? boarding.delays->arrivalDelay(position) : 0);
+    }
+
+    // Trips are sorted by their scheduled departures. Delayed ones may
+    // leave after a trip scheduled up to maxDelay() later, and no trip
+    // leaves earlier than minDelay() before its schedule.
+    bool Raptor::earliestTrip(int pattern, int position, qint32 time, Boarding *boarding) const
+    {
+        const qint32 *patternTripsBegin = m_timetable.column(GtfsTimetable::PatternTripsBegin);
+        const qint32 *first = m_timetable.column(GtfsTimetable::PatternTrips) + patternTripsBegin[pattern];
+        const qint32 *last = m_timetable.column(GtfsTimetable::PatternTrips) + patternTripsBegin[pattern + 1];
+        const qint32 *tripBegin = m_timetable.column(GtfsTimetable::TripStopTimesBegin);
+        const qint32 *departures = m_timetable.column(GtfsTimetable::StopTimeDepartures);
+
+        qint32 best = unreached;
+        for (int d = -1; d <= 1; ++d) {
+            const qint32 local = time - d * dayLength - m_router.maxDelay();
+            const qint32 *it = std::lower_bound(first, last, local, [&](qint32 candidate, qint32 value) {
+                return departures[tripBegin[candidate] + position] < value;
+            });
+            for (; it != last; ++it) {
+                const qint32 scheduled = departures[tripBegin[*it] + position] + d * dayLength;
+                if (scheduled + m_router.minDelay() >= best)
+                    break;
+                if (!m_router.isTripActive(*it, d))
+                    continue;
+                const Boarding candidate = { *it, d, m_router.tripDelays(*it, d) };
+                if (candidate.delays && candidate.delays->cancelled)
+                    continue;
+                const qint32 expected = candidate.delays
+                        ? scheduled + candidate.delays->departureDelay(position) : scheduled;
+                if (expected >= time && expected < best) {
+                    best = expected;
+                    *boarding = candidate;
+                }
+            }
+        }
+        return best != unreached;
+    }
+
+    void Raptor::collect(QList<GtfsRouter::Journey> *journeys)
+    {
+        qint32 arrivals[maxRounds + 1];
+        int targets[maxRounds + 1];
+        for (int round = 0; round <= maxRounds; ++round) {
+            arrivals[round] = unreached;
+            targets[round] = -1;
+            foreach (int target, m_targets) {
+                if (label(round, target) < arrivals[round]) {
+                    arrivals[round] = label(round, target);
+                    targets[round] = target;
+                }
+            }
+        }
+
+        // A journey with more trips has to arrive earlier
+        qint32 fewerTrips = unreached;
+        for (int round = 0; round <= maxRounds; ++round) {
+            if (arrivals[round] < m_reported[round] && arrivals[round] < fewerTrips) {
+                GtfsRouter::Journey journey;
+                if (reconstruct(round, targets[round], &journey))
+                    journeys->append(journey);
+            }
+            m_reported[round] = arrivals[round];
+            fewerTrips = qMin(fewerTrips, arrivals[round]);
+        }
+    }
+
+    bool Raptor::reconstruct(int round, int target, GtfsRouter::Journey *journey)
+    {
+        const qint32 *stopTimeStops = m_timetable.column(GtfsTimetable::StopTimeStops);
+        const qint32 *stopTimeTrips = m_timetable.column(GtfsTimetable::StopTimeTrips);
+
+        journey->legs.clear();
+        journey->arrival = label(round, target);
+        int stop = target;
+        for (int legs = 0; legs <= 3 * maxRounds + 1; ++legs) {
+            const Parent &from = parent(round, stop);
+            GtfsRouter::Leg leg;
+            switch (from.kind) {
+            case SourceParent:
+                if (journey->legs.isEmpty())
+                    return false;
+                // Leave just in time for the first trip
+                if (journey->legs.count() > 1 && journey->legs.first().trip < 0) {
+                    GtfsRouter::Leg &walk = journey->legs.first();
+                    const qint32 wait = journey->legs.at(1).departure - walk.arrival;
+                    walk.departure += wait;
+                    walk.arrival += wait;
+                }
+                journey->departure = journey->legs.first().departure;
+                return true;
+            case WalkParent:
+                leg.hasRealtime = false;
+                leg.departureDelay = 0;
+                leg.arrivalDelay = 0;
+                leg.trip = -1;
+                leg.boardStopTime = -1;
+                leg.alightStopTime = -1;
+                leg.fromStop = from.from;
+                leg.toStop = stop;
+                leg.arrival = label(round, stop);
+                leg.departure = leg.arrival - from.to;
+                break;
+            case TripParent: {
+                const int trip = stopTimeTrips[from.from];
+                const Boarding boarding = { trip, from.day, m_router.tripDelays(trip, from.day) };
+                const int boardPosition = from.from - m_timetable.tripFirstStopTime(trip);
+                const int alightPosition = from.to - m_timetable.tripFirstStopTime(trip);
+                leg.trip = trip;
+                leg.boardStopTime = from.from;
+                leg.alightStopTime = from.to;
+                leg.fromStop = stopTimeStops[from.from];
+                leg.toStop = stop;
+                leg.departure = departure(boarding, boardPosition);
+                leg.arrival = arrival(boarding, alightPosition);
+                leg.hasRealtime = boarding.delays != 0;
+                leg.departureDelay = boarding.delays ? boarding.delays->departureDelay(boardPosition) : 0;
+                leg.arrivalDelay = boarding.delays ? boarding.delays->arrivalDelay(alightPosition) : 0;
+                --round;
+                break;
+            }
+            default:
+                return false;
+            }
+            journey->legs.prepend(leg);
+            stop = leg.fromStop;
+        }
+        return false;
+    }
+
+    class RangeTask : public QRunnable
+    {
+    public:
+        RangeTask(const GtfsRouter &router, const QList<int> &from, const QList<int> &to,
+                  const qint32 *departures, int count)
+            : m_router(router), m_from(from), m_to(to), m_departures(departures), m_count(count)
+        {
+            setAutoDelete(false);
+        }
+
+        // Latest departure first, the departures are sorted descending
+        void run()
+        {
+            Raptor raptor(m_router, m_to);
+            for (int i = 0; i < m_count; ++i) {
+                raptor.run(m_from, m_departures[i]);
+                raptor.collect(&journeys);
+            }
+        }
+
+        QList<GtfsRouter::Journey> journeys;
+
+    private:
+        const GtfsRouter &m_router;
+        const QList<int> m_from;
+        const QList<int> m_to;
+        const qint32 *m_departures;
+        const int m_count;
+    };
+}
+
+int GtfsRouter::Journey::transfers() const
+{
+    int trips = 0;
+    foreach (const Leg &leg, legs) {
+        if (leg.trip >= 0)
+            ++trips;
+    }
+    return qMax(0, trips - 1);
+}
+
+GtfsRouter::GtfsRouter(const GtfsTimetable &timetable, const QDate &date, int modes,
+                       const GtfsRealtime *realtime)
+    : m_timetable(timetable)
+    , m_modes(modes)
+    , m_realtime(realtime && !realtime->isEmpty() ? realtime : 0)
+    , m_activeDays(timetable.activeServices(date))
+    , m_allowedPatterns(timetable.patternCount(), 0)
+{
+    const qint32 *routes = timetable.column(GtfsTimetable::PatternRoutes);
+    for (int pattern = 0; pattern < timetable.patternCount(); ++pattern)
+        m_allowedPatterns[pattern] = (timetable.routeMode(routes[pattern]) & modes) != 0;
+    for (int day = -1; day <= 1; ++day)
+        m_dates[day + 1] = date.addDays(day);
+}
+
+bool GtfsRouter::isTripActive(int trip, int day) const
+{
+    const int service = m_timetable.column(GtfsTimetable::TripServices)[trip];
+    return (m_activeDays[service] & (1 << (day + 1))) != 0;
+}
+
+const GtfsRealtime::TripDelays *GtfsRouter::tripDelays(int trip, int day) const
+{
+    return m_realtime ? m_realtime->trip(trip, m_dates[day + 1]) : 0;
+}
+
+QList<GtfsRouter::Journey> GtfsRouter::earliestArrival(const QList<int> &from, const QList<int> &to, qint32 departure) const
+{
+    Raptor raptor(*this, to);
+    raptor.run(from, departure);
+
+    QList<Journey> journeys;
+    raptor.collect(&journeys);
+    return paretoOptimal(journeys);
+}
+
+QList<GtfsRouter::Journey> GtfsRouter::range(const QList<int> &from, const QList<int> &to, qint32 begin, qint32 end) const
+{
+    const qint32 *eventsBegin = m_timetable.column(GtfsTimetable::StopEventsBegin);
+    const qint32 *events = m_timetable.column(GtfsTimetable::StopEvents);
+    const qint32 *stopTimeTrips = m_timetable.column(GtfsTimetable::StopTimeTrips);
+    const qint32 *departureTimes = m_timetable.column(GtfsTimetable::StopTimeDepartures);
+    const qint32 *tripRoutes = m_timetable.column(GtfsTimetable::TripRoutes);
+
+    // Every departure from the origin in the window
+    std::vector<qint32> departures;
+    foreach (int stop, from) {
+        for (int i = eventsBegin[stop]; i < eventsBegin[stop + 1]; ++i) {
+            const int stopTime = events[i];
+            const int trip = stopTimeTrips[stopTime];
+            if (stopTime == m_timetable.tripLastStopTime(trip)
+                    || !(m_timetable.routeMode(tripRoutes[trip]) & m_modes))
+                continue;
+            for (int day = -1; day <= 1; ++day) {
+                if (!isTripActive(trip, day))
+                    continue;
+                qint32 departure = departureTimes[stopTime] + day * dayLength;
+                if (const GtfsRealtime::TripDelays *delays = tripDelays(trip, day)) {
+                    if (delays->cancelled)
+                        continue;
+                    departure += delays->departureDelay(stopTime - m_timetable.tripFirstStopTime(trip));
+                }
+                if (departure >= begin && departure <= end)
+                    departures.push_back(departure);
+            }
+        }
+    }
+    std::sort(departures.begin(), departures.end(), std::greater<qint32>());
+    departures.erase(std::unique(departures.begin(), departures.end()), departures.end());
+    if (departures.empty())
+        return QList<Journey>();
+
+    // Consecutive departures per thread, so pruning still works well
+    const int count = int(departures.size());
+    const int threads = qBound(1, qMin(QThread::idealThreadCount(), count / minDeparturesPerThread), count);
+    QList<RangeTask *> tasks;
+    for (int i = 0; i < threads; ++i) {
+        const int first = count * i / threads;
+        const int last = count * (i + 1) / threads;
+        tasks.append(new RangeTask(*this, from, to, departures.data() + first, last - first));
+    }
+
+    if (threads == 1) {
+        tasks.first()->run();
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        foreach (RangeTask *task, tasks)
+            pool.start(task);
+        pool.waitForDone();
+    }
+
+    QList<Journey> journeys;
+    foreach (RangeTask *task, tasks) {
+        foreach (const Journey &journey, task->journeys) {
+            if (journey.departure >= begin && journey.departure <= end)
+                journeys.append(journey);
+        }
+    }
+    qDeleteAll(tasks);
+
+    return paretoOptimal(journeys);
+}
+
+QList<GtfsRouter::Journey> GtfsRouter::paretoOptimal(const QList<Journey> &journeys)
+{
+    QList<Journey> result;
+    for (int i = 0; i < journeys.count(); ++i) {
+        const Journey &journey = journeys.at(i);
+        bool dominated = false;
+        for (int j = 0; j < journeys.count() && !dominated; ++j) {
+            if (i == j)
+                continue;
+            const Journey &other = journeys.at(j);
+            const bool notWorse = other.departure >= journey.departure
+                    && other.arrival <= journey.arrival
+                    && other.transfers() <= journey.transfers();
+            const bool better = other.departure > journey.departure
+                    || other.arrival < journey.arrival
+                    || other.transfers() < journey.transfers();
+            // Of identical ones the first stays
+            dominated = notWorse && (better || j < i);
+        }
+        if (!dominated)
+            result.append(journey);
+    }
+
+    std::sort(result.begin(), result.end(), [](const Journey &a, const Journey &b) {
+        return a.departure < b.departure || (a.departure == b.departure && a.arrival < b.arrival);
+    });
+    return result;
+}
@@ -0,0 +1,107 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_GTFS_ROUTER_H
+#define PARSER_GTFS_ROUTER_H
+
+#include "parser_gtfs_realtime.h"
+#include "parser_gtfs_timetable.h"
+
+#include <QList>
+
+#include <vector>
+
+// Round based public transit routing (RAPTOR, Delling et al.) on a
+// GtfsTimetable. Round k finds the earliest arrivals using k trips, by
+// scanning every pattern serving a stop improved in round k - 1 and then
+// relaxing footpaths.
+//
+// All times are seconds after the start of the service day of the date
+// the router was made for. Trips of the previous and the next service day
+// are shifted by 24 hours, which is off by an hour across a daylight
+// saving time switch.
+//
+// With a GtfsRealtime overlay trips run with their delays and cancelled
+// ones not at all; the legs carry the expected, not the scheduled times.
+class GtfsRouter
+{
+public:
+    struct Leg
+    {
+        int trip;               // -1 for walking
+        int boardStopTime;
+        int alightStopTime;
+        int fromStop;
+        int toStop;
+        qint32 departure;
+        qint32 arrival;
+        // Included in departure and arrival, known only for trips
+        // with realtime data
+        bool hasRealtime;
+        qint32 departureDelay;
+        qint32 arrivalDelay;
+    };
+
+    struct Journey
+    {
+        qint32 departure;
+        qint32 arrival;
+        QList<Leg> legs;
+
+        int transfers() const;
+    };
+
+    static const int MaxTransfers = 6;
+
+    // modes is a combination of GtfsTimetable::ModeFlags
+    GtfsRouter(const GtfsTimetable &timetable, const QDate &date, int modes,
+               const GtfsRealtime *realtime = 0);
+
+    // Pareto optimal journeys by arrival and transfers for one departure
+    QList<Journey> earliestArrival(const QList<int> &from, const QList<int> &to, qint32 departure) const;
+
+    // Pareto optimal journeys by departure, arrival and transfers for all
+    // departures from the origin in [begin, end]. The departures are
+    // split across a thread pool, each thread running rRAPTOR on its
+    // share, from the latest departure to the earliest.
+    QList<Journey> range(const QList<int> &from, const QList<int> &to, qint32 begin, qint32 end) const;
+
+    // Drops journeys another one beats in departure, arrival and transfers
+    static QList<Journey> paretoOptimal(const QList<Journey> &journeys);
+
+    const GtfsTimetable &timetable() const { return m_timetable; }
+    bool isTripActive(int trip, int day) const;
+    bool isPatternAllowed(int pattern) const { return m_allowedPatterns[pattern] != 0; }
+    const GtfsRealtime::TripDelays *tripDelays(int trip, int day) const;
+    // Bounds of all delays, 0 without realtime data
+    qint32 maxDelay() const { return m_realtime ? m_realtime->maxDelay() : 0; }
+    qint32 minDelay() const { return m_realtime ? m_realtime->minDelay() : 0; }
+
+private:
+    const GtfsTimetable &m_timetable;
+    int m_modes;
+    QDate m_dates[3];           // service dates of day -1, 0 and 1
+    const GtfsRealtime *m_realtime;
+    // See GtfsTimetable::activeServices()
+    std::vector<quint8> m_activeDays;
+    std::vector<quint8> m_allowedPatterns;
+};
+
+#endif // PARSER_GTFS_ROUTER_H
@@ -0,0 +1,261 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_gtfs_timetable.h"
+
+#include <QByteArray>
+
+GtfsTimetable::GtfsTimetable()
+    : m_data(0), m_strings(0), m_timeZone(0)
+{
+    close();
+}
+
+GtfsTimetable::~GtfsTimetable()
+{
+    close();
+}
+
+bool GtfsTimetable::open(const QString &fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < qint64(sizeof(Header))) {
+        m_errorString = QString("%1 is truncated").arg(fileName);
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data) {
+        m_errorString = m_file.errorString();
+        close();
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(m_data);
+    if (header->magic != Magic || header->version != Version) {
+        m_errorString = QString("%1 has an unsupported format").arg(fileName);
+        close();
+        return false;
+    }
+
+    for (int i = 0; i < ColumnCount; ++i) {
+        const ColumnEntry &entry = header->columns[i];
+        const qint64 bytes = i == Strings ? entry.count : qint64(entry.count) * sizeof(qint32);
+        if (entry.offset % sizeof(qint32) != 0 || entry.offset + bytes > size) {
+            m_errorString = QString("%1 is corrupt").arg(fileName);
+            close();
+            return false;
+        }
+        m_columns[i] = reinterpret_cast<const qint32 *>(m_data + entry.offset);
+        m_counts[i] = entry.count;
+    }
+    m_strings = reinterpret_cast<const char *>(m_data + header->columns[Strings].offset);
+    m_columns[Strings] = 0;
+    m_timeZone = header->timeZone;
+
+    // Everything else indexes through these, so they have to fit.
+    if (m_counts[Strings] == 0 || m_strings[m_counts[Strings] - 1] != '\0'
+            || m_counts[StopChildrenBegin] != stopCount() + 1
+            || m_counts[StopEventsBegin] != stopCount() + 1
+            || m_counts[TripStopTimesBegin] != tripCount() + 1
+            || m_counts[ServiceExceptionsBegin] != serviceCount() + 1
+            || m_counts[PatternStopsBegin] != patternCount() + 1
+            || m_counts[PatternTripsBegin] != patternCount() + 1
+            || m_counts[TripPatterns] != tripCount()
+            || m_counts[TripsById] != tripCount()
+            || m_counts[StopTimeSequences] != m_counts[StopTimeStops]
+            || m_counts[StopPatternsBegin] != stopCount() + 1
+            || m_counts[StopPatternPositions] != m_counts[StopPatterns]
+            || m_counts[TransfersBegin] != stopCount() + 1
+            || m_counts[TransferTimes] != m_counts[TransferStops]
+            || m_counts[StopEvents] != m_counts[StopTimeStops]) {
+        m_errorString = QString("%1 is corrupt").arg(fileName);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void GtfsTimetable::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+    m_file.close();
+
+    m_data = 0;
+    m_strings = 0;
+    m_timeZone = 0;
+    for (int i = 0; i < ColumnCount; ++i) {
+        m_columns[i] = 0;
+        m_counts[i] = 0;
+    }
+}
+
+bool GtfsTimetable::isOpen() const
+{
+    return m_data != 0;
+}
+
+QString GtfsTimetable::errorString() const
+{
+    return m_errorString;
+}
+
+bool GtfsTimetable::isCurrentVersion(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    Header header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header))
+        return false;
+    return header.magic == Magic && header.version == Version;
+}
+
+QString GtfsTimetable::string(qint32 offset) const
+{
+    if (offset <= 0 || offset >= m_counts[Strings])
+        return QString();
+    return QString::fromUtf8(m_strings + offset);
+}
+
+QString GtfsTimetable::timeZone() const
+{
+    return string(m_timeZone);
+}
+
+int GtfsTimetable::findStop(const QString &stopId) const
+{
+    const QByteArray id = stopId.toUtf8();
+    const qint32 *ids = m_columns[StopIds];
+
+    int first = 0;
+    int last = stopCount();
+    while (first < last) {
+        const int middle = (first + last) / 2;
+        const int order = qstrcmp(m_strings + ids[middle], id.constData());
+        if (order == 0)
+            return middle;
+        if (order < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return -1;
+}
+
+int GtfsTimetable::findTrip(const QByteArray &tripId) const
+{
+    const qint32 *ids = m_columns[TripIds];
+    const qint32 *byId = m_columns[TripsById];
+
+    int first = 0;
+    int last = tripCount();
+    while (first < last) {
+        const int middle = (first + last) / 2;
+        const int order = qstrcmp(m_strings + ids[byId[middle]], tripId.constData());
+        if (order == 0)
+            return byId[middle];
+        if (order < 0)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return -1;
+}
+
+QString GtfsTimetable::routeName(int route) const
+{
+    const qint32 shortName = m_columns[RouteShortNames][route];
+    if (shortName > 0)
+        return string(shortName);
+    return string(m_columns[RouteLongNames][route]);
+}
+
+bool GtfsTimetable::isServiceActive(int service, const QDate &date) const
+{
+    const qint32 day = qint32(date.toJulianDay());
+
+    const qint32 *days = m_columns[ServiceExceptionDays];
+    const qint32 *types = m_columns[ServiceExceptionTypes];
+    for (int i = m_columns[ServiceExceptionsBegin][service]; i < m_columns[ServiceExceptionsBegin][service + 1]; ++i) {
+        if (days[i] == day)
+            return types[i] == 1;
+    }
+
+    if (day < m_columns[ServiceStartDays][service] || day > m_columns[ServiceEndDays][service])
+        return false;
+    return (m_columns[ServiceWeekdays][service] & (1 << (date.dayOfWeek() - 1))) != 0;
+}
+
+std::vector<quint8> GtfsTimetable::activeServices(const QDate &date) const
+{
+    std::vector<quint8> result(serviceCount(), 0);
+    for (int day = -1; day <= 1; ++day) {
+        const QDate serviceDate = date.addDays(day);
+        for (int service = 0; service < serviceCount(); ++service) {
+            if (isServiceActive(service, serviceDate))
+                result[service] |= 1 << (day + 1);
+        }
+    }
+    return result;
+}
+
+int GtfsTimetable::modeFlag(int routeType)
+{
+    switch (routeType) {
+    case 0:
+        return Tram;
+    case 1:
+        return Subway;
+    case 2:
+        return Rail;
+    case 3:
+        return Bus;
+    case 4:
+        return Ferry;
+    }
+
+    // Extended route types, see the Google Transit documentation
+    if (routeType >= 100 && routeType < 200)
+        return Rail;
+    if (routeType >= 200 && routeType < 300)
+        return Bus;     // Coach
+    if (routeType >= 400 && routeType < 500)
+        return Subway;  // Urban railway
+    if (routeType >= 700 && routeType < 900)
+        return Bus;     // Bus, trolleybus
+    if (routeType >= 900 && routeType < 1000)
+        return Tram;
+    if ((routeType >= 1000 && routeType < 1100) || (routeType >= 1200 && routeType < 1300))
+        return Ferry;   // Water transport, ferries
+    return OtherModes;
+}
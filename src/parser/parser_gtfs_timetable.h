@@ -0,0 +1,180 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_GTFS_TIMETABLE_H
+#define PARSER_GTFS_TIMETABLE_H
+
+#include <QDate>
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+// The compiled form of a GTFS feed as written by GtfsImporter. The file is
+// memory mapped and read in place, so opening it costs next to nothing and
+// nothing is copied: every column is an array of 32 bit integers and
+// strings are offsets into one UTF-8 blob.
+//
+// Stops, routes, trips and services are referred to by their index. Stops
+// are sorted by their GTFS stop_id, stop times by trip and stop sequence,
+// and the stop event index lists the stop times of every stop sorted by
+// departure. Times are seconds after the start of the service day and may
+// exceed 24 hours, like in GTFS.
+//
+// For routing, trips calling at the same stops in the same order form a
+// pattern. Within a pattern no trip overtakes another, so the trips sorted
+// by their first departure are sorted at every stop.
+class GtfsTimetable
+{
+public:
+    enum Column {
+        Strings,                // UTF-8, NUL terminated, offset 0 is ""
+        StopIds,
+        StopNames,
+        StopPlatforms,
+        StopLatitudes,          // millionths of a degree
+        StopLongitudes,
+        StopParents,            // -1 for none
+        StopChildrenBegin,      // stops + 1 entries into StopChildren
+        StopChildren,
+        StopEventsBegin,        // stops + 1 entries into StopEvents
+        StopEvents,             // stop times by stop and departure
+        RouteShortNames,
+        RouteLongNames,
+        RouteTypes,
+        TripIds,
+        TripRoutes,
+        TripServices,
+        TripHeadsigns,
+        TripsById,              // trips sorted by their GTFS trip_id
+        TripStopTimesBegin,     // trips + 1 entries into the stop times
+        StopTimeStops,
+        StopTimeTrips,
+        StopTimeArrivals,
+        StopTimeDepartures,
+        StopTimeSequences,      // stop_sequence, for realtime updates
+        ServiceIds,
+        ServiceStartDays,       // julian days
+        ServiceEndDays,
+        ServiceWeekdays,        // bit 0 is Monday
+        ServiceExceptionsBegin, // services + 1 entries into the exceptions
+        ServiceExceptionDays,
+        ServiceExceptionTypes,  // 1 added, 2 removed, like calendar_dates.txt
+        PatternRoutes,
+        PatternStopsBegin,      // patterns + 1 entries into PatternStops
+        PatternStops,
+        PatternTripsBegin,      // patterns + 1 entries into PatternTrips
+        PatternTrips,           // by departure, no trip overtakes another
+        TripPatterns,           // -1 for trips without stop times
+        StopPatternsBegin,      // stops + 1 entries into the two below
+        StopPatterns,
+        StopPatternPositions,   // first index of the stop in the pattern
+        TransfersBegin,         // stops + 1 entries into the two below
+        TransferStops,
+        TransferTimes,          // seconds of walking
+        ColumnCount
+    };
+
+    static const quint32 Magic = 0x54475046; // "FPGT"
+    static const quint32 Version = 4;
+
+    struct ColumnEntry
+    {
+        quint32 offset;
+        quint32 count;
+    };
+
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 timeZone;       // agency_timezone, offset into Strings
+        quint32 reserved;
+        ColumnEntry columns[ColumnCount];
+    };
+
+    GtfsTimetable();
+    ~GtfsTimetable();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    // Reads only the header, to tell whether a file needs rebuilding.
+    static bool isCurrentVersion(const QString &fileName);
+
+    const qint32 *column(Column column) const { return m_columns[column]; }
+    int count(Column column) const { return m_counts[column]; }
+    QString string(qint32 offset) const;
+    QString timeZone() const;
+
+    int stopCount() const { return m_counts[StopIds]; }
+    int tripCount() const { return m_counts[TripIds]; }
+    int routeCount() const { return m_counts[RouteShortNames]; }
+    int serviceCount() const { return m_counts[ServiceIds]; }
+    int patternCount() const { return m_counts[PatternRoutes]; }
+
+    int findStop(const QString &stopId) const;
+    QString stopId(int stop) const { return string(m_columns[StopIds][stop]); }
+    QString stopName(int stop) const { return string(m_columns[StopNames][stop]); }
+    QString stopPlatform(int stop) const { return string(m_columns[StopPlatforms][stop]); }
+    qreal stopLatitude(int stop) const { return m_columns[StopLatitudes][stop] / 1000000.0; }
+    qreal stopLongitude(int stop) const { return m_columns[StopLongitudes][stop] / 1000000.0; }
+    int stopParent(int stop) const { return m_columns[StopParents][stop]; }
+
+    int findTrip(const QByteArray &tripId) const;
+
+    QString routeName(int route) const;
+    QString tripHeadsign(int trip) const { return string(m_columns[TripHeadsigns][trip]); }
+    int tripFirstStopTime(int trip) const { return m_columns[TripStopTimesBegin][trip]; }
+    int tripLastStopTime(int trip) const { return m_columns[TripStopTimesBegin][trip + 1] - 1; }
+
+    bool isServiceActive(int service, const QDate &date) const;
+    // Bit day + 1 is set for every service running on date + day, with
+    // day -1, 0 and 1.
+    std::vector<quint8> activeServices(const QDate &date) const;
+
+    // GTFS route_type, basic and extended, as one of ModeFlags
+    enum ModeFlag {
+        Rail = 0x01,
+        Subway = 0x02,
+        Tram = 0x04,
+        Bus = 0x08,
+        Ferry = 0x10,
+        OtherModes = 0x20,
+        AllModes = 0x3f
+    };
+    static int modeFlag(int routeType);
+    int routeMode(int route) const { return modeFlag(m_columns[RouteTypes][route]); }
+
+private:
+    QFile m_file;
+    const uchar *m_data;
+    const char *m_strings;
+    const qint32 *m_columns[ColumnCount];
+    int m_counts[ColumnCount];
+    qint32 m_timeZone;
+    QString m_errorString;
+
+    Q_DISABLE_COPY(GtfsTimetable)
+};
+
+#endif // PARSER_GTFS_TIMETABLE_H
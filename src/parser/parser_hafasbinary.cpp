@@ -18,6 +18,8 @@
 ****************************************************************************/
 
 #include "parser_hafasbinary.h"
+#include "parser_hafaslocationid.h"
+#include "fahrplan_log.h"
 
 #include <QNetworkReply>
 #include <QTextCodec>
@@ -26,6 +28,8 @@
     #include <QUrlQuery>
 #endif
 
+FAHRPLAN_LOG_CATEGORY(logHafasBinary, "parser.hafasbinary")
+
 ParserHafasBinary::ParserHafasBinary(QObject *parent) :
     ParserHafasXml(parent)
 {
@@ -59,12 +63,9 @@ void ParserHafasBinary::searchJourney(const Station &departureStation, const Sta
 
     if (viaStation.id.isValid()) {
         //Convert the ID to it's parts
-        QStringList viaElements = viaStation.id.toString().split("@");
-        for (int i = 0; i <= viaElements.length() -1; i++) {
-            if (viaElements[i].split("=").length() == 2) {
-                query.addQueryItem("REQ0JourneyStops1.0" + viaElements[i].split("=")[0], viaElements[i].split("=")[1]);
-            }
-        }
+        const HafasLocationId viaId(viaStation.id.toString());
+        foreach (const HafasLocationId::Field &field, viaId.fields())
+            query.addQueryItem("REQ0JourneyStops1.0" + field.key, field.value);
     }
 
     query.addQueryItem("REQ0JourneyDate", dateTime.toString("dd.MM.yyyy"));
@@ -83,6 +84,13 @@ void ParserHafasBinary::searchJourney(const Station &departureStation, const Sta
     sendHttpRequest(uri);
 }
 
+void ParserHafasBinary::parsePartialReply(FahrplanNS::curReqStates request, QNetworkReply *networkReply, const QByteArray &received)
+{
+    // Journeys come gzipped in one binary block, only the timetables are XML
+    if (request == FahrplanNS::getTimeTableForStationRequest)
+        ParserHafasXml::parsePartialReply(request, networkReply, received);
+}
+
 void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
 {
     lastJourneyResultList = new JourneyResultList();
@@ -92,7 +100,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
     QByteArray tmpBuffer = networkReply->readAll();
 
     if (tmpBuffer.count() < 10 || tmpBuffer.at(0) != 0x1f) {
-        qWarning()<<"Bad data in response (can not find gzip magic number)";
+        fahrplanWarning(logHafasBinary) << "Bad data in response (can not find gzip magic number)";
         emit errorOccured(tr("An error ocurred with the backend"));
         return;
     }
@@ -113,12 +121,12 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
     hafasData >> hafasVersion;
 
     if (hafasVersion != 5 && hafasVersion != 6) {
-        qWarning()<<"Wrong version of hafas binary data";
+        fahrplanWarning(logHafasBinary) << "Wrong version of hafas binary data";
         emit errorOccured(tr("An error ocurred with the backend"));
         return;
     }
 
-    qDebug()<<"Binary-Data Version: "<<hafasVersion;
+    fahrplanDebug(logHafasBinary) << "Binary-Data Version: " << hafasVersion;
 
     //Basic data offsets
     qint32 serviceDaysTablePtr;
@@ -143,10 +151,10 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
     hafasData >> errorCode;
 
     //Debug data offsets
-    qDebug()<<serviceDaysTablePtr<<stringTablePtr;
-    qDebug()<<stationTablePtr<<commentTablePtr;
-    qDebug()<<extensionHeaderPtr<<extensionHeaderLength;
-    qDebug()<<errorCode;
+    fahrplanDebug(logHafasBinary) << serviceDaysTablePtr << stringTablePtr;
+    fahrplanDebug(logHafasBinary) << stationTablePtr << commentTablePtr;
+    fahrplanDebug(logHafasBinary) << extensionHeaderPtr << extensionHeaderLength;
+    fahrplanDebug(logHafasBinary) << errorCode;
 
     //Looks ok, parsing
     if (errorCode == 0) {
@@ -179,7 +187,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
         qint32 connectionAttrsPtr;
         if (extensionHeaderLength >= 0x30) {
             if (extensionHeaderLength < 0x32) {
-                qWarning() << "too short:" << extensionHeaderLength;
+                fahrplanWarning(logHafasBinary) << "too short:" << extensionHeaderLength;
                 return;
             }
             hafasData.device()->seek(extensionHeaderPtr + 0x2c);
@@ -188,18 +196,18 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
             connectionAttrsPtr = 0;
         }
 
-        qDebug()<<"seqNr:"<<seqNr;
-        qDebug()<<"reqId:"<<requestId;
-        qDebug()<<"encoding:"<<encoding;
-        qDebug()<<"ld:"<<ld;
-        qDebug()<<"Con:"<<connectionAttrsPtr;
-        qDebug()<<"Dis:"<<disruptionsPtr;
+        fahrplanDebug(logHafasBinary) << "seqNr:" << seqNr;
+        fahrplanDebug(logHafasBinary) << "reqId:" << requestId;
+        fahrplanDebug(logHafasBinary) << "encoding:" << encoding;
+        fahrplanDebug(logHafasBinary) << "ld:" << ld;
+        fahrplanDebug(logHafasBinary) << "Con:" << connectionAttrsPtr;
+        fahrplanDebug(logHafasBinary) << "Dis:" << disruptionsPtr;
 
         hafasData.device()->seek(connectionDetailsPtr);
         quint16 connectionDetailsVersion;
         hafasData >> connectionDetailsVersion;
         if (connectionDetailsVersion != 1) {
-            qWarning("unknown connectionDetailsVersion");
+            fahrplanWarning(logHafasBinary) << "unknown connectionDetailsVersion";
             return;
         }
         hafasData.device()->seek(hafasData.device()->pos() + 2);
@@ -234,7 +242,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
         lastJourneyResultList->setArrivalStation(resArrival);
         lastJourneyResultList->setTimeInfo(journeyDate.toString());
 
-        qDebug()<<resDeparture<<resArrival<<numConnections<<journeyDate;
+        fahrplanDebug(logHafasBinary) << resDeparture << resArrival << numConnections << journeyDate;
 
         QMultiMap<QDateTime, JourneyResultItem*> journeyResultsByArrivalMap;
 
@@ -251,7 +259,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
             hafasData >> numChanges;
             hafasData >> durationInt;
             QDateTime durationTime = toTime(durationInt);
-            qDebug()<<serviceDaysTableOffset<<partsOffset<<numParts<<numParts<<durationTime;
+            fahrplanDebug(logHafasBinary) << serviceDaysTableOffset << partsOffset << numParts << numParts << durationTime;
 
             hafasData.device()->seek(serviceDaysTablePtr + serviceDaysTableOffset);
 
@@ -281,7 +289,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
                 break;
             }
 
-            qDebug()<<serviceTxt<<connectionDayOffset;
+            fahrplanDebug(logHafasBinary) << serviceTxt << connectionDayOffset;
 
             hafasData.device()->seek(connectionDetailsPtr + connectionDetailsIndexOffset + iConnection * 2);
             qint16 connectionDetailsOffset;
@@ -293,7 +301,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
             hafasData >> realtimeStatus;
             hafasData >> delay;
 
-            qDebug()<<"RT"<<realtimeStatus<<delay;
+            fahrplanDebug(logHafasBinary) << "RT" << realtimeStatus << delay;
 
             QString connectionId = "TMPC" + QString::number(iConnection);
             /*
@@ -321,7 +329,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
                 }
             }*/
 
-            qDebug()<<"conId"<<connectionId;
+            fahrplanDebug(logHafasBinary) << "conId" << connectionId;
             QStringList lineNames;
 
             JourneyDetailResultList *inlineResults = new JourneyDetailResultList();
@@ -455,7 +463,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
                         else if (routingTypeName == "CAR")
                             routingTypeName = tr("Drive car");
                         else
-                            qDebug() << "Unknown routing type" << routingType;
+                            fahrplanDebug(logHafasBinary) << "Unknown routing type" << routingType;
                     }
 
                     if (duration.isEmpty()) {
@@ -474,7 +482,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
                         lineNames.append(category);
                     break;
                 default:
-                    qDebug() << "Unknown transportation type" << type;
+                    fahrplanDebug(logHafasBinary) << "Unknown transportation type" << type;
                 }
 
                 hafasData.device()->seek(connectionDetailsPtr + connectionDetailsOffset + connectionDetailsPartOffset + iPart * connectionDetailsPartSize);
@@ -486,7 +494,7 @@ void ParserHafasBinary::parseSearchJourney(QNetworkReply *networkReply)
                 hafasData >> predictedArrivalTimeInt;
                 QDateTime predictedArrivalTime = toTime(predictedArrivalTimeInt, journeyDate.addDays(connectionDayOffset));
 
-                qDebug()<<type<<lineName<<plannedDepartureTime<<predictedDepartureTimeInt<<predictedDepartureTime<<plannedDeparture<<plannedDeparturePosition<<plannedArrivalTime<<predictedArrivalTimeInt<<predictedArrivalTime<<plannedArrival<<plannedArrivalPosition<<category;
+                fahrplanDebug(logHafasBinary) << type << lineName << plannedDepartureTime << predictedDepartureTimeInt << predictedDepartureTime << plannedDeparture << plannedDeparturePosition << plannedArrivalTime << predictedArrivalTimeInt << predictedArrivalTime << plannedArrival << plannedArrivalPosition << category;
 
                 hafasData.device()->seek(hafasData.device()->pos() + 4);
                 qint16 bits;
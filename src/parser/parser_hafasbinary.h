@@ -43,6 +43,7 @@ protected:
     void parseSearchJourney(QNetworkReply *networkReply);
     void parseSearchLaterJourney(QNetworkReply *networkReply);
     void parseSearchEarlierJourney(QNetworkReply *networkReply);
+    void parsePartialReply(FahrplanNS::curReqStates request, QNetworkReply *networkReply, const QByteArray &received);
     QDate toDate(quint16 date);
     QDateTime toTime(quint16 time, QDate baseDate);
     QDateTime toTime(quint16 time);
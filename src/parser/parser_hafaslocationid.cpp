@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_hafaslocationid.h"
+
+#include <QHash>
+
+namespace
+{
+    // Per thread, so parser threads don't contend, and freed when the
+    // thread ends. Starting over once it is full keeps it bounded over a
+    // long session.
+    const int maxCachedIds = 512;
+    thread_local QHash<QString, HafasLocationId> cachedIds;
+}
+
+HafasLocationId::HafasLocationId()
+    : m_x(0), m_y(0), m_hasX(false), m_hasY(false)
+{
+}
+
+HafasLocationId::HafasLocationId(const QString &id)
+    : m_x(0), m_y(0), m_hasX(false), m_hasY(false)
+{
+    const QChar *data = id.unicode();
+    const int length = id.size();
+
+    int start = 0;
+    int separator = -1;
+    for (int i = 0; i <= length; ++i) {
+        if (i < length && data[i] != QLatin1Char('@')) {
+            if (separator < 0 && data[i] == QLatin1Char('='))
+                separator = i;
+            continue;
+        }
+
+        // Fields without a key or a '=' are dropped
+        if (separator > start) {
+            Field field;
+            field.key = id.mid(start, separator - start);
+            field.value = id.mid(separator + 1, i - separator - 1);
+
+            if (field.key == QLatin1String("X"))
+                m_x = field.value.toInt(&m_hasX);
+            else if (field.key == QLatin1String("Y"))
+                m_y = field.value.toInt(&m_hasY);
+
+            m_fields.append(field);
+        }
+        start = i + 1;
+        separator = -1;
+    }
+}
+
+HafasLocationId HafasLocationId::fromString(const QString &id)
+{
+    QHash<QString, HafasLocationId>::const_iterator it = cachedIds.constFind(id);
+    if (it != cachedIds.constEnd())
+        return it.value();
+
+    if (cachedIds.size() >= maxCachedIds)
+        cachedIds.clear();
+
+    const HafasLocationId locationId(id);
+    cachedIds.insert(id, locationId);
+    return locationId;
+}
+
+bool HafasLocationId::isValid() const
+{
+    return !m_fields.isEmpty();
+}
+
+const QVector<HafasLocationId::Field> &HafasLocationId::fields() const
+{
+    return m_fields;
+}
+
+QString HafasLocationId::value(const QString &key) const
+{
+    foreach (const Field &field, m_fields) {
+        if (field.key == key)
+            return field.value;
+    }
+    return QString();
+}
+
+QString HafasLocationId::name() const
+{
+    return value(QLatin1String("O"));
+}
+
+bool HafasLocationId::hasCoordinates() const
+{
+    return m_hasX && m_hasY;
+}
+
+int HafasLocationId::x() const
+{
+    return m_x;
+}
+
+int HafasLocationId::y() const
+{
+    return m_y;
+}
+
+bool HafasLocationId::isSameLocation(const HafasLocationId &other) const
+{
+    return m_x == other.m_x && m_y == other.m_y;
+}
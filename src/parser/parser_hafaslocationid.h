@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_HAFASLOCATIONID_H
+#define PARSER_HAFASLOCATIONID_H
+
+#include <QString>
+#include <QVector>
+
+// A HAFAS location ID like "A=1@O=Berlin Hbf@X=13369549@Y=52525589@L=8011160@"
+// taken apart in a single pass. Backends compare and split these IDs for
+// every row of a reply, so they parse each one once and work on the
+// fields from then on.
+class HafasLocationId
+{
+public:
+    struct Field
+    {
+        QString key;
+        QString value;
+    };
+
+    HafasLocationId();
+    explicit HafasLocationId(const QString &id);
+
+    // Like the constructor, but reuses IDs parsed before on this thread.
+    // Replies mention the same few stations over and over again.
+    static HafasLocationId fromString(const QString &id);
+
+    bool isValid() const;
+    const QVector<Field> &fields() const;
+    QString value(const QString &key) const;
+
+    QString name() const;
+    bool hasCoordinates() const;
+    int x() const;
+    int y() const;
+
+    // IDs of the same stop differ in their other fields from request to
+    // request, the coordinates are what stays the same.
+    bool isSameLocation(const HafasLocationId &other) const;
+
+private:
+    QVector<Field> m_fields;
+    int m_x;
+    int m_y;
+    bool m_hasX;
+    bool m_hasY;
+};
+
+#endif // PARSER_HAFASLOCATIONID_H
@@ -18,11 +18,14 @@
 ****************************************************************************/
 
 #include "parser_hafasxml.h"
+#include "parser_datetime.h"
+#include "parser_hafaslocationid.h"
 
 #include <QBuffer>
 #include <QNetworkReply>
 #include <QXmlStreamReader>
-#include <QDomDocument>
+
+#include <cctype>
 
 #if defined(BUILD_FOR_QT5)
   #include <QUrlQuery>
@@ -31,6 +34,32 @@
 // XML Schema Documentation:
 // https://stefanwehrmeyer.com/projects/vbbxsd/
 
+namespace
+{
+    // Returns the text of the first element at path (e.g. "Dep/Time")
+    // below the current element and moves to the end of the current one.
+    QString readChildText(QXmlStreamReader &xml, const QString &path)
+    {
+        const int slash = path.indexOf('/');
+        const QStringRef first = path.leftRef(slash);
+
+        QString result;
+        bool found = false;
+        while (xml.readNextStartElement()) {
+            if (found || xml.name() != first) {
+                xml.skipCurrentElement();
+            } else if (slash < 0) {
+                result = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                found = true;
+            } else {
+                result = readChildText(xml, path.mid(slash + 1));
+                found = true;
+            }
+        }
+        return result;
+    }
+}
+
 ParserHafasXml::ParserHafasXml(QObject *parent) :
     ParserAbstract(parent)
 {
@@ -48,6 +77,9 @@ ParserHafasXml::ParserHafasXml(QObject *parent) :
      hafasHeader.ver = "1.1";
 
      STTableMode = 0;
+
+     partialReply = NULL;
+     partialOffset = 0;
 }
 
 bool ParserHafasXml::supportsGps()
@@ -162,16 +194,9 @@ void ParserHafasXml::parseTimeTableMode1(QNetworkReply *networkReply)
 {
     TimetableEntriesList result;
 
-    QString data = QString::fromLatin1(networkReply->readAll());
-
     //Add a root element, because its sometimes missing
-    if (data.indexOf("StationTable") == -1) {
-        data.prepend("<StationTable>");
-        data.append("</StationTable>");
-    }
-
     QXmlStreamReader xml;
-    xml.addData(data);
+    addReplyData(xml, networkReply, "ISO-8859-1", "StationTable");
 
     while (!xml.atEnd()) {
         xml.readNext();
@@ -184,202 +209,209 @@ void ParserHafasXml::parseTimeTableMode1(QNetworkReply *networkReply)
 
         if (xml.isStartElement() && (xml.name() == "Journey")) {
             TimetableEntry item;
+            readStationTableJourney(xml, &item);
+            result << item;
+        }
 
-            QString dest = xml.attributes().value("dir").toString().simplified();
-            QString station = xml.attributes().value("depStation").toString().simplified();
-            QString train = xml.attributes().value("hafasname").toString().simplified();
-
-            if (dest.isEmpty()) {
-                dest = xml.attributes().value("targetLoc").toString().simplified();
-            }
-            if (train.isEmpty()) {
-                train = xml.attributes().value("prod").toString().simplified();
+    }
+    emit timetableResult(result);
+}
 
-                if (train.indexOf("#")) {
-                    train = train.left(train.indexOf("#"));
-                }
-            }
+void ParserHafasXml::readStationTableJourney(QXmlStreamReader &xml, TimetableEntry *item)
+{
+    QString dest = sessionStrings.internSimplified(xml.attributes().value("dir"));
+    const QString station = sessionStrings.internSimplified(xml.attributes().value("depStation"));
+    QString train = xml.attributes().value("hafasname").toString().simplified();
 
-            //get delay infos,
-            QString txtDelay = xml.attributes().value("delay").toString().simplified();
-            //QString intDelay = xml.attributes().value("e_delay").toString().simplified();
-            QString reasonDelay = xml.attributes().value("delayReason").toString().simplified();
-            QString miscInfo = "";
-
-            if (!txtDelay.isEmpty()) {
-                if (txtDelay == "-") {
-                    miscInfo = "";
-                } else if (txtDelay == "0") {
-                    miscInfo = tr("On-Time");
-                } else if (txtDelay == "cancel") {
-                    miscInfo = QString("<span style=\"color:#b30;\">%1</span>")
-                               .arg(tr("Canceled!"));
-                } else {
-                    miscInfo = txtDelay;
-                }
-            }
+    if (dest.isEmpty()) {
+        dest = sessionStrings.internSimplified(xml.attributes().value("targetLoc"));
+    }
+    if (train.isEmpty()) {
+        train = xml.attributes().value("prod").toString().simplified();
 
-            if (!reasonDelay.isEmpty()) {
-                if (!miscInfo.isEmpty()) {
-                    miscInfo.append(": ");
-                }
-                miscInfo.append(reasonDelay);
-            }
+        if (train.indexOf("#")) {
+            train = train.left(train.indexOf("#"));
+        }
+    }
 
-            item.currentStation = station;
-            item.destinationStation = dest;
-            item.trainType = train;
-            item.platform = xml.attributes().value("platform").toString().simplified();
-            item.time = QTime::fromString(xml.attributes().value("fpTime").toString(), "hh:mm");
+    //get delay infos,
+    QString txtDelay = xml.attributes().value("delay").toString().simplified();
+    //QString intDelay = xml.attributes().value("e_delay").toString().simplified();
+    QString reasonDelay = xml.attributes().value("delayReason").toString().simplified();
+    QString miscInfo = "";
+
+    if (!txtDelay.isEmpty()) {
+        if (txtDelay == "-") {
+            miscInfo = "";
+        } else if (txtDelay == "0") {
+            miscInfo = tr("On-Time");
+        } else if (txtDelay == "cancel") {
+            miscInfo = QString("<span style=\"color:#b30;\">%1</span>")
+                       .arg(tr("Canceled!"));
+        } else {
+            miscInfo = txtDelay;
+        }
+    }
 
-            QStringList announcements;
-            while (!xml.atEnd()) {
-                xml.readNext();
+    if (!reasonDelay.isEmpty()) {
+        if (!miscInfo.isEmpty()) {
+            miscInfo.append(": ");
+        }
+        miscInfo.append(reasonDelay);
+    }
 
-                if (xml.isStartElement() && xml.name() == "HIMMessage") {
-                    QStringRef text = xml.attributes().value("header");
-                    if (text.isEmpty())
-                        text = xml.attributes().value("lead");
-                    if (!text.isEmpty())
-                        announcements << text.toString();
-                }
+    item->currentStation = station;
+    item->destinationStation = dest;
+    item->trainType = responseStrings.intern(train);
+    item->platform = responseStrings.internSimplified(xml.attributes().value("platform"));
+    item->time = ParserDateTime::timeFromString(xml.attributes().value("fpTime").toString());
 
-                if (xml.isEndElement() && xml.name() == "Journey")
-                   break;
-            }
+    QStringList announcements;
+    while (!xml.atEnd()) {
+        xml.readNext();
 
-            QStringList info;
-            if (announcements.count() > 0)
-                info << QString("<span style=\"color:#b30;\">%1</span>")
-                        .arg(announcements.join("<br />").replace("\n", "<br />"));
+        if (xml.isStartElement() && xml.name() == "HIMMessage") {
+            QStringRef text = xml.attributes().value("header");
+            if (text.isEmpty())
+                text = xml.attributes().value("lead");
+            if (!text.isEmpty())
+                announcements << text.toString();
+        }
 
-            if (!miscInfo.isEmpty())
-                info << miscInfo;
+        if (xml.isEndElement() && xml.name() == "Journey")
+           break;
+    }
 
-            item.miscInfo = info.join("<br />");
+    QStringList info;
+    if (announcements.count() > 0)
+        info << QString("<span style=\"color:#b30;\">%1</span>")
+                .arg(announcements.join("<br />").replace("\n", "<br />"));
 
-            result << item;
-        }
+    if (!miscInfo.isEmpty())
+        info << miscInfo;
 
-    }
-    emit timetableResult(result);
+    item->miscInfo = info.join("<br />");
 }
 
 void ParserHafasXml::parseTimeTableMode0(QNetworkReply *networkReply)
 {
     TimetableEntriesList result;
 
-    QString data = QString::fromUtf8(networkReply->readAll());
-
     QXmlStreamReader xml;
-    xml.addData(data);
+    addReplyData(xml, networkReply, "UTF-8");
 
     while (!xml.atEnd()) {
         xml.readNext();
         if (xml.isStartElement() && (xml.name() == "STBJourney")) {
             TimetableEntry item;
+            if (readStbJourney(xml, &item))
+                result << item;
+        }
+    }
 
+    emit timetableResult(result);
+}
+
+// Returns false if the reply ended before </STBJourney>
+bool ParserHafasXml::readStbJourney(QXmlStreamReader &xml, TimetableEntry *item)
+{
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.isStartElement() && xml.name() == "Station") {
+            item->currentStation = sessionStrings.internSimplified(xml.attributes().value("name"));
+            item->latitude = xml.attributes().value("y").toString().toInt();
+            item->longitude = xml.attributes().value("x").toString().toInt();
+        }
+
+        if (xml.isStartElement() && (xml.name() == "Dep" || xml.name() == "Arr" )) {
             while (!xml.atEnd()) {
                 xml.readNext();
-                if (xml.isStartElement() && xml.name() == "Station") {
-                    item.currentStation = xml.attributes().value("name").toString().simplified();
-                    item.latitude = xml.attributes().value("y").toString().toInt();
-                    item.longitude = xml.attributes().value("x").toString().toInt();
+                if (xml.isStartElement() && xml.name() == "Time") {
+                    xml.readNext();
+                    item->time = ParserDateTime::timeFromString(xml.text().toString());
                 }
 
-                if (xml.isStartElement() && (xml.name() == "Dep" || xml.name() == "Arr" )) {
+                if (xml.isStartElement() && xml.name() == "Platform") {
                     while (!xml.atEnd()) {
                         xml.readNext();
-                        if (xml.isStartElement() && xml.name() == "Time") {
+                        if (xml.isStartElement() && xml.name() == "Text") {
                             xml.readNext();
-                            item.time = QTime::fromString(xml.text().toString(), "hh:mm");
-                        }
-
-                        if (xml.isStartElement() && xml.name() == "Platform") {
-                            while (!xml.atEnd()) {
-                                xml.readNext();
-                                if (xml.isStartElement() && xml.name() == "Text") {
-                                    xml.readNext();
-                                    item.platform = xml.text().toString().simplified();
-                                }
-
-                                if (xml.isEndElement() && xml.name() == "Platform") {
-                                   break;
-                                }
-                            }
+                            item->platform = responseStrings.internSimplified(xml.text());
                         }
 
-                        if (xml.isEndElement() && (xml.name() == "Dep" || xml.name() == "Arr" )) {
+                        if (xml.isEndElement() && xml.name() == "Platform") {
                            break;
                         }
                     }
                 }
 
-                if (xml.isStartElement() && xml.name() == "Attribute") {
-                    QString currentAttributeType = xml.attributes().value("type").toString();
-                    while (!xml.atEnd()) {
-                        xml.readNext();
-                        if (xml.isStartElement() && xml.name() == "Text") {
-                            xml.readNext();
+                if (xml.isEndElement() && (xml.name() == "Dep" || xml.name() == "Arr" )) {
+                   break;
+                }
+            }
+        }
 
-                            if (currentAttributeType == "DIRECTION") {
-                                item.destinationStation = xml.text().toString().simplified();
-                            }
-                            if (currentAttributeType == "NAME") {
-                                item.trainType = xml.text().toString().simplified();
-                            }
-                        }
+        if (xml.isStartElement() && xml.name() == "Attribute") {
+            QString currentAttributeType = xml.attributes().value("type").toString();
+            while (!xml.atEnd()) {
+                xml.readNext();
+                if (xml.isStartElement() && xml.name() == "Text") {
+                    xml.readNext();
 
-                        if (xml.isEndElement() && xml.name() == "Attribute") {
-                           break;
-                        }
+                    if (currentAttributeType == "DIRECTION") {
+                        item->destinationStation = sessionStrings.internSimplified(xml.text());
+                    }
+                    if (currentAttributeType == "NAME") {
+                        item->trainType = responseStrings.internSimplified(xml.text());
                     }
                 }
 
-                QStringList announcements;
-                if (xml.isStartElement() && xml.name() == "IList") {
-                    while (!xml.atEnd()) {
-                        xml.readNext();
+                if (xml.isEndElement() && xml.name() == "Attribute") {
+                   break;
+                }
+            }
+        }
 
-                        if (xml.isStartElement() && xml.name() == "I") {
-                            const QStringRef text = xml.attributes().value("text");
-                            if (!text.isEmpty())
-                                announcements << text.toString();
-                        }
+        QStringList announcements;
+        if (xml.isStartElement() && xml.name() == "IList") {
+            while (!xml.atEnd()) {
+                xml.readNext();
 
-                        if (xml.isEndElement() && xml.name() == "IList")
-                           break;
-                    }
+                if (xml.isStartElement() && xml.name() == "I") {
+                    const QStringRef text = xml.attributes().value("text");
+                    if (!text.isEmpty())
+                        announcements << text.toString();
                 }
 
-                QStringList info;
-                if (announcements.count() > 0)
-                    info << QString("<span style=\"color:#b30;\">%1</span>")
-                            .arg(announcements.join("<br />").replace("\n", "<br />"));
+                if (xml.isEndElement() && xml.name() == "IList")
+                   break;
+            }
+        }
 
-                if (xml.isStartElement() && xml.name() == "JProg") {
-                    xml.readNextStartElement();
-                    if (xml.name() == "JStatus") {
-                        xml.readNext();
-                        const QString status = xml.text().toString();
-                        if (status == "SCHEDULED")
-                            info << tr("On-Time");
-                        else if (status.endsWith("FAILURE"))
-                            info << QString("<span style=\"color:#b30;\">%1</span>")
-                                            .arg(tr("Canceled!"));
-                    }
-                }
-                item.miscInfo = info.join("<br />");
+        QStringList info;
+        if (announcements.count() > 0)
+            info << QString("<span style=\"color:#b30;\">%1</span>")
+                    .arg(announcements.join("<br />").replace("\n", "<br />"));
 
-                if (xml.isEndElement() && xml.name() == "STBJourney") {
-                    result << item;
-                    break;
-                }
+        if (xml.isStartElement() && xml.name() == "JProg") {
+            xml.readNextStartElement();
+            if (xml.name() == "JStatus") {
+                xml.readNext();
+                const QString status = xml.text().toString();
+                if (status == "SCHEDULED")
+                    info << tr("On-Time");
+                else if (status.endsWith("FAILURE"))
+                    info << QString("<span style=\"color:#b30;\">%1</span>")
+                                    .arg(tr("Canceled!"));
             }
         }
+        item->miscInfo = info.join("<br />");
+
+        if (xml.isEndElement() && xml.name() == "STBJourney")
+            return true;
     }
 
-    emit timetableResult(result);
+    return false;
 }
 
 void ParserHafasXml::findStationsByName(const QString &stationName)
@@ -408,19 +440,9 @@ void ParserHafasXml::findStationsByCoordinates(qreal longitude, qreal latitude)
 
     currentRequestState = FahrplanNS::stationsByCoordinatesRequest;
 
-    //We must format the lat and longitude to have the ??.?????? format.
-    QString zeros      = "0";
-    QString sLongitude = QString::number(longitude).append(zeros.repeated(6));
-    QString sLatitude  = QString::number(latitude).append(zeros.repeated(6));
-
-    QRegExp regexp = QRegExp("(\\d*)\\.(\\d\\d\\d\\d\\d\\d)(\\d*)");
-    regexp.setMinimal(true);
-
-    regexp.indexIn(sLongitude);
-    sLongitude = regexp.cap(1) + regexp.cap(2);
-
-    regexp.indexIn(sLatitude);
-    sLatitude = regexp.cap(1) + regexp.cap(2);
+    //HAFAS wants the coordinates in millionths of a degree.
+    QString sLongitude = QString::number(qRound64(longitude * 1000000));
+    QString sLatitude  = QString::number(qRound64(latitude * 1000000));
 
     QUrl uri(baseUrl + "/eol");
 #if defined(BUILD_FOR_QT5)
@@ -445,18 +467,16 @@ void ParserHafasXml::findStationsByCoordinates(qreal longitude, qreal latitude)
 
 void ParserHafasXml::parseStationsByName(QNetworkReply *networkReply)
 {
-    QString data = QString::fromLatin1(networkReply->readAll());
-    const StationsList result = internalParseStationsByName(data);
+    QXmlStreamReader xml;
+    addReplyData(xml, networkReply, "ISO-8859-1");
+    const StationsList result = internalParseStationsByName(xml);
     emit stationsResult(result);
 }
 
-StationsList ParserHafasXml::internalParseStationsByName(const QString &data) const
+StationsList ParserHafasXml::internalParseStationsByName(QXmlStreamReader &xml) const
 {
     StationsList result;
 
-    QXmlStreamReader xml;
-    xml.addData(data);
-
     while (!xml.atEnd()) {
         xml.readNext();
         if (xml.isStartElement()) {
@@ -487,8 +507,9 @@ StationsList ParserHafasXml::internalParseStationsByName(const QString &data) co
 void ParserHafasXml::parseStationsByCoordinates(QNetworkReply *networkReply)
 {
     //Normally hafas returns the data as Latin1, but here we get utf8.
-    QString data = QString::fromUtf8(networkReply->readAll());
-    const StationsList result = internalParseStationsByName(data);
+    QXmlStreamReader xml;
+    addReplyData(xml, networkReply, "UTF-8");
+    const StationsList result = internalParseStationsByName(xml);
     emit stationsResult(result);
 }
 
@@ -612,140 +633,542 @@ QByteArray ParserHafasXml::getStationsExternalIds(const QString &departureStatio
     return postData;
 }
 
-inline bool ParserHafasXml::parseXml(QDomDocument &doc, const QByteArray &xml)
+// Hands the raw reply to the reader without decoding it into a QString
+// first. The encoding is taken from the XML declaration, the charset of
+// the Content-Type header or fallbackEncoding, in that order. Some
+// backends omit the root element; if rootElement is given and does not
+// occur in the reply, the content is wrapped into it.
+// Returns the 8 bit encoding of data and where the content after the XML
+// declaration starts, or an empty encoding for UTF-16.
+QByteArray ParserHafasXml::replyEncoding(const QByteArray &data, QNetworkReply *networkReply,
+                                         const char *fallbackEncoding, int *contentStart) const
 {
-    QString error;
-    if (!doc.setContent(xml, &error)) {
-        emit errorOccured(tr("Error parsing reponse from the server: %1").arg(error));
-        return false;
+    // UTF-16 is detected by the reader itself
+    if (data.startsWith("\xFF\xFE") || data.startsWith("\xFE\xFF"))
+        return QByteArray();
+
+    QByteArray encoding;
+    int bodyStart = 0;
+    if (data.startsWith("\xEF\xBB\xBF")) {
+        encoding = "UTF-8";
+        bodyStart = 3;
     }
 
-    const QDomNodeList errors = doc.elementsByTagName("Err");
-    if (!errors.isEmpty()) {
-        QStringList errorStrings;
-        for (int i = 0; i < errors.count(); ++i)
-            errorStrings << errors.at(i).toElement().attribute("text").trimmed();
+    // The declaration is replaced by our own below, so a root element
+    // can be put in front of the content.
+    int pos = bodyStart;
+    while (pos < data.size() && isspace(uchar(data.at(pos))))
+        ++pos;
+    if (data.indexOf("<?xml", pos) == pos) {
+        const int end = data.indexOf("?>", pos);
+        if (end > 0) {
+            const QByteArray declaration = data.mid(pos, end - pos);
+            const int attribute = declaration.indexOf("encoding=");
+            if (attribute >= 0 && attribute + 10 < declaration.size()) {
+                const char quote = declaration.at(attribute + 9);
+                const int close = declaration.indexOf(quote, attribute + 10);
+                if (close > 0)
+                    encoding = declaration.mid(attribute + 10, close - attribute - 10);
+            }
+            bodyStart = end + 2;
+        }
+    }
 
-        emit errorOccured(tr("%1 replied: \"%2\"").arg(name(), errorStrings.join(" ")));
+    if (encoding.isEmpty()) {
+        const QByteArray contentType = networkReply->header(QNetworkRequest::ContentTypeHeader)
+                                                   .toByteArray().toLower();
+        const int charset = contentType.indexOf("charset=");
+        if (charset >= 0) {
+            encoding = contentType.mid(charset + 8);
+            if (encoding.contains(';'))
+                encoding = encoding.left(encoding.indexOf(';'));
+            encoding = encoding.trimmed().replace('"', "");
+        }
+    }
+    if (encoding.isEmpty())
+        encoding = fallbackEncoding;
+
+    *contentStart = bodyStart;
+    return encoding;
+}
+
+void ParserHafasXml::addReplyData(QXmlStreamReader &xml, QNetworkReply *networkReply,
+                                  const char *fallbackEncoding, const char *rootElement) const
+{
+    const QByteArray data = networkReply->readAll();
+
+    int bodyStart;
+    const QByteArray encoding = replyEncoding(data, networkReply, fallbackEncoding, &bodyStart);
+    if (encoding.isEmpty()) {
+        xml.addData(data);
+        return;
+    }
+
+    xml.addData("<?xml version=\"1.0\" encoding=\"" + encoding + "\"?>");
+    const bool wrap = rootElement && data.indexOf(rootElement, bodyStart) == -1;
+    if (wrap)
+        xml.addData("<" + QByteArray(rootElement) + ">");
+    xml.addData(QByteArray::fromRawData(data.constData() + bodyStart, data.size() - bodyStart));
+    if (wrap)
+        xml.addData("</" + QByteArray(rootElement) + ">");
+}
+
+// Adds the <element>s of a partial reply which are complete by now and
+// were not added before. Returns false if there is nothing new yet.
+bool ParserHafasXml::addPartialReplyData(QXmlStreamReader &xml, QNetworkReply *networkReply, const QByteArray &received,
+                                         const char *element, const char *fallbackEncoding)
+{
+    const QByteArray startTag = "<" + QByteArray(element);
+    const QByteArray endTag = "</" + QByteArray(element) + ">";
+
+    const int end = received.lastIndexOf(endTag);
+    if (end < partialOffset)
         return false;
+
+    // Skip longer names sharing the prefix, like <ConnectionList>
+    int begin = received.indexOf(startTag, partialOffset);
+    while (begin >= 0 && begin + startTag.size() < received.size()) {
+        const char next = received.at(begin + startTag.size());
+        if (next == '>' || next == '/' || isspace(uchar(next)))
+            break;
+        begin = received.indexOf(startTag, begin + 1);
     }
+    if (begin < 0 || begin > end)
+        return false;
+
+    int bodyStart;
+    const QByteArray encoding = replyEncoding(received, networkReply, fallbackEncoding, &bodyStart);
+    if (encoding.isEmpty())
+        return false;
 
+    partialOffset = end + endTag.size();
+    xml.addData("<?xml version=\"1.0\" encoding=\"" + encoding + "\"?><PartialReply>");
+    xml.addData(received.mid(begin, partialOffset - begin));
+    xml.addData("</PartialReply>");
     return true;
 }
 
+void ParserHafasXml::parsePartialReply(FahrplanNS::curReqStates request, QNetworkReply *networkReply, const QByteArray &received)
+{
+    if (networkReply != partialReply) {
+        partialReply = networkReply;
+        partialOffset = 0;
+        partialConnections.clear();
+    }
+
+    QXmlStreamReader xml;
+    if (request == FahrplanNS::getTimeTableForStationRequest) {
+        const char *element = STTableMode == 0 ? "STBJourney" : "Journey";
+        if (!addPartialReplyData(xml, networkReply, received, element, STTableMode == 0 ? "UTF-8" : "ISO-8859-1"))
+            return;
+
+        TimetableEntriesList result;
+        xml.readNextStartElement();
+        while (xml.readNextStartElement()) {
+            if (xml.name() != element) {
+                xml.skipCurrentElement();
+                continue;
+            }
+            TimetableEntry item;
+            if (STTableMode == 0) {
+                if (!readStbJourney(xml, &item))
+                    break;
+            } else {
+                readStationTableJourney(xml, &item);
+            }
+            result << item;
+        }
+
+        if (!xml.hasError() && !result.isEmpty())
+            emit timetablePartialResult(result);
+    } else if (request == FahrplanNS::searchJourneyRequest || request == FahrplanNS::searchJourneyLaterRequest
+               || request == FahrplanNS::searchJourneyEarlierRequest) {
+        if (!addPartialReplyData(xml, networkReply, received, "Connection", "UTF-8"))
+            return;
+
+        const int count = partialConnections.count();
+        xml.readNextStartElement();
+        while (xml.readNextStartElement()) {
+            if (xml.name() != "Connection") {
+                xml.skipCurrentElement();
+                continue;
+            }
+            partialConnections.append(ParserHafasXmlConnection());
+            readConnection(xml, &partialConnections.last());
+        }
+
+        if (xml.hasError() || partialConnections.count() == count)
+            return;
+
+        // The list handed out before belongs to the GUI thread now, which
+        // deletes it once this one replaced it
+        JourneyResultList *result = new JourneyResultList();
+        foreach (const ParserHafasXmlConnection &connection, partialConnections)
+            appendJourneyResultItem(result, connection);
+        emit journeyPartialResult(result);
+    }
+}
+
 QString ParserHafasXml::parseExternalIds(const QVariant &id) const
 {
-    QString extId;
-    QRegExp l("L=(\\d+)");
-    QRegExp u("U=(\\d+)");
-    int i;
+    const HafasLocationId locationId(HafasLocationId::fromString(id.toString()));
+    bool ok;
 
-    i = l.indexIn(id.toString());
-    if (i < 0 || l.capturedTexts().count() < 2)
+    const QString l = locationId.value("L");
+    l.toULongLong(&ok);
+    if (!ok)
         return QString();
-    extId.append(l.capturedTexts().at(1));
-
-    extId.append("#");
 
-    i = u.indexIn(id.toString());
-    if (i < 0 || u.capturedTexts().count() < 2)
+    const QString u = locationId.value("U");
+    u.toULongLong(&ok);
+    if (!ok)
         return QString();
-    extId.append(u.capturedTexts().at(1));
 
-    return extId;
+    return l + "#" + u;
 }
 
-void ParserHafasXml::parseSearchJourney(QNetworkReply *networkReply)
+// Reads all <Connection> elements of a search or detail reply in one
+// pass. Emits an error and returns false if the reply is malformed or the
+// backend reported one.
+bool ParserHafasXml::readConnections(QNetworkReply *networkReply, QList<ParserHafasXmlConnection> *connections,
+                                     QString *context)
 {
-    lastJourneyResultList = new JourneyResultList();
-    journeyDetailInlineData.clear();
+    QXmlStreamReader xml;
+    addReplyData(xml, networkReply, "UTF-8");
 
-    QDomDocument doc;
-    if (!parseXml(doc, networkReply->readAll()))
-        return;
+    QStringList errorStrings;
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (!xml.isStartElement())
+            continue;
+
+        if (xml.name() == "Err") {
+            errorStrings << xml.attributes().value("text").toString().trimmed();
+        } else if (xml.name() == "Connection") {
+            connections->append(ParserHafasXmlConnection());
+            readConnection(xml, &connections->last());
+        } else if (xml.name() == "ConResCtxt") {
+            *context = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+        }
+    }
 
-    const QDomNodeList connections = doc.elementsByTagName("Connection");
-    for (int i = 0; i < connections.count(); ++i) {
-        JourneyResultItem *item = new JourneyResultItem();
-        item->setId(connections.at(i).toElement().attribute("id").trimmed());
-
-        QDomElement overview = connections.at(i).firstChildElement("Overview");
-
-        item->setDate(QDate::fromString(overview.firstChildElement("Date").text().trimmed(),
-                                        "yyyyMMdd"));
-
-        QDomElement depStop = overview.firstChildElement("Departure").firstChildElement("BasicStop");
-        item->setDepartureTime(cleanHafasDate(depStop.firstChildElement("Dep")
-                                                     .firstChildElement("Time")
-                                                     .text()
-                                                     .trimmed()));
-        lastJourneyResultList->setDepartureStation(depStop.firstChildElement("Station")
-                                                          .attribute("name")
-                                                          .trimmed());
-
-        QDomElement arrStation = overview.firstChildElement("Arrival").firstChildElement("BasicStop");
-        item->setArrivalTime(cleanHafasDate(arrStation.firstChildElement("Arr")
-                                                      .firstChildElement("Time")
-                                                      .text()
-                                                      .trimmed()));
-        lastJourneyResultList->setArrivalStation(arrStation.firstChildElement("Station")
-                                                           .attribute("name")
-                                                           .trimmed());
-
-        item->setTransfers(overview.firstChildElement("Transfers").text().trimmed());
-        item->setDuration(cleanHafasDate(overview.firstChildElement("Duration")
-                                                 .firstChildElement("Time")
-                                                 .text()
-                                                 .trimmed()));
-
-        QStringList productNames;
-        const QDomNodeList products = overview.firstChildElement("Products").childNodes();
-        for (int j = 0; j < products.count(); ++j) {
-            productNames << products.at(j).toElement().attribute("cat").trimmed();
+    if (xml.hasError()) {
+        emit errorOccured(tr("Error parsing reponse from the server: %1").arg(xml.errorString()));
+        return false;
+    }
+
+    if (!errorStrings.isEmpty()) {
+        emit errorOccured(tr("%1 replied: \"%2\"").arg(name(), errorStrings.join(" ")));
+        return false;
+    }
+
+    return true;
+}
+
+void ParserHafasXml::readConnection(QXmlStreamReader &xml, ParserHafasXmlConnection *connection)
+{
+    connection->id = xml.attributes().value("id").toString().trimmed();
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "Overview") {
+            readOverview(xml, connection);
+        } else if (xml.name() == "ConSectionList") {
+            connection->hasSections = true;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "ConSection") {
+                    connection->sections.append(ParserHafasXmlSection());
+                    readSection(xml, &connection->sections.last());
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
+        } else if (xml.name() == "IList") {
+            while (xml.readNextStartElement()) {
+                connection->announcements << xml.attributes().value("text").toString();
+                xml.skipCurrentElement();
+            }
+        } else {
+            xml.skipCurrentElement();
         }
-        item->setTrainType(productNames.join(tr(", ")));
-
-        bool hasInline = !connections.at(i).firstChildElement("ConSectionList").isNull();
-        if (!hasInline) {
-            QString internalData1 = overview.firstChildElement("XMLHandle")
-                                            .attribute("url")
-                                            .trimmed();
-            if (internalData1.contains("query.exe")) {
-                internalData1.remove(0, internalData1.indexOf("query.exe") + 9);
-                internalData1.prepend(baseUrl);
-                item->setInternalData1(internalData1);
+    }
+}
+
+void ParserHafasXml::readOverview(QXmlStreamReader &xml, ParserHafasXmlConnection *connection)
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "Date") {
+            connection->date = ParserDateTime::dateFromCompact(xml.readElementText(QXmlStreamReader::IncludeChildElements)
+                                                                  .trimmed());
+        } else if (xml.name() == "Departure") {
+            readStop(xml, &connection->departure, "Dep");
+        } else if (xml.name() == "Arrival") {
+            readStop(xml, &connection->arrival, "Arr");
+        } else if (xml.name() == "Transfers") {
+            connection->transfers = xml.readElementText(QXmlStreamReader::IncludeChildElements).trimmed();
+        } else if (xml.name() == "Duration") {
+            connection->duration = cleanHafasDate(readChildText(xml, "Time").trimmed());
+        } else if (xml.name() == "Products") {
+            while (xml.readNextStartElement()) {
+                connection->products << xml.attributes().value("cat").toString().trimmed();
+                xml.skipCurrentElement();
             }
+        } else if (xml.name() == "XMLHandle") {
+            connection->xmlHandle = xml.attributes().value("url").toString().trimmed();
+            xml.skipCurrentElement();
         } else {
-            journeyDetailRequestData.id = item->id();
-            journeyDetailRequestData.date = item->date();
-            journeyDetailRequestData.duration = item->duration();
-            journeyDetailInlineData.append(internalParseJourneyDetails(connections.at(i)
-                                                                                  .toElement()));
+            xml.skipCurrentElement();
+        }
+    }
+}
+
+// Reads a <Departure> or <Arrival> element; timeElement is "Dep" or "Arr".
+void ParserHafasXml::readStop(QXmlStreamReader &xml, ParserHafasXmlStop *stop, const QString &timeElement)
+{
+    while (xml.readNextStartElement()) {
+        if (xml.name() != "BasicStop") {
+            xml.skipCurrentElement();
+            continue;
         }
 
-        const QDomNodeList announces = connections.at(i).firstChildElement("IList").childNodes();
-        if (announces.count() > 0) {
-            QStringList announcements;
-            for (int i = 0; i < announces.count(); ++i) {
-                announcements << announces.at(i).toElement().attribute("text");
+        while (xml.readNextStartElement()) {
+            if (xml.name() == "Station") {
+                stop->station = xml.attributes().value("name").toString().trimmed();
+                xml.skipCurrentElement();
+            } else if (xml.name() == "Location") {
+                stop->locationName = readChildText(xml, "Station/HafasName/Text").trimmed();
+            } else if (xml.name() == timeElement) {
+                while (xml.readNextStartElement()) {
+                    if (xml.name() == "Time")
+                        stop->time = xml.readElementText(QXmlStreamReader::IncludeChildElements).trimmed();
+                    else if (xml.name() == "Platform")
+                        stop->platform = readChildText(xml, "Text").trimmed();
+                    else
+                        xml.skipCurrentElement();
+                }
+            } else {
+                xml.skipCurrentElement();
             }
-            item->setMiscInfo(QString("<span style=\"color:#b30;\">%1</span>")
-                              .arg(announcements.join("<br />").replace("\n", "<br />")));
         }
+    }
+}
 
-        lastJourneyResultList->setTimeInfo(item->date().toString());
+void ParserHafasXml::readSection(QXmlStreamReader &xml, ParserHafasXmlSection *section)
+{
+    // The element following <Departure> describes the transport and can
+    // be Journey, Walk, Transfer or GisRoute
+    bool afterDeparture = false;
+
+    while (xml.readNextStartElement()) {
+        if (xml.name() == "Departure") {
+            readStop(xml, &section->departure, "Dep");
+            afterDeparture = true;
+            continue;
+        }
+        if (xml.name() == "Arrival") {
+            readStop(xml, &section->arrival, "Arr");
+            afterDeparture = false;
+            continue;
+        }
+        if (!afterDeparture) {
+            xml.skipCurrentElement();
+            continue;
+        }
+        afterDeparture = false;
+
+        if (xml.name() == "Journey") {
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "JourneyAttributeList")
+                    readJourneyAttributes(xml, section);
+                else
+                    xml.skipCurrentElement();
+            }
+        } else if (xml.name() == "Walk" || xml.name() == "Transfer") {
+            const bool isWalk = xml.name() == "Walk";
+            const QString length = xml.attributes().value("length").toString().trimmed();
+            QString duration;
+            QString distanceText;
+            bool hasDistance = false;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "Duration") {
+                    duration = cleanHafasDate(readChildText(xml, "Time").trimmed());
+                } else if (xml.name() == "Distance" && !hasDistance) {
+                    distanceText = xml.readElementText(QXmlStreamReader::IncludeChildElements).trimmed();
+                    hasDistance = true;
+                } else {
+                    xml.skipCurrentElement();
+                }
+            }
 
-        lastJourneyResultList->appendItem(item);
+            const int distance = hasDistance ? distanceText.toInt() : length.toInt();
+
+            QString type = isWalk ? tr("Walk") : tr("Transfer");
+            //: %1 can be "Walk" or "Transfer"
+            section->train = tr("%1 for %2 min").arg(type, duration);
+            if (distance > 0)
+                section->info = tr("Distance %n meter(s)", "", distance);
+        } else if (xml.name() == "GisRoute") {
+            QString type;
+            const QString t = xml.attributes().value("type").toString().trimmed();
+            if (t == "FOOT")
+                type = tr("Walk");
+            else if (t == "BIKE")
+                type = tr("Use bike");
+            else if (t == "TAXI")
+                type = tr("Take taxi");
+            else if (t == "CAR")
+                type = tr("Drive car");
+
+            QString duration;
+            while (xml.readNextStartElement()) {
+                if (xml.name() == "Duration")
+                    duration = cleanHafasDate(readChildText(xml, "Time").trimmed());
+                else
+                    xml.skipCurrentElement();
+            }
+
+            if (!type.isEmpty()) {
+                //: %1 can be "Walk", "Use bike", "Take taxi", or "Drive car"
+                section->train = tr("%1 for %2 min").arg(type, duration);
+            }
+        } else {
+            xml.skipCurrentElement();
+        }
     }
+}
 
-    hafasContext.seqNr = doc.documentElement()
-                            .firstChildElement("ConRes")
-                            .firstChildElement("ConResCtxt")
-                            .text();
+void ParserHafasXml::readJourneyAttributes(QXmlStreamReader &xml, ParserHafasXmlSection *section)
+{
+    QStringList trains;
+    QStringList directions;
+    QStringList infos;
+    QStringList categories;
+    QStringList numbers;
+
+    // <JourneyAttribute>
+    while (xml.readNextStartElement()) {
+        bool seenAttribute = false;
+        while (xml.readNextStartElement()) {
+            if (seenAttribute || xml.name() != "Attribute") {
+                xml.skipCurrentElement();
+                continue;
+            }
+            seenAttribute = true;
+
+            const QXmlStreamAttributes attributes = xml.attributes();
+            const QString type = attributes.value("type").toString();
+            const bool isInfo = !attributes.hasAttribute("type")
+                                && attributes.hasAttribute("priority")
+                                && attributes.hasAttribute("code");
+
+            // Variants are ordered SHORT, NORMAL, LONG. For the category we
+            // prefer NORMAL but it's not always available, so we store SHORT
+            // first and overwrite it with NORMAL if it's there.
+            QString text;
+            QString category;
+            bool hasText = false;
+            bool hasNormal = false;
+            while (xml.readNextStartElement()) {
+                if (xml.name() != "AttributeVariant") {
+                    xml.skipCurrentElement();
+                    continue;
+                }
+                const QString variantType = xml.attributes().value("type").toString();
+                const QString variantText = readChildText(xml, "Text");
+                if (!hasText) {
+                    text = variantText;
+                    hasText = true;
+                }
+                if (!hasNormal && variantType == "SHORT") {
+                    category = variantText.trimmed();
+                } else if (!hasNormal && variantType == "NORMAL") {
+                    category = variantText.trimmed();
+                    hasNormal = true;
+                }
+            }
+
+            if (type == "NAME") {
+                trains << text;
+            } else if (type == "DIRECTION") {
+                directions << text;
+            } else if (type == "CATEGORY") {
+                categories << category;
+            } else if (type == "NUMBER") {
+                numbers << text;
+            } else if (isInfo && !text.isEmpty() && text != ".") {
+                infos << text;
+            }
+        }
+    }
+
+    if (trains.join("").isEmpty()) {
+        // In case train info is not available try
+        // to guess it from category + number
+        section->train = categories.join("") + " " + numbers.join("");
+    } else {
+        section->train = trains.join(" ");
+    }
+    section->direction = directions.join(" ");
+    section->info = infos.join(tr(", "));
+}
+
+void ParserHafasXml::parseSearchJourney(QNetworkReply *networkReply)
+{
+    lastJourneyResultList = new JourneyResultList();
+    journeyDetailInlineData.clear();
+    inlineConnections.clear();
+
+    QList<ParserHafasXmlConnection> connections;
+    QString context;
+    if (!readConnections(networkReply, &connections, &context))
+        return;
+
+    foreach (const ParserHafasXmlConnection &connection, connections) {
+        appendJourneyResultItem(lastJourneyResultList, connection);
+        if (connection.hasSections)
+            inlineConnections.append(connection);
+    }
+
+    hafasContext.seqNr = context;
 
     emit journeyResult(lastJourneyResultList);
 }
 
+void ParserHafasXml::appendJourneyResultItem(JourneyResultList *list, const ParserHafasXmlConnection &connection)
+{
+    JourneyResultItem *item = new JourneyResultItem();
+    item->setId(connection.id);
+    item->setDate(connection.date);
+
+    item->setDepartureTime(cleanHafasDate(connection.departure.time));
+    list->setDepartureStation(connection.departure.station);
+
+    item->setArrivalTime(cleanHafasDate(connection.arrival.time));
+    list->setArrivalStation(connection.arrival.station);
+
+    item->setTransfers(connection.transfers);
+    item->setDuration(connection.duration);
+    item->setTrainType(connection.products.join(tr(", ")));
+
+    if (!connection.hasSections) {
+        QString internalData1 = connection.xmlHandle;
+        if (internalData1.contains("query.exe")) {
+            internalData1.remove(0, internalData1.indexOf("query.exe") + 9);
+            internalData1.prepend(baseUrl);
+            item->setInternalData1(internalData1);
+        }
+    }
+
+    if (connection.announcements.count() > 0) {
+        QStringList announcements = connection.announcements;
+        item->setMiscInfo(QString("<span style=\"color:#b30;\">%1</span>")
+                          .arg(announcements.join("<br />").replace("\n", "<br />")));
+    }
+
+    list->setTimeInfo(item->date().toString());
+
+    list->appendItem(item);
+}
+
 void ParserHafasXml::searchJourneyLater()
 {
     if (hafasContext.seqNr.isEmpty()) {
@@ -816,7 +1239,7 @@ void ParserHafasXml::getJourneyDetails(const QString &id)
 
     //Some hafasxml backend provide the detailsdata inline
     //if so our parser already stored them
-    if (journeyDetailInlineData.count() > 0 ) {
+    if (journeyDetailInlineData.count() > 0 || inlineConnections.count() > 0) {
 
         for (int i = 0; i < journeyDetailInlineData.count(); i++) {
             JourneyDetailResultList *item = journeyDetailInlineData.at(i);
@@ -825,6 +1248,19 @@ void ParserHafasXml::getJourneyDetails(const QString &id)
                 return;
             }
         }
+
+        //Not opened before, build the details from the stored sections
+        foreach (const ParserHafasXmlConnection &connection, inlineConnections) {
+            if (connection.id == id) {
+                journeyDetailRequestData.id = connection.id;
+                journeyDetailRequestData.date = connection.date;
+                journeyDetailRequestData.duration = connection.duration;
+                JourneyDetailResultList *item = internalParseJourneyDetails(connection);
+                journeyDetailInlineData.append(item);
+                emit journeyDetailsResult(item);
+                return;
+            }
+        }
         emit errorOccured(tr("Internal error occured: JourneyResultdata not present!"));
         return;
     }
@@ -850,168 +1286,31 @@ void ParserHafasXml::getJourneyDetails(const QString &id)
     }
 }
 
-JourneyDetailResultList* ParserHafasXml::internalParseJourneyDetails(const QDomElement &connection)
+JourneyDetailResultList* ParserHafasXml::internalParseJourneyDetails(const ParserHafasXmlConnection &connection)
 {
     JourneyDetailResultList *results = new JourneyDetailResultList();
 
-    const QDomNodeList sections = connection.elementsByTagName("ConSection");
-    for (int i = 0; i < sections.count(); ++i) {
+    foreach (const ParserHafasXmlSection &section, connection.sections) {
         JourneyDetailResultItem *item = new JourneyDetailResultItem();
 
-        const QDomNode section = sections.at(i);
-        QDomElement stop;
-
-        stop = section.firstChildElement("Departure").firstChildElement("BasicStop");
-        const QString departure = stop.firstChildElement("Station")
-                                      .attribute("name")
-                                      .trimmed();
-        const QString departure2 = stop.firstChildElement("Location")
-                                       .firstChildElement("Station")
-                                       .firstChildElement("HafasName")
-                                       .firstChildElement("Text")
-                                       .text()
-                                       .trimmed();
-        const QString depTime = stop.firstChildElement("Dep")
-                                    .firstChildElement("Time")
-                                    .text()
-                                    .trimmed();
-        const QString depPlatform = stop.firstChildElement("Dep")
-                                        .firstChildElement("Platform")
-                                        .firstChildElement("Text")
-                                        .text()
-                                        .trimmed();
-
-        item->setDepartureStation(departure.isEmpty() ? departure2 : departure);
-        item->setDepartureDateTime(cleanHafasDateTime(depTime, journeyDetailRequestData.date));
-        if (!depPlatform.isEmpty())
-            item->setDepartureInfo(tr("Pl. %1").arg(depPlatform));
-
-        // Can be Journey, Walk, Transfer or GisRoute
-        const QDomElement transport = section.firstChildElement("Departure").nextSiblingElement();
-        if (transport.tagName() == "Journey") {
-            QStringList trains;
-            QStringList directions;
-            QStringList infos;
-            QStringList categories;
-            QStringList numbers;
-
-            const QDomNodeList attributes = transport.firstChildElement("JourneyAttributeList")
-                                                     .childNodes();
-            for (int j = 0; j < attributes.count(); ++j) {
-                const QDomElement attr = attributes.at(j).toElement()
-                                                         .firstChildElement("Attribute");
-                if (attr.attribute("type") == "NAME") {
-                    trains << attr.firstChildElement("AttributeVariant")
-                                  .firstChildElement("Text")
-                                  .text();
-                } else if (attr.attribute("type") == "DIRECTION") {
-                    directions << attr.firstChildElement("AttributeVariant")
-                                      .firstChildElement("Text")
-                                      .text();
-                } else if (attr.attribute("type") == "CATEGORY") {
-                    QDomElement el = attr.firstChildElement("AttributeVariant");
-                    QString category;
-                    do {
-                        // Elements are ordered SHORT, NORMAL, LONG.
-                        // We prefer NORMAL but it's not always available,
-                        // so we store SHORT first and overwrite it with
-                        // NORMAL if it's there.
-                        if (el.attribute("type") == "SHORT") {
-                            category = el.firstChildElement("Text").text().trimmed();
-                        } else if (el.attribute("type") == "NORMAL") {
-                            category = el.firstChildElement("Text").text().trimmed();
-                            break; // We're not interested in LONG, so skip it
-                        }
-                        el = el.nextSiblingElement("AttributeVariant");
-                    } while (!el.isNull());
-                    categories << category;
-                } else if (attr.attribute("type") == "NUMBER") {
-                    numbers << attr.firstChildElement("AttributeVariant")
-                                   .firstChildElement("Text")
-                                   .text();
-                } else if (!attr.hasAttribute("type")
-                           && attr.hasAttribute("priority")
-                           && attr.hasAttribute("code")) {
-                    const QString text = attr.firstChildElement("AttributeVariant")
-                                             .firstChildElement("Text")
-                                             .text();
-                    if (!text.isEmpty() && text != ".")
-                        infos << text;
-                }
-            }
-
-            if (trains.join("").isEmpty()) {
-                // In case train info is not available try
-                // to guess it from category + number
-                item->setTrain(categories.join("") + " " + numbers.join(""));
-            } else {
-                item->setTrain(trains.join(" "));
-            }
-            item->setDirection(directions.join(" "));
-            item->setInfo(infos.join(tr(", ")));
-        } else if (transport.tagName() == "Walk" || transport.tagName() == "Transfer") {
-            const QString duration = cleanHafasDate(transport.firstChildElement("Duration")
-                                                             .firstChildElement("Time")
-                                                             .text()
-                                                             .trimmed());
-
-            int distance;
-            if (!transport.firstChildElement("Distance").isNull())
-                distance = transport.firstChildElement("Distance").text().trimmed().toInt();
-            else
-                distance = transport.attribute("length").trimmed().toInt();
-
-            QString type = transport.tagName() == "Walk" ? tr("Walk") : tr("Transfer");
-            //: %1 can be "Walk" or "Transfer"
-            item->setTrain(tr("%1 for %2 min").arg(type, duration));
-            if (distance > 0)
-                item->setInfo(tr("Distance %n meter(s)", "", distance));
-        } else if (transport.tagName() == "GisRoute") {
-            const QString duration = cleanHafasDate(transport.firstChildElement("Duration")
-                                                         .firstChildElement("Time")
-                                                         .text()
-                                                         .trimmed());
-
-            QString type;
-            const QString t = transport.attribute("type").trimmed();
-            if (t == "FOOT")
-                type = tr("Walk");
-            else if (t == "BIKE")
-                type = tr("Use bike");
-            else if (t == "TAXI")
-                type = tr("Take taxi");
-            else if (t == "CAR")
-                type = tr("Drive car");
-            if (!type.isEmpty()) {
-                //: %1 can be "Walk", "Use bike", "Take taxi", or "Drive car"
-                item->setTrain(tr("%1 for %2 min").arg(type, duration));
-            }
-        }
-
-        stop = section.firstChildElement("Arrival").firstChildElement("BasicStop");
-        const QString arrival = stop.firstChildElement("Station")
-                                    .attribute("name")
-                                    .trimmed();
-        const QString arrival2 = stop.firstChildElement("Location")
-                                     .firstChildElement("Station")
-                                     .firstChildElement("HafasName")
-                                     .firstChildElement("Text")
-                                     .text()
-                                     .trimmed();
-        const QString arrTime = stop.firstChildElement("Arr")
-                                    .firstChildElement("Time")
-                                    .text()
-                                    .trimmed();
-        const QString arrPlatform = stop.firstChildElement("Arr")
-                                        .firstChildElement("Platform")
-                                        .firstChildElement("Text")
-                                        .text()
-                                        .trimmed();
-
-        item->setArrivalStation(arrival.isEmpty() ? arrival2 : arrival);
-        item->setArrivalDateTime(cleanHafasDateTime(arrTime, journeyDetailRequestData.date));
-        if (!arrPlatform.isEmpty())
-            item->setArrivalInfo(tr("Pl. %1").arg(arrPlatform));
+        const ParserHafasXmlStop &departure = section.departure;
+        item->setDepartureStation(departure.station.isEmpty() ? departure.locationName : departure.station);
+        item->setDepartureDateTime(cleanHafasDateTime(departure.time, journeyDetailRequestData.date));
+        if (!departure.platform.isEmpty())
+            item->setDepartureInfo(tr("Pl. %1").arg(departure.platform));
+
+        if (!section.train.isEmpty())
+            item->setTrain(section.train);
+        if (!section.direction.isEmpty())
+            item->setDirection(section.direction);
+        if (!section.info.isEmpty())
+            item->setInfo(section.info);
+
+        const ParserHafasXmlStop &arrival = section.arrival;
+        item->setArrivalStation(arrival.station.isEmpty() ? arrival.locationName : arrival.station);
+        item->setArrivalDateTime(cleanHafasDateTime(arrival.time, journeyDetailRequestData.date));
+        if (!arrival.platform.isEmpty())
+            item->setArrivalInfo(tr("Pl. %1").arg(arrival.platform));
 
         results->appendItem(item);
     }
@@ -1043,59 +1342,47 @@ JourneyDetailResultList* ParserHafasXml::internalParseJourneyDetails(const QDomE
 
 void ParserHafasXml::parseJourneyDetails(QNetworkReply *networkReply)
 {
-    QDomDocument doc;
-    if (parseXml(doc, networkReply->readAll()))
+    QList<ParserHafasXmlConnection> connections;
+    QString context;
+    if (!readConnections(networkReply, &connections, &context))
         return;
 
-    QDomElement connection;
-
-    QDomNodeList connections = doc.elementsByTagName("Connection");
-    for (int i = 0; i < connections.count(); ++i) {
-        if (connections.at(i).toElement().attribute("id") == journeyDetailRequestData.id) {
-            connection = connections.at(i).toElement();
-            break;
+    foreach (const ParserHafasXmlConnection &connection, connections) {
+        if (connection.id == journeyDetailRequestData.id) {
+            emit journeyDetailsResult(internalParseJourneyDetails(connection));
+            return;
         }
     }
-    if (connection.isNull()) {
-        qDebug() << "Connection with requested ID not found:" << journeyDetailRequestData.id;
-        return;
-    }
-
-    JourneyDetailResultList *results = internalParseJourneyDetails(connection);
 
-    emit journeyDetailsResult(results);
+    qDebug() << "Connection with requested ID not found:" << journeyDetailRequestData.id;
 }
 
 QDateTime ParserHafasXml::cleanHafasDateTime(const QString &time, QDate date)
 {
-    QDateTime result;
-    result.setDate(date);
-    QRegExp tmpRegexp = QRegExp("(\\d\\d)d(\\d\\d):(\\d\\d):(\\d\\d)");
-    tmpRegexp.setMinimal(true);
-    tmpRegexp.indexIn(time);
+    int days;
+    QTime clock;
+    if (!ParserDateTime::hafasTime(time, &days, &clock))
+        return QDateTime();
 
-    result.setTime(QTime::fromString(tmpRegexp.cap(2) + tmpRegexp.cap(3) + tmpRegexp.cap(4), "hhmmss"));
-
-    if (tmpRegexp.cap(1) != "00") {
-        result = result.addDays(tmpRegexp.cap(1).toInt());
-    }
+    QDateTime result(date, clock);
+    if (days > 0)
+        result = result.addDays(days);
 
     return result;
 }
 
 QString ParserHafasXml::cleanHafasDate(const QString &time)
 {
-    QRegExp tmpRegexp = QRegExp("(\\d\\d)d(\\d\\d):(\\d\\d):(\\d\\d)");
-    tmpRegexp.setMinimal(true);
-    tmpRegexp.indexIn(time);
+    int days;
+    QTime clock;
+    if (!ParserDateTime::hafasTime(time, &days, &clock))
+        return QString();
 
-    QString result = "";
-    if (tmpRegexp.cap(1) != "00") {
-        result.append(tmpRegexp.cap(1) + tr("d") + " ");
-    }
+    QString result;
+    if (days > 0)
+        result.append(time.left(2) + tr("d") + " ");
 
-    result.append(tmpRegexp.cap(2) + ":");
-    result.append(tmpRegexp.cap(3));
+    result.append(clock.toString("hh:mm"));
 
     return result;
 }
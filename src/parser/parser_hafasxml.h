@@ -21,7 +21,7 @@
 #define PARSER_HAFASXML_H
 
 #include <QObject>
-#include <QDomElement>
+#include <QXmlStreamReader>
 #include "parser_abstract.h"
 
 struct ParserHafasXmlJourneyDetailRequestData
@@ -52,6 +52,42 @@ struct ParserHafasXmlContext
     QString ld;
 };
 
+struct ParserHafasXmlStop
+{
+    QString station;
+    QString locationName;
+    QString time;
+    QString platform;
+};
+
+struct ParserHafasXmlSection
+{
+    ParserHafasXmlStop departure;
+    ParserHafasXmlStop arrival;
+    QString train;
+    QString direction;
+    QString info;
+};
+
+// What the journey parsers keep of a <Connection> element. Filled while
+// streaming through the reply, so only the data we show is allocated.
+struct ParserHafasXmlConnection
+{
+    QString id;
+    QDate date;
+    QString transfers;
+    QString duration;
+    ParserHafasXmlStop departure;
+    ParserHafasXmlStop arrival;
+    QStringList products;
+    QString xmlHandle;
+    QStringList announcements;
+    bool hasSections;
+    QList<ParserHafasXmlSection> sections;
+
+    ParserHafasXmlConnection() : hasSections(false) {}
+};
+
 class ParserHafasXml : public ParserAbstract
 {
     Q_OBJECT
@@ -90,14 +126,18 @@ protected:
     void parseSearchLaterJourney(QNetworkReply *networkReply);
     void parseSearchEarlierJourney(QNetworkReply *networkReply);
     void parseJourneyDetails(QNetworkReply *networkReply);
+    void parsePartialReply(FahrplanNS::curReqStates request, QNetworkReply *networkReply, const QByteArray &received);
     virtual QString getTrainRestrictionsCodes(int trainrestrictions);
 
     JourneyResultList *lastJourneyResultList;
     QList<JourneyDetailResultList*> journeyDetailInlineData;
-    StationsList internalParseStationsByName(const QString &data) const;
+    StationsList internalParseStationsByName(QXmlStreamReader &xml) const;
+    void addReplyData(QXmlStreamReader &xml, QNetworkReply *networkReply, const char *fallbackEncoding,
+                      const char *rootElement = 0) const;
+    QByteArray replyEncoding(const QByteArray &data, QNetworkReply *networkReply, const char *fallbackEncoding,
+                             int *contentStart) const;
 
 private:
-    inline bool parseXml(QDomDocument &doc, const QByteArray &xml);
     QString parseExternalIds(const QVariant &id) const;
 
     QString cleanHafasDate(const QString &time);
@@ -105,7 +145,27 @@ private:
     QByteArray getStationsExternalIds(const QString &departureStation, const QString &arrivalStation, const QString &viaStation);
     void parseTimeTableMode1(QNetworkReply *networkReply);
     void parseTimeTableMode0(QNetworkReply *networkReply);
-    JourneyDetailResultList* internalParseJourneyDetails(const QDomElement &connection);
+    void readStationTableJourney(QXmlStreamReader &xml, TimetableEntry *item);
+    bool readStbJourney(QXmlStreamReader &xml, TimetableEntry *item);
+    void appendJourneyResultItem(JourneyResultList *list, const ParserHafasXmlConnection &connection);
+    bool addPartialReplyData(QXmlStreamReader &xml, QNetworkReply *networkReply, const QByteArray &received,
+                             const char *element, const char *fallbackEncoding);
+    bool readConnections(QNetworkReply *networkReply, QList<ParserHafasXmlConnection> *connections, QString *context);
+    void readConnection(QXmlStreamReader &xml, ParserHafasXmlConnection *connection);
+    void readOverview(QXmlStreamReader &xml, ParserHafasXmlConnection *connection);
+    void readSection(QXmlStreamReader &xml, ParserHafasXmlSection *section);
+    void readJourneyAttributes(QXmlStreamReader &xml, ParserHafasXmlSection *section);
+    void readStop(QXmlStreamReader &xml, ParserHafasXmlStop *stop, const QString &timeElement);
+    JourneyDetailResultList* internalParseJourneyDetails(const ParserHafasXmlConnection &connection);
+
+    // Connections that came with their sections inline. They are turned
+    // into journeyDetailInlineData entries once the user opens them.
+    QList<ParserHafasXmlConnection> inlineConnections;
+
+    // Where parsePartialReply() got to in the reply still downloading
+    const QNetworkReply *partialReply;
+    int partialOffset;
+    QList<ParserHafasXmlConnection> partialConnections;
 };
 
 #endif // PARSER_HAFASXML_H
@@ -0,0 +1,531 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_json.h"
+
+#if defined(BUILD_FOR_QT5)
+    #include <QJsonArray>
+    #include <QJsonDocument>
+    #include <QJsonObject>
+#else
+    #include <QVariantList>
+    #include <QVariantMap>
+#endif
+
+#include <cfloat>
+
+JsonValue::JsonValue()
+{
+}
+
+#if defined(BUILD_FOR_QT5)
+
+JsonValue::JsonValue(const QJsonValue &value)
+    : m_value(value)
+{
+}
+
+JsonValue JsonValue::fromJson(const QByteArray &json)
+{
+    QJsonDocument doc = QJsonDocument::fromJson(json);
+    if (doc.isObject())
+        return JsonValue(QJsonValue(doc.object()));
+    if (doc.isArray())
+        return JsonValue(QJsonValue(doc.array()));
+    return JsonValue();
+}
+
+bool JsonValue::isNull() const
+{
+    return m_value.isNull() || m_value.isUndefined();
+}
+
+bool JsonValue::isObject() const
+{
+    return m_value.isObject();
+}
+
+bool JsonValue::isArray() const
+{
+    return m_value.isArray();
+}
+
+bool JsonValue::isString() const
+{
+    return m_value.isString();
+}
+
+bool JsonValue::isNumber() const
+{
+    return m_value.isDouble();
+}
+
+bool JsonValue::isBool() const
+{
+    return m_value.isBool();
+}
+
+JsonValue JsonValue::value(const QString &key) const
+{
+    if (!m_value.isObject())
+        return JsonValue();
+    return JsonValue(m_value.toObject().value(key));
+}
+
+bool JsonValue::contains(const QString &key) const
+{
+    return m_value.isObject() && m_value.toObject().contains(key);
+}
+
+QStringList JsonValue::keys() const
+{
+    return m_value.toObject().keys();
+}
+
+JsonValue JsonValue::at(int index) const
+{
+    if (!m_value.isArray())
+        return JsonValue();
+    QJsonArray array = m_value.toArray();
+    if (index < 0 || index >= array.size())
+        return JsonValue();
+    return JsonValue(array.at(index));
+}
+
+int JsonValue::size() const
+{
+    if (m_value.isArray())
+        return m_value.toArray().size();
+    if (m_value.isObject())
+        return m_value.toObject().size();
+    return 0;
+}
+
+QString JsonValue::toString(const QString &defaultValue) const
+{
+    switch (m_value.type()) {
+    case QJsonValue::String:
+        return m_value.toString();
+    case QJsonValue::Double: {
+        double number = m_value.toDouble();
+        if (qAbs(number) < 1e15 && number == qint64(number))
+            return QString::number(qint64(number));
+        return QString::number(number, 'g', DBL_DIG);
+    }
+    case QJsonValue::Bool:
+        return m_value.toBool() ? QLatin1String("true") : QLatin1String("false");
+    default:
+        return defaultValue;
+    }
+}
+
+double JsonValue::toDouble(bool *ok) const
+{
+    switch (m_value.type()) {
+    case QJsonValue::Double:
+        if (ok)
+            *ok = true;
+        return m_value.toDouble();
+    case QJsonValue::String:
+        return m_value.toString().toDouble(ok);
+    case QJsonValue::Bool:
+        if (ok)
+            *ok = true;
+        return m_value.toBool() ? 1 : 0;
+    default:
+        if (ok)
+            *ok = false;
+        return 0;
+    }
+}
+
+qint64 JsonValue::toLongLong(bool *ok) const
+{
+    if (m_value.isString())
+        return m_value.toString().toLongLong(ok);
+    return qRound64(toDouble(ok));
+}
+
+bool JsonValue::toBool() const
+{
+    switch (m_value.type()) {
+    case QJsonValue::Bool:
+        return m_value.toBool();
+    case QJsonValue::Double:
+        return m_value.toDouble() != 0;
+    case QJsonValue::String: {
+        const QString text = m_value.toString();
+        return !text.isEmpty() && text != QLatin1String("0") && text.compare(QLatin1String("false"), Qt::CaseInsensitive) != 0;
+    }
+    default:
+        return false;
+    }
+}
+
+QVariant JsonValue::toVariant() const
+{
+    return m_value.toVariant();
+}
+
+#else
+
+// Qt 4 has no JSON support, so replies are read by the small recursive
+// descent reader below into a QVariant tree and the view works on that.
+// It accepts RFC 8259 JSON; numbers become doubles, like QtScript did.
+
+namespace
+{
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const QByteArray &json)
+            : m_pos(json.constData()), m_end(json.constData() + json.size()), m_depth(0)
+        {
+            // Skip a UTF-8 byte order mark
+            if (m_end - m_pos >= 3 && uchar(m_pos[0]) == 0xEF && uchar(m_pos[1]) == 0xBB && uchar(m_pos[2]) == 0xBF)
+                m_pos += 3;
+        }
+
+        bool parseDocument(QVariant *result)
+        {
+            if (!parseValue(result))
+                return false;
+            skipWhitespace();
+            return m_pos == m_end;
+        }
+
+    private:
+        // Nesting limit, protects the stack against hostile replies.
+        static const int MaxDepth = 512;
+
+        const char *m_pos;
+        const char *m_end;
+        int m_depth;
+
+        void skipWhitespace()
+        {
+            while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r'))
+                ++m_pos;
+        }
+
+        bool consume(char c)
+        {
+            skipWhitespace();
+            if (m_pos < m_end && *m_pos == c) {
+                ++m_pos;
+                return true;
+            }
+            return false;
+        }
+
+        bool consumeLiteral(const char *literal, int length)
+        {
+            if (m_end - m_pos < length || qstrncmp(m_pos, literal, length) != 0)
+                return false;
+            m_pos += length;
+            return true;
+        }
+
+        bool parseValue(QVariant *result)
+        {
+            skipWhitespace();
+            if (m_pos >= m_end)
+                return false;
+
+            switch (*m_pos) {
+            case '{':
+                return parseObject(result);
+            case '[':
+                return parseArray(result);
+            case '"': {
+                QString text;
+                if (!parseString(&text))
+                    return false;
+                *result = text;
+                return true;
+            }
+            case 't':
+                *result = true;
+                return consumeLiteral("true", 4);
+            case 'f':
+                *result = false;
+                return consumeLiteral("false", 5);
+            case 'n':
+                *result = QVariant();
+                return consumeLiteral("null", 4);
+            default:
+                return parseNumber(result);
+            }
+        }
+
+        bool parseObject(QVariant *result)
+        {
+            if (++m_depth > MaxDepth)
+                return false;
+            ++m_pos; // '{'
+
+            QVariantMap map;
+            if (!consume('}')) {
+                do {
+                    skipWhitespace();
+                    QString key;
+                    if (m_pos >= m_end || *m_pos != '"' || !parseString(&key))
+                        return false;
+                    if (!consume(':'))
+                        return false;
+                    QVariant value;
+                    if (!parseValue(&value))
+                        return false;
+                    map.insert(key, value);
+                } while (consume(','));
+                if (!consume('}'))
+                    return false;
+            }
+
+            --m_depth;
+            *result = map;
+            return true;
+        }
+
+        bool parseArray(QVariant *result)
+        {
+            if (++m_depth > MaxDepth)
+                return false;
+            ++m_pos; // '['
+
+            QVariantList list;
+            if (!consume(']')) {
+                do {
+                    QVariant value;
+                    if (!parseValue(&value))
+                        return false;
+                    list.append(value);
+                } while (consume(','));
+                if (!consume(']'))
+                    return false;
+            }
+
+            --m_depth;
+            *result = list;
+            return true;
+        }
+
+        static int hexDigit(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
+        }
+
+        bool parseString(QString *result)
+        {
+            ++m_pos; // '"'
+
+            // Unescaped runs are decoded in one go, most strings have no
+            // escapes at all.
+            const char *run = m_pos;
+            while (m_pos < m_end) {
+                const char c = *m_pos;
+                if (c == '"') {
+                    result->append(QString::fromUtf8(run, m_pos - run));
+                    ++m_pos;
+                    return true;
+                }
+                if (uchar(c) < 0x20)
+                    return false;
+                if (c != '\\') {
+                    ++m_pos;
+                    continue;
+                }
+
+                result->append(QString::fromUtf8(run, m_pos - run));
+                if (m_end - m_pos < 2)
+                    return false;
+                const char escape = m_pos[1];
+                m_pos += 2;
+                switch (escape) {
+                case '"':  result->append(QLatin1Char('"')); break;
+                case '\\': result->append(QLatin1Char('\\')); break;
+                case '/':  result->append(QLatin1Char('/')); break;
+                case 'b':  result->append(QLatin1Char('\b')); break;
+                case 'f':  result->append(QLatin1Char('\f')); break;
+                case 'n':  result->append(QLatin1Char('\n')); break;
+                case 'r':  result->append(QLatin1Char('\r')); break;
+                case 't':  result->append(QLatin1Char('\t')); break;
+                case 'u': {
+                    if (m_end - m_pos < 4)
+                        return false;
+                    ushort code = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        int digit = hexDigit(m_pos[i]);
+                        if (digit < 0)
+                            return false;
+                        code = (code << 4) | digit;
+                    }
+                    m_pos += 4;
+                    // Surrogate pairs arrive as two escapes and simply
+                    // end up as two UTF-16 code units.
+                    result->append(QChar(code));
+                    break;
+                }
+                default:
+                    return false;
+                }
+                run = m_pos;
+            }
+            return false;
+        }
+
+        bool parseNumber(QVariant *result)
+        {
+            const char *start = m_pos;
+            if (m_pos < m_end && *m_pos == '-')
+                ++m_pos;
+            if (m_pos >= m_end || *m_pos < '0' || *m_pos > '9')
+                return false;
+            while (m_pos < m_end && ((*m_pos >= '0' && *m_pos <= '9') || *m_pos == '.'
+                                     || *m_pos == 'e' || *m_pos == 'E' || *m_pos == '+' || *m_pos == '-'))
+                ++m_pos;
+
+            // QByteArray::toDouble() always uses the C locale
+            bool ok;
+            double value = QByteArray::fromRawData(start, m_pos - start).toDouble(&ok);
+            if (!ok)
+                return false;
+            *result = value;
+            return true;
+        }
+    };
+}
+
+JsonValue::JsonValue(const QVariant &value)
+    : m_value(value)
+{
+}
+
+JsonValue JsonValue::fromJson(const QByteArray &json)
+{
+    QVariant result;
+    JsonReader reader(json);
+    if (!reader.parseDocument(&result))
+        return JsonValue();
+    return JsonValue(result);
+}
+
+bool JsonValue::isNull() const
+{
+    return m_value.isNull();
+}
+
+bool JsonValue::isObject() const
+{
+    return m_value.type() == QVariant::Map;
+}
+
+bool JsonValue::isArray() const
+{
+    return m_value.type() == QVariant::List;
+}
+
+bool JsonValue::isString() const
+{
+    return m_value.type() == QVariant::String;
+}
+
+bool JsonValue::isNumber() const
+{
+    return m_value.type() == QVariant::Double || m_value.type() == QVariant::Int;
+}
+
+bool JsonValue::isBool() const
+{
+    return m_value.type() == QVariant::Bool;
+}
+
+JsonValue JsonValue::value(const QString &key) const
+{
+    if (!isObject())
+        return JsonValue();
+    return JsonValue(m_value.toMap().value(key));
+}
+
+bool JsonValue::contains(const QString &key) const
+{
+    return isObject() && m_value.toMap().contains(key);
+}
+
+QStringList JsonValue::keys() const
+{
+    return m_value.toMap().keys();
+}
+
+JsonValue JsonValue::at(int index) const
+{
+    if (!isArray())
+        return JsonValue();
+    return JsonValue(m_value.toList().value(index));
+}
+
+int JsonValue::size() const
+{
+    if (isArray())
+        return m_value.toList().size();
+    if (isObject())
+        return m_value.toMap().size();
+    return 0;
+}
+
+QString JsonValue::toString(const QString &defaultValue) const
+{
+    if (m_value.isNull() || isObject() || isArray())
+        return defaultValue;
+    return m_value.toString();
+}
+
+double JsonValue::toDouble(bool *ok) const
+{
+    return m_value.toDouble(ok);
+}
+
+qint64 JsonValue::toLongLong(bool *ok) const
+{
+    return m_value.toLongLong(ok);
+}
+
+bool JsonValue::toBool() const
+{
+    return m_value.toBool();
+}
+
+QVariant JsonValue::toVariant() const
+{
+    return m_value;
+}
+
+#endif
+
+int JsonValue::toInt(bool *ok) const
+{
+    return int(toLongLong(ok));
+}
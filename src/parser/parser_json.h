@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_JSON_H
+#define PARSER_JSON_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#if defined(BUILD_FOR_QT5)
+    #include <QJsonValue>
+#endif
+
+// Read only view on a parsed JSON document. Parsers walk the document
+// through it instead of converting everything into nested QVariantMaps
+// first; lookups return views on the existing data, nothing is copied.
+//
+// Missing members and out of range indices give a null value, so chained
+// lookups like doc.value("a").value("b").at(0) never need checks in
+// between. The to*() conversions follow QVariant, e.g. a number member
+// can be read with toString() and a numeric string with toInt().
+class JsonValue
+{
+public:
+    class const_iterator
+    {
+    public:
+        const_iterator(const JsonValue *array, int index) : m_array(array), m_index(index) {}
+
+        JsonValue operator*() const { return m_array->at(m_index); }
+        const_iterator &operator++() { ++m_index; return *this; }
+        bool operator==(const const_iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        const JsonValue *m_array;
+        int m_index;
+    };
+
+    JsonValue();
+
+    static JsonValue fromJson(const QByteArray &json);
+
+    bool isNull() const;
+    bool isObject() const;
+    bool isArray() const;
+    bool isString() const;
+    bool isNumber() const;
+    bool isBool() const;
+
+    // Objects
+    JsonValue value(const QString &key) const;
+    bool contains(const QString &key) const;
+    QStringList keys() const;
+
+    // Arrays, size() and isEmpty() also work for objects
+    JsonValue at(int index) const;
+    JsonValue first() const { return at(0); }
+    JsonValue last() const { return at(size() - 1); }
+    int size() const;
+    int count() const { return size(); }
+    bool isEmpty() const { return size() == 0; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, isArray() ? size() : 0); }
+
+    QString toString(const QString &defaultValue = QString()) const;
+    int toInt(bool *ok = 0) const;
+    qint64 toLongLong(bool *ok = 0) const;
+    double toDouble(bool *ok = 0) const;
+    bool toBool() const;
+
+    // For the few places which hand data on as QVariant
+    QVariant toVariant() const;
+
+private:
+#if defined(BUILD_FOR_QT5)
+    explicit JsonValue(const QJsonValue &value);
+    QJsonValue m_value;
+#else
+    explicit JsonValue(const QVariant &value);
+    QVariant m_value;
+#endif
+};
+
+#endif // PARSER_JSON_H
@@ -18,13 +18,16 @@
 ****************************************************************************/
 
 #include "parser_movas_bahnde.h"
+#include "parser_datetime.h"
+#include "parser_hafaslocationid.h"
 
-#ifdef BUILD_FOR_QT5
-#include <QJsonDocument>
-#else
-#include <QScriptEngine>
-#endif
-#include <QRegExp>
+namespace
+{
+    QDateTime legDateTime(const JsonValue& leg, const QString& key)
+    {
+        return ParserDateTime::fromIso(leg.value(key).toString(), "Europe/Berlin");
+    }
+}
 
 ParserMovasBahnDe::ParserMovasBahnDe(QObject *parent) :
         ParserAbstract(parent)
@@ -101,7 +104,7 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
 
     qDebug() << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
 
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
@@ -117,19 +120,19 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
 
     //qDebug() << "doc:\n" << doc;
 
-    QVariantList entries;
+    JsonValue entries;
 
     // returned timetable could be either bahnhofstafelAbfahrtPositionen (departures) 
     // or bahnhofstafelAnkunftPositionen (arrivals)
     if(doc.contains("bahnhofstafelAbfahrtPositionen"))
     {
         mode = ParserAbstract::Mode::Departure;
-        entries = doc.value("bahnhofstafelAbfahrtPositionen").toList();
+        entries = doc.value("bahnhofstafelAbfahrtPositionen");
     }
     else if(doc.contains("bahnhofstafelAnkunftPositionen"))
     {
         mode = ParserAbstract::Mode::Arrival;
-        entries = doc.value("bahnhofstafelAnkunftPositionen").toList();
+        entries = doc.value("bahnhofstafelAnkunftPositionen");
     }
     else
     {
@@ -137,20 +140,22 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
         return;
     }
 
-    Q_FOREACH (const QVariant& entryVar, entries) {
+    const HafasLocationId currentStationId(lastTimetableSearch.currentStation.id.toString());
+
+    Q_FOREACH (const JsonValue& entry, entries) {
         TimetableEntry item;
-        QVariantMap entry(entryVar.toMap());
+        const HafasLocationId locationId(HafasLocationId::fromString(entry.value("abfrageOrt").value("locationId").toString()));
 
         // Note: id field contents sadly do not match. have to strip both down to
         // location to compare
-        if(!isSameLocation(entry.value("abfrageOrt").toMap().value("locationId").toString(),lastTimetableSearch.currentStation.id.toString()))
+        if(!locationId.isSameLocation(currentStationId))
         {
             //continue;
             //qDebug() << " location.compare";
         }
 
         QString train(entry.value("mitteltext").toString());
-        QString station(entry.value("abfrageOrt").toMap().value("name").toString());
+        QString station(entry.value("abfrageOrt").value("name").toString());
         QString dest;
 
         if(mode == ParserAbstract::Mode::Departure)
@@ -159,7 +164,7 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
         }
         else
         {
-            dest = entry.value("abgangsOrt").toMap().value("name").toString();
+            dest = entry.value("abgangsOrt").value("name").toString();
         }
 
         //TODO: probably should query id of dest and do compare by location
@@ -192,26 +197,26 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
 
         if(mode == ParserAbstract::Mode::Departure)
         {
-            dateTime = (QDateTime::fromString(entry.value("abgangsDatum").toString(), Qt::ISODate));
-            realDateTime = (QDateTime::fromString(entry.value("ezAbgangsDatum").toString(), Qt::ISODate));
+            dateTime = ParserDateTime::fromIso(entry.value("abgangsDatum").toString());
+            realDateTime = ParserDateTime::fromIso(entry.value("ezAbgangsDatum").toString());
         }
         else
         {
-            dateTime = (QDateTime::fromString(entry.value("ankunftsDatum").toString(), Qt::ISODate));
-            realDateTime = (QDateTime::fromString(entry.value("ezAnkunftsDatum").toString(), Qt::ISODate));
+            dateTime = ParserDateTime::fromIso(entry.value("ankunftsDatum").toString());
+            realDateTime = ParserDateTime::fromIso(entry.value("ezAnkunftsDatum").toString());
         }
 
         // Delay
         qint64 delaySecs(dateTime.secsTo(realDateTime));
 
-        QVariantList realtimeNotesList = entry.value("echtzeitNotizen").toList();
+        const JsonValue realtimeNotesList = entry.value("echtzeitNotizen");
         QString miscInfo = "";
 
         bool canceled = false;
 
         QString realtimeNotes = "";
 
-        Q_FOREACH (const QVariant& realtimeNoteVar, realtimeNotesList) {
+        Q_FOREACH (const JsonValue& realtimeNoteVar, realtimeNotesList) {
             QString realtimeNote = realtimeNoteVar.toString();
             if (realtimeNote.length() > 0) {
                 if (realtimeNote.contains("Halt entfällt") || realtimeNotes.contains("Stop cancelled")) {
@@ -254,20 +259,9 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
         item.time = dateTime.time();
         item.miscInfo = miscInfo;
 
-        //parse latitude and longitute from station id
-        QStringList idElements = entry.value("abfrageOrt").toMap().value("locationId").toString().split("@");
-        for (int i = 0; i <= idElements.length() -1; i++) {
-            if (idElements[i].split("=").length() == 2) {
-                if(idElements[i].split("=")[0].startsWith("X"))
-                {
-                    item.latitude = idElements[i].split("=")[1].toInt();
-                }
-                if(idElements[i].split("=")[0].startsWith("Y"))
-                {
-                    item.longitude = idElements[i].split("=")[1].toInt();
-                }
-            }
-        }
+        //latitude and longitute from station id
+        item.latitude = locationId.x();
+        item.longitude = locationId.y();
 
         result << item;
     }
@@ -275,36 +269,14 @@ void ParserMovasBahnDe::parseTimeTable(QNetworkReply *networkReply)
     emit timetableResult(result);
 }
 
-/* Inspired by ParserAbstract::parseJson */
-QVariantList ParserMovasBahnDe::parseJsonList(const QByteArray &json) const
-{
-    QVariantList doc;
-#ifdef BUILD_FOR_QT5
-    doc = QJsonDocument::fromJson(json).toVariant().toList();
-#else
-    QString utf8(QString::fromUtf8(json));
-
-    // Validation of JSON according to RFC 4627, section 6
-    QString tmp(utf8);
-    if (tmp.replace(QRegExp("\"(\\\\.|[^\"\\\\])*\""), "")
-           .contains(QRegExp("[^,:{}\\[\\]0-9.\\-+Eaeflnr-u \\n\\r\\t]")))
-        return doc;
-
-    QScriptEngine *engine = new QScriptEngine();
-    doc = engine->evaluate("(" + utf8 + ")").toVariant().toList();
-    delete engine;
-#endif
-
-    return doc;
-}
-
 void ParserMovasBahnDe::sendHttpRequestMovas(QUrl url, QByteArray data, QLatin1String mimeType, const QList<QPair<QByteArray,QByteArray> > &additionalHeaders)
 {
     QNetworkRequest request;
     request.setUrl(url);
     request.setHeader(QNetworkRequest::ContentTypeHeader, mimeType);
     request.setRawHeader("User-Agent", userAgent.toLatin1());
-    request.setRawHeader("Cache-Control", "no-cache");
+    if (!dataSaverEnabled())
+        request.setRawHeader("Cache-Control", "no-cache");
     for (QList<QPair<QByteArray,QByteArray> >::ConstIterator it = additionalHeaders.constBegin(); it != additionalHeaders.constEnd(); ++it)
         request.setRawHeader(it->first, it->second);
 
@@ -390,35 +362,31 @@ void ParserMovasBahnDe::parseStationsByName(QNetworkReply *networkReply)
 
     //qDebug() << "Reply:\n" << allData;
 
-    QVariantMap docErr = parseJson(allData);
+    JsonValue doc = parseJson(allData);
 
-    if (!docErr.isEmpty()) {
-        //qDebug() << "docErr:\n" << docErr;
+    if (doc.isObject()) {
+        //qDebug() << "docErr:\n" << doc.toVariant();
 
-        if (docErr.value("status").toString().contains("ERROR")) {
-            emit errorOccured(tr("Backend returns an error: ") + ":\n\n" + docErr.value("code").toString());
+        if (doc.value("status").toString().contains("ERROR")) {
+            emit errorOccured(tr("Backend returns an error: ") + ":\n\n" + doc.value("code").toString());
             return;
         }
     }
 
-    QVariantList doc = parseJsonList(allData);
-
-    if (doc.isEmpty()) {
+    if (!doc.isArray() || doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList foundstations = doc;
     StationsList results;
-    Q_FOREACH (const QVariant& stationData, foundstations) {
-        const QVariantMap& station(stationData.toMap());
-        const QVariantMap& coordinates(station.value("coordinates").toMap());
+    Q_FOREACH (const JsonValue& station, doc) {
+        const JsonValue coordinates(station.value("coordinates"));
         if (coordinates.size() != 2) {
-            qDebug() << "Invalid coordinates:" << station;
+            qDebug() << "Invalid coordinates:" << station.toVariant();
             continue;
         }
         Station s;
-        s.id = station.value("locationId");
+        s.id = station.value("locationId").toVariant();
         s.name = station.value("name").toString();
         s.type = station.value("layer").toString();
 
@@ -484,7 +452,7 @@ void ParserMovasBahnDe::internalSearchJourney(const Station &departureStation, c
     }
 
     QVariantMap zeitWunsch;
-    QDateTime berlinTime(dateTime.toTimeZone(QTimeZone("Europe/Berlin")));
+    QDateTime berlinTime(dateTime.toTimeZone(ParserDateTime::timeZone("Europe/Berlin")));
     zeitWunsch["reiseDatum"] = berlinTime.toString(Qt::ISODate);
     if (mode == Arrival)
     {
@@ -533,7 +501,7 @@ void ParserMovasBahnDe::parseSearchJourney(QNetworkReply *networkReply)
 
     //qDebug() << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
 
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
@@ -549,68 +517,79 @@ void ParserMovasBahnDe::parseSearchJourney(QNetworkReply *networkReply)
 
     //qDebug() << "doc:\n" << doc;
 
-    const QVariantList& itineraries(doc.value("verbindungen").toList());
+    cachedResults.clear();
+    cachedItineraries.clear();
+
     int journeyCounter = 0;
     bool hasFoundWalkOnlyRoute = false;
-    Q_FOREACH (const QVariant itineraryVar, itineraries) {
-        const QVariantMap& itinerary(itineraryVar.toMap().value("verbindung").toMap());
+    Q_FOREACH (const JsonValue& itineraryVar, doc.value("verbindungen")) {
+        const JsonValue itinerary(itineraryVar.value("verbindung"));
         QString journeyID = QString::number(journeyCounter);
-        QList<JourneyDetailResultItem*> segments = parseJourneySegments(itinerary);
         // FIXME have not seen walk distance in movas yet
 #if 0
         bool walkDistanceOK;
         double walkDistance = itinerary.value("distanz").toDouble(&walkDistanceOK);
 #endif
 
-        if (segments.isEmpty())
-            continue;
-
-        // Duration
-        bool durationOK;
-        int minutes = itinerary.value("reiseDauer").toDouble(&durationOK) / 60;
-        int hours = minutes / 60;
-        minutes = minutes % 60;
-        QString duration = QString("%1:%2").arg(hours).arg(minutes, 2, 10, QChar('0'));
+        // Only read what the result list shows. The segments are parsed by
+        // getJourneyDetails() once the journey is opened, most never are.
+        JsonValue firstLeg;
+        JsonValue lastLeg;
+        int segmentCount = 0;
+        QString firstTrain;
 
         // Compile list of transport modes used
         QStringList transportModes;
-        foreach (JourneyDetailResultItem* segment, segments) {
-            if (segment->internalData1() != "WALK")
-                transportModes.append(segment->train());
+        Q_FOREACH (const JsonValue& leg, itinerary.value("verbindungsAbschnitte")) {
+            if (leg.value("abgangsOrt").isEmpty() || leg.value("ankunftsOrt").isEmpty())
+                continue;
+            if (segmentCount == 0) {
+                firstLeg = leg;
+                firstTrain = parseLegTrain(leg);
+            }
+            lastLeg = leg;
+            ++segmentCount;
+            if (leg.value("typ").toString() != "FUSSWEG")
+                transportModes.append(segmentCount == 1 ? firstTrain : parseLegTrain(leg));
         }
+
+        if (segmentCount == 0)
+            continue;
+
         // When the distance is short, an option with only "walk" can be present
-        if (transportModes.count() == 0 && segments.count() == 1) {
+        if (transportModes.count() == 0 && segmentCount == 1) {
             if (hasFoundWalkOnlyRoute) {
                 // For some reason there sometimes are several "walk only" routes - only use the first one
                 qDebug() << "Skipping walk only route (have already got one)";
                 continue;
             } else {
-                transportModes.append(segments.first()->train());
+                transportModes.append(firstTrain);
                 hasFoundWalkOnlyRoute = true;
             }
         }
 
-        JourneyDetailResultList* journeyDetails = new JourneyDetailResultList;
-        foreach (JourneyDetailResultItem* segment, segments)
-            journeyDetails->appendItem(segment);
-        journeyDetails->setId(journeyID);
-        journeyDetails->setDepartureStation(segments.first()->departureStation());
-        journeyDetails->setDepartureDateTime(segments.first()->departureDateTime());
-        journeyDetails->setArrivalStation(segments.last()->arrivalStation());
-        journeyDetails->setArrivalDateTime(segments.last()->arrivalDateTime());
+        // Duration
+        bool durationOK;
+        int minutes = itinerary.value("reiseDauer").toDouble(&durationOK) / 60;
+        int hours = minutes / 60;
+        minutes = minutes % 60;
+        QString duration;
         if (durationOK)
-            journeyDetails->setDuration(duration);
-        cachedResults.insert(journeyID, journeyDetails);
+            duration = QString("%1:%2").arg(hours).arg(minutes, 2, 10, QChar('0'));
+
+        const QDateTime departureDateTime(legDateTime(firstLeg, "abgangsDatum"));
+        const QDateTime arrivalDateTime(legDateTime(lastLeg, "ankunftsDatum"));
+        cachedItineraries.insert(journeyID, itinerary);
 
         // Indicate in the departure/arrival times if they are another day (e.g. "14:37+1")
-        int depDayDiff = lastJourneySearch.dateTime.date().daysTo(journeyDetails->departureDateTime().date());
-        QString depTime = journeyDetails->departureDateTime().toString("HH:mm");
+        int depDayDiff = lastJourneySearch.dateTime.date().daysTo(departureDateTime.date());
+        QString depTime = departureDateTime.toString("HH:mm");
         if (depDayDiff > 0)
             depTime += "+" + QString::number(depDayDiff);
         else if (depDayDiff < 0)
             depTime += QString::number(depDayDiff);
-        int arrDayDiff = lastJourneySearch.dateTime.date().daysTo(journeyDetails->arrivalDateTime().date());
-        QString arrTime = journeyDetails->arrivalDateTime().toString("HH:mm");
+        int arrDayDiff = lastJourneySearch.dateTime.date().daysTo(arrivalDateTime.date());
+        QString arrTime = arrivalDateTime.toString("HH:mm");
         if (arrDayDiff > 0)
             arrTime += "+" + QString::number(arrDayDiff);
         else if (arrDayDiff < 0)
@@ -618,11 +597,11 @@ void ParserMovasBahnDe::parseSearchJourney(QNetworkReply *networkReply)
 
         JourneyResultItem* journey = new JourneyResultItem;
         journey->setId(journeyID);
-        journey->setDate(segments.first()->departureDateTime().date());
+        journey->setDate(departureDateTime.date());
         journey->setDepartureTime(depTime);
         journey->setArrivalTime(arrTime);
         journey->setTrainType(transportModes.join(", "));
-        journey->setDuration(journeyDetails->duration());
+        journey->setDuration(duration);
         journey->setTransfers(QString::number(transportModes.count()-1));
         //FIXME have not seen walkDistance in movas yet
 #if 0
@@ -633,14 +612,14 @@ void ParserMovasBahnDe::parseSearchJourney(QNetworkReply *networkReply)
 
         if (journeyCounter == 0) {
             if (lastJourneySearch.mode == Departure)
-                lastJourneySearch.firstOption = journeyDetails->departureDateTime();
+                lastJourneySearch.firstOption = departureDateTime;
             else
-                lastJourneySearch.firstOption = journeyDetails->arrivalDateTime();
+                lastJourneySearch.firstOption = arrivalDateTime;
         }
         if (lastJourneySearch.mode == Departure)
-            lastJourneySearch.lastOption = journeyDetails->departureDateTime();
+            lastJourneySearch.lastOption = departureDateTime;
         else
-            lastJourneySearch.lastOption = journeyDetails->arrivalDateTime();
+            lastJourneySearch.lastOption = arrivalDateTime;
 
         ++journeyCounter;
     }
@@ -657,18 +636,72 @@ void ParserMovasBahnDe::parseSearchJourney(QNetworkReply *networkReply)
     emit journeyResult(journeyList);
 }
 
-QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QVariantMap& itinerary)
+JourneyDetailResultList* ParserMovasBahnDe::parseJourneyDetails(const QString& journeyID, const JsonValue& itinerary)
+{
+    QList<JourneyDetailResultItem*> segments = parseJourneySegments(itinerary);
+    if (segments.isEmpty())
+        return NULL;
+
+    JourneyDetailResultList* journeyDetails = new JourneyDetailResultList;
+    foreach (JourneyDetailResultItem* segment, segments)
+        journeyDetails->appendItem(segment);
+    journeyDetails->setId(journeyID);
+    journeyDetails->setDepartureStation(segments.first()->departureStation());
+    journeyDetails->setDepartureDateTime(segments.first()->departureDateTime());
+    journeyDetails->setArrivalStation(segments.last()->arrivalStation());
+    journeyDetails->setArrivalDateTime(segments.last()->arrivalDateTime());
+
+    bool durationOK;
+    int minutes = itinerary.value("reiseDauer").toDouble(&durationOK) / 60;
+    if (durationOK)
+        journeyDetails->setDuration(QString("%1:%2").arg(minutes / 60).arg(minutes % 60, 2, 10, QChar('0')));
+
+    return journeyDetails;
+}
+
+QString ParserMovasBahnDe::parseLegTrain(const JsonValue& leg)
+{
+    QString transportType = leg.value("typ").toString();
+
+    // FIXME: assuming FUSSWEG = Transfer for now since there has been
+    // no indication for walk only routes in movas yet
+    if (transportType == "FUSSWEG") {
+        qint64 duration = leg.value("abschnittsDauer").toInt() / 60;
+        QString type = tr("Transfer");
+        return tr("%1 (%n min)", "Transfer", duration).arg(type);
+    }
+
+    QString transportString(transportModeName(/*transportMode, */transportType));
+    QString routeName(leg.value("mitteltext").toString());
+
+    //qDebug() << "Route short name:" << routeName;
+
+    if (!routeName.isEmpty())
+    {
+        if(transportString.isEmpty())
+        {
+          transportString = routeName;
+        }
+        else
+        {
+          transportString += " " + routeName;
+        }
+    }
+
+    return transportString;
+}
+
+QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const JsonValue& itinerary)
 {
     QList<JourneyDetailResultItem*> results;
 
-    Q_FOREACH (const QVariant& legVar, itinerary.value("verbindungsAbschnitte").toList()) {
-        const QVariantMap& leg(legVar.toMap());
+    Q_FOREACH (const JsonValue& leg, itinerary.value("verbindungsAbschnitte")) {
         //qDebug() << "Parsing journey segment";
 
         //qDebug() << "leg:" << leg;
 
-        const QVariantMap from(leg.value("abgangsOrt").toMap());
-        const QVariantMap to(leg.value("ankunftsOrt").toMap());
+        const JsonValue from(leg.value("abgangsOrt"));
+        const JsonValue to(leg.value("ankunftsOrt"));
         if (from.isEmpty() || to.isEmpty())
             continue;
         JourneyDetailResultItem* journeySegment = new JourneyDetailResultItem();
@@ -689,20 +722,12 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
 #endif
         journeySegment->setDepartureStation(parseNodeName(from));
         journeySegment->setArrivalStation(parseNodeName(to));
-        QDateTime depDt(QDateTime::fromString(leg.value("abgangsDatum").toString(), Qt::ISODate));
-        QDateTime realDepDt(QDateTime::fromString(leg.value("ezAbgangsDatum").toString(), Qt::ISODate));
-#ifdef BUILD_FOR_QT5
-        depDt.setTimeZone(QTimeZone("Europe/Berlin"));
-        realDepDt.setTimeZone(QTimeZone("Europe/Berlin"));
-#endif
-        journeySegment->setDepartureDateTime(depDt.toLocalTime());
-        QDateTime arrDt(QDateTime::fromString(leg.value("ankunftsDatum").toString(), Qt::ISODate));
-        QDateTime realArrDt(QDateTime::fromString(leg.value("ezAnkunftsDatum").toString(), Qt::ISODate));
-#ifdef BUILD_FOR_QT5
-        arrDt.setTimeZone(QTimeZone("Europe/Berlin"));
-        realArrDt.setTimeZone(QTimeZone("Europe/Berlin"));
-#endif
-        journeySegment->setArrivalDateTime(arrDt.toLocalTime());
+        QDateTime depDt(legDateTime(leg, "abgangsDatum"));
+        QDateTime realDepDt(legDateTime(leg, "ezAbgangsDatum"));
+        journeySegment->setDepartureDateTime(depDt);
+        QDateTime arrDt(legDateTime(leg, "ankunftsDatum"));
+        QDateTime realArrDt(legDateTime(leg, "ezAnkunftsDatum"));
+        journeySegment->setArrivalDateTime(arrDt);
 
         // Delay
         qint64 departureDelaySecs(depDt.secsTo(realDepDt));
@@ -717,13 +742,13 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
         // that leads to duplicated platform displays
         if(leg.contains("halte") && transportType != "FUSSWEG")
         {
-           QVariantList stops(leg.value("halte").toList());
+           const JsonValue stops(leg.value("halte"));
 
-           if(stops.length() > 1)
+           if(stops.size() > 1)
            {
-               //qDebug() << "num stops:" << stops.length();
+               //qDebug() << "num stops:" << stops.size();
 
-               QVariantMap firstStop = stops.first().toMap();
+               const JsonValue firstStop = stops.first();
                if(firstStop.contains("ezGleis") && firstStop.value("ezGleis").toString().length() > 0)
                {
                    journeySegment->setDepartureInfo(tr("Track changed to %1","Departure").arg(firstStop.value("ezGleis").toString()));
@@ -735,7 +760,7 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
                    //qDebug() << "firstStop:" << firstStop.value("gleis").toString();
                }
 
-               QVariantMap lastStop = stops.last().toMap();
+               const JsonValue lastStop = stops.last();
                if(lastStop.contains("ezGleis") && lastStop.value("ezGleis").toString().length() > 0)
                {
                    journeySegment->setArrivalInfo(tr("Track changed to %1","Arrival").arg(lastStop.value("ezGleis").toString()));
@@ -790,11 +815,11 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
         bool departureCanceled = false;
         bool arrivalCanceled = false;
 
-        QVariantList departureInfoVarList = leg.value("echtzeitNotizen").toList();
+        const JsonValue departureInfoVarList = leg.value("echtzeitNotizen");
         if(!departureInfoVarList.isEmpty())
         {
             QString departureInfo;
-            Q_FOREACH (const QVariant& infoVar, departureInfoVarList) {
+            Q_FOREACH (const JsonValue& infoVar, departureInfoVarList) {
                 QString infoPart(infoVar.toString());
 
                 if(infoPart.length() > 0)
@@ -815,11 +840,11 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
             }
         }
 
-        QVariantList arrivalInfoVarList = leg.value("echtzeitNotizen").toList();
+        const JsonValue arrivalInfoVarList = leg.value("echtzeitNotizen");
         if(!arrivalInfoVarList.isEmpty())
         {
             QString arrivalInfo;
-            Q_FOREACH (const QVariant& infoVar, arrivalInfoVarList) {
+            Q_FOREACH (const JsonValue& infoVar, arrivalInfoVarList) {
                 QString infoPart(infoVar.toString());
 
                 if(infoPart.length() > 0)
@@ -853,10 +878,7 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
 
         QStringList announcements;
 
-        QVariantList announcementsVarList(leg.value("himNotizen").toList());
-
-        Q_FOREACH (const QVariant& announcementVar, announcementsVarList) {
-            QVariantMap announcement(announcementVar.toMap());
+        Q_FOREACH (const JsonValue& announcement, leg.value("himNotizen")) {
             announcements.append(announcement.value("ueberschrift").toString());
             announcements.append(announcement.value("text").toString());
         }
@@ -866,11 +888,9 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
                     .arg(announcements.join("<br />"));
         }
 
-        QVariantList demandInfoVarList(leg.value("auslastungsInfos").toList());
         QStringList demandInfos;
 
-        Q_FOREACH (const QVariant& demandInfoVar, demandInfoVarList) {
-            QVariantMap demandInfo(demandInfoVar.toMap());
+        Q_FOREACH (const JsonValue& demandInfo, leg.value("auslastungsInfos")) {
             QString travelClass = demandInfo.value("klasse").toString();
             QString displayText = demandInfo.value("anzeigeTextKurz").toString();
             QString demand;
@@ -921,19 +941,13 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
         }
 
         // extra attributes
-        QVariantList attributesVarList(leg.value("attributNotizen").toList());
-
-        QMap<QString,QString> legAttributes(parseJourneyLegAttributes(attributesVarList));
+        QMap<QString,QString> legAttributes(parseJourneyLegAttributes(leg.value("attributNotizen")));
 
-        qint64 duration = leg.value("abschnittsDauer").toInt() / 60;
         // FIXME: have not seen distance in the data from movas yet
         //qint64 distance = leg.value("").toInt();
 
-        // FIXME: assuming FUSSWEG = Transfer for now since there has been
-        // no indication for walk only routes in movas yet
+        journeySegment->setTrain(parseLegTrain(leg));
         if (transportType == "FUSSWEG") {
-            QString type = tr("Transfer");
-            journeySegment->setTrain(tr("%1 (%n min)", "Transfer", duration).arg(type));
             journeySegment->setInternalData1("WALK");
             // FIXME: have not seen distance in the data from movas yet
 #if 0
@@ -941,23 +955,6 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
                 journeySegment->setInfo(tr("Distance %n meter(s)", "", distance));
 #endif
         } else {
-            QString transportString(transportModeName(/*transportMode, */transportType));
-            QString routeName(leg.value("mitteltext").toString());
-
-            //qDebug() << "Route short name:" << routeName;
-
-            if (!routeName.isEmpty())
-            {
-                if(transportString.isEmpty())
-                {
-                  transportString = routeName;
-                }
-                else
-                {
-                  transportString += " " + routeName;
-                }
-            }
-
             if (legAttributes.contains("agencyName") && !legAttributes["agencyName"].isEmpty()) {
                 info.append(legAttributes["agencyName"]);
             }
@@ -965,7 +962,6 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
             QString tripHeadSign(leg.value("richtung").toString());
             if (!tripHeadSign.isEmpty())
                 journeySegment->setDirection(tripHeadSign);
-            journeySegment->setTrain(transportString);
         }
         if (!info.isEmpty())
             journeySegment->setInfo(info.join("<br/>"));
@@ -977,12 +973,11 @@ QList<JourneyDetailResultItem*> ParserMovasBahnDe::parseJourneySegments(const QV
 
 // TODO: check which other attributes and attribute values are available and
 // how to integrate them into info field
-QMap<QString, QString> ParserMovasBahnDe::parseJourneyLegAttributes(QVariantList attributesVarList)
+QMap<QString, QString> ParserMovasBahnDe::parseJourneyLegAttributes(const JsonValue& attributesVarList)
 {
    QMap<QString, QString> attributes;
 
-   Q_FOREACH (const QVariant& attributeVar, attributesVarList) {
-       QVariantMap attribute(attributeVar.toMap());
+   Q_FOREACH (const JsonValue& attribute, attributesVarList) {
        QString key(attribute.value("key").toString());
        QString text(attribute.value("text").toString());
        if(key.compare("FB",Qt::CaseSensitivity::CaseSensitive) == 0)
@@ -1073,6 +1068,14 @@ QMap<QString, QString> ParserMovasBahnDe::parseJourneyLegAttributes(QVariantList
 
 void ParserMovasBahnDe::getJourneyDetails(const QString &id)
 {
+    if (!cachedResults.contains(id) && cachedItineraries.contains(id)) {
+        JourneyDetailResultList* journeyDetails = parseJourneyDetails(id, cachedItineraries.value(id));
+        if (journeyDetails) {
+            cachedResults.insert(id, journeyDetails);
+            cachedItineraries.remove(id);
+        }
+    }
+
     if (cachedResults.contains(id))
         emit journeyDetailsResult(cachedResults.value(id));
     else
@@ -1155,7 +1158,7 @@ QString ParserMovasBahnDe::formatDistance(double distance)
         return QString("%1 %2").arg(QString::number(distance, 'f', 0)).arg("m");
 }
 
-QString ParserMovasBahnDe::parseNodeName(const QVariantMap& node)
+QString ParserMovasBahnDe::parseNodeName(const JsonValue& node)
 {
     QString name(node.value("name").toString());
     return name;
@@ -1228,95 +1231,40 @@ QStringList ParserMovasBahnDe::getTrainRestrictions()
 // TODO: add more supported restrictions and more granular restriction selection
 QStringList ParserMovasBahnDe::getTrainRestrictionsCodes(int trainrestrictions)
 {
-    QStringList trainrestr;
-    if (trainrestrictions == 0) {
-        //ALL
-        trainrestr.append("HOCHGESCHWINDIGKEITSZUEGE");
-        trainrestr.append("INTERCITYUNDEUROCITYZUEGE");
-        trainrestr.append("INTERREGIOUNDSCHNELLZUEGE");
-        trainrestr.append("NAHVERKEHRSONSTIGEZUEGE");
-        trainrestr.append("SBAHNEN");
-        trainrestr.append("UBAHN");
-        trainrestr.append("STRASSENBAHN");
-        trainrestr.append("BUSSE");
-        trainrestr.append("SCHIFFE");
-        trainrestr.append("ANRUFPFLICHTIGEVERKEHRE");
-    } else if (trainrestrictions == 1) {
-        //All without ICE
-        trainrestr.append("INTERCITYUNDEUROCITYZUEGE");
-        trainrestr.append("INTERREGIOUNDSCHNELLZUEGE");
-        trainrestr.append("NAHVERKEHRSONSTIGEZUEGE");
-        trainrestr.append("SBAHNEN");
-        trainrestr.append("UBAHN");
-        trainrestr.append("STRASSENBAHN");
-        trainrestr.append("BUSSE");
-        trainrestr.append("SCHIFFE");
-        trainrestr.append("ANRUFPFLICHTIGEVERKEHRE");
-    } else if (trainrestrictions == 2) {
-        //Only local transport
-        trainrestr.append("NAHVERKEHRSONSTIGEZUEGE");
-        trainrestr.append("SBAHNEN");
-        trainrestr.append("UBAHN");
-        trainrestr.append("STRASSENBAHN");
-        trainrestr.append("BUSSE");
-        trainrestr.append("SCHIFFE");
-        trainrestr.append("ANRUFPFLICHTIGEVERKEHRE");
-    } else if (trainrestrictions == 3) {
-        //Only local transport without S-Bahn
-        trainrestr.append("NAHVERKEHRSONSTIGEZUEGE");
-        trainrestr.append("SBAHNEN");
-        trainrestr.append("UBAHN");
-        trainrestr.append("BUSSE");
-        trainrestr.append("SCHIFFE");
-        trainrestr.append("ANRUFPFLICHTIGEVERKEHRE");
-    } else {
-        //if nothing matches also use values for ALL
-        trainrestr.append("HOCHGESCHWINDIGKEITSZUEGE");
-        trainrestr.append("INTERCITYUNDEUROCITYZUEGE");
-        trainrestr.append("INTERREGIOUNDSCHNELLZUEGE");
-        trainrestr.append("NAHVERKEHRSONSTIGEZUEGE");
-        trainrestr.append("SBAHNEN");
-        trainrestr.append("UBAHN");
-        trainrestr.append("STRASSENBAHN");
-        trainrestr.append("BUSSE");
-        trainrestr.append("SCHIFFE");
-        trainrestr.append("ANRUFPFLICHTIGEVERKEHRE");
-    }
-
-    return trainrestr;
-}
-
-bool ParserMovasBahnDe::isSameLocation(const QString& id1, const QString& id2)
-{
-  return getLatitude(id1) == getLatitude(id2) && getLongitude(id1) == getLongitude(id2);
-}
-
-quint64 ParserMovasBahnDe::getLatitude(const QString& id)
-{
-  QStringList idElements = id.split("@");
-  for (int i = 0; i <= idElements.length() -1; i++) {
-      if (idElements[i].split("=").length() == 2) {
-          if(idElements[i].split("=")[0].startsWith("X"))
-          {
-              return idElements[i].split("=")[1].toInt();
-          }
-      }
-  }
-
-  return 0;
-}
+    // Built once and shared, the lists are implicitly shared copies.
+    static const QList<QStringList> codes = []() {
+        static const char * const products[] = {
+            "HOCHGESCHWINDIGKEITSZUEGE",
+            "INTERCITYUNDEUROCITYZUEGE",
+            "INTERREGIOUNDSCHNELLZUEGE",
+            "NAHVERKEHRSONSTIGEZUEGE",
+            "SBAHNEN",
+            "UBAHN",
+            "STRASSENBAHN",
+            "BUSSE",
+            "SCHIFFE",
+            "ANRUFPFLICHTIGEVERKEHRE"
+        };
+        // Bits of products for every entry of getTrainRestrictions()
+        static const int restrictions[] = {
+            0x3ff,  // All
+            0x3fe,  // All without ICE
+            0x3f8,  // Only local transport
+            0x3b8   // Local transport without S-Bahn
+        };
+
+        QList<QStringList> result;
+        for (int restriction : restrictions) {
+            QStringList list;
+            for (int i = 0; i < int(sizeof(products) / sizeof(products[0])); ++i) {
+                if (restriction & (1 << i))
+                    list.append(QLatin1String(products[i]));
+            }
+            result.append(list);
+        }
+        return result;
+    }();
 
-quint64 ParserMovasBahnDe::getLongitude(const QString& id)
-{
-  QStringList idElements = id.split("@");
-  for (int i = 0; i <= idElements.length() -1; i++) {
-      if (idElements[i].split("=").length() == 2) {
-          if(idElements[i].split("=")[0].startsWith("Y"))
-          {
-              return idElements[i].split("=")[1].toInt();
-          }
-      }
-  }
-
-  return 0;
+    //if nothing matches also use values for ALL
+    return codes.value(trainrestrictions, codes.first());
 }
@@ -76,6 +76,7 @@ private:
     QString baseUrl;
 
     QMap<QString, JourneyDetailResultList*> cachedResults; // journey ID => detailed journey results
+    QMap<QString, JsonValue> cachedItineraries; // journey ID => itinerary, parsed when the details are opened
     // Keep track of the number of "earlier"/"later" searches we did without getting any new results
     int numberOfUnsuccessfulEarlierSearches;
     int numberOfUnsuccessfulLaterSearches;
@@ -83,10 +84,11 @@ private:
     void internalSearchJourney(const Station &departureStation, const Station &viaStation,
                                        const Station &arrivalStation, const QDateTime &dateTime,
                                        Mode mode, int trainrestrictions);
-    QList<JourneyDetailResultItem*> parseJourneySegments(const QVariantMap& itinerary);
+    QList<JourneyDetailResultItem*> parseJourneySegments(const JsonValue& itinerary);
+    JourneyDetailResultList* parseJourneyDetails(const QString& journeyID, const JsonValue& itinerary);
+    QString parseLegTrain(const JsonValue& leg);
     static QString formatDistance(double distance);
 
-    QVariantList parseJsonList(const QByteArray &json) const;
     void sendHttpRequestMovas(QUrl url, QByteArray data, QLatin1String mimeType, const QList<QPair<QByteArray,QByteArray> > &additionalHeaders);
     void parseTimeTable(QNetworkReply *networkReply);
     void parseStationsByName(QNetworkReply *networkReply);
@@ -96,16 +98,12 @@ private:
     void parseSearchEarlierJourney(QNetworkReply *networkReply);
     void parseJourneyDetails(QNetworkReply *networkReply);
 
-    QMap<QString, QString> parseJourneyLegAttributes(QVariantList attributesVarList);
+    QMap<QString, QString> parseJourneyLegAttributes(const JsonValue& attributesVarList);
 
     QString transportModeName(/*const QString& mode, */const QString& type);
-    QString parseNodeName(const QVariantMap& node);
+    QString parseNodeName(const JsonValue& node);
     QString trClass(QString travelClass);
     QStringList getTrainRestrictionsCodes(int trainrestrictions);
-
-    bool isSameLocation(const QString& id1, const QString& id2);
-    quint64 getLatitude(const QString& id);
-    quint64 getLongitude(const QString& id);
 };
 
 #endif // PARSER_MOVAS_BAHNDE_H
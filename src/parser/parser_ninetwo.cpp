@@ -18,6 +18,7 @@
  ****************************************************************************/
 
 #include "parser_ninetwo.h"
+#include "parser_datetime.h"
 
 #include <QUrl>
 #include <QNetworkReply>
@@ -253,20 +254,18 @@ void ParserNinetwo::parseTimeTable(QNetworkReply *networkReply)
     QByteArray allData = networkReply->readAll();
     qDebug() << "REPLY:>>>>>>>>>>>>\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList tabs = doc.value("tabs").toList();
-    QString currentStation(doc.value("location").toMap().value("name").toString());
+    const JsonValue tabs = doc.value("tabs");
+    QString currentStation(doc.value("location").value("name").toString());
 
-    QVariantList::const_iterator i;
-    for (i = tabs.constBegin(); i != tabs.constEnd(); ++i) {
-        QVariantMap tab = i->toMap();
+    for (const JsonValue &tab : tabs) {
         QString type = tab.value("id").toString();
-        QVariantList departures = tab.value("departures").toList();
+        const JsonValue departures = tab.value("departures");
         switch(timetableRestrictions){
             case all:
             default:
@@ -281,13 +280,11 @@ void ParserNinetwo::parseTimeTable(QNetworkReply *networkReply)
             break;
         }
 
-        QVariantList::const_iterator j;
-        for (j = departures.constBegin(); j != departures.constEnd(); ++j) {
-            QVariantMap departure = j->toMap();
+        for (const JsonValue &departure : departures) {
             TimetableEntry entry;
             entry.currentStation=currentStation;
             entry.destinationStation = departure.value("destinationName").toString();
-            entry.time = QTime::fromString(departure.value("time").toString(), "HH:mm");
+            entry.time = ParserDateTime::timeFromString(departure.value("time").toString());
             QString via(departure.value("viaNames").toString());
             if (!via.isEmpty())
                 entry.destinationStation = tr("%1 via %2").arg(entry.destinationStation, via);
@@ -307,7 +304,7 @@ void ParserNinetwo::parseTimeTable(QNetworkReply *networkReply)
 
             entry.platform = departure.value("platform").toString();
 
-            QString train = departure.value("mode").toMap().value("name").toString();
+            QString train = departure.value("mode").value("name").toString();
             const QString service = departure.value("service").toString();
             if (!service.isEmpty())
                 train.append(" ").append(service);
@@ -331,25 +328,23 @@ void ParserNinetwo::parseStationsByName(QNetworkReply *networkReply)
     QByteArray allData = networkReply->readAll();
     //qDebug() << "REPLY:>>>>>>>>>>>>\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         qWarning() << __PRETTY_FUNCTION__ << "empty response";
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList stations = doc.value("locations").toList();
+    const JsonValue stations = doc.value("locations");
 
     StationsList result;
 
-    QVariantList::const_iterator i;
-    for (i = stations.constBegin(); i != stations.constEnd(); ++i) {
-        QVariantMap station = i->toMap();
+    for (const JsonValue &station : stations) {
         Station s;
         //s.name=QString("[%1]%2").arg(station.value("type").toString(), station.value("name").toString());
         const QString name = station.value("Displayname").toString();
         const QString place = station.value("Region").toString();
-        s.miscInfo = station.value("EnglishSubType",station.value("SubType")).toString();
+        s.miscInfo = station.value("EnglishSubType").toString(station.value("SubType").toString());
 
         //s.name = QString("%3 %1 (%2)").arg(name, place, s.miscInfo);
         s.name = QString("%1 (%2)").arg(name, place);
@@ -444,13 +439,11 @@ JourneyResultItem * ParserNinetwo::parseJourneyJson(const QString& jsonData)
     // qWarning() << "journey" << "\n" << jsonData;
     // JourneyResultList *journeyList = new JourneyResultList();
 
-    // wrap it in an object, bcause it is a naked list
-    auto json = parseJson("{\"legs\":" + jsonData.toUtf8() + "}");
-    //qWarning() << "leg" << "\n" <<  json;
+    const JsonValue legs = parseJson(jsonData.toUtf8());
+    //qWarning() << "leg" << "\n" <<  legs.toVariant();
 
-    if(json["legs"].type() != QVariant::List)
+    if(!legs.isArray())
         return nullptr;
-    QVariantList legs = json["legs"].toList();
 
     QSet<QString> transportTypes;
     int walkCount = 0;
@@ -469,48 +462,47 @@ JourneyResultItem * ParserNinetwo::parseJourneyJson(const QString& jsonData)
     QDateTime departureTime;
 
     // inner loop
-    for(auto const & legv: legs)
+    for(auto const & leg: legs)
     {
-        if(legv.type() != QVariant::Map)
+        if(!leg.isObject())
         {
             qWarning() << "non-map leg detected";
             continue;
         }
-        QVariantMap leg = legv.toMap();
-        QString mode = leg["Mode"].toMap()["ModeType"].toString();
+        QString mode = leg.value("Mode").value("ModeType").toString();
         transportTypes.insert(mode);
-        QString modeName = leg["Mode"].toMap()["Name"].toString();
+        QString modeName = leg.value("Mode").value("Name").toString();
         tTypes += modeName.split(" ").at(0) + " ";
-        QString direction = leg["Destination"].toString();
+        QString direction = leg.value("Destination").toString();
         // eg. B for metro line b
-        QString service = leg["Service"].toString();
-        QString company = leg["Operator"].toMap()["Name"].toString();
+        QString service = leg.value("Service").toString();
+        QString company = leg.value("Operator").value("Name").toString();
 
         if(mode == "walk")
             walkCount++;
 
-        QVariantList calls = leg["Calls"].toList();
+        const JsonValue calls = leg.value("Calls");
         /*
         for (int i = 0; i < calls.count(); ++i) {
-                qWarning() << "Ctype: "  <<  calls[i].toMap()["CallType"].toString();
+                qWarning() << "Ctype: "  <<  calls.at(i).value("CallType").toString();
         }
         */
         int const lastCall = calls.count()-1;
 
         //QString departureStation = calls[0].toMap()["Location"].toMap()["Cluster-Type"].toString() + " "
         //                         + calls[0].toMap()["Location"].toMap()["Name"].toString();
-        QString departureStation = calls[0].toMap()["Location"].toMap()["Name"].toString();
-        QString departurePlatform = calls[0].toMap()["Platform"].toString();
-        QString arrivalStation = calls[lastCall].toMap()["Location"].toMap()["Name"].toString();
-        QString arrivalPlatform = calls[lastCall].toMap()["Platform"].toString();
+        QString departureStation = calls.at(0).value("Location").value("Name").toString();
+        QString departurePlatform = calls.at(0).value("Platform").toString();
+        QString arrivalStation = calls.at(lastCall).value("Location").value("Name").toString();
+        QString arrivalPlatform = calls.at(lastCall).value("Platform").toString();
 
         // walks have not times
-        if (calls[0].toMap()["Departure"].toString() != "")
-            departureTime = QDateTime::fromString(calls[0].toMap()["Departure"].toString(), Qt::ISODate);
+        if (calls.at(0).value("Departure").toString() != "")
+            departureTime = ParserDateTime::fromIso(calls.at(0).value("Departure").toString());
 
         // only set Arrival if we have it. not set for walk
-        if (calls[lastCall-1].toMap()["Arrival"].toString() != "")
-            arrivalTime = QDateTime::fromString(calls[lastCall].toMap()["Arrival"].toString(), Qt::ISODate);
+        if (calls.at(lastCall-1).value("Arrival").toString() != "")
+            arrivalTime = ParserDateTime::fromIso(calls.at(lastCall).value("Arrival").toString());
 
         JourneyDetailResultItem* item = new JourneyDetailResultItem;
 
@@ -523,7 +515,7 @@ JourneyResultItem * ParserNinetwo::parseJourneyJson(const QString& jsonData)
             item->setDepartureInfo(QString(tr("Pl. %1")).arg(departurePlatform));
 
         // walk Mode has Duration set
-        durationC = leg["Duration"].toString();
+        durationC = leg.value("Duration").toString();
         durationC.replace(QString("00:"), QString(""));
         if(mode == "walk") {
             QString walkDuration;
@@ -536,7 +528,7 @@ JourneyResultItem * ParserNinetwo::parseJourneyJson(const QString& jsonData)
         walkingTime = durationC.replace(QString(":00"), QString("")).toInt();
 
         // reset :)
-        durationC = leg["Duration"].toString();
+        durationC = leg.value("Duration").toString();
         durationC.replace(QString("00:"), QString(""));
 
         // we're walking, haven't reset Arrival from last leg
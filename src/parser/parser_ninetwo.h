@@ -101,11 +101,7 @@ protected:
     QMap<QString, JourneyDetailResultList*> cachedResults;
 
     // from resrobot
-    QList<JourneyDetailResultItem*> parseJourneySegments(const QVariantMap &journeyData);
-    QHash<QString, QString> hafasAttributes;
-    QHash<QString, QString> specificTransportModes;
-    QHash<QString, QString> generalTransportModes;
-    QHash<QString, QString> transportModeStrings;
+    QList<JourneyDetailResultItem*> parseJourneySegments(const JsonValue &journeyData);
 
 
 private:
@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_regexps.h"
+
+#if defined(BUILD_FOR_QT5)
+    #include <QRegularExpression>
+#else
+    #include <QRegExp>
+#endif
+
+namespace
+{
+    const char * const patterns[ParserRegExps::PatternCount] = {
+        "\"access_token\":\"([^\"]+)",
+        "\"expires_in\":([1-9][0-9]*)"
+    };
+
+#if defined(BUILD_FOR_QT5)
+    typedef QRegularExpression RegExp;
+#else
+    typedef QRegExp RegExp;
+#endif
+
+    struct Expressions
+    {
+        RegExp expressions[ParserRegExps::PatternCount];
+
+        Expressions()
+        {
+            for (int i = 0; i < ParserRegExps::PatternCount; ++i) {
+                expressions[i].setPattern(QLatin1String(patterns[i]));
+#if defined(BUILD_FOR_QT5) && QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+                expressions[i].optimize();
+#endif
+            }
+        }
+    };
+
+    const RegExp &expression(ParserRegExps::Pattern pattern)
+    {
+        static const Expressions compiled;
+        return compiled.expressions[pattern];
+    }
+}
+
+QString ParserRegExps::capture(Pattern pattern, const QString &text, int nth)
+{
+#if defined(BUILD_FOR_QT5)
+    // QRegularExpression is reentrant and match() is const, so one
+    // instance serves every thread.
+    const QRegularExpressionMatch match = expression(pattern).match(text);
+    return match.hasMatch() ? match.captured(nth) : QString();
+#else
+    // QRegExp keeps the captures in the object, so work on a copy. Copies
+    // share the compiled engine.
+    QRegExp regexp = expression(pattern);
+    return regexp.indexIn(text) >= 0 ? regexp.cap(nth) : QString();
+#endif
+}
@@ -0,0 +1,43 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_REGEXPS_H
+#define PARSER_REGEXPS_H
+
+#include <QString>
+
+// The regular expressions the parsers need, compiled once per process and
+// shared by all parser threads. Keep new patterns here instead of building
+// a QRegExp per call; if a pattern only checks a prefix or suffix, compare
+// the string directly instead.
+namespace ParserRegExps
+{
+    enum Pattern {
+        VasttrafikAccessToken,  // "access_token":"<token>"
+        VasttrafikExpiresIn,    // "expires_in":<seconds>
+        PatternCount
+    };
+
+    // The nth capture of the first match of pattern in text, a null string
+    // if there is no match.
+    QString capture(Pattern pattern, const QString &text, int nth = 1);
+}
+
+#endif // PARSER_REGEXPS_H
@@ -18,10 +18,157 @@
 ****************************************************************************/
 
 #include "parser_resrobot.h"
+#include "parser_datetime.h"
 
 #include <QDebug>
 #include <QNetworkReply>
 
+#include <algorithm>
+
+namespace
+{
+    // Lookup tables shared by all instances. Keep each of them sorted by
+    // code, they are searched with a binary search. Texts are translated
+    // when they are looked up, not when the parser is created.
+    struct Translation
+    {
+        const char *code;
+        const char *text;
+    };
+
+    // name is UTF-8 and only translated if translate is set, product names
+    // stay as they are. %1 and %2 in it take the translated arguments.
+    struct TransportMode
+    {
+        const char *code;
+        const char *name;
+        bool translate;
+        const char *arg1;
+        const char *arg2;
+    };
+
+    const Translation hafasAttributes[] = {
+        {"00", QT_TRANSLATE_NOOP("ParserResRobot", "Faster service (overtakes slower services)")},
+        {"A1", QT_TRANSLATE_NOOP("ParserResRobot", "Food in first class")},
+        {"A6", QT_TRANSLATE_NOOP("ParserResRobot", "Business class Plus available")},
+        {"A7", QT_TRANSLATE_NOOP("ParserResRobot", "No pets allowed")},
+        {"AA", QT_TRANSLATE_NOOP("ParserResRobot", "Standard class only")},
+        {"AB", QT_TRANSLATE_NOOP("ParserResRobot", "Seat reservation not possible in second class")},
+        {"AC", QT_TRANSLATE_NOOP("ParserResRobot", "Trolley service")},
+        {"AD", QT_TRANSLATE_NOOP("ParserResRobot", "Restaurant")},
+        {"AE", QT_TRANSLATE_NOOP("ParserResRobot", "No reservation")},
+        {"AF", QT_TRANSLATE_NOOP("ParserResRobot", "Mandatory seat reservation")},
+        {"AG", QT_TRANSLATE_NOOP("ParserResRobot", "Optional seat reservation")},
+        {"AH", QT_TRANSLATE_NOOP("ParserResRobot", "Access to sleeper before dep.")},
+        {"AI", QT_TRANSLATE_NOOP("ParserResRobot", "Access to sleeper after arr.")},
+        {"AJ", QT_TRANSLATE_NOOP("ParserResRobot", "Telephone reservation")},
+        {"AK", QT_TRANSLATE_NOOP("ParserResRobot", "Family coach")},
+        {"AL", QT_TRANSLATE_NOOP("ParserResRobot", "Coach with cinema and bistro")},
+        {"AM", QT_TRANSLATE_NOOP("ParserResRobot", "Supplement")},
+        {"AN", QT_TRANSLATE_NOOP("ParserResRobot", "Wheelchair lift")},
+        {"AO", QT_TRANSLATE_NOOP("ParserResRobot", "Short distance trips not allowed")},
+        {"AP", QT_TRANSLATE_NOOP("ParserResRobot", "Regional fare for reg. journey")},
+        {"AQ", QT_TRANSLATE_NOOP("ParserResRobot", "Engineering work. Bus/taxi repl.")},
+        {"AR", QT_TRANSLATE_NOOP("ParserResRobot", "Detour due to engineering work")},
+        {"AS", QT_TRANSLATE_NOOP("ParserResRobot", "Engineering work. 60-90 min delay.")},
+        {"AT", QT_TRANSLATE_NOOP("ParserResRobot", "Reduced speed (may be delayed)")},
+        {"AU", QT_TRANSLATE_NOOP("ParserResRobot", "Flexicoach with bistro")},
+        {"AV", QT_TRANSLATE_NOOP("ParserResRobot", "Bed and wheelchair or bed + parent with child")},
+        {"AW", QT_TRANSLATE_NOOP("ParserResRobot", "Internet connection")},
+        {"AZ", QT_TRANSLATE_NOOP("ParserResRobot", "Preordered breakfast")},
+        {"BF", QT_TRANSLATE_NOOP("ParserResRobot", "No reservation in first class")},
+        {"BG", QT_TRANSLATE_NOOP("ParserResRobot", "Luggage")},
+        {"D1", QT_TRANSLATE_NOOP("ParserResRobot", "Animals allowed, see rules")},
+        {"D2", QT_TRANSLATE_NOOP("ParserResRobot", "Animals allowed, see rules")},
+        {"D3", QT_TRANSLATE_NOOP("ParserResRobot", "Animals allowed, see rules")},
+        {"EL", QT_TRANSLATE_NOOP("ParserResRobot", "Electricity for reservation")},
+        {"ES", QT_TRANSLATE_NOOP("ParserResRobot", "No day coach")},
+        {"FB", QT_TRANSLATE_NOOP("ParserResRobot", "Carriage of bicycle")},
+        {"FM", QT_TRANSLATE_NOOP("ParserResRobot", "First class without food has no reservation")},
+        {"KI", QT_TRANSLATE_NOOP("ParserResRobot", "Skis")},
+        {"KO", QT_TRANSLATE_NOOP("ParserResRobot", "Office coach")},
+        {"KU", QT_TRANSLATE_NOOP("ParserResRobot", "Culture coach")},
+        {"LW", QT_TRANSLATE_NOOP("ParserResRobot", "Couchette")},
+        {"P-", QT_TRANSLATE_NOOP("ParserResRobot", "No price information available")},
+        {"PE", QT_TRANSLATE_NOOP("ParserResRobot", "Newspapers in first class")},
+        {"PS", QT_TRANSLATE_NOOP("ParserResRobot", "Society coach")},
+        {"S4", QT_TRANSLATE_NOOP("ParserResRobot", "Four-bed compartment in sleeper")},
+        {"SD", QT_TRANSLATE_NOOP("ParserResRobot", "Alcohol service")},
+        {"SF", QT_TRANSLATE_NOOP("ParserResRobot", "Breakfast in first class")},
+        {"SG", QT_TRANSLATE_NOOP("ParserResRobot", "Tavern")},
+        {"SH", QT_TRANSLATE_NOOP("ParserResRobot", "Reduced speed, may be delayed")},
+        {"SI", QT_TRANSLATE_NOOP("ParserResRobot", "No foodservice")},
+        {"SK", QT_TRANSLATE_NOOP("ParserResRobot", "Café")},
+        {"SL", QT_TRANSLATE_NOOP("ParserResRobot", "Sleeper and couchette")},
+        {"SM", QT_TRANSLATE_NOOP("ParserResRobot", "Foodservice")},
+        {"SN", QT_TRANSLATE_NOOP("ParserResRobot", "Foodservice plus")},
+        {"SS", QT_TRANSLATE_NOOP("ParserResRobot", "Food served at seat in first class")},
+        {"SV", QT_TRANSLATE_NOOP("ParserResRobot", "Hot food may be preordered")},
+        {"SW", QT_TRANSLATE_NOOP("ParserResRobot", "Sleeper")}
+    };
+
+    const TransportMode specificTransportModes[] = {
+        {"BAX", QT_TRANSLATE_NOOP("ParserResRobot", "Airport transfer (bus)"), true, 0, 0},
+        {"BOR", "Öresundståg (%1)", false, QT_TRANSLATE_NOOP("ParserResRobot", "replacement bus"), 0},
+        {"BPT", "Pågatåg (%1)", false, QT_TRANSLATE_NOOP("ParserResRobot", "replacement bus"), 0},
+        {"BXB", QT_TRANSLATE_NOOP("ParserResRobot", "Express bus"), true, 0, 0},
+        {"FNF", QT_TRANSLATE_NOOP("ParserResRobot", "Normal ferry (reduced price)"), true, 0, 0},
+        {"FUT", QT_TRANSLATE_NOOP("ParserResRobot", "International ferry"), true, 0, 0},
+        {"FXF", "%1 SF700 %2", false, QT_TRANSLATE_NOOP("ParserResRobot", "Express ferry"), QT_TRANSLATE_NOOP("ParserResRobot", "yellow dep")},
+        {"FXL", "%1 SF1500 %2", false, QT_TRANSLATE_NOOP("ParserResRobot", "Express ferry"), QT_TRANSLATE_NOOP("ParserResRobot", "white dep")},
+        {"FXM", "%1 SF700 %2", false, QT_TRANSLATE_NOOP("ParserResRobot", "Express ferry"), QT_TRANSLATE_NOOP("ParserResRobot", "white dep")},
+        {"FXN", "%1 SF1500 %2", false, QT_TRANSLATE_NOOP("ParserResRobot", "Express ferry"), QT_TRANSLATE_NOOP("ParserResRobot", "yellow dep")},
+        {"JAV", "Renfe Ave", false, 0, 0},
+        {"JAX", QT_TRANSLATE_NOOP("ParserResRobot", "Airport transfer (train)"), true, 0, 0},
+        {"JCN", "City Night Line", false, 0, 0},
+        {"JCS", QT_TRANSLATE_NOOP("ParserResRobot", "Night train"), true, 0, 0},
+        {"JEC", "EuroCity", false, 0, 0},
+        {"JEN", "EuroNight", false, 0, 0},
+        {"JES", "Eurostar Italia", false, 0, 0},
+        {"JEX", QT_TRANSLATE_NOOP("ParserResRobot", "Express train"), true, 0, 0},
+        {"JFM", "Flåmsbanen", false, 0, 0},
+        {"JGM", "Flytog", false, 0, 0},
+        {"JIC", "InterCity", false, 0, 0},
+        {"JIE", "ICE", false, 0, 0},
+        {"JIL", "InterCity Lyn", false, 0, 0},
+        {"JIR", "InterRegio", false, 0, 0},
+        {"JKP", "Kustpilen", false, 0, 0},
+        {"JNO", "Norrtåg", false, 0, 0},
+        {"JNS", "NSB/SJ", false, 0, 0},
+        {"JNT", QT_TRANSLATE_NOOP("ParserResRobot", "Night train"), true, 0, 0},
+        {"JNZ", "DB Nachtzug", false, 0, 0},
+        {"JOR", "Öresundståg", false, 0, 0},
+        {"JPT", "Pågatåg", false, 0, 0},
+        {"JSP", QT_TRANSLATE_NOOP("ParserResRobot", "Special train"), true, 0, 0},
+        {"JST", QT_TRANSLATE_NOOP("ParserResRobot", "High-speed train"), true, 0, 0},
+        {"JTH", "Thalys", false, 0, 0},
+        {"TAX", QT_TRANSLATE_NOOP("ParserResRobot", "Airport transfer (taxi)"), true, 0, 0}
+    };
+
+    const Translation generalTransportModes[] = {
+        {"A", QT_TRANSLATE_NOOP("ParserResRobot", "Flight")},
+        {"B", QT_TRANSLATE_NOOP("ParserResRobot", "Bus")},
+        {"F", QT_TRANSLATE_NOOP("ParserResRobot", "Ferry")},
+        {"H", QT_TRANSLATE_NOOP("ParserResRobot", "Helicopter")},
+        {"J", QT_TRANSLATE_NOOP("ParserResRobot", "Train")},
+        {"S", QT_TRANSLATE_NOOP("ParserResRobot", "Tram")},
+        {"T", QT_TRANSLATE_NOOP("ParserResRobot", "Taxi")},
+        {"U", QT_TRANSLATE_NOOP("ParserResRobot", "Rapid transit")}
+    };
+
+    template <typename Entry, int Size>
+    const Entry *findCode(const Entry (&table)[Size], const QString &code)
+    {
+        const Entry *end = table + Size;
+        const Entry *entry = std::lower_bound(table, end, code, [](const Entry &candidate, const QString &value) {
+            return QLatin1String(candidate.code) < value;
+        });
+        if (entry != end && code == QLatin1String(entry->code))
+            return entry;
+        return 0;
+    }
+}
+
 ParserResRobot::ParserResRobot(QObject *parent) :
         ParserAbstract(parent),
         timetableAPIKey(QLatin1String("d60211b4-50f6-4edd-acfa-d3654fec2fa3")),
@@ -32,110 +179,6 @@ ParserResRobot::ParserResRobot(QObject *parent) :
     // Symbian doesn't support SNI - ignore hostname mismatch
     ignoredSslErrors << QSslError::HostNameMismatch;
 #endif
-
-    // Translate remarks
-    hafasAttributes.insert("A1", tr("Food in first class"));
-    hafasAttributes.insert("A6", tr("Business class Plus available"));
-    hafasAttributes.insert("A7", tr("No pets allowed"));
-    hafasAttributes.insert("AA", tr("Standard class only"));
-    hafasAttributes.insert("AB", tr("Seat reservation not possible in second class"));
-    hafasAttributes.insert("AC", tr("Trolley service"));
-    hafasAttributes.insert("AD", tr("Restaurant"));
-    hafasAttributes.insert("AE", tr("No reservation"));
-    hafasAttributes.insert("AF", tr("Mandatory seat reservation"));
-    hafasAttributes.insert("AG", tr("Optional seat reservation"));
-    hafasAttributes.insert("AH", tr("Access to sleeper before dep."));
-    hafasAttributes.insert("AI", tr("Access to sleeper after arr."));
-    hafasAttributes.insert("AJ", tr("Telephone reservation"));
-    hafasAttributes.insert("AK", tr("Family coach"));
-    hafasAttributes.insert("AL", tr("Coach with cinema and bistro"));
-    hafasAttributes.insert("AM", tr("Supplement"));
-    hafasAttributes.insert("AN", tr("Wheelchair lift"));
-    hafasAttributes.insert("AO", tr("Short distance trips not allowed"));
-    hafasAttributes.insert("AP", tr("Regional fare for reg. journey"));
-    hafasAttributes.insert("AQ", tr("Engineering work. Bus/taxi repl."));
-    hafasAttributes.insert("AR", tr("Detour due to engineering work"));
-    hafasAttributes.insert("AS", tr("Engineering work. 60-90 min delay."));
-    hafasAttributes.insert("AT", tr("Reduced speed (may be delayed)"));
-    hafasAttributes.insert("AU", tr("Flexicoach with bistro"));
-    hafasAttributes.insert("AV", tr("Bed and wheelchair or bed + parent with child"));
-    hafasAttributes.insert("AW", tr("Internet connection"));
-    hafasAttributes.insert("AZ", tr("Preordered breakfast"));
-    hafasAttributes.insert("BF", tr("No reservation in first class"));
-    hafasAttributes.insert("BG", tr("Luggage"));
-    hafasAttributes.insert("D1", tr("Animals allowed, see rules"));
-    hafasAttributes.insert("D2", tr("Animals allowed, see rules"));
-    hafasAttributes.insert("D3", tr("Animals allowed, see rules"));
-    hafasAttributes.insert("EL", tr("Electricity for reservation"));
-    hafasAttributes.insert("ES", tr("No day coach"));
-    hafasAttributes.insert("FB", tr("Carriage of bicycle"));
-    hafasAttributes.insert("FM", tr("First class without food has no reservation"));
-    hafasAttributes.insert("KI", tr("Skis"));
-    hafasAttributes.insert("KO", tr("Office coach"));
-    hafasAttributes.insert("KU", tr("Culture coach"));
-    hafasAttributes.insert("LW", tr("Couchette"));
-    hafasAttributes.insert("PE", tr("Newspapers in first class"));
-    hafasAttributes.insert("PS", tr("Society coach"));
-    hafasAttributes.insert("S4", tr("Four-bed compartment in sleeper"));
-    hafasAttributes.insert("SD", tr("Alcohol service"));
-    hafasAttributes.insert("SF", tr("Breakfast in first class"));
-    hafasAttributes.insert("SG", tr("Tavern"));
-    hafasAttributes.insert("SH", tr("Reduced speed, may be delayed"));
-    hafasAttributes.insert("SI", tr("No foodservice"));
-    hafasAttributes.insert("SK", tr("Café"));
-    hafasAttributes.insert("SL", tr("Sleeper and couchette"));
-    hafasAttributes.insert("SM", tr("Foodservice"));
-    hafasAttributes.insert("SN", tr("Foodservice plus"));
-    hafasAttributes.insert("SS", tr("Food served at seat in first class"));
-    hafasAttributes.insert("SV", tr("Hot food may be preordered"));
-    hafasAttributes.insert("SW", tr("Sleeper"));
-    hafasAttributes.insert("00", tr("Faster service (overtakes slower services)"));
-    hafasAttributes.insert("P-", tr("No price information available"));
-
-    specificTransportModes.insert("BAX", tr("Airport transfer (bus)"));
-    specificTransportModes.insert("BOR", QString::fromUtf8("Öresundståg (%1)").arg(tr("replacement bus")));
-    specificTransportModes.insert("BPT", QString::fromUtf8("Pågatåg (%1)").arg(tr("replacement bus")));
-    specificTransportModes.insert("BXB", tr("Express bus"));
-    specificTransportModes.insert("FNF", tr("Normal ferry (reduced price)"));
-    specificTransportModes.insert("FUT", tr("International ferry"));
-    specificTransportModes.insert("FXF", QString("%1 SF700 %2").arg(tr("Express ferry")).arg(tr("yellow dep")));
-    specificTransportModes.insert("FXL", QString("%1 SF1500 %2").arg(tr("Express ferry")).arg(tr("white dep")));
-    specificTransportModes.insert("FXM", QString("%1 SF700 %2").arg(tr("Express ferry")).arg(tr("white dep")));
-    specificTransportModes.insert("FXN", QString("%1 SF1500 %2").arg(tr("Express ferry")).arg(tr("yellow dep")));
-    specificTransportModes.insert("JAV", "Renfe Ave");
-    specificTransportModes.insert("JAX", tr("Airport transfer (train)"));
-    specificTransportModes.insert("JCN", "City Night Line");
-    specificTransportModes.insert("JCS", tr("Night train"));
-    specificTransportModes.insert("JEC", "EuroCity");
-    specificTransportModes.insert("JEN", "EuroNight");
-    specificTransportModes.insert("JES", "Eurostar Italia");
-    specificTransportModes.insert("JEX", tr("Express train"));
-    specificTransportModes.insert("JFM", QString::fromUtf8("Flåmsbanen"));
-    specificTransportModes.insert("JGM", "Flytog");
-    specificTransportModes.insert("JIC", "InterCity");
-    specificTransportModes.insert("JIE", "ICE");
-    specificTransportModes.insert("JIL", "InterCity Lyn");
-    specificTransportModes.insert("JIR", "InterRegio");
-    specificTransportModes.insert("JKP", "Kustpilen");
-    specificTransportModes.insert("JNO", QString::fromUtf8("Norrtåg"));
-    specificTransportModes.insert("JNS", "NSB/SJ");
-    specificTransportModes.insert("JNT", tr("Night train"));
-    specificTransportModes.insert("JNZ", "DB Nachtzug");
-    specificTransportModes.insert("JOR", QString::fromUtf8("Öresundståg"));
-    specificTransportModes.insert("JPT", QString::fromUtf8("Pågatåg"));
-    specificTransportModes.insert("JSP", tr("Special train"));
-    specificTransportModes.insert("JST", tr("High-speed train"));
-    specificTransportModes.insert("JTH", "Thalys");
-    specificTransportModes.insert("TAX", tr("Airport transfer (taxi)"));
-
-    generalTransportModes.insert("A", tr("Flight"));
-    generalTransportModes.insert("B", tr("Bus"));
-    generalTransportModes.insert("F", tr("Ferry"));
-    generalTransportModes.insert("H", tr("Helicopter"));
-    generalTransportModes.insert("J", tr("Train"));
-    generalTransportModes.insert("S", tr("Tram"));
-    generalTransportModes.insert("T", tr("Taxi"));
-    generalTransportModes.insert("U", tr("Rapid transit"));
 }
 
 bool ParserResRobot::supportsGps()
@@ -377,22 +420,21 @@ void ParserResRobot::parseTimeTable(QNetworkReply *networkReply)
     QByteArray allData = networkReply->readAll();
 //    qDebug() << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList departures;
+    JsonValue departures;
     if (timetableSearchMode == Arrival)
-        departures = doc.value("Arrival").toList();
+        departures = doc.value("Arrival");
     else
-        departures = doc.value("Departure").toList();
+        departures = doc.value("Departure");
     TimetableEntriesList timetable;
-    foreach (QVariant departureData, departures) {
+    foreach (const JsonValue& departure, departures) {
         TimetableEntry resultItem;
-        const QVariantMap& departure = departureData.toMap();
-        const QVariantMap& product = departure.value("Product").toMap();
+        const JsonValue product = departure.value("Product");
         QStringList info;
 
         resultItem.currentStation = departure.value("stop").toString();
@@ -405,7 +447,7 @@ void ParserResRobot::parseTimeTable(QNetworkReply *networkReply)
         } else {
             timeStr = departure.value("time").toString();
         }
-        resultItem.time = QTime::fromString(timeStr, "HH:mm:ss");
+        resultItem.time = ParserDateTime::timeFromString(timeStr);
         if (timetableSearchMode == Arrival)
             resultItem.destinationStation = departure.value("origin").toString();
         else
@@ -440,17 +482,16 @@ void ParserResRobot::parseStationsByName(QNetworkReply *networkReply)
     QByteArray allData = networkReply->readAll();
 //    qDebug() << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList stations = doc.value("stopLocationOrCoordLocation").toList();
+    JsonValue stations = doc.value("stopLocationOrCoordLocation");
     StationsList result;
-    foreach (QVariant stationData, stations) {
-        const QVariantMap& ss = stationData.toMap();
-        QVariantMap station = ss["StopLocation"].toMap() ;
+    foreach (const JsonValue& ss, stations) {
+        JsonValue station = ss.value("StopLocation");
         Station s;
         s.id = station.value("extId").toString();
         s.name = station.value("name").toString();
@@ -467,18 +508,17 @@ void ParserResRobot::parseStationsByCoordinates(QNetworkReply *networkReply)
     QByteArray allData = networkReply->readAll();
 //    qDebug() << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList stations = doc.value("stopLocationOrCoordLocation").toList();
-    //QVariantList stations = doc.value("StopLocation").toList();
+    JsonValue stations = doc.value("stopLocationOrCoordLocation");
+    //JsonValue stations = doc.value("StopLocation");
     StationsList result;
-    foreach (QVariant stationData, stations) {
-        const QVariantMap& ss = stationData.toMap();
-        QVariantMap station = ss["StopLocation"].toMap() ;
+    foreach (const JsonValue& ss, stations) {
+        JsonValue station = ss.value("StopLocation");
         Station s;
         s.id = station.value("extId").toString();
         s.name = station.value("name").toString();
@@ -495,7 +535,7 @@ void ParserResRobot::parseSearchJourney(QNetworkReply *networkReply)
     QByteArray allData = networkReply->readAll();
 //    qDebug() << "Reply:\n" << allData;
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
@@ -504,7 +544,7 @@ void ParserResRobot::parseSearchJourney(QNetworkReply *networkReply)
     searchEarlierReference = doc.value("scrB").toString();
     searchLaterReference = doc.value("scrF").toString();
 
-    QVariantList journeyListData = doc.value("Trip").toList();
+    JsonValue journeyListData = doc.value("Trip");
 
 /*  The meta Origina and dest are now here as of 2.1 vers.
     QVariantMap dest =journeyListData[0].toMap() ;
@@ -518,9 +558,9 @@ void ParserResRobot::parseSearchJourney(QNetworkReply *networkReply)
     JourneyResultList *journeyList = new JourneyResultList();
 
     int journeyCounter = 0;
-    foreach (QVariant journeyData, journeyListData) {
+    foreach (const JsonValue& journeyData, journeyListData) {
         QString journeyID = QString::number(journeyCounter);
-        QList<JourneyDetailResultItem*> segments = parseJourneySegments(journeyData.toMap());
+        QList<JourneyDetailResultItem*> segments = parseJourneySegments(journeyData);
         if (segments.isEmpty())
             continue;
 
@@ -600,41 +640,40 @@ void ParserResRobot::parseSearchJourney(QNetworkReply *networkReply)
 }
 
 // Parse info about one journey option. Store detailed info about segments for later use.
-QList<JourneyDetailResultItem*> ParserResRobot::parseJourneySegments(const QVariantMap &journeyData)
+QList<JourneyDetailResultItem*> ParserResRobot::parseJourneySegments(const JsonValue &journeyData)
 {
     QList<JourneyDetailResultItem*> results;
 
-    QVariantList segments = journeyData.value("LegList").toMap().value("Leg").toList();
-    foreach (QVariant segmentData, segments)
+    JsonValue segments = journeyData.value("LegList").value("Leg");
+    foreach (const JsonValue& segment, segments)
     {
-        const QVariantMap& segment = segmentData.toMap();
         JourneyDetailResultItem* resultItem = new JourneyDetailResultItem;
 
         // Departure
-        QVariantMap departure = segment.value("Origin").toMap();
+        JsonValue departure = segment.value("Origin");
         resultItem->setDepartureStation(departure.value("name").toString());
         QDateTime departureDateTime;
-        departureDateTime.setDate(QDate::fromString(departure.value("date").toString(), "yyyy-MM-dd"));
-        departureDateTime.setTime(QTime::fromString(departure.value("time").toString(), "hh:mm:ss"));
+        departureDateTime.setDate(ParserDateTime::dateFromIso(departure.value("date").toString()));
+        departureDateTime.setTime(ParserDateTime::timeFromString(departure.value("time").toString()));
         resultItem->setDepartureDateTime(departureDateTime);
 
         // Arrival
-        QVariantMap arrival = segment.value("Destination").toMap();
+        JsonValue arrival = segment.value("Destination");
         resultItem->setArrivalStation(arrival.value("name").toString());
         QDateTime arrivalDateTime;
-        arrivalDateTime.setDate(QDate::fromString(arrival.value("date").toString(), "yyyy-MM-dd"));
-        arrivalDateTime.setTime(QTime::fromString(arrival.value("time").toString(), "hh:mm:ss"));
+        arrivalDateTime.setDate(ParserDateTime::dateFromIso(arrival.value("date").toString()));
+        arrivalDateTime.setTime(ParserDateTime::timeFromString(arrival.value("time").toString()));
         resultItem->setArrivalDateTime(arrivalDateTime);
 
         QStringList info;
 
         // Notes
         if (segment.contains("Notes")) {
-            QVariantList notes = segment.value("Notes").toMap().value("Note").toList();
-            foreach (QVariant note, notes) {
-                QString hafasDescription(hafasAttribute(note.toMap().value("key").toString()));
+            JsonValue notes = segment.value("Notes").value("Note");
+            foreach (const JsonValue& note, notes) {
+                QString hafasDescription(hafasAttribute(note.value("key").toString()));
                 if (hafasDescription.isEmpty())
-                    info.append(note.toMap().value("value").toString());
+                    info.append(note.value("value").toString());
                 else
                     info.append(hafasDescription);
             }
@@ -650,7 +689,7 @@ QList<JourneyDetailResultItem*> ParserResRobot::parseJourneySegments(const QVari
             resultItem->setInternalData1("WALK");
             resultItem->setTrain(tr("Walk"));
         } else if (transportMainType == "JNY") {
-            QVariantMap product = segment.value("Product").toList()[0].toMap();
+            JsonValue product = segment.value("Product").at(0);
             QString transportType = transportMode(product.value("catOutS").toString(),
                                                            product.value("catOutL").toString());
 
@@ -713,18 +752,25 @@ void ParserResRobot::parseJourneyDetails(QNetworkReply *networkReply)
 
 QString ParserResRobot::hafasAttribute(const QString& code)
 {
-    if (hafasAttributes.contains(code))
-        return hafasAttributes[code];
+    if (const Translation *attribute = findCode(hafasAttributes, code))
+        return tr(attribute->text);
     else
         return "";
 }
 
 QString ParserResRobot::transportMode(const QString& code, const QString& fallback)
 {
-    if (specificTransportModes.contains(code)) {
-        return specificTransportModes[code];
-    } else if (code.size() >= 1 && generalTransportModes.contains(code.left(1))) {
-        return generalTransportModes[code.left(1)];
+    const TransportMode *mode = findCode(specificTransportModes, code);
+    const Translation *generalMode = mode ? 0 : findCode(generalTransportModes, code.left(1));
+    if (mode) {
+        QString name = mode->translate ? tr(mode->name) : QString::fromUtf8(mode->name);
+        if (mode->arg1)
+            name = name.arg(tr(mode->arg1));
+        if (mode->arg2)
+            name = name.arg(tr(mode->arg2));
+        return name;
+    } else if (generalMode) {
+        return tr(generalMode->text);
     } else {
         qDebug() << "Didn't find transport mode" << code << ", falling back to " << fallback;
         return fallback;
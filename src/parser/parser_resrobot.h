@@ -121,17 +121,13 @@ private:
     const QString timetableAPIVersion;
     const QString journeyAPIVersion;
     QMap<QString, JourneyDetailResultList*> cachedResults;
-    QHash<QString, QString> hafasAttributes;
-    QHash<QString, QString> specificTransportModes;
-    QHash<QString, QString> generalTransportModes;
-    QHash<QString, QString> transportModeStrings;
 
 #if defined(BUILD_FOR_QT5)
     virtual void doSearchJourney(QUrlQuery query);
 #else
     virtual void doSearchJourney(QUrl query);
 #endif
-    QList<JourneyDetailResultItem*> parseJourneySegments(const QVariantMap &journeyData);
+    QList<JourneyDetailResultItem*> parseJourneySegments(const JsonValue &journeyData);
     QString hafasAttribute(const QString& original);
     QString transportMode(const QString &code, const QString &fallback);
     QString formatRestrictions(int restriction);
@@ -21,16 +21,12 @@
 #ifdef BUILD_FOR_QT5
 #include <QUrlQuery>
 #include <QTimeZone>
-#include <QJsonDocument>
-#else
-#include <QScriptEngine>
 #endif
 #include <QLocale>
-#include <QRegExp>
-#include <QVariantMap>
 #include <QFile>
 
 #include "parser_search_ch.h"
+#include "parser_datetime.h"
 
 using namespace parser_search_ch;
 
@@ -38,11 +34,11 @@ using namespace parser_search_ch;
  * TimetableRow Class
  */
 
-TimetableRow::TimetableRow(const QVariantMap& stop)
+TimetableRow::TimetableRow(const JsonValue& stop)
     : stop(stop)
 {
-    const QVariant& lat = stop.value("lat");
-    const QVariant& lon = stop.value("lon");
+    const JsonValue& lat = stop.value("lat");
+    const JsonValue& lon = stop.value("lon");
 
     if (!lon.isNull() && !lat.isNull()) {
         timetable.latitude = lat.toDouble();
@@ -50,23 +46,23 @@ TimetableRow::TimetableRow(const QVariantMap& stop)
     }
 }
 
-void TimetableRow::load(const QVariantMap& departure)
+void TimetableRow::load(const JsonValue& departure, ParserStringPool& strings)
 {
-    const QVariantMap& dest = departure.value("terminal").toMap();
+    const JsonValue& dest = departure.value("terminal");
 
-    timetable.destinationStation = dest.value("name").toString();
+    timetable.destinationStation = strings.intern(dest.value("name").toString());
     timetable.time = ParserSearchCH::tsFromMap(departure, "time").time();
 
-    this->loadTrainType(departure);
+    this->loadTrainType(departure, strings);
     this->loadDelay(departure);
-    this->loadDeparturePlatform(departure);
+    this->loadDeparturePlatform(departure, strings);
 }
 
 void TimetableRow::appendTo(TimetableEntriesList& tt) {
     tt.append(timetable);
 }
 
-void TimetableRow::loadTrainTypeWithoutLine(const QVariant& trainType)
+void TimetableRow::loadTrainTypeWithoutLine(const JsonValue& trainType)
 {
     const QString& type = trainType.toString();
 
@@ -81,10 +77,10 @@ void TimetableRow::loadTrainTypeWithoutLine(const QVariant& trainType)
     }
 }
 
-void TimetableRow::loadTrainType(const QVariantMap& departure)
+void TimetableRow::loadTrainType(const JsonValue& departure, ParserStringPool& strings)
 {
-    const QVariant& line = departure.value("line");
-    const QVariant& type = departure.value("type");
+    const JsonValue& line = departure.value("line");
+    const JsonValue& type = departure.value("type");
 
     if (type.toString() == "bus") {
         timetable.trainType = tr("Bus %1").arg(line.toString());
@@ -97,22 +93,25 @@ void TimetableRow::loadTrainType(const QVariantMap& departure)
     } else {
         timetable.trainType = line.toString();
     }
+
+    // The same lines show up again and again on a departure board
+    timetable.trainType = strings.intern(timetable.trainType);
 }
 
-void TimetableRow::loadDeparturePlatform(const QVariantMap& departure)
+void TimetableRow::loadDeparturePlatform(const JsonValue& departure, ParserStringPool& strings)
 {
-    const QVariant& platform = departure.value("track");
+    const JsonValue& platform = departure.value("track");
 
     if (platform.isNull()) {
-        timetable.currentStation = stop.value("name").toString();
+        timetable.currentStation = strings.intern(stop.value("name").toString());
     } else {
-        timetable.platform = platform.toString();
+        timetable.platform = strings.intern(platform.toString());
     }
 }
 
-void TimetableRow::loadDelay(const QVariantMap& departure)
+void TimetableRow::loadDelay(const JsonValue& departure)
 {
-    const QVariant& delay = departure.value("dep_delay");
+    const JsonValue& delay = departure.value("dep_delay");
 
     if (delay.isNull()) {
         return;
@@ -170,7 +169,7 @@ QString TrainTypeList::toString()
  * Class JourneySegment
  */
 
-JourneySegment::JourneySegment(const QVariantMap& leg, const QVariant& exit)
+JourneySegment::JourneySegment(const JsonValue& leg, const JsonValue& exit)
 {
     this->setDepartureStation(leg.value("name").toString());
     this->setDirection(leg.value("terminal").toString());
@@ -178,24 +177,24 @@ JourneySegment::JourneySegment(const QVariantMap& leg, const QVariant& exit)
     this->loadDepartureTrack(leg);
     this->loadDelay(leg);
     this->loadTrainType(leg);
-    this->loadExit(leg, exit.toMap());
+    this->loadExit(leg, exit);
 
 //  this->setInternalData1("UNUSED");
 //  this->setInternalData2("UNUSED");
 }
 
-void JourneySegment::loadDepartureTrack(const QVariantMap& leg)
+void JourneySegment::loadDepartureTrack(const JsonValue& leg)
 {
-    const QVariant& track = leg.value("track");
+    const JsonValue& track = leg.value("track");
 
     if (!track.isNull()) {
         this->setDepartureInfo(tr("Track %1").arg(track.toString()));
     }
 }
 
-void JourneySegment::loadDelay(const QVariantMap& leg)
+void JourneySegment::loadDelay(const JsonValue& leg)
 {
-    const QVariant& delay = leg.value("dep_delay");
+    const JsonValue& delay = leg.value("dep_delay");
 
     if (!delay.isNull()) {
         if (delay.toString() == "X") {
@@ -207,10 +206,10 @@ void JourneySegment::loadDelay(const QVariantMap& leg)
     }
 }
 
-void JourneySegment::loadTrainType(const QVariantMap& leg)
+void JourneySegment::loadTrainType(const JsonValue& leg)
 {
-    const QVariant& line(leg.value("line"));
-    const QVariant& type(leg.value("type"));
+    const JsonValue& line(leg.value("line"));
+    const JsonValue& type(leg.value("type"));
 
     if (line.toString() == "Bus") {
         this->setTrain(tr("Bus"));
@@ -229,11 +228,11 @@ void JourneySegment::loadTrainType(const QVariantMap& leg)
     }
 }
 
-void JourneySegment::loadExit(const QVariantMap& leg, const QVariantMap& exit)
+void JourneySegment::loadExit(const JsonValue& leg, const JsonValue& exit)
 {
     this->setArrivalStation(exit.value("name").toString());
 
-    const QVariant& track = exit.value("track");
+    const JsonValue& track = exit.value("track");
     if (!track.isNull()) {
         this->setArrivalInfo(tr("Track %1").arg(track.toString()));
     }
@@ -253,53 +252,52 @@ JourneyConnection::JourneyConnection(int id)
 //  this->setInternalData2("UNUSED");
 }
 
-void JourneyConnection::load(const QVariantMap &dataRow)
+void JourneyConnection::load(const JsonValue& dataRow, ParserStringPool& strings)
 {
     this->departure = ParserSearchCH::tsFromMap(dataRow, "departure");
     this->arrival = ParserSearchCH::tsFromMap(dataRow, "arrival");
-    legs = dataRow.value("legs").toList();
-    const QVariant& delay = dataRow.value("dep_delay");
+    legs = dataRow.value("legs");
+    const JsonValue& delay = dataRow.value("dep_delay");
 
     this->setDate(this->departure.date());
     this->loadDepartureTime(departure, dataRow.value("dep_delay"));
     this->loadArrivalTime(arrival, dataRow.value("arr_delay"));
     this->loadDuration(dataRow.value("duration"));
-    this->loadTrainTypes(legs);
+    this->loadTrainTypes(legs, strings);
     this->countTransfers(legs);
     this->checkIfCancelled(delay);
 }
 
 void JourneyConnection::loadDepartureTime(const QDateTime& ts,
-        const QVariant& delay)
+        const JsonValue& delay)
 {
     JourneyConnectionTime dep(ts, delay);
     this->setDepartureTime(dep.toString());
 }
 
 void JourneyConnection::loadArrivalTime(const QDateTime& ts,
-        const QVariant& delay)
+        const JsonValue& delay)
 {
     JourneyConnectionTime arr(ts, delay);
     this->setArrivalTime(arr.toString());
 }
 
-void JourneyConnection::loadDuration(const QVariant& duration)
+void JourneyConnection::loadDuration(const JsonValue& duration)
 {
     int min = duration.toInt() / 60;
     this->setDuration(QString("%1:%2").arg(min/60).arg(min%60,2,10,QChar('0')));
 }
 
-void JourneyConnection::loadTrainTypes(const QVariantList& legs)
+void JourneyConnection::loadTrainTypes(const JsonValue& legs, ParserStringPool& strings)
 {
     TrainTypeList types;
 
-    Q_FOREACH (const QVariant& leg, legs) {
-        const QVariantMap& details = leg.toMap();
-        const QVariant& trainType = details.value("*G");
+    Q_FOREACH (const JsonValue& leg, legs) {
+        const JsonValue& trainType = leg.value("*G");
 
         if (trainType.isNull()) {
-            const QVariant& time = details.value("runningtime");
-            const QVariant& type = details.value("type");
+            const JsonValue& time = leg.value("runningtime");
+            const JsonValue& type = leg.value("type");
 
             if ((type.toString() == "walk") && time.toInt() > 600) {
                 types.append(tr("Walk"));
@@ -309,16 +307,15 @@ void JourneyConnection::loadTrainTypes(const QVariantList& legs)
         }
     }
 
-    this->setTrainType(types.toString());
+    this->setTrainType(strings.intern(types.toString()));
 }
 
-void JourneyConnection::countTransfers(const QVariantList& legs)
+void JourneyConnection::countTransfers(const JsonValue& legs)
 {
     int transfers = 0;
 
-    Q_FOREACH (const QVariant& leg, legs) {
-        const QVariantMap& details = leg.toMap();
-        const QVariant& type = details.value("type");
+    Q_FOREACH (const JsonValue& leg, legs) {
+        const JsonValue& type = leg.value("type");
 
         if (!type.isNull()) {
             if (type.toString() == "walk") {
@@ -333,7 +330,7 @@ void JourneyConnection::countTransfers(const QVariantList& legs)
     }
 }
 
-void JourneyConnection::checkIfCancelled(const QVariant& dep_delay)
+void JourneyConnection::checkIfCancelled(const JsonValue& dep_delay)
 {
     if (!dep_delay.isNull()) {
         if (dep_delay.toString() == "X") {
@@ -367,9 +364,8 @@ JourneyConnectionDetails::JourneyConnectionDetails(JourneyConnection* con,
 
 void JourneyConnectionDetails::loadSegments(JourneyConnection* con)
 {
-    Q_FOREACH (const QVariant& row, con->legs) {
-        const QVariantMap& leg(row.toMap());
-        const QVariant& exit(leg.value("exit"));
+    Q_FOREACH (const JsonValue& leg, con->legs) {
+        const JsonValue& exit(leg.value("exit"));
 
         /* The last segment (arrival) has no exit, skip it */
         if (exit.isNull()) {
@@ -385,7 +381,7 @@ void JourneyConnectionDetails::loadSegments(JourneyConnection* con)
  */
 
 JourneyConnectionTime::JourneyConnectionTime(const QDateTime& dateTime,
-        const QVariant& delayValue)
+        const JsonValue& delayValue)
     : ts(dateTime), delay(delayValue) {}
 
 QString JourneyConnectionTime::toString()
@@ -497,29 +493,6 @@ void ParserSearchCH::addRestrictionsToQuery(QUrl& query, int restrictions)
     }
 }
 
-/* Inspired by ParserAbstract::parseJson */
-QVariantList ParserSearchCH::parseJsonList(const QByteArray &json) const
-{
-    QVariantList doc;
-#ifdef BUILD_FOR_QT5
-    doc = QJsonDocument::fromJson(json).toVariant().toList();
-#else
-    QString utf8(QString::fromUtf8(json));
-
-    // Validation of JSON according to RFC 4627, section 6
-    QString tmp(utf8);
-    if (tmp.replace(QRegExp("\"(\\\\.|[^\"\\\\])*\""), "")
-           .contains(QRegExp("[^,:{}\\[\\]0-9.\\-+Eaeflnr-u \\n\\r\\t]")))
-        return doc;
-
-    QScriptEngine *engine = new QScriptEngine();
-    doc = engine->evaluate("(" + utf8 + ")").toVariant().toList();
-    delete engine;
-#endif
-
-    return doc;
-}
-
 void ParserSearchCH::sendRequest(QUrl url)
 {
     QList<QPair<QByteArray,QByteArray> > additionalHeaders;
@@ -529,14 +502,9 @@ void ParserSearchCH::sendRequest(QUrl url)
     sendHttpRequest(url, NULL, additionalHeaders);
 }
 
-QDateTime ParserSearchCH::tsFromMap(const QVariantMap& map, const QString& key)
+QDateTime ParserSearchCH::tsFromMap(const JsonValue& map, const QString& key)
 {
-    QString departure = map.value(key).toString();
-    QDateTime dt = QDateTime::fromString(departure, "yyyy-MM-dd HH:mm:ss");
-#ifdef BUILD_FOR_QT5
-    dt.setTimeZone(QTimeZone("Europe/Zurich"));
-#endif
-    return dt.toLocalTime();
+    return ParserDateTime::fromIso(map.value(key).toString(), "Europe/Zurich");
 }
 
 
@@ -600,13 +568,13 @@ void ParserSearchCH::findStationsByCoordinates(qreal longitude, qreal latitude)
     sendRequest(url);
 }
 
-void ParserSearchCH::parseStationRow(StationsList& rows, const QVariantMap& row)
+void ParserSearchCH::parseStationRow(StationsList& rows, const JsonValue& row)
 {
-    const QVariant& icon = row.value("iconclass");
-    const QVariant& label = row.value("label");
-    const QVariant& id = row.value("id");
-    const QVariant& lon = row.value("lon");
-    const QVariant& lat = row.value("lat");
+    const JsonValue& icon = row.value("iconclass");
+    const JsonValue& label = row.value("label");
+    const JsonValue& id = row.value("id");
+    const JsonValue& lon = row.value("lon");
+    const JsonValue& lat = row.value("lat");
 
     /* Ignore street addresses */
     if ((icon.toString() == "sl-icon-type-adr") ||
@@ -647,9 +615,9 @@ void ParserSearchCH::parseStationRow(StationsList& rows, const QVariantMap& row)
     {
         const QString& name = label.toString();
         s.name = name;
-        s.id = id;
-        s.latitude = lat.toReal();
-        s.longitude = lon.toReal();
+        s.id = id.toVariant();
+        s.latitude = lat.toDouble();
+        s.longitude = lon.toDouble();
         rows.append(s);
     }
 }
@@ -658,7 +626,7 @@ void ParserSearchCH::parseStations(QNetworkReply *networkReply)
 {
     QByteArray allData(networkReply->readAll());
 
-    QVariantList stations = parseJsonList(allData);
+    JsonValue stations = parseJson(allData);
     if (stations.isEmpty()) {
         qDebug() << "Invalid reply:" << allData;
         emit errorOccured(tr("Cannot parse reply from the server"));
@@ -666,8 +634,8 @@ void ParserSearchCH::parseStations(QNetworkReply *networkReply)
     }
 
     StationsList results;
-    Q_FOREACH (const QVariant& featureData, stations) {
-        parseStationRow(results, featureData.toMap());
+    Q_FOREACH (const JsonValue& featureData, stations) {
+        parseStationRow(results, featureData);
     }
 
     emit stationsResult(results);
@@ -707,7 +675,7 @@ void ParserSearchCH::getTimeTableForStation(const Station &station,
     QUrl query;
 #endif
     query.addQueryItem("stop", station.name);
-    query.addQueryItem("limit", "15");
+    query.addQueryItem("limit", dataSaverEnabled() ? "8" : "15");
     query.addQueryItem("date", when.toString("yyyy-MM-dd"));
     query.addQueryItem("time", when.toString("hh:mm"));
     query.addQueryItem("show_tracks", "1");
@@ -733,19 +701,19 @@ void ParserSearchCH::parseTimeTable(QNetworkReply *networkReply)
     TimetableEntriesList timetable;
     QByteArray allData(networkReply->readAll());
 
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
     if (doc.isEmpty()) {
         qDebug() << "Invalid reply:" << allData;
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    const QVariantMap& stop = doc.value("stop").toMap();
-    const QVariantList departures = doc.value("connections").toList();
+    const JsonValue& stop = doc.value("stop");
+    const JsonValue departures = doc.value("connections");
 
-    Q_FOREACH (const QVariant& row, departures) {
+    Q_FOREACH (const JsonValue& row, departures) {
         TimetableRow entry(stop);
-        entry.load(row.toMap());
+        entry.load(row, responseStrings);
         entry.appendTo(timetable);
     }
 
@@ -802,7 +770,7 @@ void ParserSearchCH::searchJourney(const Station &from, const Station &via,
 
         // When searching by departure, only show entries after the given time.
         query.addQueryItem("pre", "0");
-        query.addQueryItem("num", "8");
+        query.addQueryItem("num", dataSaverEnabled() ? "4" : "8");
     }
 
 #if defined(BUILD_FOR_QT5)
@@ -819,24 +787,26 @@ void ParserSearchCH::parseSearchJourney(QNetworkReply *networkReply)
     JourneySearchResult *result = new JourneySearchResult(lastJourneySearch);
     QByteArray jsonData(networkReply->readAll());
 
-    QVariantMap doc = parseJson(jsonData);
+    JsonValue doc = parseJson(jsonData);
     if (doc.isEmpty()) {
         qDebug() << "Invalid reply:" << jsonData;
         emit errorOccured(tr("Cannot parse reply from the server"));
         return;
     }
 
-    QVariantList rows = doc.value("connections").toList();
+    const JsonValue rows = doc.value("connections");
 
     while (!details.isEmpty()) {
         delete details.takeFirst();
     }
+    connections.clear();
 
-    Q_FOREACH (const QVariant& row, rows) {
+    Q_FOREACH (const JsonValue& row, rows) {
         JourneyConnection* conn = new JourneyConnection(result->itemcount());
-        conn->load(row.toMap());
+        conn->load(row, responseStrings);
 
-        details.append(new JourneyConnectionDetails(conn, lastJourneySearch));
+        connections.append(row);
+        details.append(NULL);
         result->appendItem(conn);
     }
 
@@ -848,7 +818,12 @@ void ParserSearchCH::getJourneyDetails(const QString &id)
 {
     int i = id.toInt();
 
-    if (details.length() > i) {
+    if (i >= 0 && details.length() > i) {
+        if (!details[i]) {
+            JourneyConnection conn(i);
+            conn.load(connections[i], responseStrings);
+            details[i] = new JourneyConnectionDetails(&conn, lastJourneySearch);
+        }
         emit journeyDetailsResult(details[i]);
     } else {
         emit errorOccured(tr("No journey details found."));
@@ -859,10 +834,9 @@ void ParserSearchCH::searchJourneyLater()
 {
     QDateTime nextQueryTime;
 
-    if (details.length() > 0) {
+    if (connections.length() > 0) {
         // last search found something, skip 1 minute ahead from last result
-        JourneyDetailResultList* result = details.last();
-        nextQueryTime = result->departureDateTime().addSecs(60);
+        nextQueryTime = tsFromMap(connections.last(), "departure").addSecs(60);
     } else {
         // last search found nothing, skip 1 hour ahead from search time
         nextQueryTime = lastJourneySearch.when.addSecs(3600);
@@ -877,10 +851,9 @@ void ParserSearchCH::searchJourneyEarlier()
 {
     QDateTime nextQueryTime;
 
-    if (details.length() > 0) {
+    if (connections.length() > 0) {
         // last search found something, skip 1 minute ahead from first result
-        JourneyDetailResultList* result = details.first();
-        nextQueryTime = result->arrivalDateTime().addSecs(-60);
+        nextQueryTime = tsFromMap(connections.first(), "arrival").addSecs(-60);
     } else {
         // last search found nothing, skip 1 hour ahead from search time
         nextQueryTime = lastJourneySearch.when.addSecs(-3600);
@@ -14,15 +14,15 @@ namespace parser_search_ch
         Q_OBJECT
 
         public:
-            TimetableRow(const QVariantMap& stop);
-            void load(const QVariantMap& departure);
+            TimetableRow(const JsonValue& stop);
+            void load(const JsonValue& departure, ParserStringPool& strings);
             void appendTo(TimetableEntriesList& tt);
         private:
-            const QVariantMap& stop;
-            void loadTrainType(const QVariantMap& departure);
-            void loadTrainTypeWithoutLine(const QVariant& trainType);
-            void loadDelay(const QVariantMap& departure);
-            void loadDeparturePlatform(const QVariantMap&);
+            const JsonValue& stop;
+            void loadTrainType(const JsonValue& departure, ParserStringPool& strings);
+            void loadTrainTypeWithoutLine(const JsonValue& trainType);
+            void loadDelay(const JsonValue& departure);
+            void loadDeparturePlatform(const JsonValue&, ParserStringPool& strings);
 
             TimetableEntry timetable;
     };
@@ -62,18 +62,18 @@ namespace parser_search_ch
     {
         public:
             JourneyConnection(int id);
-            void load(const QVariantMap&);
+            void load(const JsonValue&, ParserStringPool& strings);
         private:
             QDateTime departure;
             QDateTime arrival;
-            QVariantList legs;
-
-            void loadDepartureTime(const QDateTime&, const QVariant& delay);
-            void loadArrivalTime(const QDateTime&, const QVariant& delay);
-            void loadDuration(const QVariant&);
-            void loadTrainTypes(const QVariantList&);
-            void countTransfers(const QVariantList&);
-            void checkIfCancelled(const QVariant& dep_delay);
+            JsonValue legs;
+
+            void loadDepartureTime(const QDateTime&, const JsonValue& delay);
+            void loadArrivalTime(const QDateTime&, const JsonValue& delay);
+            void loadDuration(const JsonValue&);
+            void loadTrainTypes(const JsonValue&, ParserStringPool& strings);
+            void countTransfers(const JsonValue&);
+            void checkIfCancelled(const JsonValue& dep_delay);
             friend class JourneyConnectionDetails;
     };
 
@@ -88,23 +88,23 @@ namespace parser_search_ch
     class JourneyConnectionTime
     {
         public:
-            JourneyConnectionTime(const QDateTime& time, const QVariant& delay);
+            JourneyConnectionTime(const QDateTime& time, const JsonValue& delay);
             QString toString();
         private:
             const QDateTime& ts;
-            const QVariant& delay;
+            const JsonValue& delay;
     };
 
     class JourneySegment : public JourneyDetailResultItem
     {
         Q_OBJECT
         public:
-            JourneySegment(const QVariantMap& leg, const QVariant& exit);
+            JourneySegment(const JsonValue& leg, const JsonValue& exit);
         private:
-            void loadTrainType(const QVariantMap& leg);
-            void loadExit(const QVariantMap& leg, const QVariantMap& exit);
-            void loadDelay(const QVariantMap& leg);
-            void loadDepartureTrack(const QVariantMap& leg);
+            void loadTrainType(const JsonValue& leg);
+            void loadExit(const JsonValue& leg, const JsonValue& exit);
+            void loadDelay(const JsonValue& leg);
+            void loadDepartureTrack(const JsonValue& leg);
     };
 }
 
@@ -116,7 +116,7 @@ public:
     static QString getName() { return QString("%1 (timetable.search.ch)").arg(tr("Switzerland")); }
     virtual QString name() { return getName(); }
     virtual QString shortName() { return "search.ch"; }
-    static QDateTime tsFromMap(const QVariantMap& map, const QString& key);
+    static QDateTime tsFromMap(const JsonValue& map, const QString& key);
 
 public slots:
     virtual bool supportsGps();
@@ -148,21 +148,23 @@ protected:
     virtual void searchJourneyEarlier();
     virtual void sendRequest(QUrl url);
 
+    // Connections of the last search, details[i] is only built from
+    // connections[i] once journey i is opened and stays 0 until then.
+    QList<JsonValue> connections;
     QList<JourneyDetailResultList*> details;
     parser_search_ch::JourneySearch lastJourneySearch;
 
 private:
-    QVariantList parseJsonList(const QByteArray &json) const;
 #if defined(BUILD_FOR_QT5)
     void addRestrictionsToQuery(QUrlQuery&, int);
 #else
     void addRestrictionsToQuery(QUrl&, int);
 #endif
-    void parseStationRow(StationsList& results, const QVariantMap& properties);
-    void setTTTrainTypeWithoutLine(TimetableEntry&, const QVariant&);
-    void setTTDepartureGPSPosition(TimetableEntry&, const QVariantMap&);
-    void setTTDeparturePlatform(TimetableEntry&, const QVariantMap&, const QVariantMap&);
-    void setTTDelay(TimetableEntry&, const QVariantMap&);
+    void parseStationRow(StationsList& results, const JsonValue& properties);
+    void setTTTrainTypeWithoutLine(TimetableEntry&, const JsonValue&);
+    void setTTDepartureGPSPosition(TimetableEntry&, const JsonValue&);
+    void setTTDeparturePlatform(TimetableEntry&, const JsonValue&, const JsonValue&);
+    void setTTDelay(TimetableEntry&, const JsonValue&);
 };
 
 #endif
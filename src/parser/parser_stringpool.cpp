@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#include "parser_stringpool.h"
+
+ParserStringPool::ParserStringPool(int maxSize)
+    : m_maxSize(maxSize)
+{
+}
+
+QString ParserStringPool::intern(const QString &string)
+{
+    if (string.isEmpty())
+        return string;
+
+    const uint key = hash(string.unicode(), string.size());
+    for (QMultiHash<uint, QString>::const_iterator it = m_strings.constFind(key); it != m_strings.constEnd() && it.key() == key; ++it) {
+        if (it.value() == string)
+            return it.value();
+    }
+
+    if (m_maxSize > 0 && m_strings.size() >= m_maxSize)
+        m_strings.clear();
+    m_strings.insert(key, string);
+    return string;
+}
+
+QString ParserStringPool::intern(const QStringRef &string)
+{
+    if (string.isEmpty())
+        return string.toString();
+
+    const uint key = hash(string.unicode(), string.size());
+    for (QMultiHash<uint, QString>::const_iterator it = m_strings.constFind(key); it != m_strings.constEnd() && it.key() == key; ++it) {
+        if (it.value() == string)
+            return it.value();
+    }
+
+    const QString copy = string.toString();
+    if (m_maxSize > 0 && m_strings.size() >= m_maxSize)
+        m_strings.clear();
+    m_strings.insert(key, copy);
+    return copy;
+}
+
+QString ParserStringPool::internSimplified(const QStringRef &string)
+{
+    if (isSimplified(string))
+        return intern(string);
+    return intern(string.toString().simplified());
+}
+
+int ParserStringPool::size() const
+{
+    return m_strings.size();
+}
+
+void ParserStringPool::clear()
+{
+    m_strings.clear();
+}
+
+// FNV-1a over the UTF-16 code units, works on QStringRef without a copy
+uint ParserStringPool::hash(const QChar *unicode, int size)
+{
+    uint h = 2166136261u;
+    for (int i = 0; i < size; ++i) {
+        h ^= unicode[i].unicode();
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Same rules as QString::simplified(): no whitespace at either end and
+// only single spaces inside
+bool ParserStringPool::isSimplified(const QStringRef &string)
+{
+    const QChar *unicode = string.unicode();
+    const int size = string.size();
+    if (size > 0 && (unicode[0].isSpace() || unicode[size - 1].isSpace()))
+        return false;
+    for (int i = 1; i < size; ++i) {
+        if (unicode[i].isSpace() && (unicode[i] != QLatin1Char(' ') || unicode[i - 1].isSpace()))
+            return false;
+    }
+    return true;
+}
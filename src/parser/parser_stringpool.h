@@ -0,0 +1,58 @@
+/****************************************************************************
+**
+**  This file is a part of Fahrplan.
+**
+**  This program is free software; you can redistribute it and/or modify
+**  it under the terms of the GNU General Public License as published by
+**  the Free Software Foundation; either version 2 of the License, or
+**  (at your option) any later version.
+**
+**  This program is distributed in the hope that it will be useful,
+**  but WITHOUT ANY WARRANTY; without even the implied warranty of
+**  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+**  GNU General Public License for more details.
+**
+**  You should have received a copy of the GNU General Public License along
+**  with this program.  If not, see <https://www.gnu.org/licenses/>.
+**
+****************************************************************************/
+
+
+#ifndef PARSER_STRINGPOOL_H
+#define PARSER_STRINGPOOL_H
+
+#include <QMultiHash>
+#include <QString>
+#include <QStringRef>
+
+// Hands out one shared copy of equal strings. Station names, train types
+// and platforms repeat many times within a reply; interning them makes the
+// results share their data instead of keeping a buffer per occurrence.
+//
+// Interning a QStringRef only allocates for strings not seen before, so
+// parsers reading with QXmlStreamReader can skip the copy altogether.
+// With a maximum size the pool starts over once it has grown beyond it,
+// which keeps pools living for a whole session bounded.
+class ParserStringPool
+{
+public:
+    explicit ParserStringPool(int maxSize = 0);
+
+    QString intern(const QString &string);
+    QString intern(const QStringRef &string);
+    // Interns string.simplified(), copying only when the string still
+    // needs simplifying or was not seen before
+    QString internSimplified(const QStringRef &string);
+
+    int size() const;
+    void clear();
+
+private:
+    QMultiHash<uint, QString> m_strings;
+    int m_maxSize;
+
+    static uint hash(const QChar *unicode, int size);
+    static bool isSimplified(const QStringRef &string);
+};
+
+#endif // PARSER_STRINGPOOL_H
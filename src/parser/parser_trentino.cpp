@@ -20,15 +20,12 @@
 #include <QUrl>
 #include <QUrlQuery>
 #include <QTimeZone>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonObject>
 #include <QLocale>
-#include <QRegExp>
 #include <QNetworkRequest>
 #include <QTimer>
 
 #include "parser_trentino.h"
+#include "parser_datetime.h"
 
 // Taken from Muoversi in Trentino Android app
 static const QString BASE_URL = "https://app-tpl.tndigit.it/gtlservice";
@@ -77,29 +74,23 @@ void ParserTrentinoTrasporti::sendRequest(QUrl url)
     sendHttpRequest(url, NULL, headers);
 }
 
-QVariantList ParserTrentinoTrasporti::parseJsonList(const QByteArray &json) const
-{
-    return QJsonDocument::fromJson(json).array().toVariantList();
-}
-
-void ParserTrentinoTrasporti::parseStationRow(StationsList& results, const QVariantMap& props)
+void ParserTrentinoTrasporti::parseStationRow(StationsList& results, const JsonValue& props)
 {
     Station s;
-    s.id = props.value("stopId");
+    s.id = props.value("stopId").toVariant();
     s.name = props.value("stopName").toString();
-    s.latitude = props.value("stopLat").toReal();
-    s.longitude = props.value("stopLon").toReal();
+    s.latitude = props.value("stopLat").toDouble();
+    s.longitude = props.value("stopLon").toDouble();
 
     QString town = props.value("town").toString();
     if (!town.isEmpty()) {
         s.miscInfo = town;
     }
 
-    const QVariantList routes = props.value("routes").toList();
     bool hasTrain = false;
     bool hasCableway = false;
-    Q_FOREACH (const QVariant& r, routes) {
-        int rt = r.toMap().value("routeType").toInt();
+    Q_FOREACH (const JsonValue& r, props.value("routes")) {
+        int rt = r.value("routeType").toInt();
         if (rt == 2) {
             hasTrain = true;
         } else if (rt == 5) {
@@ -192,7 +183,7 @@ void ParserTrentinoTrasporti::parseStationsByName(QNetworkReply *networkReply)
 {
     QByteArray allData(networkReply->readAll());
 
-    QVariantList stations = parseJsonList(allData);
+    JsonValue stations = parseJson(allData);
     if (stations.isEmpty()) {
         qDebug() << "Invalid reply:" << allData;
         emit errorOccured(tr("Cannot parse reply from the server"));
@@ -201,8 +192,8 @@ void ParserTrentinoTrasporti::parseStationsByName(QNetworkReply *networkReply)
 
     if (!m_stopsLoaded) {
         m_allStops.clear();
-        Q_FOREACH (const QVariant& featureData, stations) {
-            parseStationRow(m_allStops, featureData.toMap());
+        Q_FOREACH (const JsonValue& featureData, stations) {
+            parseStationRow(m_allStops, featureData);
         }
         m_stopsLoaded = true;
     }
@@ -221,7 +212,7 @@ void ParserTrentinoTrasporti::parseStationsByCoordinates(QNetworkReply *networkR
 {
     QByteArray allData(networkReply->readAll());
 
-    QVariantList stations = parseJsonList(allData);
+    JsonValue stations = parseJson(allData);
     if (stations.isEmpty()) {
         qDebug() << "Invalid reply:" << allData;
         emit errorOccured(tr("Cannot parse reply from the server"));
@@ -230,8 +221,8 @@ void ParserTrentinoTrasporti::parseStationsByCoordinates(QNetworkReply *networkR
 
     if (!m_stopsLoaded) {
         m_allStops.clear();
-        Q_FOREACH (const QVariant& featureData, stations) {
-            parseStationRow(m_allStops, featureData.toMap());
+        Q_FOREACH (const JsonValue& featureData, stations) {
+            parseStationRow(m_allStops, featureData);
         }
         m_stopsLoaded = true;
     }
@@ -282,10 +273,9 @@ void ParserTrentinoTrasporti::onRoutesReplyFinished()
     }
 
     QByteArray allData = reply->readAll();
-    QVariantList routes = parseJsonList(allData);
+    JsonValue routes = parseJson(allData);
 
-    Q_FOREACH (const QVariant& v, routes) {
-        QVariantMap r = v.toMap();
+    Q_FOREACH (const JsonValue& r, routes) {
         int routeId = r.value("routeId").toInt();
         QString shortName = r.value("routeShortName").toString();
         m_routeNames[routeId] = shortName;
@@ -325,14 +315,14 @@ void ParserTrentinoTrasporti::doGetTimeTableForStation()
 {
     currentRequestState = FahrplanNS::getTimeTableForStationRequest;
 
-    QVariantMap stop = m_stopsById.value(m_timetableStation.id.toInt());
-    QString stopType = stop.value("type", "U").toString();
+    JsonValue stop = m_stopsById.value(m_timetableStation.id.toInt());
+    QString stopType = stop.value("type").toString("U");
 
     QUrl url(BASE_URL + "/trips_new");
     QUrlQuery query;
     query.addQueryItem("stopId", m_timetableStation.id.toString());
     query.addQueryItem("type", stopType);
-    query.addQueryItem("limit", "20");
+    query.addQueryItem("limit", dataSaverEnabled() ? "10" : "20");
     query.addQueryItem("refDateTime", m_timetableDateTime.toUTC().toString(Qt::ISODate));
     url.setQuery(query);
 
@@ -344,7 +334,7 @@ void ParserTrentinoTrasporti::parseTimeTable(QNetworkReply *networkReply)
     TimetableEntriesList timetable;
     QByteArray allData(networkReply->readAll());
 
-    QVariantList trips = parseJsonList(allData);
+    JsonValue trips = parseJson(allData);
     if (trips.isEmpty()) {
         qDebug() << "Invalid reply or empty timetable:" << allData;
         emit errorOccured(tr("No departures found for this station."));
@@ -353,18 +343,16 @@ void ParserTrentinoTrasporti::parseTimeTable(QNetworkReply *networkReply)
 
     int restriction = m_timetableRestrictions;
 
-    Q_FOREACH (const QVariant& v, trips) {
-        QVariantMap trip = v.toMap();
+    const JsonValue stop = m_stopsById.value(m_timetableStation.id.toInt());
 
+    Q_FOREACH (const JsonValue& trip, trips) {
         int routeType = 0;
         int routeId = trip.value("routeId").toInt();
         QString routeName = m_routeNames.value(routeId, "");
 
-        QVariantMap stop = m_stopsById.value(m_timetableStation.id.toInt());
-        const QVariantList routes = stop.value("routes").toList();
-        Q_FOREACH (const QVariant& r, routes) {
-            if (r.toMap().value("routeId").toInt() == routeId) {
-                routeType = r.toMap().value("routeType").toInt();
+        Q_FOREACH (const JsonValue& r, stop.value("routes")) {
+            if (r.value("routeId").toInt() == routeId) {
+                routeType = r.value("routeType").toInt();
                 break;
             }
         }
@@ -395,16 +383,16 @@ void ParserTrentinoTrasporti::parseTimeTable(QNetworkReply *networkReply)
 
         QDateTime dt;
         if (!effectiveTime.isEmpty()) {
-            dt = QDateTime::fromString(effectiveTime, Qt::ISODate);
+            dt = ParserDateTime::fromIso(effectiveTime);
         }
         if (!dt.isValid() && !scheduledTime.isEmpty()) {
-            dt = QDateTime::fromString(scheduledTime, Qt::ISODate);
+            dt = ParserDateTime::fromIso(scheduledTime);
         }
         if (dt.isValid()) {
             entry.time = dt.toLocalTime().time();
         }
 
-        QVariant delay = trip.value("delay");
+        JsonValue delay = trip.value("delay");
         if (!delay.isNull() && delay.toDouble() > 0.0) {
             entry.miscInfo = tr("Delay: %1'").arg(QString::number((int)delay.toDouble()));
         }
@@ -415,15 +403,15 @@ void ParserTrentinoTrasporti::parseTimeTable(QNetworkReply *networkReply)
     emit timetableResult(timetable);
 }
 
-QDateTime ParserTrentinoTrasporti::jodaTimeToQDateTime(const QVariantMap &dt) const
+QDateTime ParserTrentinoTrasporti::jodaTimeToQDateTime(const JsonValue &dt) const
 {
     int year = dt.value("year").toInt();
     int month = dt.value("monthOfYear").toInt();
     int day = dt.value("dayOfMonth").toInt();
     int hour = dt.value("hourOfDay").toInt();
     int minute = dt.value("minuteOfHour").toInt();
-    QTimeZone tz("Europe/Rome");
-    return QDateTime(QDate(year, month, day), QTime(hour, minute), tz).toLocalTime();
+    return QDateTime(QDate(year, month, day), QTime(hour, minute),
+                     ParserDateTime::timeZone("Europe/Rome")).toLocalTime();
 }
 
 void ParserTrentinoTrasporti::searchJourney(const Station &departureStation,
@@ -462,7 +450,7 @@ void ParserTrentinoTrasporti::searchJourney(const Station &departureStation,
 void ParserTrentinoTrasporti::parseSearchJourney(QNetworkReply *networkReply)
 {
     QByteArray allData(networkReply->readAll());
-    QVariantMap doc = parseJson(allData);
+    JsonValue doc = parseJson(allData);
 
     if (doc.isEmpty()) {
         qDebug() << "Invalid reply:" << allData;
@@ -485,15 +473,10 @@ void ParserTrentinoTrasporti::parseSearchJourney(QNetworkReply *networkReply)
         delete m_details.takeFirst();
     }
 
-    QVariantList routes = doc.value("routes").toList();
     int connId = 0;
 
-    Q_FOREACH (const QVariant& routeVar, routes) {
-        QVariantMap route = routeVar.toMap();
-        QVariantList legs = route.value("legs").toList();
-        if (legs.isEmpty()) continue;
-
-        QVariantList steps = legs.first().toMap().value("steps").toList();
+    Q_FOREACH (const JsonValue& route, doc.value("routes")) {
+        const JsonValue steps = route.value("legs").first().value("steps");
         if (steps.isEmpty()) continue;
 
         // Collect transit segments
@@ -510,22 +493,21 @@ void ParserTrentinoTrasporti::parseSearchJourney(QNetworkReply *networkReply)
         };
         QList<TransitStep> transitSteps;
 
-        Q_FOREACH (const QVariant& stepVar, steps) {
-            QVariantMap step = stepVar.toMap();
+        Q_FOREACH (const JsonValue& step, steps) {
             QString travelMode = step.value("travelMode").toString();
             if (travelMode != "TRANSIT") continue;
 
-            QVariantMap td = step.value("transitDetails").toMap();
+            const JsonValue td = step.value("transitDetails");
             TransitStep ts;
-            ts.departureStation = td.value("departureStop").toMap().value("name").toString();
-            ts.arrivalStation = td.value("arrivalStop").toMap().value("name").toString();
-            ts.departureTime = jodaTimeToQDateTime(td.value("departureTime").toMap());
-            ts.arrivalTime = jodaTimeToQDateTime(td.value("arrivalTime").toMap());
-            ts.lineShortName = td.value("line").toMap().value("shortName").toString();
+            ts.departureStation = td.value("departureStop").value("name").toString();
+            ts.arrivalStation = td.value("arrivalStop").value("name").toString();
+            ts.departureTime = jodaTimeToQDateTime(td.value("departureTime"));
+            ts.arrivalTime = jodaTimeToQDateTime(td.value("arrivalTime"));
+            ts.lineShortName = td.value("line").value("shortName").toString();
             ts.headsign = td.value("headsign").toString();
             ts.numStops = td.value("numStops").toInt();
             ts.delay = td.value("delay").toDouble();
-            ts.vehicleType = td.value("line").toMap().value("vehicle").toMap()
+            ts.vehicleType = td.value("line").value("vehicle")
                 .value("type").toString();
             transitSteps.append(ts);
         }
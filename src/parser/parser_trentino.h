@@ -49,13 +49,12 @@ private slots:
 
 private:
   void sendRequest(QUrl url);
-  QVariantList parseJsonList(const QByteArray &json) const;
-  void parseStationRow(StationsList &results, const QVariantMap &props);
+  void parseStationRow(StationsList &results, const JsonValue &props);
   void fetchRoutes();
-  QDateTime jodaTimeToQDateTime(const QVariantMap &dt) const;
+  QDateTime jodaTimeToQDateTime(const JsonValue &dt) const;
 
   QMap<int, QString> m_routeNames;
-  QMap<int, QVariantMap> m_stopsById;
+  QMap<int, JsonValue> m_stopsById;
   StationsList m_allStops;
   bool m_stopsLoaded;
   QString m_lastSearchTerm;
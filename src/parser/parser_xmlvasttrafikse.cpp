@@ -18,6 +18,9 @@
 ****************************************************************************/
 
 #include "parser_xmlvasttrafikse.h"
+#include "fahrplan_network_thread.h"
+#include "parser_datetime.h"
+#include "parser_regexps.h"
 
 #include <QDebug>
 #include <QCoreApplication>
@@ -47,7 +50,6 @@ const char *ParserXmlVasttrafikSe::consumerCredentials = "ZHhONXJGdUpOZ1NfQjltc2
 ParserXmlVasttrafikSe::ParserXmlVasttrafikSe(QObject *parent)
     : ParserAbstract(parent)
 {
-    m_nam = new QNetworkAccessManager(this);
     m_searchJourneyParameters.isValid = false;
     m_timeTableForStationParameters.isValid = false;
     m_stationByNameParameters.isValid = false;
@@ -62,7 +64,6 @@ ParserXmlVasttrafikSe::ParserXmlVasttrafikSe(QObject *parent)
 }
 
 ParserXmlVasttrafikSe::~ParserXmlVasttrafikSe() {
-    delete m_nam;
 }
 
 void ParserXmlVasttrafikSe::getTimeTableForStation(const Station &currentStation, const Station &directionStation, const QDateTime &dateTime, Mode mode, int trainrestrictions)
@@ -337,11 +338,11 @@ void ParserXmlVasttrafikSe::parseTimeTable(QNetworkReply *networkReply)
                 item.trainType = QString::fromLatin1("<span style=\"color:%2; background-color: %3;\">%1</span>").arg(connectionName).arg(fgColor).arg(bgColor);
             else
                 item.trainType = connectionName;
-            const QTime scheduledTime = QTime::fromString(getAttribute(node, "time"), QLatin1String("hh:mm"));
+            const QTime scheduledTime = ParserDateTime::timeFromString(getAttribute(node, "time"));
             item.time = scheduledTime;
             const QString realTimeStr = getAttribute(node, "rtTime");
             if (!realTimeStr.isEmpty()) {
-                const QTime realTimeTime = QTime::fromString(realTimeStr, QLatin1String("hh:mm"));
+                const QTime realTimeTime = ParserDateTime::timeFromString(realTimeStr);
                 const int minutesTo = scheduledTime.msecsTo(realTimeTime) / 60000;
                 if (minutesTo > 3)
                     item.miscInfo = tr("<span style=\"color:#b30;\">%1 min late</span>").arg(minutesTo);
@@ -398,19 +399,19 @@ void ParserXmlVasttrafikSe::parseSearchJourney(QNetworkReply *networkReply)
                 QDomNode originNode = legNode.namedItem("Origin");
                 QDomNode destinationNode = legNode.namedItem("Destination");
                 if (j == 0) {
-                    journeyStart.setDate(QDate::fromString(getAttribute(originNode, "date"), QLatin1String("yyyy-MM-dd")));
+                    journeyStart.setDate(ParserDateTime::dateFromIso(getAttribute(originNode, "date")));
                     journeyEnd.setDate(journeyStart.date());
-                    const QTime time = QTime::fromString(getAttribute(originNode, "time"), "hh:mm");
+                    const QTime time = ParserDateTime::timeFromString(getAttribute(originNode, "time"));
                     journeyStart.setTime(time);
                     if (i == 0) {
-                        const QDate date = QDate::fromString(getAttribute(originNode, "date"), QLatin1String("yyyy-MM-dd"));
+                        const QDate date = ParserDateTime::dateFromIso(getAttribute(originNode, "date"));
                         journeyResultList->setDepartureStation(getAttribute(originNode, "name"));
                         //: DATE, TIME
                         journeyResultList->setTimeInfo(tr("%1, %2", "DATE, TIME").arg(date.toString(Qt::DefaultLocaleShortDate)).arg(time.toString(Qt::DefaultLocaleShortDate)));
                     }
                 }
                 if (j == legNodeList.length() - 1) {
-                    journeyEnd.setTime(QTime::fromString(getAttribute(destinationNode, "time"), "hh:mm"));
+                    journeyEnd.setTime(ParserDateTime::timeFromString(getAttribute(destinationNode, "time")));
                     if (i == 0)
                         journeyResultList->setArrivalStation(getAttribute(destinationNode, "name"));
                 }
@@ -424,12 +425,12 @@ void ParserXmlVasttrafikSe::parseSearchJourney(QNetworkReply *networkReply)
                 jdrItem->setDepartureStation(getAttribute(originNode, "name"));
                 const QString depTrack = getAttribute(originNode, "track");
                 jdrItem->setDepartureInfo(depTrack.isEmpty() ? QChar(0x2014) : tr("Track %1").arg(depTrack));
-                const QDateTime scheduledDepartureTime = QDateTime::fromString(getAttribute(originNode, "date") + getAttribute(originNode, "time"), "yyyy-MM-ddhh:mm");
+                const QDateTime scheduledDepartureTime = QDateTime(ParserDateTime::dateFromIso(getAttribute(originNode, "date")), ParserDateTime::timeFromString(getAttribute(originNode, "time")));
                 jdrItem->setDepartureDateTime(scheduledDepartureTime);
                 jdrItem->setArrivalStation(getAttribute(destinationNode, "name"));
                 const QString arrTrack = getAttribute(destinationNode, "track");
                 jdrItem->setArrivalInfo(arrTrack.isEmpty() ? QChar(0x2014) : tr("Track %1").arg(arrTrack));
-                const QDateTime scheduledArrivalTime = QDateTime::fromString(getAttribute(destinationNode, "date") + getAttribute(destinationNode, "time"), "yyyy-MM-ddhh:mm");
+                const QDateTime scheduledArrivalTime = QDateTime(ParserDateTime::dateFromIso(getAttribute(destinationNode, "date")), ParserDateTime::timeFromString(getAttribute(destinationNode, "time")));
                 jdrItem->setArrivalDateTime(scheduledArrivalTime);
                 const QString direction = getAttribute(legNode, "direction");
                 if (!direction.isEmpty())
@@ -450,7 +451,7 @@ void ParserXmlVasttrafikSe::parseSearchJourney(QNetworkReply *networkReply)
 
                 const QString realTimeDeparture = getAttribute(originNode, "rtTime");
                 if (!realTimeDeparture.isEmpty()) {
-                    const QTime realTimeTime = QTime::fromString(realTimeDeparture, QLatin1String("hh:mm"));
+                    const QTime realTimeTime = ParserDateTime::timeFromString(realTimeDeparture);
                     const int minutesTo = scheduledDepartureTime.time().msecsTo(realTimeTime) / 60000;
                     if (minutesTo > 3) {
                         jdrItem->setDepartureInfo(jdrItem->departureInfo() + tr("<br/><span style=\"color:#b30;\">%1 min late</span>").arg(minutesTo));
@@ -465,7 +466,7 @@ void ParserXmlVasttrafikSe::parseSearchJourney(QNetworkReply *networkReply)
 
                 const QString realTimeArrival = getAttribute(destinationNode, "rtTime");
                 if (!realTimeArrival.isEmpty()) {
-                    const QTime realTimeTime = QTime::fromString(realTimeArrival, QLatin1String("hh:mm"));
+                    const QTime realTimeTime = ParserDateTime::timeFromString(realTimeArrival);
                     const int minutesTo = scheduledArrivalTime.time().msecsTo(realTimeTime) / 60000;
                     if (minutesTo > 3)
                         jdrItem->setArrivalInfo(jdrItem->arrivalInfo() + tr("<br/><span style=\"color:#b30;\">%1 min late</span>").arg(minutesTo));
@@ -577,20 +578,21 @@ void ParserXmlVasttrafikSe::requestNewAccessToken() {
 #else
     postData.append(m_deviceId.toAscii());
 #endif
-    QNetworkReply *reply = m_nam->post(request, postData);
+    // Not sent through NetworkManager, as the token reply must not end up
+    // in networkReplyFinished(..)
+    QNetworkReply *reply = FahrplanNetworkThread::post(request, postData, this);
     connect(reply, SIGNAL(finished()), this, SLOT(accessTokenRequestFinished()));
 }
 
 void ParserXmlVasttrafikSe::accessTokenRequestFinished() {
-     static const QRegExp accessTokenRE(QLatin1String("\"access_token\":\"([^\"]+)"));
-     static const QRegExp expiresInRE(QLatin1String("\"expires_in\":([1-9][0-9]*)"));
-
      QNetworkReply *reply = static_cast<QNetworkReply *>(sender());
      const QString rawText = QString::fromUtf8(reply->readAll().constData());
+     const QString accessToken = ParserRegExps::capture(ParserRegExps::VasttrafikAccessToken, rawText);
+     const QString expiresIn = ParserRegExps::capture(ParserRegExps::VasttrafikExpiresIn, rawText);
      bool ok = false;
-     if (reply->error() == QNetworkReply::NoError && accessTokenRE.indexIn(rawText) > 0 && expiresInRE.indexIn(rawText) > 0) {
-         m_accessToken = accessTokenRE.cap(1);
-         int expireIn = expiresInRE.cap(1).toInt(&ok);
+     if (reply->error() == QNetworkReply::NoError && !accessToken.isEmpty() && !expiresIn.isEmpty()) {
+         m_accessToken = accessToken;
+         int expireIn = expiresIn.toInt(&ok);
          if (ok && expireIn > 0) {
              m_accessTokenExpiration = QDateTime::currentDateTime().addSecs(expireIn - 5);
              qDebug() << "Got access token" << m_accessToken << "which expires in" << expireIn << "sec";
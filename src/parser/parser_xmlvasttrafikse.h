@@ -93,7 +93,6 @@ private:
 
     static const QString baseRestUrl;
     static const char *consumerCredentials;
-    QNetworkAccessManager *m_nam;
     QDateTime m_accessTokenExpiration;
     QString m_accessToken, m_deviceId;
 